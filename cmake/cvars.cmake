@@ -19,6 +19,12 @@ set(CVAR_MENU_BAR_OPEN "gOpenMenuBar" CACHE STRING "")
 set(CVAR_PREFIX_CONTROLLERS "gControllers" CACHE STRING "")
 set(CVAR_PREFIX_ADVANCED_RESOLUTION "gAdvancedResolution" CACHE STRING "")
 set(CVAR_AUDIO_CHANNELS_SETTING "gAudioChannelsSetting" CACHE STRING "")
+set(CVAR_DISPLAY_LIST_CULLING "gDisplayListCulling" CACHE STRING "")
+set(CVAR_ASYNC_SHADER_COMPILE "gAsyncShaderCompile" CACHE STRING "")
+set(CVAR_TEXTURE_STAGING_CAP "gTextureStagingCap" CACHE STRING "")
+set(CVAR_DRAW_QUEUE "gDrawQueue" CACHE STRING "")
+set(CVAR_RESOURCE_CACHE_BUDGET "gResourceCacheBudget" CACHE STRING "")
+set(CVAR_RESOURCE_PREFETCH_IN_FLIGHT "gResourcePrefetchInFlight" CACHE STRING "")
 
 add_compile_definitions(
 	CVAR_VSYNC_ENABLED="${CVAR_VSYNC_ENABLED}"
@@ -42,4 +48,10 @@ add_compile_definitions(
 	CVAR_PREFIX_CONTROLLERS="${CVAR_PREFIX_CONTROLLERS}"
 	CVAR_PREFIX_ADVANCED_RESOLUTION="${CVAR_PREFIX_ADVANCED_RESOLUTION}"
 	CVAR_AUDIO_CHANNELS_SETTING="${CVAR_AUDIO_CHANNELS_SETTING}"
+	CVAR_DISPLAY_LIST_CULLING="${CVAR_DISPLAY_LIST_CULLING}"
+	CVAR_ASYNC_SHADER_COMPILE="${CVAR_ASYNC_SHADER_COMPILE}"
+	CVAR_TEXTURE_STAGING_CAP="${CVAR_TEXTURE_STAGING_CAP}"
+	CVAR_DRAW_QUEUE="${CVAR_DRAW_QUEUE}"
+	CVAR_RESOURCE_CACHE_BUDGET="${CVAR_RESOURCE_CACHE_BUDGET}"
+	CVAR_RESOURCE_PREFETCH_IN_FLIGHT="${CVAR_RESOURCE_PREFETCH_IN_FLIGHT}"
 )
@@ -55,6 +55,8 @@ class Fast3dWindow : public Ship::Window {
     void SetRendererUCode(UcodeHandlers ucode);
     void EnableSRGBMode();
     bool DrawAndRunGraphicsCommands(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtxReplacements);
+    // Draws one interpolated frame, the table holds the replacements of every frame of the tick
+    bool DrawAndRunGraphicsCommands(Gfx* commands, const GfxMtxReplacementTable& mtxReplacements, size_t frame);
 
     std::weak_ptr<Interpreter> GetInterpreterWeak() const;
 
@@ -70,5 +72,6 @@ class Fast3dWindow : public Ship::Window {
     GfxRenderingAPI* mRenderingApi;
     GfxWindowBackend* mWindowManagerApi;
     std::shared_ptr<Interpreter> mInterpreter = nullptr;
+    GfxMtxReplacementTable mMtxReplacements;
 };
 } // namespace Fast
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace Fast {
+// 4x4 matrix kernels of the RSP matrix stack. Every implementation gives the same bits as the scalar one: they
+// evaluate in the scalar order with separate multiplies and adds, never fused ones.
+struct GfxMatrixKernels {
+    const char* Name;
+    // Converts an s15.16 fixed point Mtx, stored as the integer parts followed by the fractional parts
+    void (*UnpackFixed)(float res[4][4], const int32_t* addr);
+    // res = a * b, res can be a or b
+    void (*Mul)(float res[4][4], const float a[4][4], const float b[4][4]);
+    // Truncates every element to s15.16, as converting it to a fixed point Mtx and back would
+    void (*Quantize)(float res[4][4], const float m[4][4]);
+    // res = the upper 3x3 of m times v, which takes a direction from eye space back to model space
+    void (*TransposedMul)(float res[3], const float v[3], const float m[4][4]);
+};
+
+const GfxMatrixKernels& GfxMatrixScalarKernels();
+// The fastest kernels the CPU supports, chosen on the first call
+const GfxMatrixKernels& GfxMatrixGetKernels();
+// Every set of kernels the CPU supports, starting with the scalar ones
+std::vector<const GfxMatrixKernels*> GfxMatrixAvailableKernels();
+} // namespace Fast
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "fast/types.h"
+
+namespace Fast {
+// Matrices that replace the ones in game memory during Interpreter::Run, for every interpolated frame of a game tick.
+// The table is built once per tick: the addresses are sorted into a flat array shared by all the frames, and the
+// matrices are stored already quantized to s15.16 the way the RSP sees them.
+class GfxMtxReplacementTable {
+  public:
+    // Empties the table, keeping its storage
+    void Clear();
+    // Adds the replacements of the next interpolated frame and returns its index
+    size_t AddFrame(const std::unordered_map<Mtx*, MtxF>& replacements);
+    // Adds one replacement to a frame returned by AddFrame, a frame holds at most one per matrix
+    void Set(size_t frame, Mtx* mtx, const MtxF& mf);
+    // Sorts and quantizes everything added since Clear, call before the table is used
+    void Finish();
+
+    // Returns the quantized replacement of mtx in the frame, or nullptr when it has none
+    const MtxF* Find(size_t frame, const Mtx* mtx) const;
+
+    size_t GetFrameCount() const;
+    size_t GetMtxCount() const;
+    Mtx* GetMtx(size_t index) const;
+    // Replacement of the index-th matrix, nullptr when the frame has none
+    const MtxF* Get(size_t frame, size_t index) const;
+
+  private:
+    struct Entry {
+        Mtx* mtx;
+        uint32_t frame;
+        MtxF mf;
+    };
+
+    // Everything AddFrame and Set collected, turned into the arrays below by Finish
+    std::vector<Entry> mPending;
+    size_t mFrameCount = 0;
+
+    std::vector<Mtx*> mMtxs;
+    // mMtxs.size() matrices per frame
+    std::vector<MtxF> mMatrices;
+    std::vector<uint8_t> mPresent;
+};
+} // namespace Fast
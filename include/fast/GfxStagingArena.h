@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <mutex>
+
+namespace Fast {
+class GfxStagingArena;
+
+// A slice of a staging block, handed back to the arena when it goes out of scope
+class GfxStagingSlice {
+  public:
+    GfxStagingSlice() = default;
+    GfxStagingSlice(GfxStagingSlice&& other) noexcept;
+    GfxStagingSlice& operator=(GfxStagingSlice&& other) noexcept;
+    GfxStagingSlice(const GfxStagingSlice&) = delete;
+    GfxStagingSlice& operator=(const GfxStagingSlice&) = delete;
+    ~GfxStagingSlice();
+
+    uint8_t* Data() const;
+    size_t Size() const;
+    explicit operator bool() const;
+    uint8_t& operator[](size_t i) const;
+
+  private:
+    friend class GfxStagingArena;
+    GfxStagingSlice(GfxStagingArena* arena, uint8_t* data, size_t size, size_t blockSize);
+    void Release();
+
+    GfxStagingArena* mArena = nullptr;
+    uint8_t* mData = nullptr;
+    size_t mSize = 0;
+    size_t mBlockSize = 0;
+};
+
+// Scratch memory for texture imports. Every import gets a slice of exactly the size it asks for, backed by a cache
+// line aligned block that is kept for later imports of a similar size. Slices can be acquired from several threads
+// and held at the same time. The memory reserved by the arena, in use or not, never exceeds its capacity.
+class GfxStagingArena {
+  public:
+    static constexpr size_t Alignment = 64;
+
+    explicit GfxStagingArena(size_t capacity = 0);
+    ~GfxStagingArena();
+    GfxStagingArena(const GfxStagingArena&) = delete;
+    GfxStagingArena& operator=(const GfxStagingArena&) = delete;
+
+    // Returns an empty slice when the capacity does not allow it
+    GfxStagingSlice Acquire(size_t size);
+
+    // A capacity of 0 is unlimited
+    void SetCapacity(size_t capacity);
+    size_t GetCapacity() const;
+    // Bytes held by slices and by idle blocks
+    size_t GetReserved() const;
+    // Highest number of bytes held by slices at once
+    size_t GetPeakUsage() const;
+    // Frees the idle blocks
+    void Trim();
+
+  private:
+    friend class GfxStagingSlice;
+    void Release(uint8_t* data, size_t blockSize);
+    void FreeIdleBlocks(size_t needed);
+
+    mutable std::mutex mMutex;
+    // Idle blocks by size
+    std::multimap<size_t, uint8_t*> mIdleBlocks;
+    size_t mIdleBytes = 0;
+    size_t mUsedBytes = 0;
+    size_t mPeakUsage = 0;
+    size_t mCapacity = 0;
+};
+} // namespace Fast
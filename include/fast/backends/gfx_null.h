@@ -0,0 +1,113 @@
+#pragma once
+
+#include <map>
+#include "gfx_rendering_api.h"
+#include "gfx_window_manager_api.h"
+#include "../interpreter.h"
+
+namespace Fast {
+struct ShaderProgramNull {
+    uint8_t numInputs;
+    bool usedTextures[SHADER_MAX_TEXTURES];
+};
+
+// Rendering backend that accepts every call and draws nothing.
+// Used to measure the interpreter on its own, e.g. when replaying a frame capture.
+class GfxRenderingAPINull final : public GfxRenderingAPI {
+  public:
+    ~GfxRenderingAPINull() override = default;
+    const char* GetName() override;
+    int GetMaxTextureSize() override;
+    GfxClipParameters GetClipParameters() override;
+    void UnloadShader(ShaderProgram* oldPrg) override;
+    void LoadShader(ShaderProgram* newPrg) override;
+    ShaderProgram* CreateAndLoadNewShader(uint64_t shaderId0, uint32_t shaderId1) override;
+    ShaderProgram* LookupShader(uint64_t shaderId0, uint32_t shaderId1) override;
+    void ShaderGetInfo(ShaderProgram* prg, uint8_t* numInputs, bool usedTextures[2]) override;
+    uint32_t NewTexture() override;
+    void SelectTexture(int tile, uint32_t textureId) override;
+    void UploadTexture(const uint8_t* rgba32Buf, uint32_t width, uint32_t height) override;
+    void SetSamplerParameters(int sampler, bool linear_filter, uint32_t cms, uint32_t cmt) override;
+    void SetDepthTestAndMask(bool depth_test, bool z_upd) override;
+    void SetZmodeDecal(bool decal) override;
+    void SetViewport(int x, int y, int width, int height) override;
+    void SetScissor(int x, int y, int width, int height) override;
+    void SetUseAlpha(bool useAlpha) override;
+    void DrawTriangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) override;
+    void Init() override;
+    void OnResize() override;
+    void StartFrame() override;
+    void EndFrame() override;
+    void FinishRender() override;
+    int CreateFramebuffer() override;
+    void UpdateFramebufferParameters(int fb_id, uint32_t width, uint32_t height, uint32_t msaa_level,
+                                     bool opengl_invertY, bool render_target, bool has_depth_buffer,
+                                     bool can_extract_depth) override;
+    void StartDrawToFramebuffer(int fbId, float noiseScale) override;
+    void CopyFramebuffer(int fbDstId, int fbSrcId, int srcX0, int srcY0, int srcX1, int srcY1, int dstX0, int dstY0,
+                         int dstX1, int dstY1) override;
+    void ClearFramebuffer(bool color, bool depth) override;
+    void ReadFramebufferToCPU(int fbId, uint32_t width, uint32_t height, uint16_t* rgba16Buf) override;
+    void ResolveMSAAColorBuffer(int fbIdTarger, int fbIdSrc) override;
+    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
+    GetPixelDepth(int fb_id, const std::vector<std::pair<float, float>>& coordinates) override;
+    void* GetFramebufferTextureId(int fbId) override;
+    void SelectTextureFb(int fbId) override;
+    void DeleteTexture(uint32_t texId) override;
+    void SetTextureFilter(FilteringMode mode) override;
+    FilteringMode GetTextureFilter() override;
+    void SetSrgbMode() override;
+    ImTextureID GetTextureById(int id) override;
+
+  private:
+    std::map<std::pair<uint64_t, uint32_t>, ShaderProgramNull> mShaderProgramPool;
+    uint32_t mTextureCount = 0;
+    int mFramebufferCount = 1; // 0 is the default screen buffer
+    FilteringMode mCurrentFilterMode = FILTER_THREE_POINT;
+};
+
+// Window backend without a window. Dimensions are fixed at Init and frames are always ready.
+class GfxWindowBackendNull final : public GfxWindowBackend {
+  public:
+    GfxWindowBackendNull() = default;
+    ~GfxWindowBackendNull() override = default;
+
+    void Init(const char* gameName, const char* apiName, bool startFullScreen, uint32_t width, uint32_t height,
+              int32_t posX, int32_t posY) override;
+    void Close() override;
+    void SetKeyboardCallbacks(bool (*onKeyDown)(int scancode), bool (*onKeyUp)(int scancode),
+                              void (*onAllKeysUp)()) override;
+    void SetMouseCallbacks(bool (*onMouseButtonDown)(int btn), bool (*onMouseButtonUp)(int btn)) override;
+    void SetFullscreenChangedCallback(void (*onFullscreenChanged)(bool is_now_fullscreen)) override;
+    void SetFullscreen(bool fullscreen) override;
+    void GetActiveWindowRefreshRate(uint32_t* refreshRate) override;
+    void SetCursorVisibility(bool visability) override;
+    void SetMousePos(int32_t posX, int32_t posY) override;
+    void GetMousePos(int32_t* x, int32_t* y) override;
+    void GetMouseDelta(int32_t* x, int32_t* y) override;
+    void GetMouseWheel(float* x, float* y) override;
+    bool GetMouseState(uint32_t btn) override;
+    void SetMouseCapture(bool capture) override;
+    bool IsMouseCaptured() override;
+    void GetDimensions(uint32_t* width, uint32_t* height, int32_t* posX, int32_t* posY) override;
+    void HandleEvents() override;
+    bool IsFrameReady() override;
+    void SwapBuffersBegin() override;
+    void SwapBuffersEnd() override;
+    double GetTime() override;
+    int GetTargetFps() override;
+    void SetTargetFps(int fps) override;
+    void SetMaxFrameLatency(int latency) override;
+    const char* GetKeyName(int scancode) override;
+    bool CanDisableVsync() override;
+    bool IsRunning() override;
+    void Destroy() override;
+    bool IsFullscreen() override;
+
+  private:
+    uint32_t mWidth = 640;
+    uint32_t mHeight = 480;
+    int32_t mPosX = 0;
+    int32_t mPosY = 0;
+};
+} // namespace Fast
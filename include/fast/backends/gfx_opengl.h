@@ -38,6 +38,12 @@ struct ShaderProgram {
     GLint texture_width_location;
     GLint texture_height_location;
     GLint texture_filtering_location;
+    uint64_t shaderId0;
+    uint32_t shaderId1;
+    // Specialized program that is still compiling, the ubershader draws in its place until it has linked
+    GLuint pendingProgramId;
+    GLint uberCombiner[16];
+    GLint uberFlags;
 };
 
 struct FramebufferOGL {
@@ -49,6 +55,23 @@ struct FramebufferOGL {
     GLuint fbo, clrbuf, clrbufMsaa, rbo;
 };
 
+struct TexturePoolStatsOGL {
+    // Uploads that found a texture object of the right size, either already bound to the id or in the pool
+    uint64_t hits = 0;
+    // Uploads that had to allocate storage for a new texture object
+    uint64_t misses = 0;
+    uint64_t uploadBytes = 0;
+    // Texture objects waiting in the pool to be reused
+    size_t pooled = 0;
+};
+
+struct DrawStatsOGL {
+    // DrawTriangles calls, one per batch the interpreter flushed
+    uint64_t batches = 0;
+    // glDrawArrays calls they were merged into
+    uint64_t drawCalls = 0;
+};
+
 class GfxRenderingAPIOGL final : public GfxRenderingAPI {
   public:
     ~GfxRenderingAPIOGL() override = default;
@@ -86,7 +109,7 @@ class GfxRenderingAPIOGL final : public GfxRenderingAPI {
     void ReadFramebufferToCPU(int fbId, uint32_t width, uint32_t height, uint16_t* rgba16Buf) override;
     void ResolveMSAAColorBuffer(int fbIdTarger, int fbIdSrc) override;
     std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-    GetPixelDepth(int fb_id, const std::set<std::pair<float, float>>& coordinates) override;
+    GetPixelDepth(int fb_id, const std::vector<std::pair<float, float>>& coordinates) override;
     void* GetFramebufferTextureId(int fbId) override;
     void SelectTextureFb(int fbId) override;
     void DeleteTexture(uint32_t texId) override;
@@ -95,24 +118,68 @@ class GfxRenderingAPIOGL final : public GfxRenderingAPI {
     void SetSrgbMode() override;
     ImTextureID GetTextureById(int id) override;
 
+    const TexturePoolStatsOGL& GetTexturePoolStats() const;
+    const DrawStatsOGL& GetDrawStats() const;
+
   private:
     void SetUniforms(ShaderProgram* prg) const;
     std::string BuildFsShader(const CCFeatures& cc_features);
+    std::string BuildUberFsShader();
     void SetPerDrawUniforms();
+    void FlushDraws();
+    void SetupShaderProgram(ShaderProgram* prg, GLuint programId, const CCFeatures& ccFeatures);
+    bool CreateUberShader();
+    void SwapCompiledShaders();
+    GLuint AcquirePooledTexture(uint32_t width, uint32_t height);
+    void ReleasePooledTexture(GLuint texture, uint32_t width, uint32_t height);
 
+    // The ids handed out by NewTexture index this vector. Storage of a texture object never changes size, so an
+    // upload with different dimensions swaps the object for one of the new size and puts the old one in the pool.
     struct TextureInfo {
-        uint16_t width;
-        uint16_t height;
-        uint16_t filtering;
-    } textures[1024];
+        GLuint texture = 0;
+        uint16_t width = 0;
+        uint16_t height = 0;
+        uint16_t filtering = 0;
+        // Sampler state, restored when the object behind the id is swapped
+        GLint filter = GL_NEAREST;
+        GLint wrapS = GL_REPEAT;
+        GLint wrapT = GL_REPEAT;
+    };
+    std::vector<TextureInfo> mTextures;
+    std::vector<uint32_t> mFreeTextureIds;
+
+    // Unused texture objects by width and height
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<GLuint>> mTexturePool;
+    TexturePoolStatsOGL mTexturePoolStats;
+    // glTexStorage2D, with GL 4.2, GL_ARB_texture_storage or GLES 3
+    bool mTextureStorage = false;
 
-    GLuint mCurrentTextureIds[SHADER_MAX_TEXTURES];
-    uint8_t mCurrentTile;
+    GLuint mCurrentTextureIds[SHADER_MAX_TEXTURES] = {};
+    uint8_t mCurrentTile = 0;
 
     std::map<std::pair<uint64_t, uint32_t>, ShaderProgram> mShaderProgramPool;
-    ShaderProgram* mCurrentShaderProgram;
+    ShaderProgram* mCurrentShaderProgram = nullptr;
+
+    // Program with the combiner in uniforms, 0 until the first shader is created or when it failed to build
+    GLuint mUberProgram = 0;
+    bool mUberShaderFailed = false;
+    GLint mUberCombinerLocation = -1;
+    GLint mUberFlagsLocation = -1;
+    // GL_KHR_parallel_shader_compile or GL_ARB_parallel_shader_compile
+    bool mParallelShaderCompile = false;
+    std::vector<ShaderProgram*> mPendingShaderPrograms;
 
     GLuint mOpenglVbo = 0;
+    // Batches drawn with the same program, textures and fixed function state, submitted as one glDrawArrays by
+    // FlushDraws before any of that state changes
+    std::vector<float> mPendingVbo;
+    size_t mPendingNumTris = 0;
+    DrawStatsOGL mDrawStats;
+    // SelectTextureFb binds a framebuffer to unit 0 without changing mCurrentTextureIds
+    bool mTextureFbSelected = false;
+    int mViewport[4] = { -1, -1, -1, -1 };
+    int mScissor[4] = { -1, -1, -1, -1 };
+    bool mUseAlpha = false;
 #if defined(__APPLE__) || defined(USE_OPENGLES)
     GLuint mOpenglVao;
 #endif
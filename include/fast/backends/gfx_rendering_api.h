@@ -4,6 +4,7 @@
 
 #include <unordered_map>
 #include <set>
+#include <vector>
 #include "imconfig.h"
 
 namespace Fast {
@@ -63,8 +64,10 @@ class GfxRenderingAPI {
     virtual void ClearFramebuffer(bool color, bool depth) = 0;
     virtual void ReadFramebufferToCPU(int fbId, uint32_t width, uint32_t height, uint16_t* rgba16Buf) = 0;
     virtual void ResolveMSAAColorBuffer(int fbIdTarger, int fbIdSrc) = 0;
+    // The coordinates are unique. They used to come as a std::set, now the interpreter passes the std::vector it
+    // reuses every frame, so backends outside this tree have to change their override to match.
     virtual std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-    GetPixelDepth(int fb_id, const std::set<std::pair<float, float>>& coordinates) = 0;
+    GetPixelDepth(int fb_id, const std::vector<std::pair<float, float>>& coordinates) = 0;
     virtual void* GetFramebufferTextureId(int fbId) = 0;
     virtual void SelectTextureFb(int fbId) = 0;
     virtual void DeleteTexture(uint32_t texId) = 0;
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "gfx_rendering_api.h"
+#include "../interpreter.h"
+
+namespace Fast {
+struct ShaderProgramSoftware {
+    CCFeatures ccFeatures;
+    uint8_t numInputs;
+    bool usedTextures[SHADER_MAX_TEXTURES];
+    uint8_t numFloats;
+    // Offsets into a vertex of bufVbo, which uses the same layout as the OpenGL backend
+    uint8_t texCoordOffset[2];
+    int8_t texClampOffset[2][2];
+    int8_t fogOffset;
+    int8_t grayscaleOffset;
+    uint8_t inputOffset;
+};
+
+struct TextureSoftware {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+    bool linearFilter = false;
+    bool threePointFilter = false;
+    uint32_t cms = 0;
+    uint32_t cmt = 0;
+};
+
+// Rows are stored bottom to top, the same way OpenGL stores them
+struct FramebufferSoftware {
+    TextureSoftware color;
+    std::vector<float> depth;
+    bool hasDepthBuffer = false;
+    bool invertY = false;
+};
+
+// Rendering backend that rasterizes on the CPU and follows the OpenGL backend's conventions, so its output can be
+// used as a reference image on machines without a GPU. Every DrawTriangles call is binned into screen tiles which
+// are rasterized in parallel, tiles never share pixels so draw order is preserved within each of them.
+class GfxRenderingAPISoftware final : public GfxRenderingAPI {
+  public:
+    // A thread count of 0 uses one thread per hardware thread
+    explicit GfxRenderingAPISoftware(uint32_t threadCount = 0);
+    ~GfxRenderingAPISoftware() override;
+    const char* GetName() override;
+    int GetMaxTextureSize() override;
+    GfxClipParameters GetClipParameters() override;
+    void UnloadShader(ShaderProgram* oldPrg) override;
+    void LoadShader(ShaderProgram* newPrg) override;
+    ShaderProgram* CreateAndLoadNewShader(uint64_t shaderId0, uint32_t shaderId1) override;
+    ShaderProgram* LookupShader(uint64_t shaderId0, uint32_t shaderId1) override;
+    void ShaderGetInfo(ShaderProgram* prg, uint8_t* numInputs, bool usedTextures[2]) override;
+    uint32_t NewTexture() override;
+    void SelectTexture(int tile, uint32_t textureId) override;
+    void UploadTexture(const uint8_t* rgba32Buf, uint32_t width, uint32_t height) override;
+    void SetSamplerParameters(int sampler, bool linearFilter, uint32_t cms, uint32_t cmt) override;
+    void SetDepthTestAndMask(bool depthTest, bool zUpd) override;
+    void SetZmodeDecal(bool decal) override;
+    void SetViewport(int x, int y, int width, int height) override;
+    void SetScissor(int x, int y, int width, int height) override;
+    void SetUseAlpha(bool useAlpha) override;
+    void DrawTriangles(float bufVbo[], size_t bufVboLen, size_t bufVboNumTris) override;
+    void Init() override;
+    void OnResize() override;
+    void StartFrame() override;
+    void EndFrame() override;
+    void FinishRender() override;
+    int CreateFramebuffer() override;
+    void UpdateFramebufferParameters(int fbId, uint32_t width, uint32_t height, uint32_t msaaLevel, bool openglInvertY,
+                                     bool renderTarget, bool hasDepthBuffer, bool canExtractDepth) override;
+    void StartDrawToFramebuffer(int fbId, float noiseScale) override;
+    void CopyFramebuffer(int fbDstId, int fbSrcId, int srcX0, int srcY0, int srcX1, int srcY1, int dstX0, int dstY0,
+                         int dstX1, int dstY1) override;
+    void ClearFramebuffer(bool color, bool depth) override;
+    void ReadFramebufferToCPU(int fbId, uint32_t width, uint32_t height, uint16_t* rgba16Buf) override;
+    void ResolveMSAAColorBuffer(int fbIdTarget, int fbIdSrc) override;
+    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
+    GetPixelDepth(int fbId, const std::vector<std::pair<float, float>>& coordinates) override;
+    void* GetFramebufferTextureId(int fbId) override;
+    void SelectTextureFb(int fbId) override;
+    void DeleteTexture(uint32_t texId) override;
+    void SetTextureFilter(FilteringMode mode) override;
+    FilteringMode GetTextureFilter() override;
+    void SetSrgbMode() override;
+    ImTextureID GetTextureById(int id) override;
+
+    // Full precision access to a framebuffer for tools, returns nullptr for unknown ids
+    const FramebufferSoftware* GetFramebuffer(int fbId) const;
+
+  private:
+    struct RasterTriangle {
+        uint32_t v[3];
+        float area;
+        float depthOffset;
+        int minX, minY, maxX, maxY;
+    };
+
+    void Blit(int fbDstId, int fbSrcId, int srcX0, int srcY0, int srcX1, int srcY1, int dstX0, int dstY0, int dstX1,
+              int dstY1);
+    uint32_t PushVertex(const float* clipVertex);
+    void SetupTriangle(uint32_t i0, uint32_t i1, uint32_t i2);
+    void RasterizeTile(uint32_t tile);
+    void RasterizeTriangle(const RasterTriangle& tri, int minX, int minY, int maxX, int maxY);
+    bool ShadeFragment(const float* attribs, int x, int y, float out[4]) const;
+    void ProcessTiles();
+    void WorkerLoop();
+
+    std::unordered_map<uint32_t, TextureSoftware> mTextures;
+    uint32_t mNextTextureId = 1;
+    const TextureSoftware* mBoundTextures[SHADER_MAX_TEXTURES] = {};
+    uint32_t mCurrentTextureIds[SHADER_MAX_TEXTURES] = {};
+    int mCurrentTile = 0;
+
+    std::map<std::pair<uint64_t, uint32_t>, ShaderProgramSoftware> mShaderProgramPool;
+    ShaderProgramSoftware* mCurrentShaderProgram = nullptr;
+
+    // A deque keeps bound framebuffer textures valid when framebuffers are created
+    std::deque<FramebufferSoftware> mFrameBuffers;
+    int mCurrentFrameBuffer = 0;
+    int mViewport[4] = {};
+    int mScissor[4] = {};
+    bool mUseAlpha = false;
+    uint32_t mFrameCount = 0;
+    float mCurrentNoiseScale = 1.0f;
+    FilteringMode mCurrentFilterMode = FILTER_THREE_POINT;
+
+    // Per draw call data shared with the raster threads, vertices are post-clip with their attributes divided by w
+    std::vector<float> mVertices;
+    std::vector<RasterTriangle> mTriangles;
+    std::vector<std::vector<uint32_t>> mBins;
+    uint32_t mTilesX = 0;
+    uint32_t mTilesY = 0;
+    bool mDepthTest = false;
+    bool mDepthWrite = false;
+    bool mDepthLessEqual = false;
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mWorkMutex;
+    std::condition_variable mWorkCv;
+    std::condition_variable mDoneCv;
+    uint64_t mWorkGeneration = 0;
+    uint32_t mWorkersBusy = 0;
+    bool mStopWorkers = false;
+    std::atomic<uint32_t> mNextTile = 0;
+};
+} // namespace Fast
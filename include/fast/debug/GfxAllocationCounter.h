@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+namespace Fast {
+
+// Counts the heap allocations the calling thread makes between Start and Stop. The library does not replace the global
+// operator new, the program has to and set the source of the count; gfxreplay does in builds with
+// GFX_COUNT_ALLOCATIONS. Without a source it always counts 0.
+class GfxAllocationCounter {
+  public:
+    // Returns the number of allocations the calling thread has made so far
+    using Source = uint64_t (*)();
+
+    static void SetSource(Source source);
+    static bool IsAvailable();
+    static void Start();
+    // Returns the number of allocations made since Start
+    static uint64_t Stop();
+};
+
+} // namespace Fast
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "fast/types.h"
+#include "fast/GfxMtxReplacementTable.h"
+
+union Gfx;
+
+namespace Fast {
+class Interpreter;
+
+constexpr uint32_t GFX_CAPTURE_VERSION = 1;
+
+struct GfxCaptureFrameBuffer {
+    int id;
+    uint32_t origWidth, origHeight;
+    uint32_t nativeWidth, nativeHeight;
+    bool resize;
+};
+
+// Interpreter state at the start of the captured Run
+struct GfxCaptureSettings {
+    uint32_t ucode = 0;
+    uintptr_t root = 0;
+    uint32_t windowWidth = 0, windowHeight = 0;
+    uint32_t width = 0, height = 0;
+    int16_t viewportX = 0, viewportY = 0;
+    uint32_t viewportWidth = 0, viewportHeight = 0;
+    uint32_t nativeWidth = 0, nativeHeight = 0;
+    float internalMul = 1.0f;
+    uint32_t msaaLevel = 1;
+    std::vector<uintptr_t> segments;
+    std::vector<GfxCaptureFrameBuffer> frameBuffers;
+};
+
+// Records everything a single Interpreter::Run reads so the frame can be replayed without the game.
+// The capture is a zip archive holding a json header, the game memory the command stream touched and a copy of
+// every resource it loaded, so it can be mounted as a regular archive when replaying.
+class GfxCapture {
+  public:
+    void Start(const std::string& path, const GfxCaptureSettings& settings);
+    bool IsCapturing() const;
+    bool Finish(const GfxMtxReplacementTable& mtxReplacements, size_t frame);
+
+    void AddMemory(const void* addr, size_t size);
+    void AddString(const char* str);
+    void AddResource(const char* path);
+    void AddResource(uint64_t hash);
+
+  private:
+    bool mCapturing = false;
+    std::string mPath;
+    GfxCaptureSettings mSettings;
+    std::vector<std::pair<uintptr_t, size_t>> mRanges;
+    std::set<std::string> mResources;
+};
+
+// Loads a capture for replaying. Captured memory is mapped back at its original addresses so every pointer in the
+// command stream stays valid, Load should therefore run before the rest of the process allocates much memory.
+class GfxCaptureReplay {
+  public:
+    ~GfxCaptureReplay();
+
+    bool Load(const std::string& path);
+    const GfxCaptureSettings& GetSettings() const;
+    Gfx* GetDisplayList() const;
+    const std::unordered_map<Mtx*, MtxF>& GetMtxReplacements() const;
+
+    // Restores the dimensions and framebuffers of the captured game, call once after Interpreter::Init
+    void ApplySettings(Interpreter* interpreter) const;
+    // Restores the state the command stream expects at the start of a frame, call before every Run
+    void ApplyFrameState(Interpreter* interpreter) const;
+
+  private:
+    GfxCaptureSettings mSettings;
+    std::unordered_map<Mtx*, MtxF> mMtxReplacements;
+    std::vector<std::pair<void*, size_t>> mMappings;
+};
+
+} // namespace Fast
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 namespace Fast {
@@ -23,11 +24,19 @@ class GfxDebugger {
 
     void SetBreakPoint(const std::vector<const F3DGfx*>& bp);
 
+    // Writes a capture of the next frame to path
+    void RequestCapture(const std::string& path);
+    bool IsCaptureRequested() const;
+    const std::string& GetCapturePath() const;
+    void ClearCaptureRequest();
+
   private:
     bool mIsDebugging = false;
     bool mIsDebuggingRequested = false;
     F3DGfx* mDlist = nullptr;
     std::vector<const F3DGfx*> mBreakPoint = {};
+    bool mIsCaptureRequested = false;
+    std::string mCapturePath;
 };
 
 } // namespace Fast
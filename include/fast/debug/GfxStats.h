@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace Fast {
+union F3DGfx;
+
+struct GfxOpcodeStats {
+    uint64_t count = 0;
+    // Time spent in the opcode handler, in nanoseconds
+    uint64_t time = 0;
+};
+
+struct GfxDisplayListStats {
+    const F3DGfx* dlist = nullptr;
+    std::string name;
+    uint64_t calls = 0;
+    uint64_t commands = 0;
+    uint64_t time = 0;
+    uint64_t triangles = 0;
+    uint64_t vertices = 0;
+    uint64_t flushes = 0;
+    uint64_t textureImports = 0;
+    // Times the display list was skipped by frustum culling and the commands that were not run because of it
+    uint64_t culls = 0;
+    uint64_t culledCommands = 0;
+};
+
+// Collects per opcode and per display list costs for a single Interpreter::Run.
+// Display list costs are exclusive, i.e. work done by a called display list is not added to the caller.
+class GfxStats {
+  public:
+    void SetEnabled(bool enabled);
+    bool IsEnabled() const;
+
+    void StartFrame(const F3DGfx* root);
+    void EndFrame();
+
+    void PushDisplayList(const F3DGfx* dlist);
+    void BranchDisplayList(const F3DGfx* dlist);
+    void PopDisplayList();
+    void NameDisplayList(const F3DGfx* dlist, const char* name);
+
+    void AddCommand(int8_t opcode, uint64_t time);
+    void AddTriangle();
+    void AddVertices(size_t count);
+    void AddFlush();
+    void AddTextureImport();
+    // A nullptr dlist is the current display list ending early
+    void AddCulledDisplayList(const F3DGfx* dlist, size_t commands);
+
+    // Results of the last completed frame
+    const std::array<GfxOpcodeStats, 256>& GetOpcodeStats() const;
+    const std::vector<GfxDisplayListStats>& GetDisplayListStats() const;
+
+    bool DumpOpcodeCsv(const std::string& path) const;
+    bool DumpDisplayListCsv(const std::string& path) const;
+
+  private:
+    size_t GetDisplayList(const F3DGfx* dlist);
+    GfxDisplayListStats* Current();
+
+    bool mEnabled = false;
+    std::array<GfxOpcodeStats, 256> mOpcodes{};
+    std::vector<GfxDisplayListStats> mDisplayLists;
+    std::unordered_map<const F3DGfx*, size_t> mDisplayListIndex;
+    std::vector<size_t> mDisplayListStack;
+
+    std::array<GfxOpcodeStats, 256> mLastOpcodes{};
+    std::vector<GfxDisplayListStats> mLastDisplayLists;
+};
+
+} // namespace Fast
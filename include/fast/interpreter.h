@@ -9,6 +9,7 @@
 #include <vector>
 #include <stack>
 #include <string>
+#include <string_view>
 
 #include "fast/lus_gbi.h"
 #include "fast/types.h"
@@ -16,6 +17,11 @@
 #include "backends/gfx_rendering_api.h"
 
 #include "fast/resource/type/Texture.h"
+#include "fast/resource/type/DisplayList.h"
+#include "fast/debug/GfxStats.h"
+#include "fast/debug/GfxCapture.h"
+#include "fast/GfxStagingArena.h"
+#include "fast/GfxMtxReplacementTable.h"
 #include "ship/resource/Resource.h"
 
 // TODO figure out why changing these to 640x480 makes the game only render in a quarter of the window
@@ -131,8 +137,8 @@ class GfxWindowBackend;
 constexpr size_t MAX_SEGMENT_POINTERS = 16;
 
 struct GfxExecStack {
-    // This is a dlist stack used to handle dlist calls.
-    std::stack<F3DGfx*> cmd_stack = {};
+    // This is a dlist stack used to handle dlist calls. Backed by a vector so its storage is reused between frames.
+    std::stack<F3DGfx*, std::vector<F3DGfx*>> cmd_stack = {};
     // This is also a dlist stack but a std::vector is used to make it possible
     // to iterate on the elements.
     // The purpose of this is to identify an instruction at a poin in time
@@ -145,6 +151,13 @@ struct GfxExecStack {
     };
     // stack for OpenDisp/CloseDisps
     std::vector<CodeDisp> disp_stack{};
+    // Set while statistics are collected so calls, branches and returns can be attributed to a display list
+    GfxStats* stats = nullptr;
+    // Set while a frame capture is recorded so handlers can report the memory and resources they read
+    GfxCapture* capture = nullptr;
+    // Size of cmd_stack when a display list culled for being off screen was called, 0 outside of one. Its commands
+    // run for the state they set, its triangles and the ones of the lists it calls are skipped.
+    size_t culled_depth = 0;
 
     void start(F3DGfx* dlist);
     void stop();
@@ -160,6 +173,8 @@ struct GfxExecStack {
 struct XYWidthHeight {
     int16_t x, y;
     uint32_t width, height;
+
+    auto operator<=>(const XYWidthHeight&) const = default;
 };
 
 struct GfxDimensions {
@@ -218,6 +233,11 @@ struct RawTexMetadata {
     Fast::TextureType type;
 };
 
+struct MaskedTextureEntry {
+    uint8_t* mask;
+    uint8_t* replacementData;
+};
+
 struct ShaderMod {
     bool enabled = false;
     int16_t id;
@@ -233,6 +253,8 @@ struct RSP {
 
     float MP_matrix[4][4];
     float P_matrix[4][4];
+    // MP_matrix is out of date, see Interpreter::UpdateMPMatrix
+    bool mp_matrix_dirty;
 
     F3DLight_t lookat[2];
     F3DLight current_lights[MAX_LIGHTS + 1];
@@ -272,6 +294,8 @@ struct RDP {
         uint32_t line_size_bytes;
         uint32_t tex_flags;
         struct RawTexMetadata raw_tex_metadata;
+        // Registered mask and replacement of the texture, looked up when it is loaded
+        MaskedTextureEntry masked_texture;
         bool masked;
         bool blended;
     } loaded_texture[2];
@@ -331,6 +355,23 @@ struct ColorCombiner {
     uint8_t shader_input_mapping[2][7];
 };
 
+// What the rendering API has bound to a texture unit
+struct BoundTexture {
+    uint32_t texture_id;
+    bool bound;
+    bool from_fb; // texture_id is a framebuffer, bound with SelectTextureFb
+
+    auto operator<=>(const BoundTexture&) const = default;
+};
+
+// Sampler parameters are kept by the texture, not by the unit it is bound to
+struct TextureSampler {
+    bool linear_filter;
+    uint8_t cms, cmt;
+
+    auto operator<=>(const TextureSampler&) const = default;
+};
+
 struct RenderingState {
     uint8_t depth_test_and_mask; // 1: depth test, 2: depth mask
     bool decal_mode;
@@ -338,6 +379,59 @@ struct RenderingState {
     struct XYWidthHeight viewport, scissor;
     struct ShaderProgram* mShaderProgram;
     TextureCacheNode* mTextures[SHADER_MAX_TEXTURES];
+    BoundTexture mBoundTextures[SHADER_MAX_TEXTURES];
+};
+
+// State of a batch in the draw queue. Only opaque batches that test and write depth without decal mode are queued,
+// so this is what may still differ between them. Batches sort by it, so the order is shader, textures, samplers.
+struct QueuedDrawState {
+    struct ShaderProgram* prg;
+    BoundTexture textures[SHADER_MAX_TEXTURES];
+    TextureSampler samplers[SHADER_MAX_TEXTURES];
+    struct XYWidthHeight viewport, scissor;
+
+    auto operator<=>(const QueuedDrawState&) const = default;
+};
+
+struct QueuedDraw {
+    uint32_t state; // index in DrawQueue::states
+    uint32_t order; // position in the display list
+    size_t vbo_offset;
+    size_t vbo_len;
+    size_t num_tris;
+};
+
+// Batches whose order does not change the frame, held back until something that depends on the order comes up and
+// then submitted sorted by state, with neighbours of the same state merged into one draw
+struct DrawQueue {
+    std::vector<QueuedDrawState> states;
+    std::vector<QueuedDraw> draws;
+    std::vector<float> vbo;
+    // Gathers batches that are merged but not next to each other in vbo
+    std::vector<float> merged;
+
+    uint64_t queued_batches = 0;
+    uint64_t submitted_draws = 0;
+};
+
+// A framebuffer copy the display list asked for. It reaches the backend once something reads its destination or
+// draws to either framebuffer, and never when another copy overwrites its destination first.
+struct PendingFbCopy {
+    int dst_id;
+    int src_id;
+    XYWidthHeight src;
+    XYWidthHeight dst;
+};
+
+struct FbCopyStats {
+    // Copies the display lists asked for, and the ones that reached the backend
+    uint64_t requested = 0;
+    uint64_t performed = 0;
+    // Copies overwritten by a later one before anything read them, or of a region onto itself
+    uint64_t elided = 0;
+    // MSAA resolves of the game framebuffer, and the ones dropped because the frame was never presented
+    uint64_t resolves = 0;
+    uint64_t elided_resolves = 0;
 };
 
 struct FBInfo {
@@ -347,11 +441,6 @@ struct FBInfo {
     bool resize;                            // Scale to match the viewport
 };
 
-struct MaskedTextureEntry {
-    uint8_t* mask;
-    uint8_t* replacementData;
-};
-
 class Interpreter {
   public:
     Interpreter();
@@ -365,7 +454,10 @@ class Interpreter {
     void StartFrame();
     void RunGuiOnly();
     void Run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacements);
+    // Runs one interpolated frame of a tick, with the replacements of that frame in the table
+    void Run(Gfx* commands, const GfxMtxReplacementTable& mtxReplacements, size_t frame);
     void EndFrame();
+    GfxCaptureSettings GetCaptureSettings(Gfx* commands) const;
     void HandleWindowEvents();
     bool IsFrameReady();
     bool ViewportMatchesRendererResolution();
@@ -377,6 +469,12 @@ class Interpreter {
     void SetFrameBuffer(int fb, float noiseScale);
     void CopyFrameBuffer(int fb_dst_id, int fb_src_id, bool copyOnce, bool* hasCopiedPtr);
     void ResetFrameBuffer();
+    void StartDrawToFramebuffer(int fbId, float noiseScale);
+    // Performs the pending copies the contents of the framebuffer depend on, call before reading or drawing to it
+    void ResolveFbCopies(int fbId);
+    void ResolveAllFbCopies();
+    // The texture the frame was rendered to, resolving the game framebuffer first when it uses MSAA
+    uintptr_t GetGfxFrameBuffer();
     void AdjustPixelDepthCoordinates(float& x, float& y);
     void GetPixelDepthPrepare(float x, float y);
     uint16_t GetPixelDepth(float x, float y);
@@ -389,7 +487,17 @@ class Interpreter {
     void GetCurDimensions(uint32_t* width, uint32_t* height);
 
     // private: TODO make these private
+    // Draws the current batch and everything in the draw queue, call before anything that depends on draw order
     void Flush();
+    // Ends the current batch, it goes to the draw queue when it may be reordered
+    void FlushBatch();
+    bool CanQueueBatch() const;
+    void QueueBatch();
+    void DrawQueueSubmit();
+    void ApplyQueuedDrawState(const QueuedDrawState& state, const QueuedDrawState* prev, ShaderProgram*& loaded);
+    void BindTexture(int i, uint32_t textureId);
+    void BindTextureFb(uint32_t fbId);
+    void SetTextureSampler(int i, bool linearFilter, uint8_t cms, uint8_t cmt);
     ShaderProgram* LookupOrCreateShaderProgram(uint64_t id0, uint64_t id1);
     ColorCombiner* LookupOrCreateColorCombiner(const ColorCombinerKey& key);
     void TextureCacheClear();
@@ -408,6 +516,8 @@ class Interpreter {
     void ImportTextureImg(int tile, bool importReplacement);
     void ImportTexture(int i, int tile, bool importReplacement);
     void ImportTextureMask(int i, int tile);
+    void LookupMaskedTexture(uint32_t tmemIndex);
+    GfxStagingSlice AcquireTexUploadBuffer(size_t size);
     void CalculateNormalDir(const F3DLight_t*, float coeffs[3]);
 
     void GfxSpMatrix(uint8_t params, const int32_t* addr);
@@ -458,18 +568,23 @@ class Interpreter {
     float AdjXForAspectRatio(float x) const;
     void AdjustVIewportOrScissor(XYWidthHeight* area);
     void CalcAndSetViewport(const F3DVp_t* viewport);
-    int16_t CreateShader(const std::string& path);
+    int16_t CreateShader(std::string_view path);
 
     void SpReset();
     void* SegAddr(uintptr_t w1);
+    bool ResolveDisplayListBounds(DisplayList* dl, uint32_t depth);
+    std::shared_ptr<DisplayList> CullDisplayList(const F3DGfx* dlist, const DisplayListResourceRef& ref);
+    void CallDisplayList(F3DGfx* caller, F3DGfx* dlist, const DisplayListResourceRef& ref);
+    bool CullLoadedVertices(size_t start, size_t end);
 
     static const char* CCMUXtoStr(uint32_t ccmux);
     static const char* ACMUXtoStr(uint32_t acmux);
     static void GenerateCC(ColorCombiner* comb, const ColorCombinerKey& key);
-    static std::string GetBaseTexturePath(const std::string& path);
     static void NormalizeVector(float v[3]);
     static void TransposedMatrixMul(float res[3], const float a[3], const float b[4][4]);
     static void MatrixMul(float res[4][4], const float a[4][4], const float b[4][4]);
+    // Recomputes MP_matrix after the matrix commands that changed it
+    void UpdateMPMatrix();
 
     RSP* mRsp;
     RDP* mRdp;
@@ -478,7 +593,8 @@ class Interpreter {
     GfxTextureCache mTextureCache{};
     std::map<ColorCombinerKey, ColorCombiner> mColorCombinerPool; // color_combiner_pool;
     std::map<ColorCombinerKey, ColorCombiner>::iterator mPrevCombiner = mColorCombinerPool.end();
-    uint8_t* mTexUploadBuffer = nullptr;
+    // Scratch memory the texture importers decode into
+    GfxStagingArena mTexStagingArena;
 
     GfxDimensions mGfxCurrentWindowDimensions{}; // gfx_current_window_dimensions;
     int32_t mCurWindowPosX{};
@@ -495,6 +611,12 @@ class Interpreter {
     float* mBufVbo; // 3 vertices in a triangle and 32 floats per vtx
     size_t mBufVboLen{};
     size_t mBufVboNumTris{};
+    // Texture units the shader of the current batch samples, one bit per unit
+    uint8_t mBufVboTextures{};
+    bool mDrawQueueEnabled = false;
+    DrawQueue mDrawQueue;
+    // Sampler parameters last set on every texture, by texture id
+    std::vector<TextureSampler> mTextureSamplers;
     GfxWindowBackend* mWapi = nullptr;
     GfxRenderingAPI* mRapi = nullptr;
 
@@ -507,16 +629,44 @@ class Interpreter {
 
     int mGameFb{};             // game_framebuffer;
     int mGameFbMsaaResolved{}; // game_framebuffer_msaa_resolved;
-
-    std::set<std::pair<float, float>> mGetPixelDepthPending; // get_pixel_depth_pending;
-    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> mGetPixelDepthCached; // get_pixel_depth_cached;
-    std::map<std::string, MaskedTextureEntry> mMaskedTextures;
-
-    const std::unordered_map<Mtx*, MtxF>* mCurMtxReplacements;
+    // Framebuffer the display list draws to, 0 for the window
+    int mDrawFb{};
+    // In the order they were asked for, performed as a prefix so a copy always reads what it would have
+    std::vector<PendingFbCopy> mPendingFbCopies;
+    // The game framebuffer is resolved into mGameFbMsaaResolved when the frame is presented instead of after Run
+    bool mMsaaResolvePending = false;
+    FbCopyStats mFbCopyStats;
+
+    // Only a handful of coordinates are queried per frame, flat lists keep their storage between frames
+    std::vector<std::pair<float, float>> mGetPixelDepthPending;                     // get_pixel_depth_pending;
+    std::vector<std::pair<std::pair<float, float>, uint16_t>> mGetPixelDepthCached; // get_pixel_depth_cached;
+    // Keyed by the CRC64 of the texture path without the alt asset prefix
+    std::unordered_map<uint64_t, MaskedTextureEntry> mMaskedTextures;
+    // Changes whenever a blended texture is registered or unregistered, textures keep their lookup until then. Taken
+    // from a counter every interpreter shares, like the textures.
+    uint32_t mMaskedTexturesGeneration;
+
+    const GfxMtxReplacementTable* mCurMtxReplacements;
+    size_t mCurMtxReplacementFrame = 0;
+    // Built from the replacements passed as a map
+    GfxMtxReplacementTable mMtxReplacementTable;
     bool mMarkerOn; // This was originally a debug feature. Now it seems to control s2dex?
     std::vector<std::string> shader_ids;
+    std::map<std::string, int16_t, std::less<>> mShaderIdsByPath;
+    // ResourceManager::GetGeneration when mShaderIdsByPath was last checked
+    uint64_t mResourceGeneration = 0;
     int mInterpolationIndex;
     int mInterpolationIndexTarget;
+    GfxStats mStats;
+    GfxCapture mCapture;
+
+    // Runs the command loop instantiated for the current microcode instead of the generic one
+    bool mSpecializedDispatch = true;
+    // Heap allocations made by the last Run, only counted when the program gave GfxAllocationCounter a source
+    uint64_t mRunAllocations = 0;
+    bool mDisplayListCulling = false;
+    // Display list resources by their instructions, so lists called through a segment can be culled as well
+    std::unordered_map<const F3DGfx*, std::weak_ptr<DisplayList>> mCullDisplayLists;
 };
 
 void gfx_set_target_ucode(UcodeHandlers ucode);
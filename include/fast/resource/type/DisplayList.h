@@ -6,6 +6,25 @@
 #include <libultraship/libultra/gbi.h>
 
 namespace Fast {
+// A resource referenced by a display list, binary lists reference them by hash and xml lists by path
+struct DisplayListResourceRef {
+    uint64_t Hash = 0;
+    const char* Path = nullptr;
+};
+
+struct DisplayListVertexRef {
+    DisplayListResourceRef Resource;
+    // In bytes
+    size_t Offset;
+    size_t Count;
+};
+
+enum class DisplayListBoundsState {
+    Unresolved,
+    Unbounded,
+    Bounded,
+};
+
 class DisplayList final : public Ship::Resource<Gfx> {
   public:
     using Resource::Resource;
@@ -15,9 +34,27 @@ class DisplayList final : public Ship::Resource<Gfx> {
 
     Gfx* GetPointer() override;
     size_t GetPointerSize() override;
+    size_t GetMemorySize() override;
 
     UcodeHandlers UCode;
     std::vector<Gfx> Instructions;
     std::vector<char*> Strings;
+
+    // Filled in at load time. A list is cullable when everything it draws comes from the vertex resources and the
+    // display lists it references, and none of its commands change the transform. A culled list that changes render
+    // state still runs for it, only its triangles are skipped.
+    bool Cullable = false;
+    bool SetsState = false;
+    std::vector<DisplayListVertexRef> CullVertices;
+    std::vector<DisplayListResourceRef> CullChildren;
+
+    // Object space bounds of the list and its children, resolved by the interpreter the first time they are needed
+    DisplayListBoundsState BoundsState = DisplayListBoundsState::Unresolved;
+    float BoundsMin[3] = {};
+    float BoundsMax[3] = {};
+    // Commands skipped when the list is culled, including the ones of its children
+    size_t BoundsCommands = 0;
+    // Whether the list or one of its children changes render state
+    bool BoundsSetsState = false;
 };
 } // namespace Fast
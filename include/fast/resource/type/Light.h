@@ -57,6 +57,7 @@ class Light final : public Ship::Resource<LightEntry> {
 
     LightEntry* GetPointer();
     size_t GetPointerSize();
+    size_t GetMemorySize() override;
 
   private:
     LightEntry mLight;
@@ -12,6 +12,7 @@ class Matrix final : public Ship::Resource<Mtx> {
 
     Mtx* GetPointer() override;
     size_t GetPointerSize() override;
+    size_t GetMemorySize() override;
 
     Mtx Matrx;
 };
@@ -6,6 +6,8 @@
 #define TEX_FLAG_LOAD_AS_IMG (1 << 1)
 
 namespace Fast {
+struct MaskedTextureEntry;
+
 enum class TextureType {
     Error = 0,
     RGBA32bpp = 1,
@@ -27,6 +29,7 @@ class Texture final : public Ship::Resource<uint8_t> {
 
     uint8_t* GetPointer() override;
     size_t GetPointerSize() override;
+    size_t GetMemorySize() override;
 
     TextureType Type;
     uint16_t Width, Height;
@@ -35,6 +38,11 @@ class Texture final : public Ship::Resource<uint8_t> {
     float VPixelScale = 1.0;
     uint32_t ImageDataSize;
     uint8_t* ImageData = nullptr;
+    // CRC64 of the path without the alt asset prefix, which blended textures are registered by
+    uint64_t BasePathHash = 0;
+    // The blended texture registered for it, kept by the interpreter until the registrations change
+    const MaskedTextureEntry* BlendedTexture = nullptr;
+    uint32_t BlendedTextureGeneration = 0;
 
     ~Texture();
 };
@@ -14,6 +14,7 @@ class Vertex final : public Ship::Resource<Vtx> {
 
     Vtx* GetPointer() override;
     size_t GetPointerSize() override;
+    size_t GetMemorySize() override;
 
     std::vector<Vtx> VertexList;
 };
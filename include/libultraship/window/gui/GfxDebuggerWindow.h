@@ -24,6 +24,7 @@ class GfxDebuggerWindow : public Ship::GuiWindow {
   private:
     void DrawDisasNode(const Fast::F3DGfx* cmd, std::vector<const Fast::F3DGfx*>& gfxPath, float parentPosY) const;
     void DrawDisas();
+    void DrawStats();
 
   private:
     std::vector<const Fast::F3DGfx*> mLastBreakPoint = {};
@@ -31,8 +31,28 @@ struct ResourceInitData {
 };
 
 struct File {
+    // The contents of the file, without the OTR header once the resource loader has read it. nullptr only for files
+    // loaded through LoadFileInPlace that the archive could read where it keeps them.
     std::shared_ptr<std::vector<char>> Buffer;
+    // Set instead of Buffer by LoadFileInPlace: the contents are in memory that Mapping keeps alive, such as an entry
+    // stored uncompressed in a memory mapped archive. GetData and GetSize read either kind of file.
+    const char* Data = nullptr;
+    size_t Size = 0;
+    std::shared_ptr<const void> Mapping;
     std::variant<std::shared_ptr<tinyxml2::XMLDocument>, std::shared_ptr<BinaryReader>> Reader;
     bool IsLoaded = false;
+
+    const char* GetData() const {
+        if (Data != nullptr) {
+            return Data;
+        }
+        return Buffer != nullptr ? Buffer->data() : nullptr;
+    }
+    size_t GetSize() const {
+        if (Data != nullptr) {
+            return Size;
+        }
+        return Buffer != nullptr ? Buffer->size() : 0;
+    }
 };
 } // namespace Ship
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#define BS_THREAD_POOL_ENABLE_PRIORITY
+#define BS_THREAD_POOL_ENABLE_PAUSE
+#include <BS_thread_pool.hpp>
+
+namespace Ship {
+
+struct PrefetchEntry {
+    // CRC64 of the resource path, the way archives hash them
+    uint64_t Hash;
+    // Size of the file in the archive
+    uint32_t Size;
+};
+
+// The order resources were first loaded in, grouped by the area that was marked before them. Areas keep the order
+// they were first marked in and a resource is only recorded once per area.
+class PrefetchManifest {
+  public:
+    static constexpr uint32_t MAGIC = 0x4650534C; // "LSPF"
+    static constexpr uint32_t VERSION = 0;
+
+    // Loads recorded from now on belong to the area, marking it again appends to what it already has
+    void MarkArea(const std::string& area);
+    void Record(uint64_t hash, size_t size);
+    void Clear();
+
+    // A copy of the entries of the area, empty when it was never marked
+    std::vector<PrefetchEntry> GetArea(const std::string& area) const;
+    size_t GetAreaCount() const;
+    size_t GetEntryCount() const;
+
+    std::vector<char> Serialize() const;
+    bool Deserialize(const char* data, size_t size);
+    bool Save(const std::string& filePath) const;
+    bool Load(const std::string& filePath);
+
+  private:
+    struct Area {
+        std::string Name;
+        std::vector<PrefetchEntry> Entries;
+        std::unordered_set<uint64_t> Recorded;
+    };
+
+    Area& GetOrAddArea(const std::string& area);
+
+    mutable std::mutex mMutex;
+    std::vector<Area> mAreas;
+    std::unordered_map<std::string, size_t> mAreaIndices;
+    // Loads recorded before any area was marked go to the unnamed one
+    size_t mCurrentArea = SIZE_MAX;
+};
+
+// Runs a list of prefetch entries on a thread pool at low priority, in order, without letting the files being loaded
+// add up to more than a number of bytes. One entry is always let through, even when it is bigger than that.
+class ResourcePrefetcher {
+  public:
+    // load is called on the pool for every entry and returns once the resource is cached
+    ResourcePrefetcher(std::shared_ptr<BS::thread_pool> threadPool, std::function<void(uint64_t hash)> load);
+    ~ResourcePrefetcher();
+
+    // Replaces whatever had not started yet with the entries
+    void Start(const std::vector<PrefetchEntry>& entries, size_t maxInFlightBytes);
+    // Drops the entries that have not started yet, the ones loading finish
+    void Stop();
+    // Blocks until every entry has loaded or was stopped
+    void Wait();
+    size_t GetPendingCount();
+    size_t GetInFlightBytes();
+
+  private:
+    // Takes the entries that fit next to the ones loading, with mMutex held
+    std::vector<PrefetchEntry> TakeStartable();
+    void Submit(const std::vector<PrefetchEntry>& entries);
+
+    std::shared_ptr<BS::thread_pool> mThreadPool;
+    std::function<void(uint64_t hash)> mLoad;
+    std::mutex mMutex;
+    std::condition_variable mIdle;
+    std::deque<PrefetchEntry> mPending;
+    size_t mMaxInFlightBytes = 0;
+    size_t mInFlightBytes = 0;
+    size_t mInFlightCount = 0;
+};
+} // namespace Ship
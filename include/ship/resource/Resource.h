@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include "ship/resource/File.h"
 
 namespace Ship {
@@ -14,14 +15,22 @@ class IResource {
 
     virtual void* GetRawPointer() = 0;
     virtual size_t GetPointerSize() = 0;
+    // Bytes the resource holds on to, counted against the resource cache budget. The data behind the pointer unless
+    // the type holds more than that.
+    virtual size_t GetMemorySize();
 
     bool IsDirty();
     void Dirty();
+    // Keeps the resource in the cache until it is unloaded. Whoever takes a raw pointer into a resource pins it, the
+    // cache cannot tell when such a pointer is dropped.
+    void Pin();
+    bool IsPinned();
     std::shared_ptr<ResourceInitData> GetInitData();
 
   private:
     std::shared_ptr<ResourceInitData> mInitData;
     bool mIsDirty = false;
+    std::atomic<bool> mIsPinned = false;
 };
 
 template <class T> class Resource : public IResource {
@@ -0,0 +1,444 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Ship {
+class Archive;
+
+struct ResourceIdentifier {
+    friend struct ResourceIdentifierHash;
+
+    ResourceIdentifier(const std::string& path, const uintptr_t owner, const std::shared_ptr<Archive> parent);
+    bool operator==(const ResourceIdentifier& rhs) const;
+
+    // Must be an exact path. Passing a path with a wildcard will return a fail state
+    const std::string Path = "";
+    const uintptr_t Owner = 0;
+    const std::shared_ptr<Archive> Parent = nullptr;
+
+    static size_t CalculateHash(std::string_view path, uintptr_t owner, const Archive* parent);
+
+  private:
+    size_t GetHash() const;
+    size_t mHash;
+};
+
+// Finds the line of an identifier without copying its path or its parent, the path has to outlive the lookup
+struct ResourceIdentifierView {
+    ResourceIdentifierView(std::string_view path, uintptr_t owner, const Archive* parent);
+    explicit ResourceIdentifierView(const ResourceIdentifier& identifier);
+
+    std::string_view Path;
+    uintptr_t Owner;
+    const Archive* Parent;
+    size_t Hash;
+};
+
+struct ResourceIdentifierHash {
+    using is_transparent = void;
+
+    size_t operator()(const ResourceIdentifier& rcd) const;
+    size_t operator()(const ResourceIdentifierView& rcd) const;
+};
+
+struct ResourceIdentifierEqual {
+    using is_transparent = void;
+
+    bool operator()(const ResourceIdentifier& lhs, const ResourceIdentifier& rhs) const;
+    bool operator()(const ResourceIdentifier& lhs, const ResourceIdentifierView& rhs) const;
+    bool operator()(const ResourceIdentifierView& lhs, const ResourceIdentifier& rhs) const;
+};
+
+struct ResourceCacheStats {
+    size_t Lines;
+    size_t Bytes;
+    size_t Budget;
+    uint64_t Evictions;
+    uint64_t EvictedBytes;
+    // Lines set again after they were evicted
+    uint64_t Reloads;
+};
+
+// Cache lines by resource identifier, split into shards that each have their own lock. Lookups only take their
+// shard's lock shared, so they never wait on each other and only wait on a writer that touches the same shard.
+//
+// Every line counts the bytes it was set with against an optional budget. Evict drops the lines that were used the
+// longest ago until the cache fits in it again. A line found during the current frame is never evicted, whoever found
+// it may still be holding a raw pointer into it.
+//
+// Every shard links its lines from the least to the most recently used one. Lookups cannot relink them under a shared
+// lock, so the first lookup of a frame pushes the line on a lock free list instead, and whoever locks the shard
+// exclusively next moves the lines on it to the newest end. Eviction only walks the lines it evicts, and lines it finds
+// pinned leave the list for good.
+template <typename T> class ResourceCache {
+  public:
+    static constexpr size_t SHARD_BITS = 6;
+    static constexpr size_t SHARD_COUNT = 1 << SHARD_BITS;
+
+    // Copies the line of the identifier into value, false when there is none. A ResourceIdentifierView finds it
+    // without allocating.
+    template <typename Identifier> bool Find(const Identifier& identifier, T& value) const {
+        const Shard& shard = GetShard(identifier);
+        const std::shared_lock<std::shared_mutex> lock(shard.Mutex);
+        auto it = shard.Lines.find(identifier);
+        if (it == shard.Lines.end()) {
+            return false;
+        }
+        value = it->second.Value;
+        // Only the first hit of a frame writes to the line
+        const uint32_t frame = mFrame.load(std::memory_order_relaxed);
+        if (it->second.LastUsed.load(std::memory_order_relaxed) != frame) {
+            it->second.LastUsed.store(frame, std::memory_order_relaxed);
+            PushUsed(shard, it->second);
+        }
+        return true;
+    }
+
+    bool Contains(const ResourceIdentifier& identifier) const {
+        const Shard& shard = GetShard(identifier);
+        const std::shared_lock<std::shared_mutex> lock(shard.Mutex);
+        return shard.Lines.contains(identifier);
+    }
+
+    void Set(const ResourceIdentifier& identifier, T value, size_t bytes = 0) {
+        Shard& shard = GetShard(identifier);
+        T replaced;
+        {
+            const std::unique_lock<std::shared_mutex> lock(shard.Mutex);
+            LinkUsedLines(shard);
+            auto [it, inserted] = shard.Lines.try_emplace(identifier);
+            if (!inserted) {
+                mBytes -= it->second.Bytes;
+                replaced = std::move(it->second.Value);
+            }
+            it->second.Value = std::move(value);
+            it->second.Bytes = bytes;
+            SetUsed(shard, it);
+            mBytes += bytes;
+        }
+
+        if (mEvictedCount.load(std::memory_order_relaxed) != 0) {
+            const std::lock_guard<std::mutex> lock(mEvictedMutex);
+            if (mEvicted.erase(ResourceIdentifierHash()(identifier)) != 0) {
+                mEvictedCount--;
+                mReloads++;
+            }
+        }
+    }
+
+    struct BatchLine {
+        const ResourceIdentifier* Identifier;
+        T* Value;
+        size_t Bytes;
+    };
+
+    // Sets every line in one pass over the shards, locking each of them once. When keep accepts the value already
+    // cached for an identifier, that one stays and is copied into the batch instead.
+    template <typename Keep> void SetBatch(const std::vector<BatchLine>& lines, Keep keep) {
+        std::array<std::vector<const BatchLine*>, SHARD_COUNT> shardLines;
+        for (const BatchLine& line : lines) {
+            shardLines[GetShardIndex(*line.Identifier)].push_back(&line);
+        }
+
+        std::vector<T> replaced;
+        for (size_t i = 0; i < SHARD_COUNT; i++) {
+            if (shardLines[i].empty()) {
+                continue;
+            }
+            Shard& shard = mShards[i];
+            const std::unique_lock<std::shared_mutex> lock(shard.Mutex);
+            LinkUsedLines(shard);
+            for (const BatchLine* line : shardLines[i]) {
+                auto [it, inserted] = shard.Lines.try_emplace(*line->Identifier);
+                if (!inserted) {
+                    if (keep(it->second.Value)) {
+                        *line->Value = it->second.Value;
+                        continue;
+                    }
+                    mBytes -= it->second.Bytes;
+                    replaced.push_back(std::move(it->second.Value));
+                }
+                it->second.Value = *line->Value;
+                it->second.Bytes = line->Bytes;
+                SetUsed(shard, it);
+                mBytes += line->Bytes;
+            }
+        }
+
+        if (mEvictedCount.load(std::memory_order_relaxed) != 0) {
+            const std::lock_guard<std::mutex> lock(mEvictedMutex);
+            for (const BatchLine& line : lines) {
+                if (mEvicted.erase(ResourceIdentifierHash()(*line.Identifier)) != 0) {
+                    mEvictedCount--;
+                    mReloads++;
+                }
+            }
+        }
+    }
+
+    // Removes the line of the identifier. What it held is destroyed after the shard is unlocked, resources may load
+    // or unload others when they go away.
+    bool Erase(const ResourceIdentifier& identifier) {
+        Shard& shard = GetShard(identifier);
+        T erased;
+        {
+            const std::unique_lock<std::shared_mutex> lock(shard.Mutex);
+            auto it = shard.Lines.find(identifier);
+            if (it == shard.Lines.end()) {
+                return false;
+            }
+            // The line may still be waiting to be relinked
+            LinkUsedLines(shard);
+            erased = std::move(it->second.Value);
+            mBytes -= it->second.Bytes;
+            if (IsLinked(shard, it->second)) {
+                Unlink(shard, it->second);
+            }
+            shard.Lines.erase(it);
+        }
+        return true;
+    }
+
+    size_t GetSize() const {
+        size_t size = 0;
+        for (const Shard& shard : mShards) {
+            const std::shared_lock<std::shared_mutex> lock(shard.Mutex);
+            size += shard.Lines.size();
+        }
+        return size;
+    }
+
+    // In bytes, 0 for no budget
+    void SetBudget(size_t budget) {
+        mBudget = budget;
+    }
+
+    // Lines found from now on are used in a new frame, the ones found before can be evicted
+    void AdvanceFrame() {
+        mFrame.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Moves the least recently used lines canEvict accepts into evicted until the cache fits in its budget, and
+    // returns how many it evicted. The caller destroys them once nothing is locked.
+    template <typename Predicate> size_t Evict(Predicate canEvict, std::vector<T>& evicted) {
+        return Evict(canEvict, [](const T&) { return false; }, evicted);
+    }
+
+    // Like above, and the lines isPinned accepts are never looked at again until they are set anew
+    template <typename Predicate, typename PinnedPredicate>
+    size_t Evict(Predicate canEvict, PinnedPredicate isPinned, std::vector<T>& evicted) {
+        const size_t budget = mBudget.load();
+        if (budget == 0 || mBytes.load() <= budget) {
+            return 0;
+        }
+
+        // The least recently used line is at the head of one of the shards. The first pass only finds the frame it
+        // was last used in, every pass after it evicts the lines last used in that frame and finds the next one.
+        const uint32_t frame = mFrame.load(std::memory_order_relaxed);
+        size_t count = 0;
+        std::optional<uint32_t> evicting;
+        do {
+            std::optional<uint32_t> oldest;
+            for (Shard& shard : mShards) {
+                if (evicting.has_value() && mBytes.load() <= budget) {
+                    break;
+                }
+                const std::unique_lock<std::shared_mutex> lock(shard.Mutex);
+                LinkUsedLines(shard);
+                Line* line = FindEvictable(shard, frame, canEvict, isPinned);
+                for (; line != nullptr && evicting == line->Linked && mBytes.load() > budget;
+                     line = FindEvictable(shard, frame, canEvict, isPinned)) {
+                    const size_t hash = ResourceIdentifierHash()(*line->Identifier);
+                    evicted.push_back(std::move(line->Value));
+                    mBytes -= line->Bytes;
+                    mEvictedBytes += line->Bytes;
+                    Unlink(shard, *line);
+                    shard.Lines.erase(shard.Lines.find(*line->Identifier));
+                    count++;
+
+                    const std::lock_guard<std::mutex> evictedLock(mEvictedMutex);
+                    if (mEvicted.insert(hash).second) {
+                        mEvictedCount++;
+                    }
+                }
+                // Frames are counted with wrapping, so they are compared by their difference
+                if (line != nullptr && (!oldest.has_value() || (int32_t)(*oldest - line->Linked) > 0)) {
+                    oldest = line->Linked;
+                }
+            }
+            evicting = oldest;
+        } while (evicting.has_value() && mBytes.load() > budget);
+
+        mEvictions += count;
+        return count;
+    }
+
+    ResourceCacheStats GetStats() const {
+        return { GetSize(), mBytes.load(), mBudget.load(), mEvictions.load(), mEvictedBytes.load(), mReloads.load() };
+    }
+
+  private:
+    struct Line {
+        T Value;
+        size_t Bytes = 0;
+        mutable std::atomic<uint32_t> LastUsed = 0;
+        // The frame the line was last used in when it was linked where it is, the list is in that order
+        uint32_t Linked = 0;
+        Line* Older = nullptr;
+        Line* Newer = nullptr;
+        // The key of the line in its shard's map
+        const ResourceIdentifier* Identifier = nullptr;
+        // Pinned lines are left out of the list until they are set again
+        bool Pinned = false;
+        // Whether the line is on its shard's list of lines used since the shard was last locked exclusively
+        mutable std::atomic<bool> Used = false;
+        mutable Line* NextUsed = nullptr;
+    };
+
+    // Every shard starts on its own cache line so that locking one does not slow down its neighbours
+    struct alignas(64) Shard {
+        mutable std::shared_mutex Mutex;
+        std::unordered_map<ResourceIdentifier, Line, ResourceIdentifierHash, ResourceIdentifierEqual> Lines;
+        Line* Oldest = nullptr;
+        Line* Newest = nullptr;
+        // The lines found since the shard was last locked exclusively, the most recent first
+        mutable std::atomic<Line*> Used = nullptr;
+    };
+
+    // Called with the shard locked shared, so only other lookups can push at the same time
+    static void PushUsed(const Shard& shard, const Line& line) {
+        if (line.Used.exchange(true, std::memory_order_relaxed)) {
+            return;
+        }
+        Line* head = shard.Used.load(std::memory_order_relaxed);
+        do {
+            line.NextUsed = head;
+        } while (!shard.Used.compare_exchange_weak(head, const_cast<Line*>(&line), std::memory_order_release,
+                                                   std::memory_order_relaxed));
+    }
+
+    static bool IsLinked(const Shard& shard, const Line& line) {
+        return line.Older != nullptr || shard.Oldest == &line;
+    }
+
+    static void Unlink(Shard& shard, Line& line) {
+        (line.Older != nullptr ? line.Older->Newer : shard.Oldest) = line.Newer;
+        (line.Newer != nullptr ? line.Newer->Older : shard.Newest) = line.Older;
+        line.Older = nullptr;
+        line.Newer = nullptr;
+    }
+
+    static void LinkNewest(Shard& shard, Line& line, uint32_t frame) {
+        // Lines are linked in the order they were last used in, so this only keeps the list ordered when frames were
+        // read out of order by racing threads
+        if (shard.Newest != nullptr && (int32_t)(shard.Newest->Linked - frame) > 0) {
+            frame = shard.Newest->Linked;
+        }
+        line.Linked = frame;
+        line.Older = shard.Newest;
+        (shard.Newest != nullptr ? shard.Newest->Newer : shard.Oldest) = &line;
+        shard.Newest = &line;
+    }
+
+    // Moves the lines found since the shard was last locked exclusively to its newest end, in the order they were
+    // last used in. Needs the shard locked exclusively.
+    static void LinkUsedLines(Shard& shard) {
+        Line* line = shard.Used.exchange(nullptr, std::memory_order_acquire);
+        if (line == nullptr) {
+            return;
+        }
+        std::vector<Line*> used;
+        for (; line != nullptr; line = line->NextUsed) {
+            used.push_back(line);
+        }
+        // They were pushed the most recent first, and a line found again in a later frame was not pushed again
+        std::reverse(used.begin(), used.end());
+        std::stable_sort(used.begin(), used.end(), [](const Line* a, const Line* b) {
+            return (int32_t)(a->LastUsed.load(std::memory_order_relaxed) -
+                             b->LastUsed.load(std::memory_order_relaxed)) < 0;
+        });
+        for (Line* usedLine : used) {
+            usedLine->NextUsed = nullptr;
+            usedLine->Used.store(false, std::memory_order_relaxed);
+            if (usedLine->Pinned) {
+                continue;
+            }
+            Unlink(shard, *usedLine);
+            LinkNewest(shard, *usedLine, usedLine->LastUsed.load(std::memory_order_relaxed));
+        }
+    }
+
+    // Links a line that was just set as the most recently used one of its shard
+    template <typename Iterator> void SetUsed(Shard& shard, Iterator it) {
+        const uint32_t frame = mFrame.load(std::memory_order_relaxed);
+        Line& line = it->second;
+        line.LastUsed.store(frame, std::memory_order_relaxed);
+        line.Identifier = &it->first;
+        line.Pinned = false;
+        if (IsLinked(shard, line)) {
+            Unlink(shard, line);
+        }
+        LinkNewest(shard, line, frame);
+    }
+
+    // The least recently used line of the shard if it was not used in this frame and canEvict accepts it, lines it
+    // does not accept are moved to the newest end on the way and pinned ones are taken out of the list. Needs the
+    // shard locked exclusively with its used lines linked.
+    template <typename Predicate, typename PinnedPredicate>
+    static Line* FindEvictable(Shard& shard, uint32_t frame, Predicate& canEvict, PinnedPredicate& isPinned) {
+        while (shard.Oldest != nullptr && (int32_t)(frame - shard.Oldest->Linked) > 0) {
+            Line* line = shard.Oldest;
+            if (isPinned(line->Value)) {
+                Unlink(shard, *line);
+                line->Pinned = true;
+                continue;
+            }
+            if (canEvict(line->Value)) {
+                return line;
+            }
+            Unlink(shard, *line);
+            LinkNewest(shard, *line, frame);
+        }
+        return nullptr;
+    }
+
+    // The maps pick buckets from the low bits of the hash, the shard comes from the high bits of a mix of it
+    template <typename Identifier> static size_t GetShardIndex(const Identifier& identifier) {
+        const uint64_t hash = ResourceIdentifierHash()(identifier);
+        return (size_t)((hash * 0x9e3779b97f4a7c15ull) >> (64 - SHARD_BITS));
+    }
+
+    Shard& GetShard(const ResourceIdentifier& identifier) {
+        return mShards[GetShardIndex(identifier)];
+    }
+
+    template <typename Identifier> const Shard& GetShard(const Identifier& identifier) const {
+        return mShards[GetShardIndex(identifier)];
+    }
+
+    std::array<Shard, SHARD_COUNT> mShards;
+    std::atomic<uint32_t> mFrame = 0;
+    std::atomic<size_t> mBytes = 0;
+    std::atomic<size_t> mBudget = 0;
+    std::atomic<uint64_t> mEvictions = 0;
+    std::atomic<uint64_t> mEvictedBytes = 0;
+    std::atomic<uint64_t> mReloads = 0;
+
+    // Hashes of the identifiers evicted and not set again since, to count reloads without copying the identifiers
+    std::mutex mEvictedMutex;
+    std::unordered_set<size_t> mEvicted;
+    std::atomic<size_t> mEvictedCount = 0;
+};
+} // namespace Ship
@@ -3,12 +3,16 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
+#include <string_view>
 #include <list>
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include <queue>
 #include <variant>
 #include "ship/resource/Resource.h"
+#include "ship/resource/ResourceCache.h"
+#include "ship/resource/PrefetchManifest.h"
 #include "ship/resource/ResourceLoader.h"
 #include "ship/resource/archive/Archive.h"
 #include "ship/resource/archive/ArchiveManager.h"
@@ -30,25 +34,10 @@ struct ResourceFilter {
     const std::shared_ptr<Archive> Parent = nullptr;
 };
 
-struct ResourceIdentifier {
-    friend struct ResourceIdentifierHash;
-
-    ResourceIdentifier(const std::string& path, const uintptr_t owner, const std::shared_ptr<Archive> parent);
-    bool operator==(const ResourceIdentifier& rhs) const;
-
-    // Must be an exact path. Passing a path with a wildcard will return a fail state
-    const std::string Path = "";
-    const uintptr_t Owner = 0;
-    const std::shared_ptr<Archive> Parent = nullptr;
-
-  private:
-    size_t GetHash() const;
-    size_t CalculateHash();
-    size_t mHash;
-};
-
-struct ResourceIdentifierHash {
-    size_t operator()(const ResourceIdentifier& rcd) const;
+// Counts the resources of a batch as they load, can be read from any thread while it runs
+struct ResourceLoadProgress {
+    std::atomic<size_t> Total = 0;
+    std::atomic<size_t> Loaded = 0;
 };
 
 class ResourceManager {
@@ -68,6 +57,9 @@ class ResourceManager {
 
     std::shared_ptr<IResource> GetCachedResource(const std::string& filePath, bool loadExact = false);
     std::shared_ptr<IResource> GetCachedResource(const ResourceIdentifier& identifier, bool loadExact = false);
+    // The resource LoadResource would return if it is cached, found without copying the path or queueing anything.
+    // nullptr when it has to be loaded.
+    std::shared_ptr<IResource> FindCachedResource(std::string_view filePath, bool loadExact = false);
     std::shared_ptr<IResource> LoadResource(const std::string& filePath, bool loadExact = false,
                                             std::shared_ptr<ResourceInitData> initData = nullptr);
     std::shared_ptr<IResource> LoadResource(const ResourceIdentifier& identifier, bool loadExact = false,
@@ -90,9 +82,11 @@ class ResourceManager {
     std::shared_ptr<std::vector<std::shared_ptr<IResource>>> LoadResources(const std::string& searchMask);
     std::shared_ptr<std::vector<std::shared_ptr<IResource>>> LoadResources(const ResourceFilter& filter);
     std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<IResource>>>>
-    LoadResourcesAsync(const std::string& searchMask, BS::priority_t priority = BS::pr::normal);
+    LoadResourcesAsync(const std::string& searchMask, BS::priority_t priority = BS::pr::normal,
+                       std::shared_ptr<ResourceLoadProgress> progress = nullptr);
     std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<IResource>>>>
-    LoadResourcesAsync(const ResourceFilter& filter, BS::priority_t priority = BS::pr::normal);
+    LoadResourcesAsync(const ResourceFilter& filter, BS::priority_t priority = BS::pr::normal,
+                       std::shared_ptr<ResourceLoadProgress> progress = nullptr);
 
     void DirtyResources(const std::string& searchMask);
     void DirtyResources(const ResourceFilter& filter);
@@ -100,6 +94,9 @@ class ResourceManager {
     void UnloadResources(const ResourceFilter& filter);
     void UnloadResourcesAsync(const std::string& searchMask, BS::priority_t priority = BS::pr::normal);
     void UnloadResourcesAsync(const ResourceFilter& filter, BS::priority_t priority = BS::pr::normal);
+    // Changes whenever resources are unloaded or dirtied and whenever the archives change, so that what is cached
+    // outside of the resource manager can be dropped
+    uint64_t GetGeneration();
 
     bool OtrSignatureCheck(const char* fileName);
     bool IsAltAssetsEnabled();
@@ -115,12 +112,35 @@ class ResourceManager {
     bool GetResourceIsCustom(const char* name);
     bool GetResourceIsCustom(uint64_t crc);
 
+    // Pins the resource, the pointer stays valid until the resource is unloaded
     void* GetResourceRawPointer(std::shared_ptr<IResource> resource);
     void* GetResourceRawPointer(const char* name);
     void* GetResourceRawPointer(uint64_t crc);
 
+    // Call once per presented frame. Evicts the least recently used resources that nothing else references and that
+    // are not pinned until the cache fits in the CVAR_RESOURCE_CACHE_BUDGET megabytes, keeping every resource used
+    // during the frame, then starts the next one. Raw pointers taken through GetResourceRawPointer or by the
+    // interpreter pin their resource, so eviction never frees memory a pointer is still into.
+    void EndFrame();
+    ResourceCacheStats GetCacheStats();
+
+    // Records the resources loaded on demand from now on, in the order they are first loaded after each area marker
+    void StartPrefetchRecording();
+    void StopPrefetchRecording();
+    bool SavePrefetchManifest(const std::string& filePath);
+    // Prefetches the resources the manifest lists for every area marked from now on
+    bool LoadPrefetchManifest(const std::string& filePath);
+    // Call when the game starts loading an area. Drops what the last area still had to prefetch and starts on the
+    // thread pool with the resources this one loaded when it was recorded, keeping at most
+    // CVAR_RESOURCE_PREFETCH_IN_FLIGHT megabytes of files loading at once.
+    void MarkPrefetchArea(const std::string& area);
+    std::shared_ptr<PrefetchManifest> GetPrefetchRecording();
+
   protected:
-    std::shared_ptr<std::vector<std::shared_ptr<IResource>>> LoadResourcesProcess(const ResourceFilter& filter);
+    // Splits the matching files into chunks that the calling thread and the thread pool load together, grouped by
+    // archive and in the order each archive stores them. Everything loaded is cached in one pass at the end.
+    std::shared_ptr<std::vector<std::shared_ptr<IResource>>>
+    LoadResourcesProcess(const ResourceFilter& filter, std::shared_ptr<ResourceLoadProgress> progress = nullptr);
     void UnloadResourcesProcess(const ResourceFilter& filter);
     std::variant<ResourceLoadError, std::shared_ptr<IResource>> CheckCache(const ResourceIdentifier& identifier,
                                                                            bool loadExact = false);
@@ -128,18 +148,34 @@ class ResourceManager {
                                                                            bool loadExact = false);
 
     std::shared_ptr<IResource> GetCachedResource(std::variant<ResourceLoadError, std::shared_ptr<IResource>> cacheLine);
+    std::shared_ptr<IResource> FindCachedResource(const ResourceIdentifierView& identifier, bool loadExact);
+    // LoadResource without copying the path on a hit
+    std::shared_ptr<IResource> LoadResourceByPath(std::string_view filePath, bool loadExact = false,
+                                                  std::shared_ptr<ResourceInitData> initData = nullptr);
+    // The misses of LoadResource and LoadResourceAsync, which already looked the resource up in the cache
+    std::shared_ptr<IResource> LoadUncachedResource(const ResourceIdentifier& identifier, bool loadExact,
+                                                    std::shared_ptr<ResourceInitData> initData);
+    std::shared_future<std::shared_ptr<IResource>> QueueResourceLoad(const ResourceIdentifier& identifier,
+                                                                     bool loadExact, BS::priority_t priority,
+                                                                     std::shared_ptr<ResourceInitData> initData);
 
   private:
-    std::unordered_map<ResourceIdentifier, std::variant<ResourceLoadError, std::shared_ptr<IResource>>,
-                       ResourceIdentifierHash>
-        mResourceCache;
+    struct ResourceBatch;
+    void LoadResourceBatchChunks(std::shared_ptr<ResourceBatch> batch);
+
+    ResourceCache<std::variant<ResourceLoadError, std::shared_ptr<IResource>>> mResourceCache;
     std::shared_ptr<ResourceLoader> mResourceLoader;
     std::shared_ptr<ArchiveManager> mArchiveManager;
     std::shared_ptr<BS::thread_pool> mThreadPool;
-    std::mutex mMutex;
     bool mAltAssetsEnabled = false;
     // Private information for which owner and archive are default.
     uintptr_t mDefaultCacheOwner = 0;
     std::shared_ptr<Archive> mDefaultCacheArchive = nullptr;
+    std::atomic<uint64_t> mUnloadGeneration = 0;
+    std::atomic<bool> mIsRecordingPrefetch = false;
+    std::shared_ptr<PrefetchManifest> mPrefetchRecording = std::make_shared<PrefetchManifest>();
+    std::shared_ptr<PrefetchManifest> mPrefetchManifest = nullptr;
+    // Last so that it is destroyed first, its tasks load through everything above
+    std::unique_ptr<ResourcePrefetcher> mPrefetcher;
 };
 } // namespace Ship
@@ -16,6 +16,7 @@ namespace Ship {
 
 struct File;
 struct ResourceInitData;
+class ArchiveIndex;
 
 class Archive : public std::enable_shared_from_this<Archive> {
     friend class ArchiveManager;
@@ -31,6 +32,12 @@ class Archive : public std::enable_shared_from_this<Archive> {
 
     virtual std::shared_ptr<File> LoadFile(const std::string& filePath) = 0;
     virtual std::shared_ptr<File> LoadFile(uint64_t hash) = 0;
+    // Like LoadFile, but the archive may skip copying the contents into Buffer and point Data at where it keeps them.
+    // Archives that cannot do that load the file as LoadFile does.
+    virtual std::shared_ptr<File> LoadFileInPlace(uint64_t hash);
+    // Where the file is stored in the archive, loading files in this order reads the archive front to back. 0 when
+    // the archive does not know.
+    virtual uint64_t GetFileOffset(uint64_t hash);
     std::shared_ptr<std::unordered_map<uint64_t, std::string>> ListFiles();
     std::shared_ptr<std::unordered_map<uint64_t, std::string>> ListFiles(const std::string& filter);
     bool HasFile(const std::string& filePath);
@@ -48,6 +55,8 @@ class Archive : public std::enable_shared_from_this<Archive> {
     void SetLoaded(bool isLoaded);
     void SetGameVersion(uint32_t gameVersion);
     void IndexFile(const std::string& filePath);
+    // Indexes every file of the index without hashing their paths again
+    void IndexFiles(const ArchiveIndex& index);
 
   private:
     bool mIsLoaded;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Ship {
+
+// The paths of an archive with their CRC64 hashes, stored inside it so that opening the archive does not have to hash
+// every path. Entries are sorted by hash and name their file by its index in the archive, with the paths in a string
+// table after them. The fingerprint ties the index to the state of the archive it was built for, archives compare it
+// with their own before they use the index.
+//
+// Layout, little endian: magic, version, fingerprint (u64), entry count, string table size, the entries and the
+// string table.
+class ArchiveIndex {
+  public:
+    static constexpr const char* PATH = "__index";
+    static constexpr uint32_t MAGIC = 0x5849534C; // "LSIX"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 24;
+
+    struct Entry {
+        uint64_t Hash;
+        uint32_t NameOffset;
+        uint32_t NameLength;
+        uint64_t Index;
+    };
+    static_assert(sizeof(Entry) == 24, "Entries are copied straight from the index");
+
+    // The fingerprint of an MPQ archive, the CRC64 of the paths in its list file without the index itself. Hashing the
+    // list file is much cheaper than hashing every path on its own.
+    static uint64_t HashListFile(std::string_view listFile);
+
+    // Files are paths with their index in the archive
+    static std::vector<char> Build(const std::vector<std::pair<std::string, uint64_t>>& files, uint64_t fingerprint);
+
+    // Copies the entries and the string table out of the data. Fails on anything that does not look like an index
+    // this version wrote, the entries have to be in order and their names inside the string table.
+    bool Parse(const char* data, size_t size);
+
+    uint64_t GetFingerprint() const;
+    const std::vector<Entry>& GetEntries() const;
+    std::string_view GetName(const Entry& entry) const;
+
+  private:
+    uint64_t mFingerprint = 0;
+    std::vector<Entry> mEntries;
+    std::string mNames;
+};
+} // namespace Ship
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <vector>
@@ -30,6 +31,8 @@ class ArchiveManager {
     bool IsLoaded();
     std::shared_ptr<File> LoadFile(const std::string& filePath);
     std::shared_ptr<File> LoadFile(uint64_t hash);
+    std::shared_ptr<File> LoadFileInPlace(const std::string& filePath);
+    std::shared_ptr<File> LoadFileInPlace(uint64_t hash);
     bool WriteFile(std::shared_ptr<Archive> archive, const std::string& filename, const std::vector<uint8_t>& data);
     bool HasFile(const std::string& filePath);
     bool HasFile(uint64_t hash);
@@ -43,6 +46,8 @@ class ArchiveManager {
     const std::string* HashToString(uint64_t hash) const;
     const char* HashToCString(uint64_t hash) const;
     bool IsGameVersionValid(uint32_t gameVersion);
+    // Changes whenever an archive is added, removed or written to
+    uint64_t GetGeneration() const;
 
   protected:
     static std::vector<std::string> GetArchiveListInPaths(const std::vector<std::string>& archivePaths);
@@ -56,5 +61,6 @@ class ArchiveManager {
     std::unordered_map<uint64_t, std::string> mHashes;
     std::unordered_set<std::string> mDirectories;
     std::unordered_map<uint64_t, std::shared_ptr<Archive>> mFileToArchive;
+    std::atomic<uint64_t> mGeneration = 0;
 };
 } // namespace Ship
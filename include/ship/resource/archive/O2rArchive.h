@@ -4,13 +4,16 @@
 
 #include <string>
 #include <stdint.h>
-#include <string>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 #include "zip.h"
 
 #include "ship/resource/File.h"
 #include "ship/resource/Resource.h"
 #include "ship/resource/archive/Archive.h"
+#include "ship/resource/archive/ZipDirectory.h"
 
 namespace Ship {
 struct File;
@@ -26,8 +29,31 @@ class O2rArchive final : virtual public Archive {
 
     std::shared_ptr<File> LoadFile(const std::string& filePath);
     std::shared_ptr<File> LoadFile(uint64_t hash);
+    // Entries stored uncompressed are read straight from the mapped archive. On Windows the archive cannot be written
+    // to while such files are alive.
+    std::shared_ptr<File> LoadFileInPlace(uint64_t hash) override;
+    uint64_t GetFileOffset(uint64_t hash) override;
+    // Whether Open took the paths from the index in the archive rather than hashing them
+    bool IsIndexed();
 
   private:
-    zip_t* mZipArchive;
+    std::shared_ptr<File> LoadHashedFile(uint64_t hash, bool inPlace);
+    std::shared_ptr<File> LoadEntry(const ZipDirectory::Entry& entry, bool inPlace);
+    std::shared_ptr<File> LoadZipEntry(zip_t* zipArchive, zip_int64_t index, const std::string& description);
+    std::shared_ptr<File> LoadZipFile(const std::string& filePath);
+    // A read only libzip handle for the calling thread to use until it releases it, libzip handles cannot be shared
+    // between threads. Released handles are kept for the next load, up to one per hardware thread.
+    zip_t* AcquireReadHandle();
+    void ReleaseReadHandle(zip_t* zipArchive);
+    void CloseReadHandles();
+
+    // Only used for writing
+    zip_t* mZipArchive = nullptr;
+    // Reads entries straight from the mapped archive, libzip is left for writing and the entries it cannot read
+    ZipDirectory mDirectory;
+    // Loads hold it shared, opening, closing and writing the archive hold it exclusively
+    std::shared_mutex mMutex;
+    std::mutex mReadHandlesMutex;
+    std::vector<zip_t*> mIdleReadHandles;
 };
 } // namespace Ship
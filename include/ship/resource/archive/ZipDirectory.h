@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ship/resource/archive/ArchiveIndex.h"
+
+namespace Ship {
+// A file mapped read only into memory, unmapped when the last reference to it goes away
+class MappedFile {
+  public:
+    ~MappedFile();
+
+    static std::shared_ptr<MappedFile> Open(const std::string& path);
+
+    const char* GetData() const;
+    size_t GetSize() const;
+
+  private:
+    MappedFile() = default;
+
+    const char* mData = nullptr;
+    size_t mSize = 0;
+#ifdef _WIN32
+    void* mFileHandle = nullptr;
+    void* mMappingHandle = nullptr;
+#endif
+};
+
+// The entries of a memory mapped zip file, read from its central directory once and found by the CRC64 of their name.
+// Nothing changes after Open, so any number of threads can look entries up and read them at the same time. When the
+// archive carries an ArchiveIndex that matches its central directory, the hashes are taken from it.
+class ZipDirectory {
+  public:
+    struct Entry {
+        // Position in the central directory, which is also the index libzip gives the entry
+        uint64_t Index;
+        uint64_t LocalHeaderOffset;
+        uint64_t CompressedSize;
+        uint64_t Size;
+        uint32_t Crc32;
+        uint16_t Method;
+        bool Encrypted;
+    };
+
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const;
+
+    const Entry* Find(uint64_t hash) const;
+    size_t GetEntryCount() const;
+    // The entry as stored in the archive, nullptr when its local header does not fit in the file
+    const char* GetEntryData(const Entry& entry) const;
+    // Decompresses a deflated entry into dest, which has room for entry.Size bytes, and checks it against its CRC32
+    bool Inflate(const Entry& entry, char* dest) const;
+    // Whether the entry.Size bytes at data are what the archive stored for the entry
+    static bool CheckCrc32(const Entry& entry, const char* data);
+    // Keeps the entries returned by GetEntryData alive after Close
+    const std::shared_ptr<MappedFile>& GetMapping() const;
+    // The index the entries were found through, nullptr when the archive has none or it did not match
+    const std::shared_ptr<ArchiveIndex>& GetIndex() const;
+
+  private:
+    bool ReadCentralDirectory();
+    bool ReadIndex(const std::vector<Entry>& records, const std::vector<std::string_view>& names, size_t fileCount);
+
+    std::shared_ptr<MappedFile> mMapping;
+    std::shared_ptr<ArchiveIndex> mIndex;
+    std::unordered_map<uint64_t, Entry> mEntries;
+};
+} // namespace Ship
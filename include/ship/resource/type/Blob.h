@@ -11,6 +11,7 @@ class Blob final : public Ship::Resource<void> {
 
     void* GetPointer() override;
     size_t GetPointerSize() override;
+    size_t GetMemorySize() override;
 
     std::vector<uint8_t> Data;
 };
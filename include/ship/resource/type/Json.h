@@ -13,6 +13,7 @@ class Json final : public Resource<void> {
 
     void* GetPointer() override;
     size_t GetPointerSize() override;
+    size_t GetMemorySize() override;
 
     nlohmann::json Data;
     size_t DataSize;
@@ -11,6 +11,7 @@ class Shader final : public Resource<void> {
 
     void* GetPointer() override;
     size_t GetPointerSize() override;
+    size_t GetMemorySize() override;
 
     std::string Data;
 };
@@ -90,4 +90,22 @@
 
 extern uint64_t update_crc64(const void* buf, uint32_t len, uint64_t crc);
 extern uint64_t crc64(const void* buf, uint32_t len);
-extern uint64_t CRC64(const char* t);
\ No newline at end of file
+extern uint64_t CRC64(const char* t);
+
+#ifdef __cplusplus
+#include <stddef.h>
+#include <vector>
+
+// Ways of computing the CRC64 above, every one of them gives the same results as the byte at a time table walk
+struct Crc64Kernel {
+    const char* Name;
+    // Advances crc over len bytes, without the final inversion update_crc64 applies
+    uint64_t (*Update)(uint64_t crc, const void* buf, size_t len);
+};
+
+const Crc64Kernel& Crc64TableKernel();
+// The fastest kernel the CPU supports, chosen on the first call
+const Crc64Kernel& Crc64GetKernel();
+// Every kernel the CPU supports, starting with the table walk
+std::vector<const Crc64Kernel*> Crc64AvailableKernels();
+#endif
@@ -2,8 +2,10 @@
 
 #include <string>
 #include <memory>
+#include <type_traits>
 #include <vector>
 #include "endianness.h"
+#include "ByteSwap.h"
 #include "Stream.h"
 
 class BinaryReader;
@@ -23,6 +25,7 @@ class BinaryReader {
 
     void Seek(int32_t offset, SeekOffsetType seekType);
     uint32_t GetBaseAddress();
+    uint64_t GetLength();
 
     void Read(int32_t length);
     void Read(char* buffer, int32_t length);
@@ -40,6 +43,29 @@ class BinaryReader {
     std::string ReadString();
     std::string ReadCString();
 
+    // Read count values with one stream read and swap them to the native byte order all at once. Unlike ReadFloat and
+    // ReadDouble, NaNs are returned as they are.
+    template <typename T> void ReadArray(T* dest, size_t count) {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "ReadArray reads numbers");
+        mStream->Read((char*)dest, count * sizeof(T));
+        if (mEndianness == Endianness::Native) {
+            return;
+        }
+        if constexpr (sizeof(T) == 2) {
+            ByteSwapArray16(dest, count);
+        } else if constexpr (sizeof(T) == 4) {
+            ByteSwapArray32(dest, count);
+        } else if constexpr (sizeof(T) == 8) {
+            ByteSwapArray64(dest, count);
+        }
+    }
+
+    template <typename T> std::vector<T> ReadArray(size_t count) {
+        std::vector<T> result(count);
+        ReadArray(result.data(), count);
+        return result;
+    }
+
     std::vector<char> ToVector();
 
   protected:
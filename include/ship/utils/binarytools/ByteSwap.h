@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace Ship {
+// Reverse the bytes of count 16, 32 or 64 bit values in place, several values at a time where the CPU allows it.
+// The data does not have to be aligned.
+void ByteSwapArray16(void* data, size_t count);
+void ByteSwapArray32(void* data, size_t count);
+void ByteSwapArray64(void* data, size_t count);
+} // namespace Ship
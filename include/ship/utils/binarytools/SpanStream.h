@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Stream.h"
+
+namespace Ship {
+// Reads bytes it does not own, like a file buffer or a view into a mapped archive, without copying them first.
+// The owner is only held to keep the bytes alive. Writing to the stream throws.
+class SpanStream final : public Stream {
+  public:
+    SpanStream(const char* data, size_t size, std::shared_ptr<const void> owner = nullptr);
+
+    uint64_t GetLength() override;
+
+    void Seek(int32_t offset, SeekOffsetType seekType) override;
+
+    std::unique_ptr<char[]> Read(size_t length) override;
+    void Read(const char* dest, size_t length) override;
+    int8_t ReadByte() override;
+
+    void Write(char* srcBuffer, size_t length) override;
+    void WriteByte(int8_t value) override;
+
+    std::vector<char> ToVector() override;
+
+    void Flush() override;
+    void Close() override;
+
+  private:
+    const char* mData;
+    size_t mSize;
+    std::shared_ptr<const void> mOwner;
+};
+} // namespace Ship
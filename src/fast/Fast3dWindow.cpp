@@ -1,6 +1,7 @@
 #include "fast/Fast3dWindow.h"
 
 #include "ship/Context.h"
+#include "ship/resource/ResourceManager.h"
 #include "ship/config/Config.h"
 #include "ship/controller/controldeck/ControlDeck.h"
 #include "ship/config/ConsoleVariable.h"
@@ -170,12 +171,21 @@ void Fast3dWindow::RunGuiOnly() {
     mInterpreter->RunGuiOnly();
 }
 
+// Once per presented frame rather than per interpreter run, interpolated frames run the interpreter several times
+static void EndResourceFrame() {
+    auto resourceManager = Ship::Context::GetInstance()->GetResourceManager();
+    if (resourceManager != nullptr) {
+        resourceManager->EndFrame();
+    }
+}
+
 void Fast3dWindow::StartFrame() {
     mInterpreter->StartFrame();
 }
 
 void Fast3dWindow::EndFrame() {
     mInterpreter->EndFrame();
+    EndResourceFrame();
 }
 
 bool Fast3dWindow::IsFrameReady() {
@@ -183,6 +193,14 @@ bool Fast3dWindow::IsFrameReady() {
 }
 
 bool Fast3dWindow::DrawAndRunGraphicsCommands(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtxReplacements) {
+    mMtxReplacements.Clear();
+    mMtxReplacements.AddFrame(mtxReplacements);
+    mMtxReplacements.Finish();
+    return DrawAndRunGraphicsCommands(commands, mMtxReplacements, 0);
+}
+
+bool Fast3dWindow::DrawAndRunGraphicsCommands(Gfx* commands, const GfxMtxReplacementTable& mtxReplacements,
+                                              size_t frame) {
     std::shared_ptr<Window> wnd = Ship::Context::GetInstance()->GetWindow();
 
     // Skip dropped frames
@@ -196,11 +214,12 @@ bool Fast3dWindow::DrawAndRunGraphicsCommands(Gfx* commands, const std::unordere
     // Setup game framebuffers to match available window space
     mInterpreter->StartFrame();
     // Execute the games gfx commands
-    mInterpreter->Run(commands, mtxReplacements);
+    mInterpreter->Run(commands, mtxReplacements, frame);
     // Renders the game frame buffer to the final window and finishes the GUI
     gui->EndDraw();
     // Finalize swap buffers
     mInterpreter->EndFrame();
+    EndResourceFrame();
 
     return true;
 }
@@ -324,7 +343,7 @@ bool Fast3dWindow::IsRunning() {
 }
 
 uintptr_t Fast3dWindow::GetGfxFrameBuffer() {
-    return mInterpreter->mGfxFrameBuffer;
+    return mInterpreter->GetGfxFrameBuffer();
 }
 
 const char* Fast3dWindow::GetKeyName(int32_t scancode) {
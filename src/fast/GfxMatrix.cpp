@@ -0,0 +1,241 @@
+#include "fast/GfxMatrix.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GFX_MATRIX_SSE2
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define GFX_TARGET_AVX
+#else
+#define GFX_TARGET_AVX __attribute__((target("avx")))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define GFX_MATRIX_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Fast {
+
+static void UnpackFixedScalar(float res[4][4], const int32_t* addr) {
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j += 2) {
+            int32_t int_part = addr[i * 2 + j / 2];
+            uint32_t frac_part = addr[8 + i * 2 + j / 2];
+            res[i][j] = (int32_t)((int_part & 0xffff0000) | (frac_part >> 16)) / 65536.0f;
+            res[i][j + 1] = (int32_t)((int_part << 16) | (frac_part & 0xffff)) / 65536.0f;
+        }
+    }
+}
+
+static void MulScalar(float res[4][4], const float a[4][4], const float b[4][4]) {
+    float tmp[4][4];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            tmp[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
+        }
+    }
+    memcpy(res, tmp, sizeof(tmp));
+}
+
+static void QuantizeScalar(float res[4][4], const float m[4][4]) {
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            int as_int = (int)(m[i][j] * 65536.0f);
+            res[i][j] = as_int * (1.0f / 65536.0f);
+        }
+    }
+}
+
+static void TransposedMulScalar(float res[3], const float v[3], const float m[4][4]) {
+    float tmp[3];
+    tmp[0] = v[0] * m[0][0] + v[1] * m[0][1] + v[2] * m[0][2];
+    tmp[1] = v[0] * m[1][0] + v[1] * m[1][1] + v[2] * m[1][2];
+    tmp[2] = v[0] * m[2][0] + v[1] * m[2][1] + v[2] * m[2][2];
+    memcpy(res, tmp, sizeof(tmp));
+}
+
+static const GfxMatrixKernels sScalarKernels = { "scalar", UnpackFixedScalar, MulScalar, QuantizeScalar,
+                                                 TransposedMulScalar };
+
+#ifdef GFX_MATRIX_SSE2
+static void UnpackFixedSse2(float res[4][4], const int32_t* addr) {
+    const __m128i hiMask = _mm_set1_epi32((int32_t)0xffff0000);
+    const __m128i loMask = _mm_set1_epi32(0xffff);
+    const __m128 scale = _mm_set1_ps(1.0f / 65536.0f);
+
+    // Each word holds two elements, two rows per iteration
+    for (int i = 0; i < 4; i += 2) {
+        __m128i intPart = _mm_loadu_si128((const __m128i*)(addr + i * 2));
+        __m128i fracPart = _mm_loadu_si128((const __m128i*)(addr + 8 + i * 2));
+        __m128i even = _mm_or_si128(_mm_and_si128(intPart, hiMask), _mm_srli_epi32(fracPart, 16));
+        __m128i odd = _mm_or_si128(_mm_slli_epi32(intPart, 16), _mm_and_si128(fracPart, loMask));
+        _mm_storeu_ps(res[i], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi32(even, odd)), scale));
+        _mm_storeu_ps(res[i + 1], _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi32(even, odd)), scale));
+    }
+}
+
+static void MulSse2(float res[4][4], const float a[4][4], const float b[4][4]) {
+    const __m128 b0 = _mm_loadu_ps(b[0]);
+    const __m128 b1 = _mm_loadu_ps(b[1]);
+    const __m128 b2 = _mm_loadu_ps(b[2]);
+    const __m128 b3 = _mm_loadu_ps(b[3]);
+
+    __m128 rows[4];
+    for (int i = 0; i < 4; i++) {
+        __m128 row = _mm_mul_ps(_mm_set1_ps(a[i][0]), b0);
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[i][1]), b1));
+        row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[i][2]), b2));
+        rows[i] = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(a[i][3]), b3));
+    }
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_ps(res[i], rows[i]);
+    }
+}
+
+static void QuantizeSse2(float res[4][4], const float m[4][4]) {
+    const __m128 toFixed = _mm_set1_ps(65536.0f);
+    const __m128 toFloat = _mm_set1_ps(1.0f / 65536.0f);
+    for (int i = 0; i < 4; i++) {
+        __m128i asInt = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(m[i]), toFixed));
+        _mm_storeu_ps(res[i], _mm_mul_ps(_mm_cvtepi32_ps(asInt), toFloat));
+    }
+}
+
+static void TransposedMulSse2(float res[3], const float v[3], const float m[4][4]) {
+    __m128 c0 = _mm_loadu_ps(m[0]);
+    __m128 c1 = _mm_loadu_ps(m[1]);
+    __m128 c2 = _mm_loadu_ps(m[2]);
+    __m128 c3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    __m128 sum = _mm_mul_ps(_mm_set1_ps(v[0]), c0);
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(v[1]), c1));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(v[2]), c2));
+    float tmp[4];
+    _mm_storeu_ps(tmp, sum);
+    memcpy(res, tmp, sizeof(float) * 3);
+}
+
+static const GfxMatrixKernels sSse2Kernels = { "sse2", UnpackFixedSse2, MulSse2, QuantizeSse2, TransposedMulSse2 };
+
+// Two rows per 256 bit register. Integer operations on 256 bit registers need AVX2, so unpacking stays on SSE2.
+GFX_TARGET_AVX static inline __m256 BroadcastRowAvx(const float row[4]) {
+    const __m128 r = _mm_loadu_ps(row);
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(r), r, 1);
+}
+
+GFX_TARGET_AVX static void MulAvx(float res[4][4], const float a[4][4], const float b[4][4]) {
+    const __m256 b0 = BroadcastRowAvx(b[0]);
+    const __m256 b1 = BroadcastRowAvx(b[1]);
+    const __m256 b2 = BroadcastRowAvx(b[2]);
+    const __m256 b3 = BroadcastRowAvx(b[3]);
+
+    __m256 rows[2];
+    for (int i = 0; i < 2; i++) {
+        const __m256 ai = _mm256_loadu_ps(a[i * 2]);
+        __m256 row = _mm256_mul_ps(_mm256_permute_ps(ai, 0x00), b0);
+        row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(ai, 0x55), b1));
+        row = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(ai, 0xaa), b2));
+        rows[i] = _mm256_add_ps(row, _mm256_mul_ps(_mm256_permute_ps(ai, 0xff), b3));
+    }
+    _mm256_storeu_ps(res[0], rows[0]);
+    _mm256_storeu_ps(res[2], rows[1]);
+}
+
+GFX_TARGET_AVX static void QuantizeAvx(float res[4][4], const float m[4][4]) {
+    const __m256 toFixed = _mm256_set1_ps(65536.0f);
+    const __m256 toFloat = _mm256_set1_ps(1.0f / 65536.0f);
+    for (int i = 0; i < 4; i += 2) {
+        __m256i asInt = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(m[i]), toFixed));
+        _mm256_storeu_ps(res[i], _mm256_mul_ps(_mm256_cvtepi32_ps(asInt), toFloat));
+    }
+}
+
+static const GfxMatrixKernels sAvxKernels = { "avx", UnpackFixedSse2, MulAvx, QuantizeAvx, TransposedMulSse2 };
+
+static bool CpuSupportsAvx() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    // AVX and OSXSAVE, then the OS has to save the ymm registers
+    if ((info[2] & (1 << 28)) == 0 || (info[2] & (1 << 27)) == 0) {
+        return false;
+    }
+    return (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+#ifdef GFX_MATRIX_NEON
+static void UnpackFixedNeon(float res[4][4], const int32_t* addr) {
+    const uint32x4_t hiMask = vdupq_n_u32(0xffff0000);
+    const uint32x4_t loMask = vdupq_n_u32(0xffff);
+
+    // Each word holds two elements, two rows per iteration
+    for (int i = 0; i < 4; i += 2) {
+        uint32x4_t intPart = vreinterpretq_u32_s32(vld1q_s32(addr + i * 2));
+        uint32x4_t fracPart = vreinterpretq_u32_s32(vld1q_s32(addr + 8 + i * 2));
+        uint32x4_t even = vorrq_u32(vandq_u32(intPart, hiMask), vshrq_n_u32(fracPart, 16));
+        uint32x4_t odd = vorrq_u32(vshlq_n_u32(intPart, 16), vandq_u32(fracPart, loMask));
+        uint32x4x2_t rows = vzipq_u32(even, odd);
+        vst1q_f32(res[i], vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(rows.val[0])), 1.0f / 65536.0f));
+        vst1q_f32(res[i + 1], vmulq_n_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(rows.val[1])), 1.0f / 65536.0f));
+    }
+}
+
+static void MulNeon(float res[4][4], const float a[4][4], const float b[4][4]) {
+    const float32x4_t b0 = vld1q_f32(b[0]);
+    const float32x4_t b1 = vld1q_f32(b[1]);
+    const float32x4_t b2 = vld1q_f32(b[2]);
+    const float32x4_t b3 = vld1q_f32(b[3]);
+
+    float32x4_t rows[4];
+    for (int i = 0; i < 4; i++) {
+        float32x4_t row = vmulq_n_f32(b0, a[i][0]);
+        row = vaddq_f32(row, vmulq_n_f32(b1, a[i][1]));
+        row = vaddq_f32(row, vmulq_n_f32(b2, a[i][2]));
+        rows[i] = vaddq_f32(row, vmulq_n_f32(b3, a[i][3]));
+    }
+    for (int i = 0; i < 4; i++) {
+        vst1q_f32(res[i], rows[i]);
+    }
+}
+
+static void QuantizeNeon(float res[4][4], const float m[4][4]) {
+    for (int i = 0; i < 4; i++) {
+        int32x4_t asInt = vcvtq_s32_f32(vmulq_n_f32(vld1q_f32(m[i]), 65536.0f));
+        vst1q_f32(res[i], vmulq_n_f32(vcvtq_f32_s32(asInt), 1.0f / 65536.0f));
+    }
+}
+
+static const GfxMatrixKernels sNeonKernels = { "neon", UnpackFixedNeon, MulNeon, QuantizeNeon, TransposedMulScalar };
+#endif
+
+const GfxMatrixKernels& GfxMatrixScalarKernels() {
+    return sScalarKernels;
+}
+
+std::vector<const GfxMatrixKernels*> GfxMatrixAvailableKernels() {
+    std::vector<const GfxMatrixKernels*> kernels = { &sScalarKernels };
+#ifdef GFX_MATRIX_SSE2
+    kernels.push_back(&sSse2Kernels);
+    if (CpuSupportsAvx()) {
+        kernels.push_back(&sAvxKernels);
+    }
+#endif
+#ifdef GFX_MATRIX_NEON
+    kernels.push_back(&sNeonKernels);
+#endif
+    return kernels;
+}
+
+const GfxMatrixKernels& GfxMatrixGetKernels() {
+    static const GfxMatrixKernels& kernels = *GfxMatrixAvailableKernels().back();
+    return kernels;
+}
+
+} // namespace Fast
@@ -0,0 +1,83 @@
+#include "fast/GfxMtxReplacementTable.h"
+
+#include <algorithm>
+
+#include "fast/GfxMatrix.h"
+
+namespace Fast {
+
+void GfxMtxReplacementTable::Clear() {
+    mPending.clear();
+    mFrameCount = 0;
+    mMtxs.clear();
+    mMatrices.clear();
+    mPresent.clear();
+}
+
+size_t GfxMtxReplacementTable::AddFrame(const std::unordered_map<Mtx*, MtxF>& replacements) {
+    size_t frame = mFrameCount++;
+    for (const auto& [mtx, mf] : replacements) {
+        Set(frame, mtx, mf);
+    }
+    return frame;
+}
+
+void GfxMtxReplacementTable::Set(size_t frame, Mtx* mtx, const MtxF& mf) {
+    mPending.push_back({ mtx, (uint32_t)frame, mf });
+}
+
+void GfxMtxReplacementTable::Finish() {
+    std::sort(mPending.begin(), mPending.end(), [](const Entry& a, const Entry& b) {
+        return a.mtx != b.mtx ? a.mtx < b.mtx : a.frame < b.frame;
+    });
+
+    mMtxs.clear();
+    for (const Entry& entry : mPending) {
+        if (mMtxs.empty() || mMtxs.back() != entry.mtx) {
+            mMtxs.push_back(entry.mtx);
+        }
+    }
+
+    mMatrices.resize(mFrameCount * mMtxs.size());
+    mPresent.assign(mFrameCount * mMtxs.size(), 0);
+    const GfxMatrixKernels& kernels = GfxMatrixGetKernels();
+    size_t index = 0;
+    for (size_t i = 0; i < mPending.size(); i++) {
+        if (i > 0 && mPending[i].mtx != mPending[i - 1].mtx) {
+            index++;
+        }
+        size_t slot = mPending[i].frame * mMtxs.size() + index;
+        kernels.Quantize(mMatrices[slot].mf, mPending[i].mf.mf);
+        mPresent[slot] = 1;
+    }
+}
+
+const MtxF* GfxMtxReplacementTable::Find(size_t frame, const Mtx* mtx) const {
+    auto it = std::lower_bound(mMtxs.begin(), mMtxs.end(), mtx);
+    if (it == mMtxs.end() || *it != mtx) {
+        return nullptr;
+    }
+    return Get(frame, it - mMtxs.begin());
+}
+
+size_t GfxMtxReplacementTable::GetFrameCount() const {
+    return mFrameCount;
+}
+
+size_t GfxMtxReplacementTable::GetMtxCount() const {
+    return mMtxs.size();
+}
+
+Mtx* GfxMtxReplacementTable::GetMtx(size_t index) const {
+    return mMtxs[index];
+}
+
+const MtxF* GfxMtxReplacementTable::Get(size_t frame, size_t index) const {
+    if (frame >= mFrameCount) {
+        return nullptr;
+    }
+    size_t slot = frame * mMtxs.size() + index;
+    return mPresent[slot] ? &mMatrices[slot] : nullptr;
+}
+
+} // namespace Fast
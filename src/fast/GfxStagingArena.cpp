@@ -0,0 +1,159 @@
+#include "fast/GfxStagingArena.h"
+
+#include <algorithm>
+#include <new>
+#include <utility>
+
+// Idle blocks past this many bytes are freed instead of kept, so a single huge import does not stay resident
+#define STAGING_MAX_IDLE_BYTES (16 * 1024 * 1024)
+
+namespace Fast {
+
+static uint8_t* AllocateBlock(size_t size) {
+    return static_cast<uint8_t*>(operator new(size, std::align_val_t(GfxStagingArena::Alignment), std::nothrow));
+}
+
+static void FreeBlock(uint8_t* block) {
+    operator delete(block, std::align_val_t(GfxStagingArena::Alignment));
+}
+
+GfxStagingSlice::GfxStagingSlice(GfxStagingArena* arena, uint8_t* data, size_t size, size_t blockSize)
+    : mArena(arena), mData(data), mSize(size), mBlockSize(blockSize) {
+}
+
+GfxStagingSlice::GfxStagingSlice(GfxStagingSlice&& other) noexcept
+    : mArena(std::exchange(other.mArena, nullptr)), mData(std::exchange(other.mData, nullptr)),
+      mSize(std::exchange(other.mSize, 0)), mBlockSize(std::exchange(other.mBlockSize, 0)) {
+}
+
+GfxStagingSlice& GfxStagingSlice::operator=(GfxStagingSlice&& other) noexcept {
+    if (this != &other) {
+        Release();
+        mArena = std::exchange(other.mArena, nullptr);
+        mData = std::exchange(other.mData, nullptr);
+        mSize = std::exchange(other.mSize, 0);
+        mBlockSize = std::exchange(other.mBlockSize, 0);
+    }
+    return *this;
+}
+
+GfxStagingSlice::~GfxStagingSlice() {
+    Release();
+}
+
+void GfxStagingSlice::Release() {
+    if (mArena != nullptr) {
+        mArena->Release(mData, mBlockSize);
+        mArena = nullptr;
+        mData = nullptr;
+    }
+}
+
+uint8_t* GfxStagingSlice::Data() const {
+    return mData;
+}
+
+size_t GfxStagingSlice::Size() const {
+    return mSize;
+}
+
+GfxStagingSlice::operator bool() const {
+    return mData != nullptr;
+}
+
+uint8_t& GfxStagingSlice::operator[](size_t i) const {
+    return mData[i];
+}
+
+GfxStagingArena::GfxStagingArena(size_t capacity) : mCapacity(capacity) {
+}
+
+GfxStagingArena::~GfxStagingArena() {
+    Trim();
+}
+
+GfxStagingSlice GfxStagingArena::Acquire(size_t size) {
+    const size_t blockSize = (std::max<size_t>(size, 1) + Alignment - 1) & ~(Alignment - 1);
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Reuse the smallest idle block that fits, as long as it does not waste more than the slice uses
+    uint8_t* block = nullptr;
+    size_t reusedSize = 0;
+    auto it = mIdleBlocks.lower_bound(blockSize);
+    if (it != mIdleBlocks.end() && it->first <= blockSize * 2) {
+        block = it->second;
+        reusedSize = it->first;
+        mIdleBytes -= reusedSize;
+        mIdleBlocks.erase(it);
+    } else {
+        if (mCapacity != 0 && mUsedBytes + mIdleBytes + blockSize > mCapacity) {
+            FreeIdleBlocks(mUsedBytes + mIdleBytes + blockSize - mCapacity);
+            if (mUsedBytes + mIdleBytes + blockSize > mCapacity) {
+                return GfxStagingSlice();
+            }
+        }
+        block = AllocateBlock(blockSize);
+        if (block == nullptr) {
+            return GfxStagingSlice();
+        }
+        reusedSize = blockSize;
+    }
+
+    mUsedBytes += reusedSize;
+    mPeakUsage = std::max(mPeakUsage, mUsedBytes);
+    return GfxStagingSlice(this, block, size, reusedSize);
+}
+
+void GfxStagingArena::Release(uint8_t* data, size_t blockSize) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mUsedBytes -= blockSize;
+    if (mIdleBytes + blockSize > STAGING_MAX_IDLE_BYTES ||
+        (mCapacity != 0 && mUsedBytes + mIdleBytes + blockSize > mCapacity)) {
+        FreeBlock(data);
+        return;
+    }
+    mIdleBlocks.emplace(blockSize, data);
+    mIdleBytes += blockSize;
+}
+
+void GfxStagingArena::FreeIdleBlocks(size_t needed) {
+    // Largest first, they are the least likely to be reused
+    size_t freed = 0;
+    while (freed < needed && !mIdleBlocks.empty()) {
+        auto it = std::prev(mIdleBlocks.end());
+        freed += it->first;
+        mIdleBytes -= it->first;
+        FreeBlock(it->second);
+        mIdleBlocks.erase(it);
+    }
+}
+
+void GfxStagingArena::SetCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mCapacity = capacity;
+    if (mCapacity != 0 && mUsedBytes + mIdleBytes > mCapacity) {
+        FreeIdleBlocks(mUsedBytes + mIdleBytes - mCapacity);
+    }
+}
+
+size_t GfxStagingArena::GetCapacity() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCapacity;
+}
+
+size_t GfxStagingArena::GetReserved() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mUsedBytes + mIdleBytes;
+}
+
+size_t GfxStagingArena::GetPeakUsage() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mPeakUsage;
+}
+
+void GfxStagingArena::Trim() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    FreeIdleBlocks(mIdleBytes);
+}
+
+} // namespace Fast
@@ -1011,7 +1011,7 @@ FilteringMode GfxRenderingAPIDX11::GetTextureFilter() {
 }
 
 std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-GfxRenderingAPIDX11::GetPixelDepth(int fb_id, const std::set<std::pair<float, float>>& coordinates) {
+GfxRenderingAPIDX11::GetPixelDepth(int fb_id, const std::vector<std::pair<float, float>>& coordinates) {
     FramebufferDX11& fb = mFrameBuffers[fb_id];
     TextureData& td = mTextures[fb.texture_id];
 
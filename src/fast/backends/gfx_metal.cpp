@@ -937,7 +937,7 @@ void GfxRenderingAPIMetal::ResolveMSAAColorBuffer(int fb_id_target, int fb_id_so
 }
 
 std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-GfxRenderingAPIMetal::GetPixelDepth(int fb_id, const std::set<std::pair<float, float>>& coordinates) {
+GfxRenderingAPIMetal::GetPixelDepth(int fb_id, const std::vector<std::pair<float, float>>& coordinates) {
     auto framebuffer = mFramebuffers[fb_id];
 
     if (coordinates.size() > mCoordBufferSize) {
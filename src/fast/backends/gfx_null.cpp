@@ -0,0 +1,280 @@
+#include "fast/backends/gfx_null.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace Fast {
+
+const char* GfxRenderingAPINull::GetName() {
+    return "Null";
+}
+
+int GfxRenderingAPINull::GetMaxTextureSize() {
+    return 8192;
+}
+
+GfxClipParameters GfxRenderingAPINull::GetClipParameters() {
+    return { false, false };
+}
+
+void GfxRenderingAPINull::UnloadShader(ShaderProgram* oldPrg) {
+}
+
+void GfxRenderingAPINull::LoadShader(ShaderProgram* newPrg) {
+}
+
+ShaderProgram* GfxRenderingAPINull::CreateAndLoadNewShader(uint64_t shaderId0, uint32_t shaderId1) {
+    CCFeatures cc_features;
+    gfx_cc_get_features(shaderId0, shaderId1, &cc_features);
+
+    // The interpreter only asks which inputs and textures a shader uses, everything else is irrelevant here
+    ShaderProgramNull* prg = &mShaderProgramPool[std::make_pair(shaderId0, shaderId1)];
+    prg->numInputs = cc_features.numInputs;
+    prg->usedTextures[0] = cc_features.usedTextures[0];
+    prg->usedTextures[1] = cc_features.usedTextures[1];
+    prg->usedTextures[2] = cc_features.used_masks[0];
+    prg->usedTextures[3] = cc_features.used_masks[1];
+    prg->usedTextures[4] = cc_features.used_blend[0];
+    prg->usedTextures[5] = cc_features.used_blend[1];
+
+    return (ShaderProgram*)prg;
+}
+
+ShaderProgram* GfxRenderingAPINull::LookupShader(uint64_t shaderId0, uint32_t shaderId1) {
+    auto it = mShaderProgramPool.find(std::make_pair(shaderId0, shaderId1));
+    return it == mShaderProgramPool.end() ? nullptr : (ShaderProgram*)&it->second;
+}
+
+void GfxRenderingAPINull::ShaderGetInfo(ShaderProgram* prg, uint8_t* numInputs, bool usedTextures[2]) {
+    ShaderProgramNull* p = (ShaderProgramNull*)prg;
+
+    *numInputs = p->numInputs;
+    usedTextures[0] = p->usedTextures[0];
+    usedTextures[1] = p->usedTextures[1];
+}
+
+uint32_t GfxRenderingAPINull::NewTexture() {
+    return mTextureCount++;
+}
+
+void GfxRenderingAPINull::SelectTexture(int tile, uint32_t textureId) {
+}
+
+void GfxRenderingAPINull::UploadTexture(const uint8_t* rgba32Buf, uint32_t width, uint32_t height) {
+}
+
+void GfxRenderingAPINull::SetSamplerParameters(int sampler, bool linear_filter, uint32_t cms, uint32_t cmt) {
+}
+
+void GfxRenderingAPINull::SetDepthTestAndMask(bool depth_test, bool z_upd) {
+}
+
+void GfxRenderingAPINull::SetZmodeDecal(bool decal) {
+}
+
+void GfxRenderingAPINull::SetViewport(int x, int y, int width, int height) {
+}
+
+void GfxRenderingAPINull::SetScissor(int x, int y, int width, int height) {
+}
+
+void GfxRenderingAPINull::SetUseAlpha(bool useAlpha) {
+}
+
+void GfxRenderingAPINull::DrawTriangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+}
+
+void GfxRenderingAPINull::Init() {
+}
+
+void GfxRenderingAPINull::OnResize() {
+}
+
+void GfxRenderingAPINull::StartFrame() {
+}
+
+void GfxRenderingAPINull::EndFrame() {
+}
+
+void GfxRenderingAPINull::FinishRender() {
+}
+
+int GfxRenderingAPINull::CreateFramebuffer() {
+    return mFramebufferCount++;
+}
+
+void GfxRenderingAPINull::UpdateFramebufferParameters(int fb_id, uint32_t width, uint32_t height, uint32_t msaa_level,
+                                                      bool opengl_invertY, bool render_target, bool has_depth_buffer,
+                                                      bool can_extract_depth) {
+}
+
+void GfxRenderingAPINull::StartDrawToFramebuffer(int fbId, float noiseScale) {
+}
+
+void GfxRenderingAPINull::CopyFramebuffer(int fbDstId, int fbSrcId, int srcX0, int srcY0, int srcX1, int srcY1,
+                                          int dstX0, int dstY0, int dstX1, int dstY1) {
+}
+
+void GfxRenderingAPINull::ClearFramebuffer(bool color, bool depth) {
+}
+
+void GfxRenderingAPINull::ReadFramebufferToCPU(int fbId, uint32_t width, uint32_t height, uint16_t* rgba16Buf) {
+    std::fill_n(rgba16Buf, width * height, 0);
+}
+
+void GfxRenderingAPINull::ResolveMSAAColorBuffer(int fbIdTarger, int fbIdSrc) {
+}
+
+std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
+GfxRenderingAPINull::GetPixelDepth(int fb_id, const std::vector<std::pair<float, float>>& coordinates) {
+    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res;
+    for (const auto& coord : coordinates) {
+        res.emplace(coord, 0);
+    }
+    return res;
+}
+
+void* GfxRenderingAPINull::GetFramebufferTextureId(int fbId) {
+    return (void*)(uintptr_t)fbId;
+}
+
+void GfxRenderingAPINull::SelectTextureFb(int fbId) {
+}
+
+void GfxRenderingAPINull::DeleteTexture(uint32_t texId) {
+}
+
+void GfxRenderingAPINull::SetTextureFilter(FilteringMode mode) {
+    mCurrentFilterMode = mode;
+}
+
+FilteringMode GfxRenderingAPINull::GetTextureFilter() {
+    return mCurrentFilterMode;
+}
+
+void GfxRenderingAPINull::SetSrgbMode() {
+    mSrgbMode = true;
+}
+
+ImTextureID GfxRenderingAPINull::GetTextureById(int id) {
+    return (ImTextureID)(uintptr_t)id;
+}
+
+void GfxWindowBackendNull::Init(const char* gameName, const char* apiName, bool startFullScreen, uint32_t width,
+                                uint32_t height, int32_t posX, int32_t posY) {
+    mWidth = width;
+    mHeight = height;
+    mPosX = posX;
+    mPosY = posY;
+    mFullScreen = startFullScreen;
+}
+
+void GfxWindowBackendNull::Close() {
+    mIsRunning = false;
+}
+
+void GfxWindowBackendNull::SetKeyboardCallbacks(bool (*onKeyDown)(int scancode), bool (*onKeyUp)(int scancode),
+                                                void (*onAllKeysUp)()) {
+}
+
+void GfxWindowBackendNull::SetMouseCallbacks(bool (*onMouseButtonDown)(int btn), bool (*onMouseButtonUp)(int btn)) {
+}
+
+void GfxWindowBackendNull::SetFullscreenChangedCallback(void (*onFullscreenChanged)(bool is_now_fullscreen)) {
+}
+
+void GfxWindowBackendNull::SetFullscreen(bool fullscreen) {
+    mFullScreen = fullscreen;
+}
+
+void GfxWindowBackendNull::GetActiveWindowRefreshRate(uint32_t* refreshRate) {
+    *refreshRate = mTargetFps;
+}
+
+void GfxWindowBackendNull::SetCursorVisibility(bool visability) {
+}
+
+void GfxWindowBackendNull::SetMousePos(int32_t posX, int32_t posY) {
+}
+
+void GfxWindowBackendNull::GetMousePos(int32_t* x, int32_t* y) {
+    *x = 0;
+    *y = 0;
+}
+
+void GfxWindowBackendNull::GetMouseDelta(int32_t* x, int32_t* y) {
+    *x = 0;
+    *y = 0;
+}
+
+void GfxWindowBackendNull::GetMouseWheel(float* x, float* y) {
+    *x = 0.0f;
+    *y = 0.0f;
+}
+
+bool GfxWindowBackendNull::GetMouseState(uint32_t btn) {
+    return false;
+}
+
+void GfxWindowBackendNull::SetMouseCapture(bool capture) {
+}
+
+bool GfxWindowBackendNull::IsMouseCaptured() {
+    return false;
+}
+
+void GfxWindowBackendNull::GetDimensions(uint32_t* width, uint32_t* height, int32_t* posX, int32_t* posY) {
+    *width = mWidth;
+    *height = mHeight;
+    *posX = mPosX;
+    *posY = mPosY;
+}
+
+void GfxWindowBackendNull::HandleEvents() {
+}
+
+bool GfxWindowBackendNull::IsFrameReady() {
+    return true;
+}
+
+void GfxWindowBackendNull::SwapBuffersBegin() {
+}
+
+void GfxWindowBackendNull::SwapBuffersEnd() {
+}
+
+double GfxWindowBackendNull::GetTime() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int GfxWindowBackendNull::GetTargetFps() {
+    return mTargetFps;
+}
+
+void GfxWindowBackendNull::SetTargetFps(int fps) {
+    mTargetFps = fps;
+}
+
+void GfxWindowBackendNull::SetMaxFrameLatency(int latency) {
+}
+
+const char* GfxWindowBackendNull::GetKeyName(int scancode) {
+    return "";
+}
+
+bool GfxWindowBackendNull::CanDisableVsync() {
+    return true;
+}
+
+bool GfxWindowBackendNull::IsRunning() {
+    return mIsRunning;
+}
+
+void GfxWindowBackendNull::Destroy() {
+    mIsRunning = false;
+}
+
+bool GfxWindowBackendNull::IsFullscreen() {
+    return mFullScreen;
+}
+} // namespace Fast
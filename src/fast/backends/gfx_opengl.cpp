@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <map>
 #include <unordered_map>
@@ -27,7 +28,39 @@
 #include "fast/interpreter.h"
 #include "ship/config/ConsoleVariable.h"
 
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Texture objects kept for reuse, objects released past it are deleted
+#define TEXTURE_POOL_MAX_SIZE 256
+
 namespace Fast {
+
+// Features of the ubershader, passed in the uFlags uniform
+enum UberShaderFlags {
+    UBER_ALPHA = 1 << 0,
+    UBER_FOG = 1 << 1,
+    UBER_TEXTURE_EDGE = 1 << 2,
+    UBER_NOISE = 1 << 3,
+    UBER_2CYC = 1 << 4,
+    UBER_ALPHA_THRESHOLD = 1 << 5,
+    UBER_INVISIBLE = 1 << 6,
+    UBER_GRAYSCALE = 1 << 7,
+    UBER_THREE_POINT = 1 << 8,
+    // The flags of the second texture are the ones of the first shifted left by one
+    UBER_TEXTURE0 = 1 << 9,
+    UBER_TEXTURE1 = 1 << 10,
+    UBER_MASK0 = 1 << 11,
+    UBER_MASK1 = 1 << 12,
+    UBER_BLEND0 = 1 << 13,
+    UBER_BLEND1 = 1 << 14,
+    UBER_CLAMP_S0 = 1 << 15,
+    UBER_CLAMP_S1 = 1 << 16,
+    UBER_CLAMP_T0 = 1 << 17,
+    UBER_CLAMP_T1 = 1 << 18,
+};
+
 int GfxRenderingAPIOGL::GetMaxTextureSize() {
     GLint max_texture_size;
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
@@ -57,22 +90,31 @@ static void VertexArraySetAttribs(ShaderProgram* prg) {
 void GfxRenderingAPIOGL::SetUniforms(ShaderProgram* prg) const {
     glUniform1i(prg->frameCountLocation, mFrameCount);
     glUniform1f(prg->noiseScaleLocation, mCurrentNoiseScale);
+    // The ubershader is shared by every combiner that is still compiling
+    if (mUberProgram != 0 && prg->openglProgramId == mUberProgram) {
+        glUniform4iv(mUberCombinerLocation, 4, prg->uberCombiner);
+        glUniform1i(mUberFlagsLocation,
+                    prg->uberFlags | (mCurrentFilterMode == FILTER_THREE_POINT ? UBER_THREE_POINT : 0));
+    }
 }
 
 void GfxRenderingAPIOGL::SetPerDrawUniforms() {
     if (mCurrentShaderProgram->usedTextures[0] || mCurrentShaderProgram->usedTextures[1]) {
-        GLint filtering[2] = { textures[mCurrentTextureIds[0]].filtering, textures[mCurrentTextureIds[1]].filtering };
+        const TextureInfo& tex0 = mTextures[mCurrentTextureIds[0]];
+        const TextureInfo& tex1 = mTextures[mCurrentTextureIds[1]];
+        GLint filtering[2] = { tex0.filtering, tex1.filtering };
         glUniform1iv(mCurrentShaderProgram->texture_filtering_location, 2, filtering);
 
-        GLint width[2] = { textures[mCurrentTextureIds[0]].width, textures[mCurrentTextureIds[1]].width };
+        GLint width[2] = { tex0.width, tex1.width };
         glUniform1iv(mCurrentShaderProgram->texture_width_location, 2, width);
 
-        GLint height[2] = { textures[mCurrentTextureIds[0]].height, textures[mCurrentTextureIds[1]].height };
+        GLint height[2] = { tex0.height, tex1.height };
         glUniform1iv(mCurrentShaderProgram->texture_height_location, 2, height);
     }
 }
 
 void GfxRenderingAPIOGL::UnloadShader(ShaderProgram* old_prg) {
+    FlushDraws();
     if (old_prg != nullptr) {
         for (unsigned int i = 0; i < old_prg->numAttribs; i++) {
             glDisableVertexAttribArray(old_prg->attribLocations[i]);
@@ -81,6 +123,7 @@ void GfxRenderingAPIOGL::UnloadShader(ShaderProgram* old_prg) {
 }
 
 void GfxRenderingAPIOGL::LoadShader(ShaderProgram* new_prg) {
+    FlushDraws();
     // if (!new_prg) return;
     mCurrentShaderProgram = new_prg;
     glUseProgram(new_prg->openglProgramId);
@@ -314,6 +357,84 @@ std::string GfxRenderingAPIOGL::BuildFsShader(const CCFeatures& cc_features) {
     return result;
 }
 
+std::string GfxRenderingAPIOGL::BuildUberFsShader() {
+    prism::Processor processor;
+    prism::ContextItems mContext = {
+        { "UBER_ALPHA", UBER_ALPHA },
+        { "UBER_FOG", UBER_FOG },
+        { "UBER_TEXTURE_EDGE", UBER_TEXTURE_EDGE },
+        { "UBER_NOISE", UBER_NOISE },
+        { "UBER_2CYC", UBER_2CYC },
+        { "UBER_ALPHA_THRESHOLD", UBER_ALPHA_THRESHOLD },
+        { "UBER_INVISIBLE", UBER_INVISIBLE },
+        { "UBER_GRAYSCALE", UBER_GRAYSCALE },
+        { "UBER_THREE_POINT", UBER_THREE_POINT },
+        { "UBER_TEXTURE0", UBER_TEXTURE0 },
+        { "UBER_TEXTURE1", UBER_TEXTURE1 },
+        { "UBER_MASK0", UBER_MASK0 },
+        { "UBER_BLEND0", UBER_BLEND0 },
+        { "UBER_CLAMP_S0", UBER_CLAMP_S0 },
+        { "UBER_CLAMP_T0", UBER_CLAMP_T0 },
+        { "FILTER_THREE_POINT", FILTER_THREE_POINT },
+        { "srgb_mode", mSrgbMode },
+        { "SHADER_0", SHADER_0 },
+        { "SHADER_INPUT_1", SHADER_INPUT_1 },
+        { "SHADER_INPUT_2", SHADER_INPUT_2 },
+        { "SHADER_INPUT_3", SHADER_INPUT_3 },
+        { "SHADER_INPUT_4", SHADER_INPUT_4 },
+        { "SHADER_INPUT_5", SHADER_INPUT_5 },
+        { "SHADER_INPUT_6", SHADER_INPUT_6 },
+        { "SHADER_INPUT_7", SHADER_INPUT_7 },
+        { "SHADER_TEXEL0", SHADER_TEXEL0 },
+        { "SHADER_TEXEL0A", SHADER_TEXEL0A },
+        { "SHADER_TEXEL1", SHADER_TEXEL1 },
+        { "SHADER_TEXEL1A", SHADER_TEXEL1A },
+        { "SHADER_1", SHADER_1 },
+        { "SHADER_COMBINED", SHADER_COMBINED },
+        { "SHADER_NOISE", SHADER_NOISE },
+#ifdef __APPLE__
+        { "GLSL_VERSION", "#version 410 core" },
+        { "attr", "in" },
+        { "opengles", false },
+        { "core_opengl", true },
+        { "texture", "texture" },
+        { "vOutColor", "vOutColor" },
+#elif defined(USE_OPENGLES)
+        { "GLSL_VERSION", "#version 300 es\nprecision mediump float;" },
+        { "attr", "in" },
+        { "opengles", true },
+        { "core_opengl", false },
+        { "texture", "texture" },
+        { "vOutColor", "vOutColor" },
+#else
+        { "GLSL_VERSION", "#version 130" },
+        { "attr", "varying" },
+        { "opengles", false },
+        { "core_opengl", false },
+        { "texture", "texture2D" },
+        { "vOutColor", "gl_FragColor" },
+#endif
+    };
+    processor.populate(mContext);
+    auto init = std::make_shared<Ship::ResourceInitData>();
+    init->Type = (uint32_t)Ship::ResourceType::Shader;
+    init->ByteOrder = Ship::Endianness::Native;
+    init->Format = RESOURCE_FORMAT_BINARY;
+    auto res = std::static_pointer_cast<Ship::Shader>(Ship::Context::GetInstance()->GetResourceManager()->LoadResource(
+        "shaders/opengl/uber.shader.fs", true, init));
+
+    // Older archives don't have it, shaders are then compiled before their first draw
+    if (res == nullptr) {
+        SPDLOG_WARN("Failed to load uber fragment shader, new shaders will be compiled synchronously");
+        return "";
+    }
+
+    auto shader = static_cast<std::string*>(res->GetRawPointer());
+    processor.load(*shader);
+    processor.bind_include_loader(opengl_include_fs);
+    return processor.process();
+}
+
 static size_t numFloats = 0;
 
 static prism::ContextTypes* UpdateFloats(prism::ContextTypes* _, prism::ContextTypes* num) {
@@ -372,51 +493,143 @@ static std::string BuildVsShader(const CCFeatures& cc_features) {
     return result;
 }
 
-ShaderProgram* GfxRenderingAPIOGL::CreateAndLoadNewShader(uint64_t shader_id0, uint32_t shader_id1) {
-    CCFeatures cc_features;
-    gfx_cc_get_features(shader_id0, shader_id1, &cc_features);
-    const auto fs_buf = BuildFsShader(cc_features);
-    const auto vs_buf = BuildVsShader(cc_features);
+static std::string BuildUberVsShader() {
+    prism::Processor processor;
+    prism::ContextItems mContext = {
+#ifdef __APPLE__
+        { "GLSL_VERSION", "#version 410 core" },
+        { "attr", "in" },
+        { "out", "out" },
+        { "opengles", false }
+#elif defined(USE_OPENGLES)
+        { "GLSL_VERSION", "#version 300 es" },
+        { "attr", "in" },
+        { "out", "out" },
+        { "opengles", true }
+#else
+        { "GLSL_VERSION", "#version 110" },
+        { "attr", "attribute" },
+        { "out", "varying" },
+        { "opengles", false }
+#endif
+    };
+    processor.populate(mContext);
+
+    auto init = std::make_shared<Ship::ResourceInitData>();
+    init->Type = (uint32_t)Ship::ResourceType::Shader;
+    init->ByteOrder = Ship::Endianness::Native;
+    init->Format = RESOURCE_FORMAT_BINARY;
+    auto res = std::static_pointer_cast<Ship::Shader>(Ship::Context::GetInstance()->GetResourceManager()->LoadResource(
+        "shaders/opengl/uber.shader.vs", true, init));
+
+    if (res == nullptr) {
+        SPDLOG_WARN("Failed to load uber vertex shader, new shaders will be compiled synchronously");
+        return "";
+    }
+
+    auto shader = static_cast<std::string*>(res->GetRawPointer());
+    processor.load(*shader);
+    processor.bind_include_loader(opengl_include_fs);
+    return processor.process();
+}
+
+// Starts compiling and linking, the results are only waited for when the status is queried
+static GLuint CreateProgram(const std::string& vs_buf, const std::string& fs_buf) {
     const GLchar* sources[2] = { vs_buf.data(), fs_buf.data() };
     const GLint lengths[2] = { (GLint)vs_buf.size(), (GLint)fs_buf.size() };
-    GLint success;
 
     GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
     glShaderSource(vertex_shader, 1, &sources[0], &lengths[0]);
     glCompileShader(vertex_shader);
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        GLint max_length = 0;
-        glGetShaderiv(vertex_shader, GL_INFO_LOG_LENGTH, &max_length);
-        char error_log[1024];
-        // fprintf(stderr, "Vertex shader compilation failed\n");
-        glGetShaderInfoLog(vertex_shader, max_length, &max_length, &error_log[0]);
-        // fprintf(stderr, "%s\n", &error_log[0]);
-        abort();
-    }
 
     GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
     glShaderSource(fragment_shader, 1, &sources[1], &lengths[1]);
     glCompileShader(fragment_shader);
-    glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        GLint max_length = 0;
-        glGetShaderiv(fragment_shader, GL_INFO_LOG_LENGTH, &max_length);
-        char error_log[1024];
-        fprintf(stderr, "Fragment shader compilation failed\n");
-        glGetShaderInfoLog(fragment_shader, max_length, &max_length, &error_log[0]);
-        fprintf(stderr, "%s\n", &error_log[0]);
-        abort();
-    }
 
     GLuint shader_program = glCreateProgram();
     glAttachShader(shader_program, vertex_shader);
     glAttachShader(shader_program, fragment_shader);
     glLinkProgram(shader_program);
+    return shader_program;
+}
+
+static bool CheckProgram(GLuint program) {
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (success) {
+        return true;
+    }
 
+    GLuint shaders[2];
+    GLsizei count = 0;
+    char error_log[1024];
+    glGetAttachedShaders(program, 2, &count, shaders);
+    for (GLsizei i = 0; i < count; i++) {
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shaders[i], sizeof(error_log), nullptr, error_log);
+            SPDLOG_ERROR("Shader compilation failed: {}", error_log);
+        }
+    }
+    glGetProgramInfoLog(program, sizeof(error_log), nullptr, error_log);
+    SPDLOG_ERROR("Shader program link failed: {}", error_log);
+    return false;
+}
+
+static GLint GetUberShaderFlags(const CCFeatures& cc_features) {
+    GLint flags = 0;
+    flags |= cc_features.opt_alpha ? UBER_ALPHA : 0;
+    flags |= cc_features.opt_fog ? UBER_FOG : 0;
+    flags |= cc_features.opt_texture_edge ? UBER_TEXTURE_EDGE : 0;
+    flags |= cc_features.opt_noise ? UBER_NOISE : 0;
+    flags |= cc_features.opt_2cyc ? UBER_2CYC : 0;
+    flags |= cc_features.opt_alpha_threshold ? UBER_ALPHA_THRESHOLD : 0;
+    flags |= cc_features.opt_invisible ? UBER_INVISIBLE : 0;
+    flags |= cc_features.opt_grayscale ? UBER_GRAYSCALE : 0;
+    for (int i = 0; i < 2; i++) {
+        flags |= cc_features.usedTextures[i] ? UBER_TEXTURE0 << i : 0;
+        flags |= cc_features.used_masks[i] ? UBER_MASK0 << i : 0;
+        flags |= cc_features.used_blend[i] ? UBER_BLEND0 << i : 0;
+        flags |= cc_features.clamp[i][0] ? UBER_CLAMP_S0 << i : 0;
+        flags |= cc_features.clamp[i][1] ? UBER_CLAMP_T0 << i : 0;
+    }
+    return flags;
+}
+
+bool GfxRenderingAPIOGL::CreateUberShader() {
+    if (mUberProgram != 0) {
+        return true;
+    }
+    if (mUberShaderFailed) {
+        return false;
+    }
+
+    const auto fs_buf = BuildUberFsShader();
+    const auto vs_buf = BuildUberVsShader();
+    if (fs_buf.empty() || vs_buf.empty()) {
+        mUberShaderFailed = true;
+        return false;
+    }
+
+    GLuint shader_program = CreateProgram(vs_buf, fs_buf);
+    if (!CheckProgram(shader_program)) {
+        SPDLOG_ERROR("Failed to build the uber shader, new shaders will be compiled synchronously");
+        glDeleteProgram(shader_program);
+        mUberShaderFailed = true;
+        return false;
+    }
+
+    mUberProgram = shader_program;
+    mUberCombinerLocation = glGetUniformLocation(shader_program, "uCombiner");
+    mUberFlagsLocation = glGetUniformLocation(shader_program, "uFlags");
+    return true;
+}
+
+// Looks up the inputs of a program that draws with the given features, and binds its samplers
+void GfxRenderingAPIOGL::SetupShaderProgram(ShaderProgram* prg, GLuint shader_program,
+                                            const CCFeatures& cc_features) {
     size_t cnt = 0;
 
-    struct ShaderProgram* prg = &mShaderProgramPool[std::make_pair(shader_id0, shader_id1)];
     prg->attribLocations[cnt] = glGetAttribLocation(shader_program, "aVtxPos");
     prg->attribSizes[cnt] = 4;
     ++cnt;
@@ -461,14 +674,6 @@ ShaderProgram* GfxRenderingAPIOGL::CreateAndLoadNewShader(uint64_t shader_id0, u
     }
 
     prg->openglProgramId = shader_program;
-    prg->numInputs = cc_features.numInputs;
-    prg->usedTextures[0] = cc_features.usedTextures[0];
-    prg->usedTextures[1] = cc_features.usedTextures[1];
-    prg->usedTextures[2] = cc_features.used_masks[0];
-    prg->usedTextures[3] = cc_features.used_masks[1];
-    prg->usedTextures[4] = cc_features.used_blend[0];
-    prg->usedTextures[5] = cc_features.used_blend[1];
-    prg->numFloats = numFloats;
     prg->numAttribs = cnt;
 
     prg->frameCountLocation = glGetUniformLocation(shader_program, "frame_count");
@@ -477,7 +682,7 @@ ShaderProgram* GfxRenderingAPIOGL::CreateAndLoadNewShader(uint64_t shader_id0, u
     prg->texture_height_location = glGetUniformLocation(shader_program, "texture_height");
     prg->texture_filtering_location = glGetUniformLocation(shader_program, "texture_filtering");
 
-    LoadShader(prg);
+    glUseProgram(shader_program);
 
     if (cc_features.usedTextures[0]) {
         GLint sampler_location = glGetUniformLocation(shader_program, "uTex0");
@@ -503,7 +708,83 @@ ShaderProgram* GfxRenderingAPIOGL::CreateAndLoadNewShader(uint64_t shader_id0, u
         GLint sampler_location = glGetUniformLocation(shader_program, "uTexBlend1");
         glUniform1i(sampler_location, 5);
     }
+}
+
+// Without parallel shader compile there is no way to ask whether a program is done, so its link status is read on the
+// frame after it was created. Drivers that compile on their own threads have usually finished by then.
+void GfxRenderingAPIOGL::SwapCompiledShaders() {
+    bool swapped = false;
+    for (auto it = mPendingShaderPrograms.begin(); it != mPendingShaderPrograms.end();) {
+        ShaderProgram* prg = *it;
+        if (mParallelShaderCompile) {
+            GLint completed = GL_FALSE;
+            glGetProgramiv(prg->pendingProgramId, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed) {
+                ++it;
+                continue;
+            }
+        }
+
+        if (CheckProgram(prg->pendingProgramId)) {
+            if (prg == mCurrentShaderProgram) {
+                UnloadShader(prg);
+            }
+            CCFeatures cc_features;
+            gfx_cc_get_features(prg->shaderId0, prg->shaderId1, &cc_features);
+            SetupShaderProgram(prg, prg->pendingProgramId, cc_features);
+            swapped = true;
+        } else {
+            // Keeps drawing with the ubershader
+            glDeleteProgram(prg->pendingProgramId);
+        }
+        prg->pendingProgramId = 0;
+        it = mPendingShaderPrograms.erase(it);
+    }
+
+    if (swapped && mCurrentShaderProgram != nullptr) {
+        LoadShader(mCurrentShaderProgram);
+    }
+}
+
+ShaderProgram* GfxRenderingAPIOGL::CreateAndLoadNewShader(uint64_t shader_id0, uint32_t shader_id1) {
+    FlushDraws();
+    CCFeatures cc_features;
+    gfx_cc_get_features(shader_id0, shader_id1, &cc_features);
+    const auto fs_buf = BuildFsShader(cc_features);
+    const auto vs_buf = BuildVsShader(cc_features);
+    GLuint shader_program = CreateProgram(vs_buf, fs_buf);
+
+    struct ShaderProgram* prg = &mShaderProgramPool[std::make_pair(shader_id0, shader_id1)];
+    prg->shaderId0 = shader_id0;
+    prg->shaderId1 = shader_id1;
+    prg->numInputs = cc_features.numInputs;
+    prg->usedTextures[0] = cc_features.usedTextures[0];
+    prg->usedTextures[1] = cc_features.usedTextures[1];
+    prg->usedTextures[2] = cc_features.used_masks[0];
+    prg->usedTextures[3] = cc_features.used_masks[1];
+    prg->usedTextures[4] = cc_features.used_blend[0];
+    prg->usedTextures[5] = cc_features.used_blend[1];
+    prg->numFloats = numFloats;
+
+    // Draw with the ubershader until the specialized program has linked, so new combiners don't stall the frame. Off by
+    // default while the ubershader has not been validated on every driver.
+    if (Ship::Context::GetInstance()->GetConsoleVariables()->GetInteger(CVAR_ASYNC_SHADER_COMPILE, 0) &&
+        CreateUberShader()) {
+        for (int i = 0; i < 16; i++) {
+            prg->uberCombiner[i] = cc_features.c[i / 8][(i / 4) % 2][i % 4];
+        }
+        prg->uberFlags = GetUberShaderFlags(cc_features);
+        prg->pendingProgramId = shader_program;
+        SetupShaderProgram(prg, mUberProgram, cc_features);
+        mPendingShaderPrograms.push_back(prg);
+    } else {
+        if (!CheckProgram(shader_program)) {
+            abort();
+        }
+        SetupShaderProgram(prg, shader_program, cc_features);
+    }
 
+    LoadShader(prg);
     return prg;
 }
 
@@ -518,27 +799,101 @@ void GfxRenderingAPIOGL::ShaderGetInfo(struct ShaderProgram* prg, uint8_t* numIn
     usedTextures[1] = prg->usedTextures[1];
 }
 
-GLuint GfxRenderingAPIOGL::NewTexture() {
-    GLuint ret;
-    glGenTextures(1, &ret);
-    return ret;
+uint32_t GfxRenderingAPIOGL::NewTexture() {
+    if (!mFreeTextureIds.empty()) {
+        uint32_t texId = mFreeTextureIds.back();
+        mFreeTextureIds.pop_back();
+        return texId;
+    }
+    mTextures.emplace_back();
+    return mTextures.size() - 1;
 }
 
 void GfxRenderingAPIOGL::DeleteTexture(uint32_t texID) {
-    glDeleteTextures(1, &texID);
+    FlushDraws();
+    if (texID == 0 || texID >= mTextures.size()) {
+        return;
+    }
+    TextureInfo& info = mTextures[texID];
+    if (info.texture != 0) {
+        ReleasePooledTexture(info.texture, info.width, info.height);
+    }
+    info = TextureInfo();
+    mFreeTextureIds.push_back(texID);
+}
+
+GLuint GfxRenderingAPIOGL::AcquirePooledTexture(uint32_t width, uint32_t height) {
+    auto it = mTexturePool.find({ width, height });
+    if (it != mTexturePool.end() && !it->second.empty()) {
+        GLuint texture = it->second.back();
+        it->second.pop_back();
+        mTexturePoolStats.pooled--;
+        mTexturePoolStats.hits++;
+        return texture;
+    }
+
+    mTexturePoolStats.misses++;
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (mTextureStorage) {
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    return texture;
 }
 
-void GfxRenderingAPIOGL::SelectTexture(int tile, GLuint texture_id) {
+void GfxRenderingAPIOGL::ReleasePooledTexture(GLuint texture, uint32_t width, uint32_t height) {
+    if (mTexturePoolStats.pooled >= TEXTURE_POOL_MAX_SIZE) {
+        glDeleteTextures(1, &texture);
+        return;
+    }
+    mTexturePool[{ width, height }].push_back(texture);
+    mTexturePoolStats.pooled++;
+}
+
+void GfxRenderingAPIOGL::SelectTexture(int tile, uint32_t texture_id) {
+    if (mCurrentTextureIds[tile] != texture_id || (tile == 0 && mTextureFbSelected)) {
+        FlushDraws();
+    }
+    if (tile == 0) {
+        mTextureFbSelected = false;
+    }
     glActiveTexture(GL_TEXTURE0 + tile);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glBindTexture(GL_TEXTURE_2D, mTextures[texture_id].texture);
     mCurrentTextureIds[tile] = texture_id;
     mCurrentTile = tile;
 }
 
 void GfxRenderingAPIOGL::UploadTexture(const uint8_t* rgba32_buf, uint32_t width, uint32_t height) {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba32_buf);
-    textures[mCurrentTextureIds[mCurrentTile]].width = width;
-    textures[mCurrentTextureIds[mCurrentTile]].height = height;
+    FlushDraws();
+    TextureInfo& info = mTextures[mCurrentTextureIds[mCurrentTile]];
+    glActiveTexture(GL_TEXTURE0 + mCurrentTile);
+
+    if (info.texture != 0 && info.width == width && info.height == height) {
+        mTexturePoolStats.hits++;
+    } else {
+        if (info.texture != 0) {
+            ReleasePooledTexture(info.texture, info.width, info.height);
+        }
+        info.texture = AcquirePooledTexture(width, height);
+        info.width = width;
+        info.height = height;
+
+        glBindTexture(GL_TEXTURE_2D, info.texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, info.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, info.filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, info.wrapS);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, info.wrapT);
+    }
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba32_buf);
+    mTexturePoolStats.uploadBytes += (uint64_t)width * height * 4;
+}
+
+const TexturePoolStatsOGL& GfxRenderingAPIOGL::GetTexturePoolStats() const {
+    return mTexturePoolStats;
 }
 
 #ifdef USE_OPENGLES
@@ -561,12 +916,22 @@ static uint32_t gfx_cm_to_opengl(uint32_t val) {
 
 void GfxRenderingAPIOGL::SetSamplerParameters(int tile, bool linear_filter, uint32_t cms, uint32_t cmt) {
     glActiveTexture(GL_TEXTURE0 + tile);
-    const GLint filter = linear_filter && mCurrentFilterMode == FILTER_LINEAR ? GL_LINEAR : GL_NEAREST;
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-    textures[mCurrentTextureIds[tile]].filtering = !linear_filter ? FILTER_LINEAR : FILTER_THREE_POINT;
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, gfx_cm_to_opengl(cms));
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, gfx_cm_to_opengl(cmt));
+    TextureInfo& info = mTextures[mCurrentTextureIds[tile]];
+    GLint filter = linear_filter && mCurrentFilterMode == FILTER_LINEAR ? GL_LINEAR : GL_NEAREST;
+    uint16_t filtering = !linear_filter ? FILTER_LINEAR : FILTER_THREE_POINT;
+    GLint wrapS = gfx_cm_to_opengl(cms);
+    GLint wrapT = gfx_cm_to_opengl(cmt);
+    if (filter != info.filter || filtering != info.filtering || wrapS != info.wrapS || wrapT != info.wrapT) {
+        FlushDraws();
+    }
+    info.filter = filter;
+    info.filtering = filtering;
+    info.wrapS = wrapS;
+    info.wrapT = wrapT;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, info.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, info.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, info.wrapS);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, info.wrapT);
 }
 
 void GfxRenderingAPIOGL::SetDepthTestAndMask(bool depth_test, bool z_upd) {
@@ -579,14 +944,28 @@ void GfxRenderingAPIOGL::SetZmodeDecal(bool zmode_decal) {
 }
 
 void GfxRenderingAPIOGL::SetViewport(int x, int y, int width, int height) {
+    const int viewport[4] = { x, y, width, height };
+    if (memcmp(viewport, mViewport, sizeof(viewport)) != 0) {
+        FlushDraws();
+        memcpy(mViewport, viewport, sizeof(viewport));
+    }
     glViewport(x, y, width, height);
 }
 
 void GfxRenderingAPIOGL::SetScissor(int x, int y, int width, int height) {
+    const int scissor[4] = { x, y, width, height };
+    if (memcmp(scissor, mScissor, sizeof(scissor)) != 0) {
+        FlushDraws();
+        memcpy(mScissor, scissor, sizeof(scissor));
+    }
     glScissor(x, y, width, height);
 }
 
 void GfxRenderingAPIOGL::SetUseAlpha(bool use_alpha) {
+    if (use_alpha != mUseAlpha) {
+        FlushDraws();
+        mUseAlpha = use_alpha;
+    }
     if (use_alpha) {
         glEnable(GL_BLEND);
     } else {
@@ -595,6 +974,11 @@ void GfxRenderingAPIOGL::SetUseAlpha(bool use_alpha) {
 }
 
 void GfxRenderingAPIOGL::DrawTriangles(float buf_vbo[], size_t buf_vbo_len, size_t buf_vbo_num_tris) {
+    if (mCurrentDepthTest != mLastDepthTest || mCurrentDepthMask != mLastDepthMask ||
+        mCurrentZmodeDecal != mLastZmodeDecal) {
+        FlushDraws();
+    }
+
     if (mCurrentDepthTest != mLastDepthTest || mCurrentDepthMask != mLastDepthMask) {
         mLastDepthTest = mCurrentDepthTest;
         mLastDepthMask = mCurrentDepthMask;
@@ -644,11 +1028,31 @@ void GfxRenderingAPIOGL::DrawTriangles(float buf_vbo[], size_t buf_vbo_len, size
         }
     }
 
+    // Every state the batch depends on flushed the pending ones when it changed, so it can join them
+    mPendingVbo.insert(mPendingVbo.end(), buf_vbo, buf_vbo + buf_vbo_len);
+    mPendingNumTris += buf_vbo_num_tris;
+    mDrawStats.batches++;
+}
+
+// The per draw uniforms only depend on the bound textures, which are the same for all the pending batches
+void GfxRenderingAPIOGL::FlushDraws() {
+    if (mPendingNumTris == 0) {
+        mPendingVbo.clear();
+        return;
+    }
+
     SetPerDrawUniforms();
 
-    // printf("flushing %d tris\n", buf_vbo_num_tris);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * buf_vbo_len, buf_vbo, GL_STREAM_DRAW);
-    glDrawArrays(GL_TRIANGLES, 0, 3 * buf_vbo_num_tris);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * mPendingVbo.size(), mPendingVbo.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, 3 * mPendingNumTris);
+    mDrawStats.drawCalls++;
+
+    mPendingVbo.clear();
+    mPendingNumTris = 0;
+}
+
+const DrawStatsOGL& GfxRenderingAPIOGL::GetDrawStats() const {
+    return mDrawStats;
 }
 
 void GfxRenderingAPIOGL::Init() {
@@ -685,23 +1089,45 @@ void GfxRenderingAPIOGL::Init() {
     mPixelDepthRbSize = 1;
 
     glGetIntegerv(GL_MAX_SAMPLES, &mMaxMsaaLevel);
+
+    mParallelShaderCompile = SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile") ||
+                             SDL_GL_ExtensionSupported("GL_ARB_parallel_shader_compile");
+
+#ifdef USE_OPENGLES
+    mTextureStorage = true;
+#else
+    GLint majorVersion = 0;
+    GLint minorVersion = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
+    glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
+    mTextureStorage = majorVersion > 4 || (majorVersion == 4 && minorVersion >= 2) ||
+                      SDL_GL_ExtensionSupported("GL_ARB_texture_storage");
+#endif
+
+    // Id 0 stands for no texture
+    mTextures.resize(1);
 }
 
 void GfxRenderingAPIOGL::OnResize() {
 }
 
 void GfxRenderingAPIOGL::StartFrame() {
+    FlushDraws();
     mFrameCount++;
+    SwapCompiledShaders();
 }
 
 void GfxRenderingAPIOGL::EndFrame() {
+    FlushDraws();
     glFlush();
 }
 
 void GfxRenderingAPIOGL::FinishRender() {
+    FlushDraws();
 }
 
 int GfxRenderingAPIOGL::CreateFramebuffer() {
+    FlushDraws();
     GLuint clrbuf;
     glGenTextures(1, &clrbuf);
     glBindTexture(GL_TEXTURE_2D, clrbuf);
@@ -736,6 +1162,7 @@ int GfxRenderingAPIOGL::CreateFramebuffer() {
 void GfxRenderingAPIOGL::UpdateFramebufferParameters(int fb_id, uint32_t width, uint32_t height, uint32_t msaa_level,
                                                      bool opengl_invertY, bool render_target, bool has_depth_buffer,
                                                      bool can_extract_depth) {
+    FlushDraws();
     FramebufferOGL& fb = mFrameBuffers[fb_id];
 
     width = std::max(width, 1U);
@@ -785,6 +1212,7 @@ void GfxRenderingAPIOGL::UpdateFramebufferParameters(int fb_id, uint32_t width,
 }
 
 void GfxRenderingAPIOGL::StartDrawToFramebuffer(int fb_id, float noise_scale) {
+    FlushDraws();
     FramebufferOGL& fb = mFrameBuffers[fb_id];
 
     if (noise_scale != 0.0f) {
@@ -795,6 +1223,7 @@ void GfxRenderingAPIOGL::StartDrawToFramebuffer(int fb_id, float noise_scale) {
 }
 
 void GfxRenderingAPIOGL::ClearFramebuffer(bool color, bool depth) {
+    FlushDraws();
     glDisable(GL_SCISSOR_TEST);
     glDepthMask(GL_TRUE);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -804,6 +1233,7 @@ void GfxRenderingAPIOGL::ClearFramebuffer(bool color, bool depth) {
 }
 
 void GfxRenderingAPIOGL::ResolveMSAAColorBuffer(int fb_id_target, int fb_id_source) {
+    FlushDraws();
     FramebufferOGL& fb_dst = mFrameBuffers[fb_id_target];
     FramebufferOGL& fb_src = mFrameBuffers[fb_id_source];
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb_dst.fbo);
@@ -824,13 +1254,16 @@ void* GfxRenderingAPIOGL::GetFramebufferTextureId(int fb_id) {
 }
 
 void GfxRenderingAPIOGL::SelectTextureFb(int fb_id) {
+    FlushDraws();
     // glDisable(GL_DEPTH_TEST);
     glActiveTexture(GL_TEXTURE0 + 0);
     glBindTexture(GL_TEXTURE_2D, mFrameBuffers[fb_id].clrbuf);
+    mTextureFbSelected = true;
 }
 
 void GfxRenderingAPIOGL::CopyFramebuffer(int fb_dst_id, int fb_src_id, int srcX0, int srcY0, int srcX1, int srcY1,
                                          int dstX0, int dstY0, int dstX1, int dstY1) {
+    FlushDraws();
     if (fb_dst_id >= (int)mFrameBuffers.size() || fb_src_id >= (int)mFrameBuffers.size()) {
         return;
     }
@@ -896,6 +1329,7 @@ void GfxRenderingAPIOGL::CopyFramebuffer(int fb_dst_id, int fb_src_id, int srcX0
 }
 
 void GfxRenderingAPIOGL::ReadFramebufferToCPU(int fb_id, uint32_t width, uint32_t height, uint16_t* rgba16_buf) {
+    FlushDraws();
     if (fb_id >= (int)mFrameBuffers.size()) {
         return;
     }
@@ -906,7 +1340,8 @@ void GfxRenderingAPIOGL::ReadFramebufferToCPU(int fb_id, uint32_t width, uint32_
 }
 
 std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
-GfxRenderingAPIOGL::GetPixelDepth(int fb_id, const std::set<std::pair<float, float>>& coordinates) {
+GfxRenderingAPIOGL::GetPixelDepth(int fb_id, const std::vector<std::pair<float, float>>& coordinates) {
+    FlushDraws();
     std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res;
 
     FramebufferOGL& fb = mFrameBuffers[fb_id];
@@ -975,6 +1410,7 @@ GfxRenderingAPIOGL::GetPixelDepth(int fb_id, const std::set<std::pair<float, flo
 }
 
 void GfxRenderingAPIOGL::SetTextureFilter(FilteringMode mode) {
+    FlushDraws();
     gfx_texture_cache_clear();
     mCurrentFilterMode = mode;
 }
@@ -984,11 +1420,15 @@ FilteringMode GfxRenderingAPIOGL::GetTextureFilter() {
 }
 
 void GfxRenderingAPIOGL::SetSrgbMode() {
+    FlushDraws();
     mSrgbMode = true;
 }
 
 ImTextureID GfxRenderingAPIOGL::GetTextureById(int id) {
-    return reinterpret_cast<ImTextureID>(id);
+    if (id <= 0 || id >= (int)mTextures.size()) {
+        return (ImTextureID)0;
+    }
+    return (ImTextureID)(uintptr_t)mTextures[id].texture;
 }
 } // namespace Fast
 #endif
@@ -0,0 +1,1060 @@
+#include "fast/backends/gfx_software.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+#include "ship/Context.h"
+#include "ship/config/ConsoleVariable.h"
+
+namespace Fast {
+
+static constexpr uint32_t TILE_SIZE = 64;
+static constexpr size_t MAX_VERTEX_FLOATS = 64;
+// Clipping a triangle against five planes adds at most one vertex per plane
+static constexpr size_t MAX_CLIP_VERTICES = 8;
+static constexpr int NUM_CLIP_PLANES = 5;
+static constexpr float CLIP_W_EPSILON = 1e-5f;
+// Smallest resolvable difference of a 24 bit depth buffer, used for the polygon offset of decals
+static constexpr float DEPTH_UNIT = 1.0f / (1 << 24);
+
+GfxRenderingAPISoftware::GfxRenderingAPISoftware(uint32_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    // The thread issuing the draw call rasterizes tiles as well
+    for (uint32_t i = 1; i < threadCount; i++) {
+        mWorkers.emplace_back(&GfxRenderingAPISoftware::WorkerLoop, this);
+    }
+}
+
+GfxRenderingAPISoftware::~GfxRenderingAPISoftware() {
+    {
+        std::lock_guard<std::mutex> lock(mWorkMutex);
+        mStopWorkers = true;
+    }
+    mWorkCv.notify_all();
+    for (auto& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+const char* GfxRenderingAPISoftware::GetName() {
+    return "Software";
+}
+
+int GfxRenderingAPISoftware::GetMaxTextureSize() {
+    return 8192;
+}
+
+GfxClipParameters GfxRenderingAPISoftware::GetClipParameters() {
+    return { false, mFrameBuffers[mCurrentFrameBuffer].invertY };
+}
+
+void GfxRenderingAPISoftware::UnloadShader(ShaderProgram* oldPrg) {
+}
+
+void GfxRenderingAPISoftware::LoadShader(ShaderProgram* newPrg) {
+    mCurrentShaderProgram = (ShaderProgramSoftware*)newPrg;
+}
+
+ShaderProgram* GfxRenderingAPISoftware::CreateAndLoadNewShader(uint64_t shaderId0, uint32_t shaderId1) {
+    CCFeatures cc_features;
+    gfx_cc_get_features(shaderId0, shaderId1, &cc_features);
+
+    ShaderProgramSoftware* prg = &mShaderProgramPool[std::make_pair(shaderId0, shaderId1)];
+    prg->ccFeatures = cc_features;
+    prg->numInputs = cc_features.numInputs;
+    prg->usedTextures[0] = cc_features.usedTextures[0];
+    prg->usedTextures[1] = cc_features.usedTextures[1];
+    prg->usedTextures[2] = cc_features.used_masks[0];
+    prg->usedTextures[3] = cc_features.used_masks[1];
+    prg->usedTextures[4] = cc_features.used_blend[0];
+    prg->usedTextures[5] = cc_features.used_blend[1];
+
+    // Mirrors the attribute order of the OpenGL vertex shader
+    uint8_t numFloats = 4;
+    for (int i = 0; i < 2; i++) {
+        prg->texClampOffset[i][0] = prg->texClampOffset[i][1] = -1;
+        if (cc_features.usedTextures[i]) {
+            prg->texCoordOffset[i] = numFloats;
+            numFloats += 2;
+            for (int j = 0; j < 2; j++) {
+                if (cc_features.clamp[i][j]) {
+                    prg->texClampOffset[i][j] = numFloats++;
+                }
+            }
+        }
+    }
+    prg->fogOffset = -1;
+    if (cc_features.opt_fog) {
+        prg->fogOffset = numFloats;
+        numFloats += 4;
+    }
+    prg->grayscaleOffset = -1;
+    if (cc_features.opt_grayscale) {
+        prg->grayscaleOffset = numFloats;
+        numFloats += 4;
+    }
+    prg->inputOffset = numFloats;
+    numFloats += cc_features.numInputs * (cc_features.opt_alpha ? 4 : 3);
+    prg->numFloats = numFloats;
+
+    if (numFloats > MAX_VERTEX_FLOATS) {
+        SPDLOG_ERROR("Software renderer does not support {} floats per vertex", numFloats);
+        abort();
+    }
+
+    LoadShader((ShaderProgram*)prg);
+    return (ShaderProgram*)prg;
+}
+
+ShaderProgram* GfxRenderingAPISoftware::LookupShader(uint64_t shaderId0, uint32_t shaderId1) {
+    auto it = mShaderProgramPool.find(std::make_pair(shaderId0, shaderId1));
+    return it == mShaderProgramPool.end() ? nullptr : (ShaderProgram*)&it->second;
+}
+
+void GfxRenderingAPISoftware::ShaderGetInfo(ShaderProgram* prg, uint8_t* numInputs, bool usedTextures[2]) {
+    ShaderProgramSoftware* p = (ShaderProgramSoftware*)prg;
+
+    *numInputs = p->numInputs;
+    usedTextures[0] = p->usedTextures[0];
+    usedTextures[1] = p->usedTextures[1];
+}
+
+uint32_t GfxRenderingAPISoftware::NewTexture() {
+    uint32_t id = mNextTextureId++;
+    mTextures[id];
+    return id;
+}
+
+void GfxRenderingAPISoftware::SelectTexture(int tile, uint32_t textureId) {
+    auto it = mTextures.find(textureId);
+    mBoundTextures[tile] = it == mTextures.end() ? nullptr : &it->second;
+    mCurrentTextureIds[tile] = textureId;
+    mCurrentTile = tile;
+}
+
+void GfxRenderingAPISoftware::UploadTexture(const uint8_t* rgba32Buf, uint32_t width, uint32_t height) {
+    auto it = mTextures.find(mCurrentTextureIds[mCurrentTile]);
+    if (it == mTextures.end()) {
+        return;
+    }
+
+    TextureSoftware& tex = it->second;
+    tex.width = width;
+    tex.height = height;
+    tex.rgba.assign(rgba32Buf, rgba32Buf + (size_t)width * height * 4);
+}
+
+void GfxRenderingAPISoftware::SetSamplerParameters(int sampler, bool linearFilter, uint32_t cms, uint32_t cmt) {
+    auto it = mTextures.find(mCurrentTextureIds[sampler]);
+    if (it == mTextures.end()) {
+        return;
+    }
+
+    // Same as the OpenGL backend, three point filtering is done in the shader on top of nearest sampling
+    TextureSoftware& tex = it->second;
+    tex.linearFilter = linearFilter && mCurrentFilterMode == FILTER_LINEAR;
+    tex.threePointFilter = linearFilter;
+    tex.cms = cms;
+    tex.cmt = cmt;
+}
+
+void GfxRenderingAPISoftware::SetDepthTestAndMask(bool depthTest, bool zUpd) {
+    mCurrentDepthTest = depthTest;
+    mCurrentDepthMask = zUpd;
+}
+
+void GfxRenderingAPISoftware::SetZmodeDecal(bool decal) {
+    mCurrentZmodeDecal = decal;
+}
+
+void GfxRenderingAPISoftware::SetViewport(int x, int y, int width, int height) {
+    mViewport[0] = x;
+    mViewport[1] = y;
+    mViewport[2] = width;
+    mViewport[3] = height;
+}
+
+void GfxRenderingAPISoftware::SetScissor(int x, int y, int width, int height) {
+    mScissor[0] = x;
+    mScissor[1] = y;
+    mScissor[2] = width;
+    mScissor[3] = height;
+}
+
+void GfxRenderingAPISoftware::SetUseAlpha(bool useAlpha) {
+    mUseAlpha = useAlpha;
+}
+
+static float ClipDistance(const float* v, int plane) {
+    switch (plane) {
+        case 0:
+            return v[3] - v[0];
+        case 1:
+            return v[3] + v[0];
+        case 2:
+            return v[3] - v[1];
+        case 3:
+            return v[3] + v[1];
+        default:
+            return v[3] - CLIP_W_EPSILON;
+    }
+}
+
+// Sutherland-Hodgman against one plane, attributes are interpolated linearly in clip space
+static size_t ClipPolygon(float (*in)[MAX_VERTEX_FLOATS], size_t count, float (*out)[MAX_VERTEX_FLOATS],
+                          size_t numFloats, int plane) {
+    size_t outCount = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const float* a = in[i];
+        const float* b = in[(i + 1) % count];
+        float da = ClipDistance(a, plane);
+        float db = ClipDistance(b, plane);
+
+        if (da >= 0) {
+            memcpy(out[outCount++], a, numFloats * sizeof(float));
+        }
+        if ((da >= 0) != (db >= 0)) {
+            float t = da / (da - db);
+            for (size_t k = 0; k < numFloats; k++) {
+                out[outCount][k] = a[k] + t * (b[k] - a[k]);
+            }
+            outCount++;
+        }
+    }
+
+    return outCount;
+}
+
+uint32_t GfxRenderingAPISoftware::PushVertex(const float* clipVertex) {
+    const size_t numFloats = mCurrentShaderProgram->numFloats;
+    const uint32_t index = mVertices.size() / numFloats;
+    const float invW = 1.0f / clipVertex[3];
+
+    mVertices.push_back(mViewport[0] + (clipVertex[0] * invW + 1.0f) * 0.5f * mViewport[2]);
+    mVertices.push_back(mViewport[1] + (clipVertex[1] * invW + 1.0f) * 0.5f * mViewport[3]);
+    mVertices.push_back((clipVertex[2] * invW + 1.0f) * 0.5f);
+    mVertices.push_back(invW);
+    for (size_t k = 4; k < numFloats; k++) {
+        mVertices.push_back(clipVertex[k] * invW);
+    }
+
+    return index;
+}
+
+void GfxRenderingAPISoftware::SetupTriangle(uint32_t i0, uint32_t i1, uint32_t i2) {
+    const size_t numFloats = mCurrentShaderProgram->numFloats;
+    const FramebufferSoftware& fb = mFrameBuffers[mCurrentFrameBuffer];
+    const float* v0 = &mVertices[i0 * numFloats];
+    const float* v1 = &mVertices[i1 * numFloats];
+    const float* v2 = &mVertices[i2 * numFloats];
+
+    float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v2[0] - v0[0]) * (v1[1] - v0[1]);
+    if (!(area != 0.0f) || !std::isfinite(area)) {
+        return;
+    }
+
+    RasterTriangle tri;
+    if (area < 0.0f) {
+        // Culling already happened in the interpreter, rasterize everything counter-clockwise
+        std::swap(i1, i2);
+        std::swap(v1, v2);
+        area = -area;
+    }
+    tri.v[0] = i0;
+    tri.v[1] = i1;
+    tri.v[2] = i2;
+    tri.area = area;
+
+    float minX = std::min({ v0[0], v1[0], v2[0] });
+    float maxX = std::max({ v0[0], v1[0], v2[0] });
+    float minY = std::min({ v0[1], v1[1], v2[1] });
+    float maxY = std::max({ v0[1], v1[1], v2[1] });
+    tri.minX = std::max({ (int)std::floor(minX), mScissor[0], 0 });
+    tri.minY = std::max({ (int)std::floor(minY), mScissor[1], 0 });
+    tri.maxX = std::min({ (int)std::ceil(maxX), mScissor[0] + mScissor[2], (int)fb.color.width });
+    tri.maxY = std::min({ (int)std::ceil(maxY), mScissor[1] + mScissor[3], (int)fb.color.height });
+    if (tri.minX >= tri.maxX || tri.minY >= tri.maxY) {
+        return;
+    }
+
+    tri.depthOffset = 0.0f;
+    if (mCurrentZmodeDecal) {
+        // Same slope scaled bias as the OpenGL backend's glPolygonOffset
+        const int n64modeFactor = 120;
+        const int noVanishFactor = 100;
+        float factor = -2;
+        switch (Ship::Context::GetInstance()->GetConsoleVariables()->GetInteger(CVAR_Z_FIGHTING_MODE, 0)) {
+            // scaled z-fighting (N64 mode like)
+            case 1:
+                factor = -1.0f * fb.color.height / n64modeFactor;
+                break;
+            // no vanishing paths
+            case 2:
+                factor = -1.0f * fb.color.height / noVanishFactor;
+                break;
+            // disabled
+            case 0:
+            default:
+                factor = -2;
+        }
+
+        float dzdx = ((v1[2] - v0[2]) * (v2[1] - v0[1]) - (v2[2] - v0[2]) * (v1[1] - v0[1])) / area;
+        float dzdy = ((v1[0] - v0[0]) * (v2[2] - v0[2]) - (v2[0] - v0[0]) * (v1[2] - v0[2])) / area;
+        tri.depthOffset = factor * std::max(std::abs(dzdx), std::abs(dzdy)) - 2 * DEPTH_UNIT;
+    }
+
+    mTriangles.push_back(tri);
+}
+
+void GfxRenderingAPISoftware::DrawTriangles(float bufVbo[], size_t bufVboLen, size_t bufVboNumTris) {
+    FramebufferSoftware& fb = mFrameBuffers[mCurrentFrameBuffer];
+    if (mCurrentShaderProgram == nullptr || fb.color.width == 0 || fb.color.height == 0) {
+        return;
+    }
+
+    // Matches the OpenGL backend, depth is only touched while testing or writing and only if the target has a buffer
+    const bool depthEnabled = fb.hasDepthBuffer && (mCurrentDepthTest || mCurrentDepthMask);
+    mDepthTest = depthEnabled && mCurrentDepthTest;
+    mDepthWrite = depthEnabled && mCurrentDepthMask;
+    mDepthLessEqual = mCurrentZmodeDecal;
+
+    const size_t numFloats = mCurrentShaderProgram->numFloats;
+    mVertices.clear();
+    mTriangles.clear();
+
+    float polygon[2][MAX_CLIP_VERTICES][MAX_VERTEX_FLOATS];
+    uint32_t indices[MAX_CLIP_VERTICES];
+    for (size_t t = 0; t < bufVboNumTris; t++) {
+        const float* tri = &bufVbo[t * 3 * numFloats];
+
+        bool inside = true;
+        for (int plane = 0; plane < NUM_CLIP_PLANES && inside; plane++) {
+            for (int i = 0; i < 3; i++) {
+                inside &= ClipDistance(&tri[i * numFloats], plane) >= 0;
+            }
+        }
+
+        if (inside) {
+            uint32_t i0 = PushVertex(&tri[0]);
+            uint32_t i1 = PushVertex(&tri[numFloats]);
+            uint32_t i2 = PushVertex(&tri[2 * numFloats]);
+            SetupTriangle(i0, i1, i2);
+            continue;
+        }
+
+        size_t count = 3;
+        int cur = 0;
+        for (int i = 0; i < 3; i++) {
+            memcpy(polygon[cur][i], &tri[i * numFloats], numFloats * sizeof(float));
+        }
+        for (int plane = 0; plane < NUM_CLIP_PLANES && count >= 3; plane++) {
+            count = ClipPolygon(polygon[cur], count, polygon[cur ^ 1], numFloats, plane);
+            cur ^= 1;
+        }
+        if (count < 3) {
+            continue;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            indices[i] = PushVertex(polygon[cur][i]);
+        }
+        for (size_t i = 1; i + 1 < count; i++) {
+            SetupTriangle(indices[0], indices[i], indices[i + 1]);
+        }
+    }
+
+    if (mTriangles.empty()) {
+        return;
+    }
+
+    mTilesX = (fb.color.width + TILE_SIZE - 1) / TILE_SIZE;
+    mTilesY = (fb.color.height + TILE_SIZE - 1) / TILE_SIZE;
+    mBins.resize(mTilesX * mTilesY);
+    for (auto& bin : mBins) {
+        bin.clear();
+    }
+
+    uint32_t usedBins = 0;
+    for (uint32_t i = 0; i < mTriangles.size(); i++) {
+        const RasterTriangle& tri = mTriangles[i];
+        for (uint32_t ty = tri.minY / TILE_SIZE; ty <= (tri.maxY - 1) / TILE_SIZE; ty++) {
+            for (uint32_t tx = tri.minX / TILE_SIZE; tx <= (tri.maxX - 1) / TILE_SIZE; tx++) {
+                auto& bin = mBins[ty * mTilesX + tx];
+                usedBins += bin.empty();
+                bin.push_back(i);
+            }
+        }
+    }
+
+    if (mWorkers.empty() || usedBins <= 1) {
+        for (uint32_t tile = 0; tile < mBins.size(); tile++) {
+            RasterizeTile(tile);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mWorkMutex);
+        mNextTile = 0;
+        mWorkersBusy = mWorkers.size();
+        mWorkGeneration++;
+    }
+    mWorkCv.notify_all();
+    ProcessTiles();
+
+    std::unique_lock<std::mutex> lock(mWorkMutex);
+    mDoneCv.wait(lock, [this] { return mWorkersBusy == 0; });
+}
+
+void GfxRenderingAPISoftware::ProcessTiles() {
+    uint32_t tile;
+    while ((tile = mNextTile.fetch_add(1)) < mBins.size()) {
+        RasterizeTile(tile);
+    }
+}
+
+void GfxRenderingAPISoftware::WorkerLoop() {
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(mWorkMutex);
+
+    while (true) {
+        mWorkCv.wait(lock, [&] { return mStopWorkers || mWorkGeneration != generation; });
+        if (mStopWorkers) {
+            return;
+        }
+        generation = mWorkGeneration;
+
+        lock.unlock();
+        ProcessTiles();
+        lock.lock();
+
+        if (--mWorkersBusy == 0) {
+            mDoneCv.notify_one();
+        }
+    }
+}
+
+void GfxRenderingAPISoftware::RasterizeTile(uint32_t tile) {
+    const auto& bin = mBins[tile];
+    if (bin.empty()) {
+        return;
+    }
+
+    const int tileMinX = (tile % mTilesX) * TILE_SIZE;
+    const int tileMinY = (tile / mTilesX) * TILE_SIZE;
+    for (uint32_t index : bin) {
+        const RasterTriangle& tri = mTriangles[index];
+        RasterizeTriangle(tri, std::max(tri.minX, tileMinX), std::max(tri.minY, tileMinY),
+                          std::min(tri.maxX, tileMinX + (int)TILE_SIZE), std::min(tri.maxY, tileMinY + (int)TILE_SIZE));
+    }
+}
+
+// Edges shared by two triangles are walked in opposite directions, so exactly one of them owns pixels on the edge
+static bool OwnsEdge(const float* a, const float* b) {
+    float dx = b[0] - a[0];
+    float dy = b[1] - a[1];
+    return dy < 0 || (dy == 0 && dx > 0);
+}
+
+void GfxRenderingAPISoftware::RasterizeTriangle(const RasterTriangle& tri, int minX, int minY, int maxX, int maxY) {
+    const size_t numFloats = mCurrentShaderProgram->numFloats;
+    FramebufferSoftware& fb = mFrameBuffers[mCurrentFrameBuffer];
+    const uint32_t width = fb.color.width;
+    const float* v0 = &mVertices[tri.v[0] * numFloats];
+    const float* v1 = &mVertices[tri.v[1] * numFloats];
+    const float* v2 = &mVertices[tri.v[2] * numFloats];
+    const bool owns0 = OwnsEdge(v1, v2);
+    const bool owns1 = OwnsEdge(v2, v0);
+    const bool owns2 = OwnsEdge(v0, v1);
+    const float invArea = 1.0f / tri.area;
+
+    float attribs[MAX_VERTEX_FLOATS];
+    float color[4];
+
+    for (int y = minY; y < maxY; y++) {
+        const float py = y + 0.5f;
+        for (int x = minX; x < maxX; x++) {
+            const float px = x + 0.5f;
+            float e0 = (v2[0] - v1[0]) * (py - v1[1]) - (v2[1] - v1[1]) * (px - v1[0]);
+            float e1 = (v0[0] - v2[0]) * (py - v2[1]) - (v0[1] - v2[1]) * (px - v2[0]);
+            float e2 = (v1[0] - v0[0]) * (py - v0[1]) - (v1[1] - v0[1]) * (px - v0[0]);
+            if (e0 < 0 || e1 < 0 || e2 < 0 || (e0 == 0 && !owns0) || (e1 == 0 && !owns1) || (e2 == 0 && !owns2)) {
+                continue;
+            }
+
+            const float b0 = e0 * invArea;
+            const float b1 = e1 * invArea;
+            const float b2 = e2 * invArea;
+            const size_t pixel = (size_t)y * width + x;
+
+            float z = std::clamp(b0 * v0[2] + b1 * v1[2] + b2 * v2[2] + tri.depthOffset, 0.0f, 1.0f);
+            if (mDepthTest && !(mDepthLessEqual ? z <= fb.depth[pixel] : z < fb.depth[pixel])) {
+                continue;
+            }
+
+            const float w = 1.0f / (b0 * v0[3] + b1 * v1[3] + b2 * v2[3]);
+            for (size_t k = 4; k < numFloats; k++) {
+                attribs[k] = (b0 * v0[k] + b1 * v1[k] + b2 * v2[k]) * w;
+            }
+
+            if (!ShadeFragment(attribs, x, y, color)) {
+                continue;
+            }
+
+            if (mDepthWrite) {
+                fb.depth[pixel] = z;
+            }
+
+            uint8_t* dst = &fb.color.rgba[pixel * 4];
+            for (int c = 0; c < 3; c++) {
+                float value = color[c];
+                if (mUseAlpha) {
+                    value = value * color[3] + (dst[c] / 255.0f) * (1.0f - color[3]);
+                }
+                dst[c] = (uint8_t)std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f);
+            }
+        }
+    }
+}
+
+static int AddressTexel(int i, int size, uint32_t cm) {
+    switch (cm) {
+        case G_TX_NOMIRROR | G_TX_CLAMP:
+            return std::clamp(i, 0, size - 1);
+        case G_TX_MIRROR | G_TX_WRAP: {
+            int period = size * 2;
+            i = ((i % period) + period) % period;
+            return i < size ? i : period - 1 - i;
+        }
+        case G_TX_MIRROR | G_TX_CLAMP:
+            return std::min(i < 0 ? -1 - i : i, size - 1);
+        case G_TX_NOMIRROR | G_TX_WRAP:
+        default:
+            return ((i % size) + size) % size;
+    }
+}
+
+static void FetchTexel(const TextureSoftware& tex, int x, int y, float out[4]) {
+    x = AddressTexel(x, tex.width, tex.cms);
+    y = AddressTexel(y, tex.height, tex.cmt);
+
+    const uint8_t* texel = &tex.rgba[((size_t)y * tex.width + x) * 4];
+    for (int c = 0; c < 4; c++) {
+        out[c] = texel[c] / 255.0f;
+    }
+}
+
+// Equivalent of texture() with the sampler state the OpenGL backend would set
+static void SampleTexture(const TextureSoftware& tex, float u, float v, float out[4]) {
+    const float x = u * tex.width;
+    const float y = v * tex.height;
+
+    if (!tex.linearFilter) {
+        FetchTexel(tex, (int)std::floor(x), (int)std::floor(y), out);
+        return;
+    }
+
+    const float fx = x - 0.5f;
+    const float fy = y - 0.5f;
+    const int x0 = (int)std::floor(fx);
+    const int y0 = (int)std::floor(fy);
+    const float ax = fx - x0;
+    const float ay = fy - y0;
+
+    float c00[4], c10[4], c01[4], c11[4];
+    FetchTexel(tex, x0, y0, c00);
+    FetchTexel(tex, x0 + 1, y0, c10);
+    FetchTexel(tex, x0, y0 + 1, c01);
+    FetchTexel(tex, x0 + 1, y0 + 1, c11);
+    for (int c = 0; c < 4; c++) {
+        float top = c00[c] + (c10[c] - c00[c]) * ax;
+        float bottom = c01[c] + (c11[c] - c01[c]) * ax;
+        out[c] = top + (bottom - top) * ay;
+    }
+}
+
+static float Sign(float value) {
+    return value > 0 ? 1.0f : (value < 0 ? -1.0f : 0.0f);
+}
+
+// Port of hookTexture2D and filter3point from the OpenGL fragment shader
+static void HookTexture(const TextureSoftware* tex, float u, float v, float texWidth, float texHeight,
+                        bool threePoint, float out[4]) {
+    if (tex == nullptr || tex->width == 0 || tex->height == 0) {
+        out[0] = out[1] = out[2] = 0.0f;
+        out[3] = 1.0f;
+        return;
+    }
+
+    if (!threePoint) {
+        SampleTexture(*tex, u, v, out);
+        return;
+    }
+
+    float offX = u * texWidth - 0.5f;
+    float offY = v * texHeight - 0.5f;
+    offX -= std::floor(offX);
+    offY -= std::floor(offY);
+    if (offX + offY >= 1.0f) {
+        offX -= 1.0f;
+        offY -= 1.0f;
+    }
+
+    float c0[4], c1[4], c2[4];
+    SampleTexture(*tex, u - offX / texWidth, v - offY / texHeight, c0);
+    SampleTexture(*tex, u - (offX - Sign(offX)) / texWidth, v - offY / texHeight, c1);
+    SampleTexture(*tex, u - offX / texWidth, v - (offY - Sign(offY)) / texHeight, c2);
+    for (int c = 0; c < 4; c++) {
+        out[c] = c0[c] + std::abs(offX) * (c1[c] - c0[c]) + std::abs(offY) * (c2[c] - c0[c]);
+    }
+}
+
+static float Wrap(float x, float low, float high) {
+    float range = high - low;
+    float value = x - low;
+    return value - range * std::floor(value / range) + low;
+}
+
+static float Random(float x, float y, float z) {
+    float random = std::sin(x) * 12.9898f + std::sin(y) * 78.233f + std::sin(z) * 37.719f;
+    float value = std::sin(random) * 143758.5453f;
+    return value - std::floor(value);
+}
+
+static float FromLinear(float value) {
+    return value < 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+struct CombinerInputs {
+    const float (*texVal)[4];
+    const float* inputs;
+    int inputStride;
+    const float* texel;
+    float noise;
+    bool firstCycle;
+};
+
+// Value of a combiner input for one channel, 3 being alpha, following shader_item_to_str of the OpenGL backend
+static float ItemValue(int item, int channel, const CombinerInputs& in) {
+    const int tex0 = in.firstCycle ? 0 : 1;
+    const int tex1 = in.firstCycle ? 1 : 0;
+
+    switch (item) {
+        case SHADER_1:
+            return 1.0f;
+        case SHADER_INPUT_1:
+        case SHADER_INPUT_2:
+        case SHADER_INPUT_3:
+        case SHADER_INPUT_4:
+        case SHADER_INPUT_5:
+        case SHADER_INPUT_6:
+        case SHADER_INPUT_7:
+            return in.inputs[(item - SHADER_INPUT_1) * in.inputStride + channel];
+        case SHADER_TEXEL0:
+            return in.texVal[tex0][channel];
+        case SHADER_TEXEL0A:
+            return in.texVal[tex0][3];
+        case SHADER_TEXEL1:
+            return in.texVal[tex1][channel];
+        case SHADER_TEXEL1A:
+            return in.texVal[tex1][3];
+        case SHADER_COMBINED:
+            return in.texel[channel];
+        case SHADER_NOISE:
+            return in.noise;
+        case SHADER_0:
+        default:
+            return 0.0f;
+    }
+}
+
+static float Formula(const int* c, bool single, bool multiply, bool mix, int channel, const CombinerInputs& in) {
+    if (single) {
+        return ItemValue(c[3], channel, in);
+    }
+    if (multiply) {
+        return ItemValue(c[0], channel, in) * ItemValue(c[2], channel, in);
+    }
+    if (mix) {
+        float b = ItemValue(c[1], channel, in);
+        return b + (ItemValue(c[0], channel, in) - b) * ItemValue(c[2], channel, in);
+    }
+    return (ItemValue(c[0], channel, in) - ItemValue(c[1], channel, in)) * ItemValue(c[2], channel, in) +
+           ItemValue(c[3], channel, in);
+}
+
+bool GfxRenderingAPISoftware::ShadeFragment(const float* attribs, int x, int y, float out[4]) const {
+    const ShaderProgramSoftware& prg = *mCurrentShaderProgram;
+    const CCFeatures& cc = prg.ccFeatures;
+    const bool alpha = cc.opt_alpha;
+
+    float texVal[2][4] = {};
+    for (int i = 0; i < 2; i++) {
+        if (!cc.usedTextures[i]) {
+            continue;
+        }
+
+        const TextureSoftware* tex = mBoundTextures[i];
+        const float texWidth = tex != nullptr ? tex->width : 0.0f;
+        const float texHeight = tex != nullptr ? tex->height : 0.0f;
+        const bool threePoint = mCurrentFilterMode == FILTER_THREE_POINT && tex != nullptr && tex->threePointFilter;
+
+        float u = attribs[prg.texCoordOffset[i]];
+        float v = attribs[prg.texCoordOffset[i] + 1];
+        if (prg.texClampOffset[i][0] >= 0) {
+            u = std::min(std::max(u, 0.5f / texWidth), attribs[prg.texClampOffset[i][0]]);
+        }
+        if (prg.texClampOffset[i][1] >= 0) {
+            v = std::min(std::max(v, 0.5f / texHeight), attribs[prg.texClampOffset[i][1]]);
+        }
+
+        HookTexture(tex, u, v, texWidth, texHeight, threePoint, texVal[i]);
+
+        if (cc.used_masks[i]) {
+            const TextureSoftware* mask = mBoundTextures[SHADER_FIRST_MASK_TEXTURE + i];
+            float maskVal[4];
+            float blendVal[4] = {};
+            HookTexture(mask, u, v, mask != nullptr ? mask->width : 0.0f, mask != nullptr ? mask->height : 0.0f,
+                        threePoint, maskVal);
+            if (cc.used_blend[i]) {
+                HookTexture(mBoundTextures[SHADER_FIRST_REPLACEMENT_TEXTURE + i], u, v, texWidth, texHeight,
+                            threePoint, blendVal);
+            }
+            for (int c = 0; c < 4; c++) {
+                texVal[i][c] += (blendVal[c] - texVal[i][c]) * maskVal[3];
+            }
+        }
+    }
+
+    const float fragX = std::floor((x + 0.5f) * mCurrentNoiseScale);
+    const float fragY = std::floor((y + 0.5f) * mCurrentNoiseScale);
+
+    float texel[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    CombinerInputs in;
+    in.texVal = texVal;
+    in.inputs = &attribs[prg.inputOffset];
+    in.inputStride = alpha ? 4 : 3;
+    in.texel = texel;
+    in.noise = (Random(fragX, fragY, (float)mFrameCount) + 1.0f) / 2.0f;
+
+    for (int c = 0; c < (cc.opt_2cyc ? 2 : 1); c++) {
+        if (c == 1) {
+            if (alpha) {
+                texel[3] = cc.c[c][1][2] == SHADER_COMBINED ? Wrap(texel[3], -1.01f, 1.01f)
+                                                           : Wrap(texel[3], -0.51f, 1.51f);
+            }
+            for (int ch = 0; ch < 3; ch++) {
+                texel[ch] = cc.c[c][0][2] == SHADER_COMBINED ? Wrap(texel[ch], -1.01f, 1.01f)
+                                                            : Wrap(texel[ch], -0.51f, 1.51f);
+            }
+        }
+
+        in.firstCycle = c == 0;
+        // The alpha formula only differs from the color one when the shader was generated with separate alpha
+        const int a = !cc.color_alpha_same[c] && alpha ? 1 : 0;
+        float result[4];
+        for (int ch = 0; ch < 3; ch++) {
+            result[ch] = Formula(cc.c[c][0], cc.do_single[c][0], cc.do_multiply[c][0], cc.do_mix[c][0], ch, in);
+        }
+        result[3] = alpha ? Formula(cc.c[c][a], cc.do_single[c][a], cc.do_multiply[c][a], cc.do_mix[c][a], 3, in)
+                          : 1.0f;
+        memcpy(texel, result, sizeof(result));
+    }
+
+    for (int ch = 0; ch < (alpha ? 4 : 3); ch++) {
+        texel[ch] = std::clamp(Wrap(texel[ch], -0.51f, 1.51f), 0.0f, 1.0f);
+    }
+
+    if (cc.opt_fog) {
+        const float* fog = &attribs[prg.fogOffset];
+        for (int ch = 0; ch < 3; ch++) {
+            texel[ch] += (fog[ch] - texel[ch]) * fog[3];
+        }
+    }
+
+    if (cc.opt_texture_edge && alpha) {
+        if (texel[3] > 0.19f) {
+            texel[3] = 1.0f;
+        } else {
+            return false;
+        }
+    }
+
+    if (alpha && cc.opt_noise) {
+        texel[3] *= std::floor(std::clamp(Random(fragX, fragY, (float)mFrameCount) + texel[3], 0.0f, 1.0f));
+    }
+
+    if (cc.opt_grayscale) {
+        const float* grayscale = &attribs[prg.grayscaleOffset];
+        float intensity = (texel[0] + texel[1] + texel[2]) / 3.0f;
+        for (int ch = 0; ch < 3; ch++) {
+            texel[ch] += (grayscale[ch] * intensity - texel[ch]) * grayscale[3];
+        }
+    }
+
+    if (alpha) {
+        if (cc.opt_alpha_threshold && texel[3] < 8.0f / 256.0f) {
+            return false;
+        }
+        if (cc.opt_invisible) {
+            texel[3] = 0.0f;
+        }
+    } else {
+        texel[3] = 1.0f;
+    }
+
+    if (mSrgbMode) {
+        for (int ch = 0; ch < 3; ch++) {
+            texel[ch] = FromLinear(texel[ch]);
+        }
+    }
+
+    memcpy(out, texel, sizeof(texel));
+    return true;
+}
+
+void GfxRenderingAPISoftware::Init() {
+    mFrameBuffers.resize(1); // for the default screen buffer
+}
+
+void GfxRenderingAPISoftware::OnResize() {
+}
+
+void GfxRenderingAPISoftware::StartFrame() {
+    mFrameCount++;
+}
+
+void GfxRenderingAPISoftware::EndFrame() {
+}
+
+void GfxRenderingAPISoftware::FinishRender() {
+}
+
+int GfxRenderingAPISoftware::CreateFramebuffer() {
+    size_t i = mFrameBuffers.size();
+    mFrameBuffers.resize(i + 1);
+
+    // Framebuffer textures are created with linear filtering and the default repeat wrapping in OpenGL
+    mFrameBuffers[i].color.linearFilter = true;
+    mFrameBuffers[i].color.cms = G_TX_NOMIRROR | G_TX_WRAP;
+    mFrameBuffers[i].color.cmt = G_TX_NOMIRROR | G_TX_WRAP;
+
+    return i;
+}
+
+void GfxRenderingAPISoftware::UpdateFramebufferParameters(int fbId, uint32_t width, uint32_t height, uint32_t msaaLevel,
+                                                          bool openglInvertY, bool renderTarget, bool hasDepthBuffer,
+                                                          bool canExtractDepth) {
+    FramebufferSoftware& fb = mFrameBuffers[fbId];
+
+    // Multisampling is not emulated, every framebuffer has a single sample
+    width = std::max(width, 1U);
+    height = std::max(height, 1U);
+
+    const bool resized = fb.color.width != width || fb.color.height != height;
+    if (resized) {
+        fb.color.width = width;
+        fb.color.height = height;
+        fb.color.rgba.assign((size_t)width * height * 4, 0);
+        for (size_t i = 3; i < fb.color.rgba.size(); i += 4) {
+            fb.color.rgba[i] = 0xFF;
+        }
+    }
+    if (hasDepthBuffer && (resized || !fb.hasDepthBuffer)) {
+        fb.depth.assign((size_t)width * height, 1.0f);
+    } else if (!hasDepthBuffer) {
+        fb.depth.clear();
+    }
+
+    fb.hasDepthBuffer = hasDepthBuffer;
+    fb.invertY = openglInvertY;
+}
+
+void GfxRenderingAPISoftware::StartDrawToFramebuffer(int fbId, float noiseScale) {
+    if (noiseScale != 0.0f) {
+        mCurrentNoiseScale = 1.0f / noiseScale;
+    }
+    mCurrentFrameBuffer = fbId;
+}
+
+void GfxRenderingAPISoftware::Blit(int fbDstId, int fbSrcId, int srcX0, int srcY0, int srcX1, int srcY1, int dstX0,
+                                   int dstY0, int dstX1, int dstY1) {
+    const TextureSoftware& src = mFrameBuffers[fbSrcId].color;
+    TextureSoftware& dst = mFrameBuffers[fbDstId].color;
+    if (dstX0 == dstX1 || dstY0 == dstY1) {
+        return;
+    }
+
+    // Nearest sampling of the source rectangle, reversed rectangles flip the image like glBlitFramebuffer
+    const int minX = std::max(std::min(dstX0, dstX1), 0);
+    const int maxX = std::min(std::max(dstX0, dstX1), (int)dst.width);
+    const int minY = std::max(std::min(dstY0, dstY1), 0);
+    const int maxY = std::min(std::max(dstY0, dstY1), (int)dst.height);
+    const float scaleX = (float)(srcX1 - srcX0) / (dstX1 - dstX0);
+    const float scaleY = (float)(srcY1 - srcY0) / (dstY1 - dstY0);
+
+    // Copy through a temporary when source and destination are the same framebuffer
+    std::vector<uint8_t> copy;
+    const uint8_t* source = src.rgba.data();
+    if (fbDstId == fbSrcId) {
+        copy = src.rgba;
+        source = copy.data();
+    }
+    for (int y = minY; y < maxY; y++) {
+        int sy = (int)std::floor(srcY0 + (y + 0.5f - dstY0) * scaleY);
+        if (sy < 0 || sy >= (int)src.height) {
+            continue;
+        }
+        for (int x = minX; x < maxX; x++) {
+            int sx = (int)std::floor(srcX0 + (x + 0.5f - dstX0) * scaleX);
+            if (sx < 0 || sx >= (int)src.width) {
+                continue;
+            }
+            memcpy(&dst.rgba[((size_t)y * dst.width + x) * 4], &source[((size_t)sy * src.width + sx) * 4], 4);
+        }
+    }
+}
+
+void GfxRenderingAPISoftware::CopyFramebuffer(int fbDstId, int fbSrcId, int srcX0, int srcY0, int srcX1, int srcY1,
+                                              int dstX0, int dstY0, int dstX1, int dstY1) {
+    if (fbDstId >= (int)mFrameBuffers.size() || fbSrcId >= (int)mFrameBuffers.size()) {
+        return;
+    }
+
+    const FramebufferSoftware& src = mFrameBuffers[fbSrcId];
+    const FramebufferSoftware& dst = mFrameBuffers[fbDstId];
+
+    // Same y adjustments as the OpenGL backend, the storage uses the bottom left as origin as well
+    if (!src.invertY) {
+        int temp = srcY1 - srcY0;
+        srcY1 = src.color.height - srcY0;
+        srcY0 = srcY1 - temp;
+    }
+
+    if (src.invertY != dst.invertY) {
+        std::swap(srcY0, srcY1);
+    }
+
+    Blit(fbDstId, fbSrcId, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1);
+}
+
+void GfxRenderingAPISoftware::ClearFramebuffer(bool color, bool depth) {
+    FramebufferSoftware& fb = mFrameBuffers[mCurrentFrameBuffer];
+
+    // Clears ignore the scissor
+    if (color) {
+        for (size_t i = 0; i < fb.color.rgba.size(); i += 4) {
+            fb.color.rgba[i + 0] = 0;
+            fb.color.rgba[i + 1] = 0;
+            fb.color.rgba[i + 2] = 0;
+            fb.color.rgba[i + 3] = 0xFF;
+        }
+    }
+    if (depth) {
+        std::fill(fb.depth.begin(), fb.depth.end(), 1.0f);
+    }
+}
+
+void GfxRenderingAPISoftware::ReadFramebufferToCPU(int fbId, uint32_t width, uint32_t height, uint16_t* rgba16Buf) {
+    if (fbId >= (int)mFrameBuffers.size()) {
+        return;
+    }
+
+    const TextureSoftware& color = mFrameBuffers[fbId].color;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint16_t value = 0;
+            if (x < color.width && y < color.height) {
+                const uint8_t* pixel = &color.rgba[((size_t)y * color.width + x) * 4];
+                // GL_UNSIGNED_SHORT_5_5_5_1, the framebuffers have no alpha channel
+                value = (uint16_t)(std::lround(pixel[0] * 31 / 255.0f) << 11 |
+                                   std::lround(pixel[1] * 31 / 255.0f) << 6 |
+                                   std::lround(pixel[2] * 31 / 255.0f) << 1 | 1);
+            }
+            rgba16Buf[(size_t)y * width + x] = value;
+        }
+    }
+}
+
+void GfxRenderingAPISoftware::ResolveMSAAColorBuffer(int fbIdTarget, int fbIdSrc) {
+    const TextureSoftware& src = mFrameBuffers[fbIdSrc].color;
+    const TextureSoftware& dst = mFrameBuffers[fbIdTarget].color;
+    Blit(fbIdTarget, fbIdSrc, 0, 0, src.width, src.height, 0, 0, dst.width, dst.height);
+}
+
+std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff>
+GfxRenderingAPISoftware::GetPixelDepth(int fbId, const std::vector<std::pair<float, float>>& coordinates) {
+    std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res;
+
+    const FramebufferSoftware& fb = mFrameBuffers[fbId];
+    for (const auto& coord : coordinates) {
+        int x = coord.first;
+        int y = coord.second;
+        if (fb.invertY) {
+            y = fb.color.height - y;
+        }
+
+        uint16_t value = 0;
+        if (fb.hasDepthBuffer && x >= 0 && y >= 0 && x < (int)fb.color.width && y < (int)fb.color.height) {
+            // Same precision as reading back a 24 bit depth buffer in the OpenGL backend
+            uint32_t depth = (uint32_t)(fb.depth[(size_t)y * fb.color.width + x] * 0xFFFFFF);
+            value = (depth >> 10) << 2;
+        }
+        res.emplace(coord, value);
+    }
+
+    return res;
+}
+
+void* GfxRenderingAPISoftware::GetFramebufferTextureId(int fbId) {
+    return (void*)(uintptr_t)fbId;
+}
+
+void GfxRenderingAPISoftware::SelectTextureFb(int fbId) {
+    mBoundTextures[0] = &mFrameBuffers[fbId].color;
+}
+
+void GfxRenderingAPISoftware::DeleteTexture(uint32_t texId) {
+    auto it = mTextures.find(texId);
+    if (it == mTextures.end()) {
+        return;
+    }
+
+    for (auto& bound : mBoundTextures) {
+        if (bound == &it->second) {
+            bound = nullptr;
+        }
+    }
+    mTextures.erase(it);
+}
+
+void GfxRenderingAPISoftware::SetTextureFilter(FilteringMode mode) {
+    gfx_texture_cache_clear();
+    mCurrentFilterMode = mode;
+}
+
+FilteringMode GfxRenderingAPISoftware::GetTextureFilter() {
+    return mCurrentFilterMode;
+}
+
+void GfxRenderingAPISoftware::SetSrgbMode() {
+    mSrgbMode = true;
+}
+
+ImTextureID GfxRenderingAPISoftware::GetTextureById(int id) {
+    return (ImTextureID)(uintptr_t)id;
+}
+
+const FramebufferSoftware* GfxRenderingAPISoftware::GetFramebuffer(int fbId) const {
+    if (fbId < 0 || fbId >= (int)mFrameBuffers.size()) {
+        return nullptr;
+    }
+    return &mFrameBuffers[fbId];
+}
+} // namespace Fast
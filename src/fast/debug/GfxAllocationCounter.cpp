@@ -0,0 +1,27 @@
+#include "fast/debug/GfxAllocationCounter.h"
+#include <atomic>
+
+namespace Fast {
+
+static std::atomic<GfxAllocationCounter::Source> sSource = nullptr;
+static thread_local uint64_t sStartCount = 0;
+
+void GfxAllocationCounter::SetSource(Source source) {
+    sSource.store(source, std::memory_order_relaxed);
+}
+
+bool GfxAllocationCounter::IsAvailable() {
+    return sSource.load(std::memory_order_relaxed) != nullptr;
+}
+
+void GfxAllocationCounter::Start() {
+    const Source source = sSource.load(std::memory_order_relaxed);
+    sStartCount = source != nullptr ? source() : 0;
+}
+
+uint64_t GfxAllocationCounter::Stop() {
+    const Source source = sSource.load(std::memory_order_relaxed);
+    return source != nullptr ? source() - sStartCount : 0;
+}
+
+} // namespace Fast
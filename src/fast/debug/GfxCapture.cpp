@@ -0,0 +1,420 @@
+#include "fast/debug/GfxCapture.h"
+#include "fast/interpreter.h"
+#include "ship/Context.h"
+#include "ship/resource/File.h"
+#include "ship/resource/ResourceManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <zip.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace Fast {
+
+#define CAPTURE_HEADER_PATH "__capture/header.json"
+#define CAPTURE_MEMORY_PATH "__capture/memory.bin"
+#define CAPTURE_MTX_PATH "__capture/mtx_replacements.bin"
+#define CAPTURE_FORMAT_NAME "lus-gfx-capture"
+
+// Captured memory is mapped in chunks of the largest common allocation granularity (64 KiB on Windows)
+constexpr uintptr_t CAPTURE_MAP_GRANULARITY = 0x10000;
+
+template <typename T> static void WriteValue(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T> static bool ReadValue(const std::vector<uint8_t>& in, size_t& pos, T& value) {
+    if (pos + sizeof(T) > in.size()) {
+        return false;
+    }
+    memcpy(&value, in.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+static bool AddZipEntry(zip_t* zip, const std::string& name, const void* data, size_t size) {
+    zip_source_t* source = zip_source_buffer(zip, data, size, 0);
+    if (source == nullptr) {
+        SPDLOG_ERROR("Failed to create zip source for {}", name);
+        return false;
+    }
+
+    zip_int64_t index = zip_file_add(zip, name.c_str(), source, ZIP_FL_ENC_UTF_8 | ZIP_FL_OVERWRITE);
+    if (index < 0) {
+        SPDLOG_ERROR("Failed to add {} to capture", name);
+        zip_source_free(source);
+        return false;
+    }
+
+    zip_set_file_compression(zip, index, ZIP_CM_DEFLATE, 0);
+    return true;
+}
+
+static bool ReadZipEntry(zip_t* zip, const std::string& name, std::vector<uint8_t>& out) {
+    zip_int64_t index = zip_name_locate(zip, name.c_str(), 0);
+    if (index < 0) {
+        SPDLOG_ERROR("Capture is missing {}", name);
+        return false;
+    }
+
+    struct zip_stat stat;
+    zip_stat_init(&stat);
+    if (zip_stat_index(zip, index, 0, &stat) != 0) {
+        SPDLOG_ERROR("Failed to stat {} in capture", name);
+        return false;
+    }
+
+    zip_file_t* file = zip_fopen_index(zip, index, 0);
+    if (file == nullptr) {
+        SPDLOG_ERROR("Failed to open {} in capture", name);
+        return false;
+    }
+
+    out.resize(stat.size);
+    bool ok = zip_fread(file, out.data(), stat.size) == (zip_int64_t)stat.size;
+    zip_fclose(file);
+    if (!ok) {
+        SPDLOG_ERROR("Failed to read {} from capture", name);
+    }
+    return ok;
+}
+
+static void* MapAt(uintptr_t addr, size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc((void*)addr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void* ptr = mmap((void*)addr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+    // Without MAP_FIXED the address is only a hint, anything else means the range is already in use
+    if (ptr != (void*)addr) {
+        munmap(ptr, size);
+        return nullptr;
+    }
+    return ptr;
+#endif
+}
+
+static void Unmap(void* addr, size_t size) {
+#ifdef _WIN32
+    VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    munmap(addr, size);
+#endif
+}
+
+void GfxCapture::Start(const std::string& path, const GfxCaptureSettings& settings) {
+    mCapturing = true;
+    mPath = path;
+    mSettings = settings;
+    mRanges.clear();
+    mResources.clear();
+}
+
+bool GfxCapture::IsCapturing() const {
+    return mCapturing;
+}
+
+void GfxCapture::AddMemory(const void* addr, size_t size) {
+    if (addr == nullptr || size == 0) {
+        return;
+    }
+    mRanges.emplace_back((uintptr_t)addr, size);
+}
+
+void GfxCapture::AddString(const char* str) {
+    if (str != nullptr) {
+        AddMemory(str, strlen(str) + 1);
+    }
+}
+
+void GfxCapture::AddResource(const char* path) {
+    if (path == nullptr) {
+        return;
+    }
+
+    auto resourceManager = Ship::Context::GetInstance()->GetResourceManager();
+    if (resourceManager->OtrSignatureCheck(path)) {
+        path += 7;
+    }
+    mResources.emplace(path);
+
+    const std::string altPath = Ship::IResource::gAltAssetPrefix + path;
+    if (resourceManager->IsAltAssetsEnabled() && resourceManager->GetArchiveManager()->HasFile(altPath)) {
+        mResources.emplace(altPath);
+    }
+}
+
+void GfxCapture::AddResource(uint64_t hash) {
+    AddResource(Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToCString(hash));
+}
+
+bool GfxCapture::Finish(const GfxMtxReplacementTable& mtxReplacements, size_t frame) {
+    mCapturing = false;
+
+    // Merge the recorded ranges so overlapping reads are only stored once
+    std::sort(mRanges.begin(), mRanges.end());
+    std::vector<std::pair<uintptr_t, uintptr_t>> blocks;
+    for (const auto& [addr, size] : mRanges) {
+        if (!blocks.empty() && addr <= blocks.back().second) {
+            blocks.back().second = std::max(blocks.back().second, addr + size);
+        } else {
+            blocks.emplace_back(addr, addr + size);
+        }
+    }
+
+    std::vector<uint8_t> memory;
+    for (const auto& [start, end] : blocks) {
+        WriteValue<uint64_t>(memory, start);
+        WriteValue<uint64_t>(memory, end - start);
+        memory.insert(memory.end(), (const uint8_t*)start, (const uint8_t*)end);
+    }
+
+    std::vector<uint8_t> replacements;
+    // The matrices are stored quantized, which quantizing again when replaying leaves as they are
+    for (size_t i = 0; i < mtxReplacements.GetMtxCount(); i++) {
+        if (const MtxF* mf = mtxReplacements.Get(frame, i)) {
+            WriteValue<uint64_t>(replacements, (uintptr_t)mtxReplacements.GetMtx(i));
+            WriteValue(replacements, *mf);
+        }
+    }
+
+    nlohmann::json header;
+    header["format"] = CAPTURE_FORMAT_NAME;
+    header["version"] = GFX_CAPTURE_VERSION;
+    header["pointer_size"] = sizeof(uintptr_t);
+    header["ucode"] = mSettings.ucode;
+    header["root"] = (uint64_t)mSettings.root;
+    header["window"] = { mSettings.windowWidth, mSettings.windowHeight };
+    header["dimensions"] = { mSettings.width, mSettings.height };
+    header["viewport"] = { mSettings.viewportX, mSettings.viewportY, mSettings.viewportWidth,
+                           mSettings.viewportHeight };
+    header["native_dimensions"] = { mSettings.nativeWidth, mSettings.nativeHeight };
+    header["internal_mul"] = mSettings.internalMul;
+    header["msaa"] = mSettings.msaaLevel;
+    header["segments"] = nlohmann::json::array();
+    for (uintptr_t segment : mSettings.segments) {
+        header["segments"].push_back((uint64_t)segment);
+    }
+    header["framebuffers"] = nlohmann::json::array();
+    for (const GfxCaptureFrameBuffer& fb : mSettings.frameBuffers) {
+        header["framebuffers"].push_back({ { "id", fb.id },
+                                           { "orig_width", fb.origWidth },
+                                           { "orig_height", fb.origHeight },
+                                           { "native_width", fb.nativeWidth },
+                                           { "native_height", fb.nativeHeight },
+                                           { "resize", fb.resize } });
+    }
+    header["resources"] = mResources;
+    const std::string headerText = header.dump(4);
+
+    int error = 0;
+    zip_t* zip = zip_open(mPath.c_str(), ZIP_CREATE | ZIP_TRUNCATE, &error);
+    if (zip == nullptr) {
+        SPDLOG_ERROR("Failed to create capture file {} ({})", mPath, error);
+        return false;
+    }
+
+    // Zip sources reference these buffers until the archive is closed
+    std::vector<std::shared_ptr<Ship::File>> files;
+    bool ok = AddZipEntry(zip, CAPTURE_HEADER_PATH, headerText.data(), headerText.size()) &&
+              AddZipEntry(zip, CAPTURE_MEMORY_PATH, memory.data(), memory.size()) &&
+              AddZipEntry(zip, CAPTURE_MTX_PATH, replacements.data(), replacements.size());
+
+    auto archiveManager = Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager();
+    for (const std::string& path : mResources) {
+        if (!ok) {
+            break;
+        }
+
+        // Only copied into the capture, the contents do not have to be copied out of the archive first
+        auto file = archiveManager->LoadFileInPlace(path);
+        if (file == nullptr || !file->IsLoaded) {
+            SPDLOG_WARN("Capture could not copy resource {}", path);
+            continue;
+        }
+        files.push_back(file);
+        ok = AddZipEntry(zip, path, file->GetData(), file->GetSize());
+    }
+
+    if (!ok) {
+        zip_discard(zip);
+        return false;
+    }
+
+    if (zip_close(zip) != 0) {
+        SPDLOG_ERROR("Failed to write capture file {}: {}", mPath, zip_strerror(zip));
+        zip_discard(zip);
+        return false;
+    }
+
+    SPDLOG_INFO("Wrote frame capture {} ({} memory blocks, {} resources)", mPath, blocks.size(), mResources.size());
+    return true;
+}
+
+GfxCaptureReplay::~GfxCaptureReplay() {
+    for (const auto& [addr, size] : mMappings) {
+        Unmap(addr, size);
+    }
+}
+
+bool GfxCaptureReplay::Load(const std::string& path) {
+    int error = 0;
+    zip_t* zip = zip_open(path.c_str(), ZIP_RDONLY, &error);
+    if (zip == nullptr) {
+        SPDLOG_ERROR("Failed to open capture file {} ({})", path, error);
+        return false;
+    }
+
+    std::vector<uint8_t> headerData, memory, replacements;
+    bool ok = ReadZipEntry(zip, CAPTURE_HEADER_PATH, headerData) && ReadZipEntry(zip, CAPTURE_MEMORY_PATH, memory) &&
+              ReadZipEntry(zip, CAPTURE_MTX_PATH, replacements);
+    zip_discard(zip);
+    if (!ok) {
+        return false;
+    }
+
+    nlohmann::json header = nlohmann::json::parse(headerData.begin(), headerData.end(), nullptr, false);
+    if (header.is_discarded() || header.value("format", "") != CAPTURE_FORMAT_NAME) {
+        SPDLOG_ERROR("{} is not a frame capture", path);
+        return false;
+    }
+    if (header["version"].get<uint32_t>() != GFX_CAPTURE_VERSION) {
+        SPDLOG_ERROR("Unsupported capture version {} in {}, expected {}", header["version"].get<uint32_t>(), path,
+                     GFX_CAPTURE_VERSION);
+        return false;
+    }
+    if (header["pointer_size"].get<size_t>() != sizeof(uintptr_t)) {
+        SPDLOG_ERROR("Capture {} was made by a {} bit build", path, header["pointer_size"].get<size_t>() * 8);
+        return false;
+    }
+
+    mSettings.ucode = header["ucode"].get<uint32_t>();
+    mSettings.root = (uintptr_t)header["root"].get<uint64_t>();
+    mSettings.windowWidth = header["window"][0].get<uint32_t>();
+    mSettings.windowHeight = header["window"][1].get<uint32_t>();
+    mSettings.width = header["dimensions"][0].get<uint32_t>();
+    mSettings.height = header["dimensions"][1].get<uint32_t>();
+    mSettings.viewportX = header["viewport"][0].get<int16_t>();
+    mSettings.viewportY = header["viewport"][1].get<int16_t>();
+    mSettings.viewportWidth = header["viewport"][2].get<uint32_t>();
+    mSettings.viewportHeight = header["viewport"][3].get<uint32_t>();
+    mSettings.nativeWidth = header["native_dimensions"][0].get<uint32_t>();
+    mSettings.nativeHeight = header["native_dimensions"][1].get<uint32_t>();
+    mSettings.internalMul = header["internal_mul"].get<float>();
+    mSettings.msaaLevel = header["msaa"].get<uint32_t>();
+    mSettings.segments.clear();
+    for (const auto& segment : header["segments"]) {
+        mSettings.segments.push_back((uintptr_t)segment.get<uint64_t>());
+    }
+    mSettings.frameBuffers.clear();
+    for (const auto& fb : header["framebuffers"]) {
+        mSettings.frameBuffers.push_back({ fb["id"].get<int>(), fb["orig_width"].get<uint32_t>(),
+                                           fb["orig_height"].get<uint32_t>(), fb["native_width"].get<uint32_t>(),
+                                           fb["native_height"].get<uint32_t>(), fb["resize"].get<bool>() });
+    }
+
+    // Collect the blocks first so they can be mapped as few, granularity aligned regions
+    std::vector<std::tuple<uintptr_t, size_t, size_t>> blocks;
+    std::vector<std::pair<uintptr_t, uintptr_t>> regions;
+    size_t pos = 0;
+    while (pos < memory.size()) {
+        uint64_t addr, size;
+        if (!ReadValue(memory, pos, addr) || !ReadValue(memory, pos, size) || pos + size > memory.size()) {
+            SPDLOG_ERROR("Capture {} has a truncated memory snapshot", path);
+            return false;
+        }
+        blocks.emplace_back((uintptr_t)addr, pos, size);
+
+        uintptr_t start = (uintptr_t)addr & ~(CAPTURE_MAP_GRANULARITY - 1);
+        uintptr_t end = ((uintptr_t)(addr + size) + CAPTURE_MAP_GRANULARITY - 1) & ~(CAPTURE_MAP_GRANULARITY - 1);
+        if (!regions.empty() && start <= regions.back().second) {
+            regions.back().second = std::max(regions.back().second, end);
+        } else {
+            regions.emplace_back(start, end);
+        }
+        pos += size;
+    }
+
+    for (const auto& [start, end] : regions) {
+        void* mapping = MapAt(start, end - start);
+        if (mapping == nullptr) {
+            SPDLOG_ERROR("Failed to map captured memory at 0x{:X}-0x{:X}, the range is already in use", start, end);
+            return false;
+        }
+        mMappings.emplace_back(mapping, end - start);
+    }
+
+    for (const auto& [addr, offset, size] : blocks) {
+        memcpy((void*)addr, memory.data() + offset, size);
+    }
+
+    mMtxReplacements.clear();
+    pos = 0;
+    while (pos < replacements.size()) {
+        uint64_t addr;
+        MtxF mf;
+        if (!ReadValue(replacements, pos, addr) || !ReadValue(replacements, pos, mf)) {
+            SPDLOG_ERROR("Capture {} has truncated matrix replacements", path);
+            return false;
+        }
+        mMtxReplacements[(Mtx*)(uintptr_t)addr] = mf;
+    }
+
+    return true;
+}
+
+const GfxCaptureSettings& GfxCaptureReplay::GetSettings() const {
+    return mSettings;
+}
+
+Gfx* GfxCaptureReplay::GetDisplayList() const {
+    return (Gfx*)mSettings.root;
+}
+
+const std::unordered_map<Mtx*, MtxF>& GfxCaptureReplay::GetMtxReplacements() const {
+    return mMtxReplacements;
+}
+
+void GfxCaptureReplay::ApplySettings(Interpreter* interpreter) const {
+    interpreter->SetMsaaLevel(mSettings.msaaLevel);
+    interpreter->SetResolutionMultiplier(mSettings.internalMul);
+    interpreter->SetNativeDimensions(mSettings.nativeWidth, mSettings.nativeHeight);
+    interpreter->mCurDimensions.width = mSettings.width;
+    interpreter->mCurDimensions.height = mSettings.height;
+    interpreter->mGameWindowViewport.x = mSettings.viewportX;
+    interpreter->mGameWindowViewport.y = mSettings.viewportY;
+    interpreter->mGameWindowViewport.width = mSettings.viewportWidth;
+    interpreter->mGameWindowViewport.height = mSettings.viewportHeight;
+
+    // Game framebuffers are referenced by id from the command stream, so they are recreated in the same order
+    std::vector<GfxCaptureFrameBuffer> frameBuffers = mSettings.frameBuffers;
+    std::sort(frameBuffers.begin(), frameBuffers.end(),
+              [](const GfxCaptureFrameBuffer& a, const GfxCaptureFrameBuffer& b) { return a.id < b.id; });
+    for (const GfxCaptureFrameBuffer& fb : frameBuffers) {
+        int id = interpreter->CreateFrameBuffer(fb.origWidth, fb.origHeight, fb.nativeWidth, fb.nativeHeight,
+                                                fb.resize);
+        if (id != fb.id) {
+            SPDLOG_WARN("Captured framebuffer {} was recreated as {}", fb.id, id);
+        }
+    }
+}
+
+void GfxCaptureReplay::ApplyFrameState(Interpreter* interpreter) const {
+    gfx_set_target_ucode((UcodeHandlers)mSettings.ucode);
+    for (size_t i = 0; i < mSettings.segments.size() && i < MAX_SEGMENT_POINTERS; i++) {
+        interpreter->mSegmentPointers[i] = mSettings.segments[i];
+    }
+}
+
+} // namespace Fast
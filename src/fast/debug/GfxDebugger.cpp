@@ -51,4 +51,21 @@ bool GfxDebugger::HasBreakPoint(const std::vector<const F3DGfx*>& path) const {
     return true;
 }
 
+void GfxDebugger::RequestCapture(const std::string& path) {
+    mCapturePath = path;
+    mIsCaptureRequested = true;
+}
+
+bool GfxDebugger::IsCaptureRequested() const {
+    return mIsCaptureRequested;
+}
+
+const std::string& GfxDebugger::GetCapturePath() const {
+    return mCapturePath;
+}
+
+void GfxDebugger::ClearCaptureRequest() {
+    mIsCaptureRequested = false;
+}
+
 } // namespace Fast
@@ -0,0 +1,160 @@
+#include "fast/debug/GfxStats.h"
+#include "fast/interpreter.h"
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+namespace Fast {
+
+void GfxStats::SetEnabled(bool enabled) {
+    mEnabled = enabled;
+}
+
+bool GfxStats::IsEnabled() const {
+    return mEnabled;
+}
+
+void GfxStats::StartFrame(const F3DGfx* root) {
+    mOpcodes = {};
+    mDisplayLists.clear();
+    mDisplayListIndex.clear();
+    mDisplayListStack.clear();
+    PushDisplayList(root);
+    mDisplayLists.front().name = "root";
+}
+
+void GfxStats::EndFrame() {
+    mLastOpcodes = mOpcodes;
+    mLastDisplayLists.swap(mDisplayLists);
+    mDisplayListStack.clear();
+}
+
+size_t GfxStats::GetDisplayList(const F3DGfx* dlist) {
+    auto [it, inserted] = mDisplayListIndex.try_emplace(dlist, mDisplayLists.size());
+    if (inserted) {
+        GfxDisplayListStats& stats = mDisplayLists.emplace_back();
+        stats.dlist = dlist;
+        stats.name = fmt::format("{}", (const void*)dlist);
+    }
+    return it->second;
+}
+
+GfxDisplayListStats* GfxStats::Current() {
+    if (mDisplayListStack.empty()) {
+        return nullptr;
+    }
+    return &mDisplayLists[mDisplayListStack.back()];
+}
+
+void GfxStats::PushDisplayList(const F3DGfx* dlist) {
+    size_t index = GetDisplayList(dlist);
+    mDisplayLists[index].calls++;
+    mDisplayListStack.push_back(index);
+}
+
+void GfxStats::BranchDisplayList(const F3DGfx* dlist) {
+    // A branch replaces the current display list, both return to the same caller
+    if (!mDisplayListStack.empty()) {
+        mDisplayListStack.pop_back();
+    }
+    PushDisplayList(dlist);
+}
+
+void GfxStats::PopDisplayList() {
+    if (!mDisplayListStack.empty()) {
+        mDisplayListStack.pop_back();
+    }
+}
+
+void GfxStats::NameDisplayList(const F3DGfx* dlist, const char* name) {
+    if (name != nullptr) {
+        mDisplayLists[GetDisplayList(dlist)].name = name;
+    }
+}
+
+void GfxStats::AddCommand(int8_t opcode, uint64_t time) {
+    GfxOpcodeStats& op = mOpcodes[(uint8_t)opcode];
+    op.count++;
+    op.time += time;
+
+    if (auto dl = Current()) {
+        dl->commands++;
+        dl->time += time;
+    }
+}
+
+void GfxStats::AddTriangle() {
+    if (auto dl = Current()) {
+        dl->triangles++;
+    }
+}
+
+void GfxStats::AddVertices(size_t count) {
+    if (auto dl = Current()) {
+        dl->vertices += count;
+    }
+}
+
+void GfxStats::AddFlush() {
+    if (auto dl = Current()) {
+        dl->flushes++;
+    }
+}
+
+void GfxStats::AddTextureImport() {
+    if (auto dl = Current()) {
+        dl->textureImports++;
+    }
+}
+
+void GfxStats::AddCulledDisplayList(const F3DGfx* dlist, size_t commands) {
+    GfxDisplayListStats* dl = dlist != nullptr ? &mDisplayLists[GetDisplayList(dlist)] : Current();
+    if (dl != nullptr) {
+        dl->culls++;
+        dl->culledCommands += commands;
+    }
+}
+
+const std::array<GfxOpcodeStats, 256>& GfxStats::GetOpcodeStats() const {
+    return mLastOpcodes;
+}
+
+const std::vector<GfxDisplayListStats>& GfxStats::GetDisplayListStats() const {
+    return mLastDisplayLists;
+}
+
+bool GfxStats::DumpOpcodeCsv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        SPDLOG_ERROR("Failed to open {} for writing", path);
+        return false;
+    }
+
+    out << "opcode,name,count,time_ns\n";
+    for (size_t i = 0; i < mLastOpcodes.size(); i++) {
+        const GfxOpcodeStats& op = mLastOpcodes[i];
+        if (op.count == 0) {
+            continue;
+        }
+        const char* name = GfxGetOpcodeName((int8_t)i);
+        out << fmt::format("0x{:02X},{},{},{}\n", i, name != nullptr ? name : "UNK", op.count, op.time);
+    }
+    return true;
+}
+
+bool GfxStats::DumpDisplayListCsv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        SPDLOG_ERROR("Failed to open {} for writing", path);
+        return false;
+    }
+
+    out << "name,calls,commands,time_ns,triangles,vertices,flushes,texture_imports,culls,culled_commands\n";
+    for (const GfxDisplayListStats& dl : mLastDisplayLists) {
+        out << fmt::format("\"{}\",{},{},{},{},{},{},{},{},{}\n", dl.name, dl.calls, dl.commands, dl.time,
+                           dl.triangles, dl.vertices, dl.flushes, dl.textureImports, dl.culls, dl.culledCommands);
+    }
+    return true;
+}
+
+} // namespace Fast
@@ -1,6 +1,7 @@
 #define NOMINMAX
 
 #include <math.h>
+#include <float.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,19 +9,25 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <any>
+#include <atomic>
 #include <map>
 #include <set>
 #include <unordered_map>
 #include <vector>
 #include <list>
 #include <stack>
+#include <chrono>
 #include "fast/resource/type/Light.h"
+#include "fast/resource/type/Vertex.h"
 
 #ifndef _LANGUAGE_C
 #define _LANGUAGE_C
 #endif
 #include "fast/debug/GfxDebugger.h"
+#include "fast/debug/GfxAllocationCounter.h"
+#include "fast/GfxMatrix.h"
 #include "fast/types.h"
 #include <string>
 
@@ -32,6 +39,7 @@
 #include "ship/window/gui/Gui.h"
 #include "ship/resource/ResourceManager.h"
 #include "ship/utils/Utils.h"
+#include "ship/utils/StrHash64.h"
 #include "ship/Context.h"
 #include "ship/config/ConsoleVariable.h"
 
@@ -39,7 +47,8 @@
 
 #include <spdlog/fmt/fmt.h>
 
-std::stack<std::string> currentDir;
+// Directories pushed by G_PUSHCD, the views point into the display lists that pushed them
+std::vector<std::string_view> currentDir;
 
 #define SEG_ADDR(seg, addr) (addr | (seg << 24) | 1)
 #define SUPPORT_CHECK(x) assert(x)
@@ -92,12 +101,12 @@ static uint32_t get_attr(Attribute attr) {
     return (*ucode_map)[attr];
 }
 
-static std::string GetPathWithoutFileName(char* filePath) {
+static std::string_view GetPathWithoutFileName(const char* filePath) {
     size_t len = strlen(filePath);
 
     for (size_t i = len - 1; (long)i >= 0; i--) {
         if (filePath[i] == '/' || filePath[i] == '\\') {
-            return std::string(filePath).substr(0, i);
+            return std::string_view(filePath, i);
         }
     }
 
@@ -106,10 +115,13 @@ static std::string GetPathWithoutFileName(char* filePath) {
 
 constexpr size_t MAX_TRI_BUFFER = 256;
 
+static std::atomic<uint32_t> sMaskedTexturesGeneration = 0;
+
 Interpreter::Interpreter() {
     mRsp = new RSP();
     mRdp = new RDP();
     mBufVbo = new float[MAX_TRI_BUFFER * (32 * 3)];
+    mMaskedTexturesGeneration = ++sMaskedTexturesGeneration;
 }
 
 Interpreter::~Interpreter() {
@@ -124,14 +136,272 @@ void GfxSetInstance(std::shared_ptr<Interpreter> gfx) {
     mInstance = gfx;
 }
 
+// Resource lookups made by the command stream go through these so a frame capture knows which resources it needs
+static void* gfx_get_resource_raw_pointer(const char* path) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddString(path);
+        g_exec_stack.capture->AddResource(path);
+    }
+    return Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(path);
+}
+
+static void* gfx_get_resource_raw_pointer(uint64_t hash) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddResource(hash);
+    }
+    return Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash);
+}
+
+// Cached resources are found without copying their path, only a miss builds the strings a load needs. The interpreter
+// keeps raw pointers into what it loads, such as texture data and display lists, so it pins them.
+static std::shared_ptr<Ship::IResource> gfx_load_resource_process(const char* path) {
+    auto resourceManager = Ship::Context::GetInstance()->GetResourceManager();
+    auto resource = resourceManager->FindCachedResource(path);
+    if (resource == nullptr) {
+        resource = resourceManager->LoadResourceProcess(path);
+    }
+    if (resource != nullptr) {
+        resource->Pin();
+    }
+    return resource;
+}
+
+static std::shared_ptr<Ship::IResource> gfx_load_resource(const char* path) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddString(path);
+        g_exec_stack.capture->AddResource(path);
+    }
+    return gfx_load_resource_process(path);
+}
+
+static std::shared_ptr<Ship::IResource> gfx_load_resource(uint64_t hash) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddResource(hash);
+    }
+    return gfx_load_resource_process(
+        Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToCString(hash));
+}
+
+static std::shared_ptr<Ship::IResource> gfx_load_resource_ref(const DisplayListResourceRef& ref) {
+    auto resourceManager = Ship::Context::GetInstance()->GetResourceManager();
+    std::shared_ptr<Ship::IResource> resource;
+    if (ref.Path == nullptr) {
+        resource = resourceManager->LoadResource(ref.Hash);
+    } else {
+        resource = resourceManager->FindCachedResource(ref.Path);
+        if (resource == nullptr) {
+            resource = resourceManager->LoadResource(ref.Path);
+        }
+    }
+    if (resource != nullptr) {
+        resource->Pin();
+    }
+    return resource;
+}
+
 void Interpreter::Flush() {
+    FlushBatch();
+    DrawQueueSubmit();
+}
+
+void Interpreter::FlushBatch() {
     if (mBufVboLen > 0) {
-        mRapi->DrawTriangles(mBufVbo, mBufVboLen, mBufVboNumTris);
+        if (g_exec_stack.stats != nullptr) {
+            g_exec_stack.stats->AddFlush();
+        }
+        if (CanQueueBatch()) {
+            QueueBatch();
+        } else {
+            DrawQueueSubmit();
+            ResolveFbCopies(mDrawFb);
+            mRapi->DrawTriangles(mBufVbo, mBufVboLen, mBufVboNumTris);
+        }
         mBufVboLen = 0;
         mBufVboNumTris = 0;
     }
 }
 
+bool Interpreter::CanQueueBatch() const {
+    // Blending and decals depend on what was drawn before, and without depth writes neither does the depth buffer
+    if (!mDrawQueueEnabled || mRenderingState.depth_test_and_mask != 3 || mRenderingState.decal_mode ||
+        mRenderingState.alpha_blend) {
+        return false;
+    }
+    // Framebuffer textures are not tracked per texture, keep them in order
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        if ((mBufVboTextures & (1 << i)) != 0 && mRenderingState.mBoundTextures[i].from_fb) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Interpreter::QueueBatch() {
+    QueuedDrawState state{};
+    state.prg = mRenderingState.mShaderProgram;
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        const BoundTexture& texture = mRenderingState.mBoundTextures[i];
+        // Units the shader does not sample would only keep batches apart
+        if ((mBufVboTextures & (1 << i)) != 0 && texture.bound) {
+            state.textures[i] = texture;
+            state.samplers[i] = mTextureSamplers[texture.texture_id];
+        }
+    }
+    state.viewport = mRenderingState.viewport;
+    state.scissor = mRenderingState.scissor;
+
+    if (mDrawQueue.states.empty() || mDrawQueue.states.back() != state) {
+        mDrawQueue.states.push_back(state);
+    }
+    mDrawQueue.draws.push_back({ (uint32_t)mDrawQueue.states.size() - 1, (uint32_t)mDrawQueue.draws.size(),
+                                 mDrawQueue.vbo.size(), mBufVboLen, mBufVboNumTris });
+    mDrawQueue.vbo.insert(mDrawQueue.vbo.end(), mBufVbo, mBufVbo + mBufVboLen);
+    mDrawQueue.queued_batches++;
+}
+
+void Interpreter::ApplyQueuedDrawState(const QueuedDrawState& state, const QueuedDrawState* prev,
+                                       ShaderProgram*& loaded) {
+    if (state.prg != loaded) {
+        mRapi->UnloadShader(loaded);
+        mRapi->LoadShader(state.prg);
+        loaded = state.prg;
+    }
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        if (!state.textures[i].bound) {
+            continue;
+        }
+        if (prev == nullptr || state.textures[i] != prev->textures[i] || state.samplers[i] != prev->samplers[i]) {
+            mRapi->SelectTexture(i, state.textures[i].texture_id);
+            mRapi->SetSamplerParameters(i, state.samplers[i].linear_filter, state.samplers[i].cms,
+                                        state.samplers[i].cmt);
+        }
+    }
+    if (prev == nullptr || state.viewport != prev->viewport) {
+        mRapi->SetViewport(state.viewport.x, state.viewport.y, state.viewport.width, state.viewport.height);
+    }
+    if (prev == nullptr || state.scissor != prev->scissor) {
+        mRapi->SetScissor(state.scissor.x, state.scissor.y, state.scissor.width, state.scissor.height);
+    }
+}
+
+void Interpreter::DrawQueueSubmit() {
+    DrawQueue& queue = mDrawQueue;
+    if (queue.draws.empty()) {
+        return;
+    }
+
+    // Batches with the same state end up next to each other, in display list order
+    std::sort(queue.draws.begin(), queue.draws.end(), [&queue](const QueuedDraw& a, const QueuedDraw& b) {
+        if (a.state != b.state) {
+            auto order = queue.states[a.state] <=> queue.states[b.state];
+            if (order != 0) {
+                return order < 0;
+            }
+        }
+        return a.order < b.order;
+    });
+
+    ResolveFbCopies(mDrawFb);
+
+    // Everything in the queue tests and writes depth without decal mode or blending
+    mRapi->SetDepthTestAndMask(true, true);
+    mRapi->SetZmodeDecal(false);
+    mRapi->SetUseAlpha(false);
+
+    ShaderProgram* loaded = mRenderingState.mShaderProgram;
+    const QueuedDrawState* prev = nullptr;
+    for (size_t i = 0; i < queue.draws.size();) {
+        const QueuedDrawState& state = queue.states[queue.draws[i].state];
+        size_t len = queue.draws[i].vbo_len;
+        size_t numTris = queue.draws[i].num_tris;
+        bool contiguous = true;
+        size_t end = i + 1;
+        // Merged draws stay within the size of a batch, which is what the backends expect
+        while (end < queue.draws.size() && numTris + queue.draws[end].num_tris <= MAX_TRI_BUFFER &&
+               (queue.draws[end].state == queue.draws[i].state || queue.states[queue.draws[end].state] == state)) {
+            contiguous &= queue.draws[end].vbo_offset == queue.draws[end - 1].vbo_offset + queue.draws[end - 1].vbo_len;
+            len += queue.draws[end].vbo_len;
+            numTris += queue.draws[end].num_tris;
+            end++;
+        }
+
+        float* vbo = &queue.vbo[queue.draws[i].vbo_offset];
+        if (!contiguous) {
+            queue.merged.clear();
+            for (size_t j = i; j < end; j++) {
+                const float* data = &queue.vbo[queue.draws[j].vbo_offset];
+                queue.merged.insert(queue.merged.end(), data, data + queue.draws[j].vbo_len);
+            }
+            vbo = queue.merged.data();
+        }
+
+        ApplyQueuedDrawState(state, prev, loaded);
+        mRapi->DrawTriangles(vbo, len, numTris);
+        queue.submitted_draws++;
+        prev = &state;
+        i = end;
+    }
+
+    // Put back the state the interpreter expects, starting with the samplers of every texture that was drawn with
+    for (const QueuedDrawState& state : queue.states) {
+        for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+            uint32_t textureId = state.textures[i].texture_id;
+            if (state.textures[i].bound && state.samplers[i] != mTextureSamplers[textureId]) {
+                const TextureSampler& sampler = mTextureSamplers[textureId];
+                mRapi->SelectTexture(i, textureId);
+                mRapi->SetSamplerParameters(i, sampler.linear_filter, sampler.cms, sampler.cmt);
+            }
+        }
+    }
+    for (int i = 0; i < SHADER_MAX_TEXTURES; i++) {
+        const BoundTexture& texture = mRenderingState.mBoundTextures[i];
+        if (texture.from_fb) {
+            mRapi->SelectTextureFb(texture.texture_id);
+        } else if (texture.bound) {
+            mRapi->SelectTexture(i, texture.texture_id);
+        }
+    }
+    if (loaded != mRenderingState.mShaderProgram) {
+        mRapi->UnloadShader(loaded);
+        if (mRenderingState.mShaderProgram != nullptr) {
+            mRapi->LoadShader(mRenderingState.mShaderProgram);
+        }
+    }
+    mRapi->SetViewport(mRenderingState.viewport.x, mRenderingState.viewport.y, mRenderingState.viewport.width,
+                       mRenderingState.viewport.height);
+    mRapi->SetScissor(mRenderingState.scissor.x, mRenderingState.scissor.y, mRenderingState.scissor.width,
+                      mRenderingState.scissor.height);
+    mRapi->SetDepthTestAndMask(mRenderingState.depth_test_and_mask & 1, mRenderingState.depth_test_and_mask & 2);
+    mRapi->SetZmodeDecal(mRenderingState.decal_mode);
+    mRapi->SetUseAlpha(mRenderingState.alpha_blend);
+
+    queue.states.clear();
+    queue.draws.clear();
+    queue.vbo.clear();
+}
+
+void Interpreter::BindTexture(int i, uint32_t textureId) {
+    mRapi->SelectTexture(i, textureId);
+    mRenderingState.mBoundTextures[i] = { textureId, true, false };
+    if (textureId >= mTextureSamplers.size()) {
+        mTextureSamplers.resize(textureId + 1);
+    }
+}
+
+void Interpreter::BindTextureFb(uint32_t fbId) {
+    ResolveFbCopies(fbId);
+    mRapi->SelectTextureFb(fbId);
+    mRenderingState.mBoundTextures[0] = { fbId, true, true };
+}
+
+void Interpreter::SetTextureSampler(int i, bool linearFilter, uint8_t cms, uint8_t cmt) {
+    mRapi->SetSamplerParameters(i, linearFilter, cms, cmt);
+    const BoundTexture& texture = mRenderingState.mBoundTextures[i];
+    if (texture.bound && !texture.from_fb) {
+        mTextureSamplers[texture.texture_id] = { linearFilter, cms, cmt };
+    }
+}
+
 ShaderProgram* Interpreter::LookupOrCreateShaderProgram(uint64_t id0, uint64_t id1) {
     ShaderProgram* prg = mRapi->LookupShader(id0, id1);
     if (prg == nullptr) {
@@ -399,7 +669,7 @@ ColorCombiner* Interpreter::LookupOrCreateColorCombiner(const ColorCombinerKey&
     if (mPrevCombiner != mColorCombinerPool.end()) {
         return &mPrevCombiner->second;
     }
-    Flush();
+    FlushBatch();
     mPrevCombiner = mColorCombinerPool.insert(std::make_pair(key, ColorCombiner())).first;
     GenerateCC(&mPrevCombiner->second, key);
     return &mPrevCombiner->second;
@@ -418,7 +688,7 @@ bool Interpreter::TextureCacheLookup(int i, const TextureCacheKey& key) {
     TextureCacheNode** n = &mRenderingState.mTextures[i];
 
     if (it != mTextureCache.map.end()) {
-        mRapi->SelectTexture(i, it->second.texture_id);
+        BindTexture(i, it->second.texture_id);
         *n = &*it;
         mTextureCache.lru.splice(mTextureCache.lru.end(), mTextureCache.lru,
                                  it->second.lru_location); // move to back
@@ -435,6 +705,8 @@ bool Interpreter::TextureCacheLookup(int i, const TextureCacheKey& key) {
 
     uint32_t texture_id;
     if (!mTextureCache.free_texture_ids.empty()) {
+        // The id is about to get new contents, queued batches have to draw with the old ones first
+        DrawQueueSubmit();
         texture_id = mTextureCache.free_texture_ids.back();
         mTextureCache.free_texture_ids.pop_back();
     } else {
@@ -446,20 +718,12 @@ bool Interpreter::TextureCacheLookup(int i, const TextureCacheKey& key) {
     node->second.texture_id = texture_id;
     node->second.lru_location = mTextureCache.lru.insert(mTextureCache.lru.end(), { it });
 
-    mRapi->SelectTexture(i, texture_id);
-    mRapi->SetSamplerParameters(i, false, 0, 0);
+    BindTexture(i, texture_id);
+    SetTextureSampler(i, false, 0, 0);
     *n = node;
     return false;
 }
 
-std::string Interpreter::GetBaseTexturePath(const std::string& path) {
-    if (path.starts_with(Ship::IResource::gAltAssetPrefix)) {
-        return path.substr(Ship::IResource::gAltAssetPrefix.length());
-    }
-
-    return path;
-}
-
 void Interpreter::TextureCacheDelete(const uint8_t* origAddr) {
     while (mTextureCache.map.bucket_count() > 0) {
         TextureCacheKey key = { origAddr, { 0 }, 0, 0, 0 }; // bucket index only depends on the address
@@ -484,7 +748,7 @@ void Interpreter::ImportTextureRgba16(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t sizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t fullImageLineSizeBytes =
@@ -499,6 +763,11 @@ void Interpreter::ImportTextureRgba16(int tile, bool importReplacement) {
         fullImageLineSizeBytes = width * 2;
     }
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(width * height * 4);
+    if (!upload) {
+        return;
+    }
+
     uint32_t i = 0;
 
     for (uint32_t y = 0; y < height; y++) {
@@ -510,23 +779,23 @@ void Interpreter::ImportTextureRgba16(int tile, bool importReplacement) {
             uint8_t r = col16 >> 11;
             uint8_t g = (col16 >> 6) & 0x1f;
             uint8_t b = (col16 >> 1) & 0x1f;
-            mTexUploadBuffer[4 * i + 0] = SCALE_5_8(r);
-            mTexUploadBuffer[4 * i + 1] = SCALE_5_8(g);
-            mTexUploadBuffer[4 * i + 2] = SCALE_5_8(b);
-            mTexUploadBuffer[4 * i + 3] = a ? 255 : 0;
+            upload[4 * i + 0] = SCALE_5_8(r);
+            upload[4 * i + 1] = SCALE_5_8(g);
+            upload[4 * i + 2] = SCALE_5_8(b);
+            upload[4 * i + 3] = a ? 255 : 0;
 
             i++;
         }
     }
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureRgba32(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes =
@@ -543,7 +812,7 @@ void Interpreter::ImportTextureIA4(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t sizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t fullImageLineSizeBytes =
@@ -551,6 +820,11 @@ void Interpreter::ImportTextureIA4(int tile, bool importReplacement) {
     uint32_t lineSizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].line_size_bytes;
     SUPPORT_CHECK(fullImageLineSizeBytes == lineSizeBytes);
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(sizeBytes * 2 * 4);
+    if (!upload) {
+        return;
+    }
+
     for (uint32_t i = 0; i < sizeBytes * 2; i++) {
         uint8_t byte = addr[i / 2];
         uint8_t part = (byte >> (4 - (i % 2) * 4)) & 0xf;
@@ -559,23 +833,23 @@ void Interpreter::ImportTextureIA4(int tile, bool importReplacement) {
         uint8_t r = intensity;
         uint8_t g = intensity;
         uint8_t b = intensity;
-        mTexUploadBuffer[4 * i + 0] = SCALE_3_8(r);
-        mTexUploadBuffer[4 * i + 1] = SCALE_3_8(g);
-        mTexUploadBuffer[4 * i + 2] = SCALE_3_8(b);
-        mTexUploadBuffer[4 * i + 3] = alpha ? 255 : 0;
+        upload[4 * i + 0] = SCALE_3_8(r);
+        upload[4 * i + 1] = SCALE_3_8(g);
+        upload[4 * i + 2] = SCALE_3_8(b);
+        upload[4 * i + 3] = alpha ? 255 : 0;
     }
 
     uint32_t width = mRdp->texture_tile[tile].line_size_bytes * 2;
     uint32_t height = sizeBytes / mRdp->texture_tile[tile].line_size_bytes;
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureIA8(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t sizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t fullImageLineSizeBytes =
@@ -583,29 +857,34 @@ void Interpreter::ImportTextureIA8(int tile, bool importReplacement) {
     uint32_t lineSizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].line_size_bytes;
     SUPPORT_CHECK(fullImageLineSizeBytes == lineSizeBytes);
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(sizeBytes * 4);
+    if (!upload) {
+        return;
+    }
+
     for (uint32_t i = 0; i < sizeBytes; i++) {
         uint8_t intensity = addr[i] >> 4;
         uint8_t alpha = addr[i] & 0xf;
         uint8_t r = intensity;
         uint8_t g = intensity;
         uint8_t b = intensity;
-        mTexUploadBuffer[4 * i + 0] = SCALE_4_8(r);
-        mTexUploadBuffer[4 * i + 1] = SCALE_4_8(g);
-        mTexUploadBuffer[4 * i + 2] = SCALE_4_8(b);
-        mTexUploadBuffer[4 * i + 3] = SCALE_4_8(alpha);
+        upload[4 * i + 0] = SCALE_4_8(r);
+        upload[4 * i + 1] = SCALE_4_8(g);
+        upload[4 * i + 2] = SCALE_4_8(b);
+        upload[4 * i + 3] = SCALE_4_8(alpha);
     }
 
     uint32_t width = mRdp->texture_tile[tile].line_size_bytes;
     uint32_t height = sizeBytes / mRdp->texture_tile[tile].line_size_bytes;
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureIA16(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t size_bytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes =
@@ -620,6 +899,11 @@ void Interpreter::ImportTextureIA16(int tile, bool importReplacement) {
         full_image_line_size_bytes = width * 2;
     }
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(width * height * 4);
+    if (!upload) {
+        return;
+    }
+
     uint32_t i = 0;
 
     for (uint32_t y = 0; y < height; y++) {
@@ -631,23 +915,23 @@ void Interpreter::ImportTextureIA16(int tile, bool importReplacement) {
             uint8_t r = intensity;
             uint8_t g = intensity;
             uint8_t b = intensity;
-            mTexUploadBuffer[4 * i + 0] = r;
-            mTexUploadBuffer[4 * i + 1] = g;
-            mTexUploadBuffer[4 * i + 2] = b;
-            mTexUploadBuffer[4 * i + 3] = alpha;
+            upload[4 * i + 0] = r;
+            upload[4 * i + 1] = g;
+            upload[4 * i + 2] = b;
+            upload[4 * i + 3] = alpha;
 
             i++;
         }
     }
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureI4(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t sizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t fullImageLineSizeBytes =
@@ -662,6 +946,11 @@ void Interpreter::ImportTextureI4(int tile, bool importReplacement) {
         fullImageLineSizeBytes = width / 2;
     }
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(width * height * 4);
+    if (!upload) {
+        return;
+    }
+
     uint32_t i = 0;
 
     for (uint32_t y = 0; y < height; y++) {
@@ -675,41 +964,46 @@ void Interpreter::ImportTextureI4(int tile, bool importReplacement) {
             uint8_t g = intensity;
             uint8_t b = intensity;
             uint8_t a = intensity;
-            mTexUploadBuffer[4 * i + 0] = SCALE_4_8(r);
-            mTexUploadBuffer[4 * i + 1] = SCALE_4_8(g);
-            mTexUploadBuffer[4 * i + 2] = SCALE_4_8(b);
-            mTexUploadBuffer[4 * i + 3] = SCALE_4_8(a);
+            upload[4 * i + 0] = SCALE_4_8(r);
+            upload[4 * i + 1] = SCALE_4_8(g);
+            upload[4 * i + 2] = SCALE_4_8(b);
+            upload[4 * i + 3] = SCALE_4_8(a);
 
             i++;
         }
     }
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureI8(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t sizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t full_image_line_size_bytes =
         mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t line_size_bytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].line_size_bytes;
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(sizeBytes * 4);
+    if (!upload) {
+        return;
+    }
+
     for (uint32_t i = 0; i < sizeBytes; i++) {
         uint8_t intensity = addr[i];
-        mTexUploadBuffer[4 * i + 0] = intensity;
-        mTexUploadBuffer[4 * i + 1] = intensity;
-        mTexUploadBuffer[4 * i + 2] = intensity;
-        mTexUploadBuffer[4 * i + 3] = intensity;
+        upload[4 * i + 0] = intensity;
+        upload[4 * i + 1] = intensity;
+        upload[4 * i + 2] = intensity;
+        upload[4 * i + 3] = intensity;
     }
 
     uint32_t width = mRdp->texture_tile[tile].line_size_bytes;
     uint32_t height = sizeBytes / mRdp->texture_tile[tile].line_size_bytes;
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureCi4(int tile, bool importReplacement) {
@@ -718,7 +1012,7 @@ void Interpreter::ImportTextureCi4(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t sizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t lineSizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].line_size_bytes;
@@ -733,6 +1027,11 @@ void Interpreter::ImportTextureCi4(int tile, bool importReplacement) {
 
     SUPPORT_CHECK(fullImageLineSizeBytes == lineSizeBytes);
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(sizeBytes * 2 * 4);
+    if (!upload) {
+        return;
+    }
+
     for (uint32_t i = 0; i < sizeBytes * 2; i++) {
         uint8_t byte = addr[i / 2];
         uint8_t idx = (byte >> (4 - (i % 2) * 4)) & 0xf;
@@ -741,10 +1040,10 @@ void Interpreter::ImportTextureCi4(int tile, bool importReplacement) {
         uint8_t r = col16 >> 11;
         uint8_t g = (col16 >> 6) & 0x1f;
         uint8_t b = (col16 >> 1) & 0x1f;
-        mTexUploadBuffer[4 * i + 0] = SCALE_5_8(r);
-        mTexUploadBuffer[4 * i + 1] = SCALE_5_8(g);
-        mTexUploadBuffer[4 * i + 2] = SCALE_5_8(b);
-        mTexUploadBuffer[4 * i + 3] = a ? 255 : 0;
+        upload[4 * i + 0] = SCALE_5_8(r);
+        upload[4 * i + 1] = SCALE_5_8(g);
+        upload[4 * i + 2] = SCALE_5_8(b);
+        upload[4 * i + 3] = a ? 255 : 0;
     }
 
     uint32_t resultLineSizeBytes = mRdp->texture_tile[tile].line_size_bytes;
@@ -755,20 +1054,27 @@ void Interpreter::ImportTextureCi4(int tile, bool importReplacement) {
     uint32_t width = resultLineSizeBytes * 2;
     uint32_t height = sizeBytes / resultLineSizeBytes;
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureCi8(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
     uint32_t sizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].size_bytes;
     uint32_t fullImageLineSizeBytes =
         mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].full_image_line_size_bytes;
     uint32_t lineSizeBytes = mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].line_size_bytes;
 
+    // Whole lines are decoded, so the last one can go past sizeBytes
+    uint32_t decodedBytes = lineSizeBytes != 0 ? (sizeBytes + lineSizeBytes - 1) / lineSizeBytes * lineSizeBytes : 0;
+    GfxStagingSlice upload = AcquireTexUploadBuffer(decodedBytes * 4);
+    if (!upload) {
+        return;
+    }
+
     for (uint32_t i = 0, j = 0; i < sizeBytes; j += fullImageLineSizeBytes - lineSizeBytes) {
         for (uint32_t k = 0; k < lineSizeBytes; i++, k++, j++) {
             uint8_t idx = addr[j];
@@ -778,10 +1084,10 @@ void Interpreter::ImportTextureCi8(int tile, bool importReplacement) {
             uint8_t r = col16 >> 11;
             uint8_t g = (col16 >> 6) & 0x1f;
             uint8_t b = (col16 >> 1) & 0x1f;
-            mTexUploadBuffer[4 * i + 0] = SCALE_5_8(r);
-            mTexUploadBuffer[4 * i + 1] = SCALE_5_8(g);
-            mTexUploadBuffer[4 * i + 2] = SCALE_5_8(b);
-            mTexUploadBuffer[4 * i + 3] = a ? 255 : 0;
+            upload[4 * i + 0] = SCALE_5_8(r);
+            upload[4 * i + 1] = SCALE_5_8(g);
+            upload[4 * i + 2] = SCALE_5_8(b);
+            upload[4 * i + 3] = a ? 255 : 0;
         }
     }
 
@@ -793,14 +1099,14 @@ void Interpreter::ImportTextureCi8(int tile, bool importReplacement) {
     uint32_t width = resultLineSizeBytes;
     uint32_t height = sizeBytes / resultLineSizeBytes;
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
 }
 
 void Interpreter::ImportTextureImg(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
 
     uint16_t width = metadata->width;
@@ -812,7 +1118,7 @@ void Interpreter::ImportTextureRaw(int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* addr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr;
 
     uint16_t width = metadata->width;
@@ -870,17 +1176,26 @@ void Interpreter::ImportTextureRaw(int tile, bool importReplacement) {
         safeFullImageLineSizeBytes = resourceImageSizeBytes;
     }
 
+    // Whole lines are copied, so the last one can go past the loaded bytes
+    size_t copiedBytes =
+        safeLineSizeBytes != 0 ? (safeLoadedBytes + safeLineSizeBytes - 1) / safeLineSizeBytes * safeLineSizeBytes : 0;
+    GfxStagingSlice upload = AcquireTexUploadBuffer(
+        std::max<size_t>({ copiedBytes, numLoadedBytes, (size_t)resultNewLineSize * resultNewHeight }));
+    if (!upload) {
+        return;
+    }
+
     // Safely only copy the amount of bytes the resource can allow
     for (uint32_t i = 0, j = 0; i < safeLoadedBytes; i += safeLineSizeBytes, j += safeFullImageLineSizeBytes) {
-        memcpy(mTexUploadBuffer + i, addr + j, safeLineSizeBytes);
+        memcpy(upload.Data() + i, addr + j, safeLineSizeBytes);
     }
 
     // Set the remaining bytes to load as 0
     if (numLoadedBytes > resourceImageSizeBytes) {
-        memset(mTexUploadBuffer + resourceImageSizeBytes, 0, numLoadedBytes - resourceImageSizeBytes);
+        memset(upload.Data() + resourceImageSizeBytes, 0, numLoadedBytes - resourceImageSizeBytes);
     }
 
-    mRapi->UploadTexture(mTexUploadBuffer, resultNewLineSize / 4, resultNewHeight);
+    mRapi->UploadTexture(upload.Data(), resultNewLineSize / 4, resultNewHeight);
 }
 
 void Interpreter::ImportTexture(int i, int tile, bool importReplacement) {
@@ -894,7 +1209,7 @@ void Interpreter::ImportTexture(int i, int tile, bool importReplacement) {
     const RawTexMetadata* metadata = &mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata;
     const uint8_t* origAddr =
         importReplacement && (metadata->resource != nullptr)
-            ? mMaskedTextures.find(GetBaseTexturePath(metadata->resource->GetInitData()->Path))->second.replacementData
+            ? mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked_texture.replacementData
             : mRdp->loaded_texture[tmemIdex].addr;
 
     TextureCacheKey key;
@@ -908,6 +1223,10 @@ void Interpreter::ImportTexture(int i, int tile, bool importReplacement) {
         return;
     }
 
+    if (g_exec_stack.stats != nullptr) {
+        g_exec_stack.stats->AddTextureImport();
+    }
+
     if ((texFlags & TEX_FLAG_LOAD_AS_IMG) != 0) {
         ImportTextureImg(tile, importReplacement);
         return;
@@ -970,20 +1289,45 @@ void Interpreter::ImportTexture(int i, int tile, bool importReplacement) {
     }
 }
 
-void Interpreter::ImportTextureMask(int i, int tile) {
-    uint32_t tmemIndex = mRdp->texture_tile[tile].tmem_index;
-    RawTexMetadata metadata = mRdp->loaded_texture[tmemIndex].raw_tex_metadata;
+void Interpreter::LookupMaskedTexture(uint32_t tmemIndex) {
+    auto& loadedTexture = mRdp->loaded_texture[tmemIndex];
+    loadedTexture.masked_texture = {};
+    loadedTexture.masked = false;
+    loadedTexture.blended = false;
 
-    if (metadata.resource == nullptr) {
+    // Most games never register one
+    if (mMaskedTextures.empty()) {
         return;
     }
 
-    auto maskIter = mMaskedTextures.find(GetBaseTexturePath(metadata.resource->GetInitData()->Path));
-    if (maskIter == mMaskedTextures.end()) {
-        return;
+    const MaskedTextureEntry* entry = nullptr;
+    Fast::Texture* texture = loadedTexture.raw_tex_metadata.resource.get();
+    if (texture != nullptr) {
+        // Looked up once per texture, the map only changes its entries through the calls that change the generation
+        if (texture->BlendedTextureGeneration != mMaskedTexturesGeneration) {
+            auto it = mMaskedTextures.find(texture->BasePathHash);
+            texture->BlendedTexture = it != mMaskedTextures.end() ? &it->second : nullptr;
+            texture->BlendedTextureGeneration = mMaskedTexturesGeneration;
+        }
+        entry = texture->BlendedTexture;
+    } else {
+        // A texture that is not a resource is looked up by the empty path
+        static const uint64_t emptyPathHash = CRC64("");
+        auto it = mMaskedTextures.find(emptyPathHash);
+        entry = it != mMaskedTextures.end() ? &it->second : nullptr;
     }
 
-    const uint8_t* orig_addr = maskIter->second.mask;
+    if (entry != nullptr) {
+        // Registered without a mask still counts as masked, ImportTextureMask skips it
+        loadedTexture.masked_texture = *entry;
+        loadedTexture.masked = true;
+        loadedTexture.blended = entry->replacementData != nullptr;
+    }
+}
+
+void Interpreter::ImportTextureMask(int i, int tile) {
+    uint32_t tmemIndex = mRdp->texture_tile[tile].tmem_index;
+    const uint8_t* orig_addr = mRdp->loaded_texture[tmemIndex].masked_texture.mask;
 
     if (orig_addr == nullptr) {
         return;
@@ -1013,22 +1357,36 @@ void Interpreter::ImportTextureMask(int i, int tile) {
             break;
     }
 
+    GfxStagingSlice upload = AcquireTexUploadBuffer(width * height * 4);
+    if (!upload) {
+        return;
+    }
+
     for (uint32_t texIndex = 0; texIndex < width * height; texIndex++) {
         uint8_t masked = orig_addr[texIndex];
         if (masked) {
-            mTexUploadBuffer[4 * texIndex + 0] = 0;
-            mTexUploadBuffer[4 * texIndex + 1] = 0;
-            mTexUploadBuffer[4 * texIndex + 2] = 0;
-            mTexUploadBuffer[4 * texIndex + 3] = 0xFF;
+            upload[4 * texIndex + 0] = 0;
+            upload[4 * texIndex + 1] = 0;
+            upload[4 * texIndex + 2] = 0;
+            upload[4 * texIndex + 3] = 0xFF;
         } else {
-            mTexUploadBuffer[4 * texIndex + 0] = 0;
-            mTexUploadBuffer[4 * texIndex + 1] = 0;
-            mTexUploadBuffer[4 * texIndex + 2] = 0;
-            mTexUploadBuffer[4 * texIndex + 3] = 0;
+            upload[4 * texIndex + 0] = 0;
+            upload[4 * texIndex + 1] = 0;
+            upload[4 * texIndex + 2] = 0;
+            upload[4 * texIndex + 3] = 0;
         }
     }
 
-    mRapi->UploadTexture(mTexUploadBuffer, width, height);
+    mRapi->UploadTexture(upload.Data(), width, height);
+}
+
+GfxStagingSlice Interpreter::AcquireTexUploadBuffer(size_t size) {
+    GfxStagingSlice upload = mTexStagingArena.Acquire(size);
+    if (!upload) {
+        SPDLOG_ERROR("Texture import of {} bytes does not fit in the staging arena ({} of {} bytes reserved)", size,
+                     mTexStagingArena.GetReserved(), mTexStagingArena.GetCapacity());
+    }
+    return upload;
 }
 
 void Interpreter::NormalizeVector(float v[3]) {
@@ -1039,19 +1397,19 @@ void Interpreter::NormalizeVector(float v[3]) {
 }
 
 void Interpreter::TransposedMatrixMul(float res[3], const float a[3], const float b[4][4]) {
-    res[0] = a[0] * b[0][0] + a[1] * b[0][1] + a[2] * b[0][2];
-    res[1] = a[0] * b[1][0] + a[1] * b[1][1] + a[2] * b[1][2];
-    res[2] = a[0] * b[2][0] + a[1] * b[2][1] + a[2] * b[2][2];
+    GfxMatrixGetKernels().TransposedMul(res, a, b);
 }
 
 void Interpreter::MatrixMul(float res[4][4], const float a[4][4], const float b[4][4]) {
-    float tmp[4][4];
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < 4; j++) {
-            tmp[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j] + a[i][3] * b[3][j];
-        }
+    GfxMatrixGetKernels().Mul(res, a, b);
+}
+
+void Interpreter::UpdateMPMatrix() {
+    if (mRsp->mp_matrix_dirty && mRsp->modelview_matrix_stack_size > 0) {
+        MatrixMul(mRsp->MP_matrix, mRsp->modelview_matrix_stack[mRsp->modelview_matrix_stack_size - 1],
+                  mRsp->P_matrix);
     }
-    memcpy(res, tmp, sizeof(tmp));
+    mRsp->mp_matrix_dirty = false;
 }
 
 void Interpreter::CalculateNormalDir(const F3DLight_t* light, float coeffs[3]) {
@@ -1065,25 +1423,16 @@ void Interpreter::CalculateNormalDir(const F3DLight_t* light, float coeffs[3]) {
 void Interpreter::GfxSpMatrix(uint8_t parameters, const int32_t* addr) {
     float matrix[4][4];
 
-    if (auto it = mCurMtxReplacements->find((Mtx*)addr); it != mCurMtxReplacements->end()) {
-        for (int i = 0; i < 4; i++) {
-            for (int j = 0; j < 4; j++) {
-                float v = it->second.mf[i][j];
-                int as_int = (int)(v * 65536.0f);
-                matrix[i][j] = as_int * (1.0f / 65536.0f);
-            }
-        }
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddMemory(addr, sizeof(Mtx));
+    }
+
+    if (const MtxF* replacement = mCurMtxReplacements->Find(mCurMtxReplacementFrame, (const Mtx*)addr)) {
+        memcpy(matrix, replacement->mf, sizeof(matrix));
     } else {
 #ifndef GBI_FLOATS
         // Original GBI where fixed point matrices are used
-        for (int i = 0; i < 4; i++) {
-            for (int j = 0; j < 4; j += 2) {
-                int32_t int_part = addr[i * 2 + j / 2];
-                uint32_t frac_part = addr[8 + i * 2 + j / 2];
-                matrix[i][j] = (int32_t)((int_part & 0xffff0000) | (frac_part >> 16)) / 65536.0f;
-                matrix[i][j + 1] = (int32_t)((int_part << 16) | (frac_part & 0xffff)) / 65536.0f;
-            }
-        }
+        GfxMatrixGetKernels().UnpackFixed(matrix, addr);
 #else
         // For a modified GBI where fixed point values are replaced with floats
         memcpy(matrix, addr, sizeof(matrix));
@@ -1116,17 +1465,19 @@ void Interpreter::GfxSpMatrix(uint8_t parameters, const int32_t* addr) {
         }
         mRsp->lights_changed = 1;
     }
-    MatrixMul(mRsp->MP_matrix, mRsp->modelview_matrix_stack[mRsp->modelview_matrix_stack_size - 1], mRsp->P_matrix);
+    // Several matrices are often loaded back to back, the product is only needed by the next vertices
+    mRsp->mp_matrix_dirty = true;
 }
 
 void Interpreter::GfxSpPopMatrix(uint32_t count) {
     while (count--) {
         if (mRsp->modelview_matrix_stack_size > 0) {
-            --mRsp->modelview_matrix_stack_size;
-            if (mRsp->modelview_matrix_stack_size > 0) {
-                MatrixMul(mRsp->MP_matrix, mRsp->modelview_matrix_stack[mRsp->modelview_matrix_stack_size - 1],
-                          mRsp->P_matrix);
+            if (mRsp->modelview_matrix_stack_size == 1) {
+                // An empty stack keeps the product of its last matrix
+                UpdateMPMatrix();
             }
+            --mRsp->modelview_matrix_stack_size;
+            mRsp->mp_matrix_dirty = mRsp->modelview_matrix_stack_size > 0;
         }
     }
     mRsp->lights_changed = true;
@@ -1155,6 +1506,14 @@ void Interpreter::AdjustWidthHeightForScale(uint32_t& width, uint32_t& height, u
 }
 
 void Interpreter::GfxSpVertex(size_t n_vertices, size_t dest_index, const F3DVtx* vertices) {
+    if (g_exec_stack.stats != nullptr) {
+        g_exec_stack.stats->AddVertices(n_vertices);
+    }
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddMemory(vertices, n_vertices * sizeof(F3DVtx));
+    }
+
+    UpdateMPMatrix();
     for (size_t i = 0; i < n_vertices; i++, dest_index++) {
         const F3DVtx_t* v = &vertices[i].v;
         const F3DVtx_tn* vn = &vertices[i].n;
@@ -1361,6 +1720,11 @@ void Interpreter::GfxSpTri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx
 
     // if (rand()%2) return;
 
+    if (g_exec_stack.culled_depth != 0) {
+        // Inside a display list culled for being off screen, which only runs for the state it sets
+        return;
+    }
+
     if (v1->clip_rej & v2->clip_rej & v3->clip_rej) {
         // The whole triangle lies outside the visible area
         return;
@@ -1409,26 +1773,26 @@ void Interpreter::GfxSpTri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx
     bool depth_mask = (mRdp->other_mode_l & Z_UPD) == Z_UPD;
     uint8_t depth_test_and_mask = (depth_test ? 1 : 0) | (depth_mask ? 2 : 0);
     if (depth_test_and_mask != mRenderingState.depth_test_and_mask) {
-        Flush();
+        FlushBatch();
         mRapi->SetDepthTestAndMask(depth_test, depth_mask);
         mRenderingState.depth_test_and_mask = depth_test_and_mask;
     }
 
     bool zmode_decal = (mRdp->other_mode_l & ZMODE_DEC) == ZMODE_DEC;
     if (zmode_decal != mRenderingState.decal_mode) {
-        Flush();
+        FlushBatch();
         mRapi->SetZmodeDecal(zmode_decal);
         mRenderingState.decal_mode = zmode_decal;
     }
 
     if (mRdp->viewport_or_scissor_changed) {
         if (memcmp(&mRdp->viewport, &mRenderingState.viewport, sizeof(mRdp->viewport)) != 0) {
-            Flush();
+            FlushBatch();
             mRapi->SetViewport(mRdp->viewport.x, mRdp->viewport.y, mRdp->viewport.width, mRdp->viewport.height);
             mRenderingState.viewport = mRdp->viewport;
         }
         if (memcmp(&mRdp->scissor, &mRenderingState.scissor, sizeof(mRdp->scissor)) != 0) {
-            Flush();
+            FlushBatch();
             mRapi->SetScissor(mRdp->scissor.x, mRdp->scissor.y, mRdp->scissor.width, mRdp->scissor.height);
             mRenderingState.scissor = mRdp->scissor;
         }
@@ -1518,7 +1882,7 @@ void Interpreter::GfxSpTri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx
         uint32_t tile = mRdp->first_tile_index + i;
         if (comb->usedTextures[i]) {
             if (mRdp->textures_changed[i]) {
-                Flush();
+                FlushBatch();
                 ImportTexture(i, tile, false);
                 if (mRdp->loaded_texture[i].masked) {
                     ImportTextureMask(SHADER_FIRST_MASK_TEXTURE + i, tile);
@@ -1578,14 +1942,14 @@ void Interpreter::GfxSpTri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx
             bool linear_filter = (mRdp->other_mode_h & (3U << G_MDSFT_TEXTFILT)) != G_TF_POINT;
             if (linear_filter != mRenderingState.mTextures[i]->second.linear_filter ||
                 cms != mRenderingState.mTextures[i]->second.cms || cmt != mRenderingState.mTextures[i]->second.cmt) {
-                Flush();
+                FlushBatch();
 
                 // Set the same sampler params on the blended texture. Needed for opengl.
                 if (mRdp->loaded_texture[i].blended) {
-                    mRapi->SetSamplerParameters(SHADER_FIRST_REPLACEMENT_TEXTURE + i, linear_filter, cms, cmt);
+                    SetTextureSampler(SHADER_FIRST_REPLACEMENT_TEXTURE + i, linear_filter, cms, cmt);
                 }
 
-                mRapi->SetSamplerParameters(i, linear_filter, cms, cmt);
+                SetTextureSampler(i, linear_filter, cms, cmt);
                 mRenderingState.mTextures[i]->second.linear_filter = linear_filter;
                 mRenderingState.mTextures[i]->second.cms = cms;
                 mRenderingState.mTextures[i]->second.cmt = cmt;
@@ -1599,13 +1963,13 @@ void Interpreter::GfxSpTri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx
             LookupOrCreateShaderProgram(comb->shader_id0, comb->shader_id1 | tm * SHADER_OPT(TEXEL0_CLAMP_S));
     }
     if (prg != mRenderingState.mShaderProgram) {
-        Flush();
+        FlushBatch();
         mRapi->UnloadShader(mRenderingState.mShaderProgram);
         mRapi->LoadShader(prg);
         mRenderingState.mShaderProgram = prg;
     }
     if (use_alpha != mRenderingState.alpha_blend) {
-        Flush();
+        FlushBatch();
         mRapi->SetUseAlpha(use_alpha);
         mRenderingState.alpha_blend = use_alpha;
     }
@@ -1614,6 +1978,20 @@ void Interpreter::GfxSpTri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx
 
     mRapi->ShaderGetInfo(prg, &numInputs, usedTextures);
 
+    // The shader only changes with a new batch, and so do the units it samples
+    mBufVboTextures = 0;
+    for (int i = 0; i < 2; i++) {
+        if (usedTextures[i]) {
+            mBufVboTextures |= 1 << (SHADER_FIRST_TEXTURE + i);
+            if (mRdp->loaded_texture[i].masked) {
+                mBufVboTextures |= 1 << (SHADER_FIRST_MASK_TEXTURE + i);
+            }
+            if (mRdp->loaded_texture[i].blended) {
+                mBufVboTextures |= 1 << (SHADER_FIRST_REPLACEMENT_TEXTURE + i);
+            }
+        }
+    }
+
     struct GfxClipParameters clip_parameters = mRapi->GetClipParameters();
 
     for (int i = 0; i < 3; i++) {
@@ -1770,9 +2148,13 @@ void Interpreter::GfxSpTri1(uint8_t vtx1_idx, uint8_t vtx2_idx, uint8_t vtx3_idx
         // mBufVbo[mBufVboLen++] = color->a / 255.0f;
     }
 
+    if (g_exec_stack.stats != nullptr) {
+        g_exec_stack.stats->AddTriangle();
+    }
+
     if (++mBufVboNumTris == MAX_TRI_BUFFER) {
         // if (++mBufVbo_num_tris == 1) {
-        Flush();
+        FlushBatch();
     }
 }
 
@@ -1838,14 +2220,23 @@ void Interpreter::CalcAndSetViewport(const F3DVp_t* viewport) {
 void Interpreter::GfxSpMovememF3dex2(uint8_t index, uint8_t offset, const void* data) {
     switch (index) {
         case F3DEX2_G_MV_VIEWPORT:
+            if (g_exec_stack.capture != nullptr) {
+                g_exec_stack.capture->AddMemory(data, sizeof(F3DVp_t));
+            }
             CalcAndSetViewport((const F3DVp_t*)data);
             break;
         case F3DEX2_G_MV_LIGHT: {
             int lightidx = offset / 24 - 2;
             if (lightidx >= 0 && lightidx <= MAX_LIGHTS) { // skip lookat
+                if (g_exec_stack.capture != nullptr) {
+                    g_exec_stack.capture->AddMemory(data, sizeof(F3DLight));
+                }
                 // NOTE: reads out of bounds if it is an ambient light
                 memcpy(mRsp->current_lights + lightidx, data, sizeof(F3DLight));
             } else if (lightidx < 0) {
+                if (g_exec_stack.capture != nullptr) {
+                    g_exec_stack.capture->AddMemory(data, sizeof(F3DLight_t));
+                }
                 memcpy(mRsp->lookat + offset / 24, data, sizeof(F3DLight_t)); // TODO Light?
             }
             break;
@@ -1854,6 +2245,10 @@ void Interpreter::GfxSpMovememF3dex2(uint8_t index, uint8_t offset, const void*
 }
 
 void Interpreter::GfxSpMovememF3d(uint8_t index, uint8_t offset, const void* data) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddMemory(data, index == F3DEX_G_MV_VIEWPORT ? sizeof(F3DVp_t) : sizeof(F3DLight_t));
+    }
+
     switch (index) {
         case F3DEX_G_MV_VIEWPORT:
             CalcAndSetViewport((const F3DVp_t*)data);
@@ -2008,6 +2403,10 @@ void Interpreter::GfxDpSetTileSize(uint8_t tile, uint16_t uls, uint16_t ult, uin
 void Interpreter::GfxDpLoadTlut(uint8_t tile, uint32_t high_index) {
     SUPPORT_CHECK(mRdp->texture_to_load.siz == G_IM_SIZ_16b);
 
+    if (g_exec_stack.capture != nullptr && mRdp->texture_to_load.raw_tex_metadata.resource == nullptr) {
+        g_exec_stack.capture->AddMemory(mRdp->texture_to_load.addr, (high_index + 1) * 2);
+    }
+
     if (mRdp->texture_tile[tile].tmem == 256) {
         mRdp->palettes[0] = mRdp->texture_to_load.addr;
         if (high_index == 255) {
@@ -2054,23 +2453,14 @@ void Interpreter::GfxDpLoadBlock(uint8_t tile, uint32_t uls, uint32_t ult, uint3
     mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].tex_flags = mRdp->texture_to_load.tex_flags;
     mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata = mRdp->texture_to_load.raw_tex_metadata;
     mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr = mRdp->texture_to_load.addr;
+    if (g_exec_stack.capture != nullptr && mRdp->texture_to_load.raw_tex_metadata.resource == nullptr) {
+        g_exec_stack.capture->AddMemory(mRdp->texture_to_load.addr, size_bytes);
+    }
     // fprintf(stderr, "GfxDpLoadBlock: line_size = 0x%x; orig = 0x%x; bpp=%d; lrs=%d\n", size_bytes,
     // orig_size_bytes,
     //         mRdp->texture_to_load.siz, lrs);
 
-    const std::string& texPath =
-        mRdp->texture_to_load.raw_tex_metadata.resource != nullptr
-            ? GetBaseTexturePath(mRdp->texture_to_load.raw_tex_metadata.resource->GetInitData()->Path)
-            : "";
-    auto maskedTextureIter = mMaskedTextures.find(texPath);
-    if (maskedTextureIter != mMaskedTextures.end()) {
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked = true;
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].blended =
-            maskedTextureIter->second.replacementData != nullptr;
-    } else {
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked = false;
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].blended = false;
-    }
+    LookupMaskedTexture(mRdp->texture_tile[tile].tmem_index);
 
     mRdp->textures_changed[mRdp->texture_tile[tile].tmem_index] = true;
 }
@@ -2127,21 +2517,13 @@ void Interpreter::GfxDpLoadTile(uint8_t tile, uint32_t uls, uint32_t ult, uint32
     mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].tex_flags = mRdp->texture_to_load.tex_flags;
     mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].raw_tex_metadata = mRdp->texture_to_load.raw_tex_metadata;
     mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].addr = mRdp->texture_to_load.addr + start_offset_bytes;
-
-    const std::string& texPath =
-        mRdp->texture_to_load.raw_tex_metadata.resource != nullptr
-            ? GetBaseTexturePath(mRdp->texture_to_load.raw_tex_metadata.resource->GetInitData()->Path)
-            : "";
-    auto maskedTextureIter = mMaskedTextures.find(texPath);
-    if (maskedTextureIter != mMaskedTextures.end()) {
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked = true;
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].blended =
-            maskedTextureIter->second.replacementData != nullptr;
-    } else {
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].masked = false;
-        mRdp->loaded_texture[mRdp->texture_tile[tile].tmem_index].blended = false;
+    if (g_exec_stack.capture != nullptr && mRdp->texture_to_load.raw_tex_metadata.resource == nullptr) {
+        g_exec_stack.capture->AddMemory(mRdp->texture_to_load.addr + start_offset_bytes,
+                                        full_image_line_size_bytes * (tile_height - 1) + tile_line_size_bytes);
     }
 
+    LookupMaskedTexture(mRdp->texture_tile[tile].tmem_index);
+
     mRdp->texture_tile[tile].uls = uls;
     mRdp->texture_tile[tile].ult = ult;
     mRdp->texture_tile[tile].lrs = lrs;
@@ -2488,6 +2870,10 @@ void Interpreter::GfxDpSetOtherMode(uint32_t h, uint32_t l) {
 }
 
 void Interpreter::Gfxs2dexBgCopy(F3DuObjBg* bg) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddMemory(bg, sizeof(F3DuObjBg));
+    }
+
     /*
     bg->b.imageX = 0;
     bg->b.imageW = width * 4;
@@ -2509,8 +2895,8 @@ void Interpreter::Gfxs2dexBgCopy(F3DuObjBg* bg) {
     RawTexMetadata rawTexMetadata = {};
 
     if ((bool)gfx_check_image_signature((char*)data)) {
-        std::shared_ptr<Fast::Texture> tex = std::static_pointer_cast<Fast::Texture>(
-            Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess((char*)data));
+        std::shared_ptr<Fast::Texture> tex =
+            std::static_pointer_cast<Fast::Texture>(gfx_load_resource((char*)data));
         texFlags = tex->Flags;
         rawTexMetadata.width = tex->Width;
         rawTexMetadata.height = tex->Height;
@@ -2540,14 +2926,18 @@ void Interpreter::Gfxs2dexBgCopy(F3DuObjBg* bg) {
 }
 
 void Interpreter::Gfxs2dexBg1cyc(F3DuObjBg* bg) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddMemory(bg, sizeof(F3DuObjBg));
+    }
+
     uintptr_t data = (uintptr_t)bg->b.imagePtr;
 
     uint32_t texFlags = 0;
     RawTexMetadata rawTexMetadata = {};
 
     if ((bool)gfx_check_image_signature((char*)data)) {
-        std::shared_ptr<Fast::Texture> tex = std::static_pointer_cast<Fast::Texture>(
-            Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess((char*)data));
+        std::shared_ptr<Fast::Texture> tex =
+            std::static_pointer_cast<Fast::Texture>(gfx_load_resource((char*)data));
         texFlags = tex->Flags;
         rawTexMetadata.width = tex->Width;
         rawTexMetadata.height = tex->Height;
@@ -2583,6 +2973,10 @@ void Interpreter::Gfxs2dexBg1cyc(F3DuObjBg* bg) {
 }
 
 void Interpreter::Gfxs2dexRecyCopy(F3DuObjSprite* spr) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddMemory(spr, sizeof(F3DuObjSprite));
+    }
+
     s16 dsdx = 4 << 10;
     [[maybe_unused]] s16 uls = spr->s.objX << 3;
     // Flip flag only flips horizontally
@@ -2623,6 +3017,150 @@ void* Interpreter::SegAddr(uintptr_t w1) {
     }
 }
 
+bool Interpreter::ResolveDisplayListBounds(DisplayList* dl, uint32_t depth) {
+    if (dl->BoundsState != DisplayListBoundsState::Unresolved) {
+        return dl->BoundsState == DisplayListBoundsState::Bounded;
+    }
+
+    // Set first so a list that ends up calling itself is not resolved forever
+    dl->BoundsState = DisplayListBoundsState::Unbounded;
+    if (!dl->Cullable || depth > 64) {
+        return false;
+    }
+
+    float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    size_t commands = dl->Instructions.size();
+    bool setsState = dl->SetsState;
+
+    for (const DisplayListVertexRef& ref : dl->CullVertices) {
+        auto vertices = std::dynamic_pointer_cast<Vertex>(gfx_load_resource_ref(ref.Resource));
+        if (vertices == nullptr || ref.Offset + ref.Count * sizeof(F3DVtx) > vertices->GetPointerSize()) {
+            return false;
+        }
+
+        const F3DVtx* vtx = (const F3DVtx*)((const char*)vertices->GetPointer() + ref.Offset);
+        for (size_t i = 0; i < ref.Count; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                boundsMin[axis] = std::min(boundsMin[axis], (float)vtx[i].v.ob[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], (float)vtx[i].v.ob[axis]);
+            }
+        }
+    }
+
+    for (const DisplayListResourceRef& ref : dl->CullChildren) {
+        auto child = std::dynamic_pointer_cast<DisplayList>(gfx_load_resource_ref(ref));
+        if (child == nullptr || child->UCode != dl->UCode || !ResolveDisplayListBounds(child.get(), depth + 1)) {
+            return false;
+        }
+
+        for (int axis = 0; axis < 3; axis++) {
+            boundsMin[axis] = std::min(boundsMin[axis], child->BoundsMin[axis]);
+            boundsMax[axis] = std::max(boundsMax[axis], child->BoundsMax[axis]);
+        }
+        commands += child->BoundsCommands;
+        setsState = setsState || child->BoundsSetsState;
+    }
+
+    if (boundsMin[0] > boundsMax[0]) {
+        return false;
+    }
+
+    memcpy(dl->BoundsMin, boundsMin, sizeof(boundsMin));
+    memcpy(dl->BoundsMax, boundsMax, sizeof(boundsMax));
+    dl->BoundsCommands = commands;
+    dl->BoundsSetsState = setsState;
+    dl->BoundsState = DisplayListBoundsState::Bounded;
+    return true;
+}
+
+// Transforms the corners of the display list bounds the same way GfxSpVertex does. If they are all outside of the same
+// clip plane every triangle of the list would have been rejected, so none of them has to be drawn. Returns the culled
+// list, nullptr when it has to be drawn.
+std::shared_ptr<DisplayList> Interpreter::CullDisplayList(const F3DGfx* dlist, const DisplayListResourceRef& ref) {
+    if (!mDisplayListCulling || dlist == nullptr) {
+        return nullptr;
+    }
+
+    std::shared_ptr<DisplayList> dl;
+    auto it = mCullDisplayLists.find(dlist);
+    if (it != mCullDisplayLists.end()) {
+        dl = it->second.lock();
+    }
+    if (dl == nullptr && (ref.Hash != 0 || ref.Path != nullptr)) {
+        dl = std::dynamic_pointer_cast<DisplayList>(gfx_load_resource_ref(ref));
+        if (dl != nullptr) {
+            mCullDisplayLists[dlist] = dl;
+        }
+    }
+
+    if (dl == nullptr || (const F3DGfx*)dl->GetPointer() != dlist || dl->UCode != ucode_handler_index ||
+        !ResolveDisplayListBounds(dl.get(), 0)) {
+        return nullptr;
+    }
+
+    UpdateMPMatrix();
+    uint8_t clipRej = 0xFF;
+    for (int i = 0; i < 8 && clipRej != 0; i++) {
+        const float ob[3] = { (i & 1) ? dl->BoundsMax[0] : dl->BoundsMin[0],
+                              (i & 2) ? dl->BoundsMax[1] : dl->BoundsMin[1],
+                              (i & 4) ? dl->BoundsMax[2] : dl->BoundsMin[2] };
+        float x = ob[0] * mRsp->MP_matrix[0][0] + ob[1] * mRsp->MP_matrix[1][0] + ob[2] * mRsp->MP_matrix[2][0] +
+                  mRsp->MP_matrix[3][0];
+        float y = ob[0] * mRsp->MP_matrix[0][1] + ob[1] * mRsp->MP_matrix[1][1] + ob[2] * mRsp->MP_matrix[2][1] +
+                  mRsp->MP_matrix[3][1];
+        float z = ob[0] * mRsp->MP_matrix[0][2] + ob[1] * mRsp->MP_matrix[1][2] + ob[2] * mRsp->MP_matrix[2][2] +
+                  mRsp->MP_matrix[3][2];
+        float w = ob[0] * mRsp->MP_matrix[0][3] + ob[1] * mRsp->MP_matrix[1][3] + ob[2] * mRsp->MP_matrix[2][3] +
+                  mRsp->MP_matrix[3][3];
+        x = AdjXForAspectRatio(x);
+
+        uint8_t rej = 0;
+        rej |= x < -w ? 1 : 0;
+        rej |= x > w ? 2 : 0;
+        rej |= y < -w ? 4 : 0;
+        rej |= y > w ? 8 : 0;
+        rej |= z > w ? 32 : 0;
+        clipRej &= rej;
+    }
+
+    if (clipRej == 0) {
+        return nullptr;
+    }
+
+    // Lists that change render state still run their commands
+    if (g_exec_stack.stats != nullptr) {
+        g_exec_stack.stats->AddCulledDisplayList(dlist, dl->BoundsSetsState ? 0 : dl->BoundsCommands);
+    }
+    return dl;
+}
+
+// A culled list that only draws is skipped whole. One that changes render state is called with its triangles skipped,
+// so that the draws after it still see the combiner, textures, othermode, lights and segments it set.
+void Interpreter::CallDisplayList(F3DGfx* caller, F3DGfx* dlist, const DisplayListResourceRef& ref) {
+    const std::shared_ptr<DisplayList> culled = CullDisplayList(dlist, ref);
+    if (culled != nullptr && !culled->BoundsSetsState) {
+        return;
+    }
+
+    g_exec_stack.call(caller, dlist);
+    if (culled != nullptr && g_exec_stack.culled_depth == 0) {
+        g_exec_stack.culled_depth = g_exec_stack.cmd_stack.size();
+    }
+}
+
+bool Interpreter::CullLoadedVertices(size_t start, size_t end) {
+    if (!mDisplayListCulling || start > end || end >= MAX_VERTICES) {
+        return false;
+    }
+
+    uint8_t clipRej = 0xFF;
+    for (size_t i = start; i <= end && clipRej != 0; i++) {
+        clipRej &= mRsp->loaded_vertices[i].clip_rej;
+    }
+    return clipRej != 0;
+}
+
 #define C0(pos, width) ((cmd->words.w0 >> (pos)) & ((1U << width) - 1))
 #define C1(pos, width) ((cmd->words.w1 >> (pos)) & ((1U << width) - 1))
 
@@ -2630,6 +3168,7 @@ void GfxExecStack::start(F3DGfx* dlist) {
     while (!cmd_stack.empty())
         cmd_stack.pop();
     gfx_path.clear();
+    culled_depth = 0;
     cmd_stack.push(dlist);
     disp_stack.clear();
 }
@@ -2638,6 +3177,7 @@ void GfxExecStack::stop() {
     while (!cmd_stack.empty())
         cmd_stack.pop();
     gfx_path.clear();
+    culled_depth = 0;
 }
 
 F3DGfx*& GfxExecStack::currCmd() {
@@ -2661,16 +3201,28 @@ void GfxExecStack::branch(F3DGfx* caller) {
     cmd_stack.push(old);
 
     gfx_path.push_back(caller);
+
+    if (stats != nullptr) {
+        stats->BranchDisplayList(old);
+    }
 }
 
 void GfxExecStack::call(F3DGfx* caller, F3DGfx* callee) {
     cmd_stack.push(callee);
     gfx_path.push_back(caller);
+
+    if (stats != nullptr) {
+        stats->PushDisplayList(callee);
+    }
 }
 
 F3DGfx* GfxExecStack::ret() {
     F3DGfx* cmd = cmd_stack.top();
 
+    if (stats != nullptr) {
+        stats->PopDisplayList();
+    }
+
     cmd_stack.pop();
     if (!gfx_path.empty()) {
         gfx_path.pop_back();
@@ -2682,6 +3234,9 @@ F3DGfx* GfxExecStack::ret() {
             gfx_path.pop_back();
         }
     }
+    if (cmd_stack.size() < culled_depth) {
+        culled_depth = 0;
+    }
     return cmd;
 }
 
@@ -2701,9 +3256,31 @@ bool gfx_load_ucode_handler_f3dex2(F3DGfx** cmd) {
     return false;
 }
 
-bool gfx_cull_dl_handler_f3dex2(F3DGfx** cmd) {
-    // TODO:
-    return false;
+bool gfx_cull_dl_handler_f3dex2(F3DGfx** cmd0) {
+    Interpreter* gfx = mInstance.lock().get();
+    F3DGfx* cmd = *cmd0;
+    size_t start;
+    size_t end;
+
+    // F3D encodes the vertex range as offsets into its 40 byte vertex buffer entries
+    if (ucode_handler_index == ucode_f3d || ucode_handler_index == ucode_f3db) {
+        start = C0(0, 16) / 40;
+        end = C1(0, 16) / 40 - 1;
+    } else {
+        start = C0(0, 16) / 2;
+        end = C1(0, 16) / 2;
+    }
+
+    if (!gfx->CullLoadedVertices(start, end)) {
+        return false;
+    }
+
+    if (g_exec_stack.stats != nullptr) {
+        g_exec_stack.stats->AddCulledDisplayList(nullptr, 0);
+    }
+    gfx->mMarkerOn = false;
+    *cmd0 = g_exec_stack.ret();
+    return true;
 }
 
 bool gfx_marker_handler_otr(F3DGfx** cmd0) {
@@ -2765,8 +3342,7 @@ bool gfx_mtx_otr_filepath_handler_custom_f3dex2(F3DGfx** cmd0) {
     Interpreter* gfx = mInstance.lock().get();
     F3DGfx* cmd = *cmd0;
     const char* fileName = (const char*)cmd->words.w1;
-    const int32_t* mtx = (const int32_t*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(
-        (const char*)fileName);
+    const int32_t* mtx = (const int32_t*)gfx_get_resource_raw_pointer((const char*)fileName);
 
     if (mtx != NULL) {
         gfx->GfxSpMatrix(C0(0, 8) ^ F3DEX2_G_MTX_PUSH, mtx);
@@ -2779,8 +3355,7 @@ bool gfx_mtx_otr_filepath_handler_custom_f3d(F3DGfx** cmd0) {
     Interpreter* gfx = mInstance.lock().get();
     F3DGfx* cmd = *cmd0;
     const char* fileName = (const char*)cmd->words.w1;
-    const int32_t* mtx = (const int32_t*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(
-        (const char*)fileName);
+    const int32_t* mtx = (const int32_t*)gfx_get_resource_raw_pointer((const char*)fileName);
 
     if (mtx != NULL) {
         gfx->GfxSpMatrix(C0(16, 8), mtx);
@@ -2802,8 +3377,7 @@ bool gfx_mtx_otr_handler_custom_f3dex2(F3DGfx** cmd0) {
     F3DGfx* cmd = *cmd0;
 
     const uint64_t hash = ((uint64_t)cmd->words.w0 << 32) + cmd->words.w1;
-    const int32_t* mtx =
-        (const int32_t*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash);
+    const int32_t* mtx = (const int32_t*)gfx_get_resource_raw_pointer(hash);
 
     if (mtx != NULL) {
         Interpreter* gfx = mInstance.lock().get();
@@ -2821,8 +3395,7 @@ bool gfx_mtx_otr_handler_custom_f3d(F3DGfx** cmd0) {
     F3DGfx* cmd = *cmd0;
 
     const uint64_t hash = ((uint64_t)cmd->words.w0 << 32) + cmd->words.w1;
-    const int32_t* mtx =
-        (const int32_t*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash);
+    const int32_t* mtx = (const int32_t*)gfx_get_resource_raw_pointer(hash);
     if (mtx != nullptr) {
         cmd--;
         gfx->GfxSpMatrix(C0(16, 8), mtx);
@@ -2888,27 +3461,30 @@ bool gfx_movemem_handler_otr(F3DGfx** cmd0) {
     const uint64_t hash = ((uint64_t)(*cmd0)->words.w0 << 32) + (*cmd0)->words.w1;
 
     if (ucode_handler_index == ucode_f3dex2) {
-        gfx->GfxSpMovememF3dex2(index, offset,
-                                Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash));
+        gfx->GfxSpMovememF3dex2(index, offset, gfx_get_resource_raw_pointer(hash));
     } else {
-        auto light = (Fast::LightEntry*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash);
+        auto light = (Fast::LightEntry*)gfx_get_resource_raw_pointer(hash);
         uintptr_t data = (uintptr_t)&light->Ambient;
         gfx->GfxSpMovememF3d(index, offset, (void*)(data + (hasOffset == 1 ? 0x8 : 0)));
     }
     return false;
 }
 
-int16_t Interpreter::CreateShader(const std::string& path) {
-    std::shared_ptr<Ship::ResourceInitData> initData = std::make_shared<Ship::ResourceInitData>();
-    initData->Path = path;
-    initData->IsCustom = false;
-    initData->ByteOrder = Ship::Endianness::Native;
-    auto shader = Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->LoadFile(path);
+int16_t Interpreter::CreateShader(std::string_view path) {
+    if (auto it = mShaderIdsByPath.find(path); it != mShaderIdsByPath.end()) {
+        return it->second;
+    }
+
+    auto shader =
+        Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->LoadFile(std::string(path));
     if (shader == nullptr || !shader->IsLoaded) {
         return -1;
     }
-    shader_ids.push_back(std::string(shader->Buffer->data()));
-    return shader_ids.size() - 1;
+    // The source may not be null terminated when it is read in place from the archive
+    shader_ids.push_back(std::string(shader->GetData(), strnlen(shader->GetData(), shader->GetSize())));
+    int16_t id = shader_ids.size() - 1;
+    mShaderIdsByPath.emplace(path, id);
+    return id;
 }
 
 bool gfx_set_shader_custom(F3DGfx** cmd0) {
@@ -2922,8 +3498,7 @@ bool gfx_set_shader_custom(F3DGfx** cmd0) {
         return false;
     }
 
-    const auto path = std::string(file);
-    const auto shaderId = gfx->CreateShader(path);
+    const auto shaderId = gfx->CreateShader(file);
     gfx->mRdp->current_shader = { true, shaderId, (uint8_t)C0(16, 1) };
     return false;
 }
@@ -3009,7 +3584,7 @@ bool gfx_vtx_hash_handler_custom(F3DGfx** cmd0) {
         gfx->GfxSpVertex(C0(12, 8), C0(1, 7) - C0(12, 8), (F3DVtx*)offset);
         (*cmd0)++;
     } else {
-        F3DVtx* vtx = (F3DVtx*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash);
+        F3DVtx* vtx = (F3DVtx*)gfx_get_resource_raw_pointer(hash);
 
         if (vtx != NULL) {
             vtx = (F3DVtx*)((char*)vtx + offset);
@@ -3036,8 +3611,7 @@ bool gfx_vtx_otr_filepath_handler_custom(F3DGfx** cmd0) {
     size_t vtxCnt = cmd->words.w0;
     size_t vtxIdxOff = cmd->words.w1 >> 16;
     size_t vtxDataOff = cmd->words.w1 & 0xFFFF;
-    F3DVtx* vtx =
-        (F3DVtx*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer((const char*)fileName);
+    F3DVtx* vtx = (F3DVtx*)gfx_get_resource_raw_pointer((const char*)fileName);
     vtx += vtxDataOff;
 
     gfx->GfxSpVertex(vtxCnt, vtxIdxOff, vtx);
@@ -3047,11 +3621,14 @@ bool gfx_vtx_otr_filepath_handler_custom(F3DGfx** cmd0) {
 bool gfx_dl_otr_filepath_handler_custom(F3DGfx** cmd0) {
     F3DGfx* cmd = *cmd0;
     char* fileName = (char*)cmd->words.w1;
-    F3DGfx* nDL =
-        (F3DGfx*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer((const char*)fileName);
+    F3DGfx* nDL = (F3DGfx*)gfx_get_resource_raw_pointer((const char*)fileName);
+
+    if (g_exec_stack.stats != nullptr && nDL != nullptr) {
+        g_exec_stack.stats->NameDisplayList(nDL, fileName);
+    }
 
     if (C0(16, 1) == 0 && nDL != nullptr) {
-        g_exec_stack.call(*cmd0, nDL);
+        mInstance.lock()->CallDisplayList(*cmd0, nDL, { 0, fileName });
     } else {
         if (nDL != nullptr) {
             (*cmd0) = nDL;
@@ -3083,7 +3660,7 @@ bool gfx_dl_handler_common(F3DGfx** cmd0) {
     if (C0(16, 1) == 0) {
         // Push return address
         if (subGFX != nullptr) {
-            g_exec_stack.call(*cmd0, subGFX);
+            gfx->CallDisplayList(*cmd0, subGFX, {});
         }
     } else {
         (*cmd0) = subGFX;
@@ -3101,10 +3678,15 @@ bool gfx_dl_otr_hash_handler_custom(F3DGfx** cmd0) {
 
         uint64_t hash = ((uint64_t)(*cmd0)->words.w0 << 32) + (*cmd0)->words.w1;
 
-        F3DGfx* gfx = (F3DGfx*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash);
+        F3DGfx* gfx = (F3DGfx*)gfx_get_resource_raw_pointer(hash);
+
+        if (g_exec_stack.stats != nullptr && gfx != 0) {
+            g_exec_stack.stats->NameDisplayList(
+                gfx, Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToCString(hash));
+        }
 
         if (gfx != 0) {
-            g_exec_stack.call(cmd, gfx);
+            mInstance.lock()->CallDisplayList(cmd, gfx, { hash, nullptr });
         }
     } else {
         Interpreter* gfx = mInstance.lock().get();
@@ -3128,7 +3710,7 @@ bool gfx_dl_index_handler(F3DGfx** cmd0) {
     if (C0(16, 1) == 0) {
         // Push return address
         if (subGFX != nullptr) {
-            g_exec_stack.call((*cmd0), subGFX);
+            gfx->CallDisplayList(*cmd0, subGFX, {});
         }
     } else {
         (*cmd0) = subGFX;
@@ -3140,6 +3722,9 @@ bool gfx_dl_index_handler(F3DGfx** cmd0) {
 
 // TODO handle special OTR opcodes later...
 bool gfx_pushcd_handler_custom(F3DGfx** cmd0) {
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddString((char*)(*cmd0)->words.w1);
+    }
     gfx_push_current_dir((char*)(*cmd0)->words.w1);
     return false;
 }
@@ -3159,7 +3744,17 @@ bool gfx_branch_z_otr_handler_f3dex2(F3DGfx** cmd0) {
         (gfx->mRsp->extra_geometry_mode & G_EX_ALWAYS_EXECUTE_BRANCH) != 0) {
         uint64_t hash = ((uint64_t)(*cmd0)->words.w0 << 32) + (*cmd0)->words.w1;
 
-        F3DGfx* gfx = (F3DGfx*)Ship::Context::GetInstance()->GetResourceManager()->GetResourceRawPointer(hash);
+        if (g_exec_stack.capture != nullptr) {
+            // The branch skips the capture of consumed words in gfx_step
+            g_exec_stack.capture->AddMemory(*cmd0, sizeof(F3DGfx));
+        }
+
+        F3DGfx* gfx = (F3DGfx*)gfx_get_resource_raw_pointer(hash);
+
+        if (g_exec_stack.stats != nullptr && gfx != 0) {
+            g_exec_stack.stats->NameDisplayList(
+                gfx, Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToCString(hash));
+        }
 
         if (gfx != 0) {
             (*cmd0) = gfx;
@@ -3342,8 +3937,8 @@ bool gfx_set_timg_handler_rdp(F3DGfx** cmd0) {
 
     if ((i & 1) != 1) {
         if (gfx_check_image_signature(imgData) == 1) {
-            std::shared_ptr<Fast::Texture> tex = std::static_pointer_cast<Fast::Texture>(
-                Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess(imgData));
+            std::shared_ptr<Fast::Texture> tex =
+                std::static_pointer_cast<Fast::Texture>(gfx_load_resource(imgData));
 
             if (tex == nullptr) {
                 (*cmd0)++;
@@ -3380,9 +3975,7 @@ bool gfx_set_timg_otr_hash_handler_custom(F3DGfx** cmd0) {
         return false;
     }
 
-    std::shared_ptr<Fast::Texture> texture =
-        std::static_pointer_cast<Fast::Texture>(Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess(
-            Ship::Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToCString(hash)));
+    std::shared_ptr<Fast::Texture> texture = std::static_pointer_cast<Fast::Texture>(gfx_load_resource(hash));
     if (texture != nullptr) {
         texFlags = texture->Flags;
         rawTexMetadata.width = texture->Width;
@@ -3436,8 +4029,7 @@ bool gfx_set_timg_otr_filepath_handler_custom(F3DGfx** cmd0) {
     uint32_t texFlags = 0;
     RawTexMetadata rawTexMetadata = {};
 
-    std::shared_ptr<Fast::Texture> texture = std::static_pointer_cast<Fast::Texture>(
-        Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess(fileName));
+    std::shared_ptr<Fast::Texture> texture = std::static_pointer_cast<Fast::Texture>(gfx_load_resource(fileName));
     if (texture != nullptr) {
         Interpreter* gfx = mInstance.lock().get();
         texFlags = texture->Flags;
@@ -3482,8 +4074,8 @@ bool gfx_reset_fb_handler_custom(F3DGfx** cmd0) {
     gfx->Flush();
     gfx->mFbActive = false;
     gfx->mActiveFrameBuffer = gfx->mFrameBuffers.end();
-    gfx->mRapi->StartDrawToFramebuffer(gfx->mRendersToFb ? gfx->mGameFb : 0,
-                                       (float)gfx->mCurDimensions.height / gfx->mNativeDimensions.height);
+    gfx->StartDrawToFramebuffer(gfx->mRendersToFb ? gfx->mGameFb : 0,
+                                (float)gfx->mCurDimensions.height / gfx->mNativeDimensions.height);
     // Force viewport and scissor to reapply against the main framebuffer, in case a previous smaller
     // framebuffer truncated the values
     gfx->mRdp->viewport_or_scissor_changed = true;
@@ -3520,6 +4112,11 @@ bool gfx_read_fb_handler_custom(F3DGfx** cmd0) {
     height = C1(16, 16);
 
     gfx->Flush();
+    if (g_exec_stack.capture != nullptr) {
+        // Not read, but the replay needs the destination to exist
+        g_exec_stack.capture->AddMemory(rgba16Buffer, (size_t)width * height * sizeof(uint16_t));
+    }
+    gfx->ResolveFbCopies(fbId);
     gfx->mRapi->ReadFramebufferToCPU(fbId, width, height, rgba16Buffer);
 
 #ifndef IS_BIGENDIAN
@@ -3570,7 +4167,7 @@ bool gfx_set_timg_fb_handler_custom(F3DGfx** cmd0) {
     F3DGfx* cmd = *cmd0;
 
     gfx->Flush();
-    gfx->mRapi->SelectTextureFb((uint32_t)cmd->words.w1);
+    gfx->BindTextureFb((uint32_t)cmd->words.w1);
     gfx->mRdp->textures_changed[0] = false;
     gfx->mRdp->textures_changed[1] = false;
     return false;
@@ -3897,6 +4494,19 @@ class UcodeHandler {
         }
     }
 
+    // Flattens several tables into one, earlier tables take precedence the same way they do in the generic gfx_step
+    inline constexpr UcodeHandler(std::initializer_list<const UcodeHandler*> tables) {
+        for (size_t i = 0; i < std::size(mHandlers); i++) {
+            mHandlers[i] = std::pair<const char*, GfxOpcodeHandlerFunc>(nullptr, nullptr);
+            for (const UcodeHandler* table : tables) {
+                if (table->mHandlers[i].first != nullptr) {
+                    mHandlers[i] = table->mHandlers[i];
+                    break;
+                }
+            }
+        }
+    }
+
     inline bool contains(int8_t opcode) const {
         return mHandlers[static_cast<uint8_t>(opcode)].first != nullptr;
     }
@@ -4064,6 +4674,21 @@ static constexpr std::array ucode_handlers = {
     &s2dexHandlers,  // ucode_s2dex
 };
 
+// Every opcode a microcode understands in a single table, used by the loops specialized per microcode
+static constexpr UcodeHandler f3dDispatch = { &otrHandlers, &rdpHandlers, &f3dHandlers };
+static constexpr UcodeHandler f3dexDispatch = { &otrHandlers, &rdpHandlers, &f3dexHandlers };
+static constexpr UcodeHandler f3dex2Dispatch = { &otrHandlers, &rdpHandlers, &f3dex2Handlers };
+static constexpr UcodeHandler s2dexDispatch = { &otrHandlers, &rdpHandlers, &s2dexHandlers };
+
+static constexpr std::array ucode_dispatch_handlers = {
+    &f3dDispatch,    // ucode_f3db
+    &f3dDispatch,    // ucode_f3d
+    &f3dexDispatch,  // ucode_f3dex
+    &f3dexDispatch,  // ucode_f3dexb
+    &f3dex2Dispatch, // ucode_f3dex2
+    &s2dexDispatch,  // ucode_s2dex
+};
+
 const char* GfxGetOpcodeName(int8_t opcode) {
     if (otrHandlers.contains(opcode)) {
         return otrHandlers.at(opcode).first;
@@ -4110,11 +4735,17 @@ static void gfx_set_ucode_handler(UcodeHandlers ucode) {
     }
 }
 
-static void gfx_step() {
+// Runs a single command. ucode_max looks handlers up through the otr, rdp and current microcode tables at runtime,
+// any other microcode uses its flattened table. Returns true when the command loaded a different microcode.
+template <UcodeHandlers ucode> static bool gfx_step() {
     auto& cmd = g_exec_stack.currCmd();
     auto cmd0 = cmd;
     int8_t opcode = (int8_t)(cmd->words.w0 >> 24);
 
+    if (g_exec_stack.capture != nullptr) {
+        g_exec_stack.capture->AddMemory(cmd0, sizeof(F3DGfx));
+    }
+
 #ifdef USE_GBI_TRACE
     if (cmd->words.trace.valid &&
         Ship::Context::GetInstance()->GetConsoleVariables()->GetInteger("gEnableGFXTrace", 0)) {
@@ -4130,38 +4761,121 @@ static void gfx_step() {
 #endif
 
     if (opcode == F3DEX2_G_LOAD_UCODE) {
+        UcodeHandlers previous = ucode_handler_index;
         gfx_set_ucode_handler((UcodeHandlers)(cmd->words.w0 & 0xFFFFFF));
         ++cmd;
-        return;
+        return ucode_handler_index != previous;
         // Instead of having a handler for each ucode for switching ucode, just check for it early and return.
     }
 
-    if (otrHandlers.contains(opcode)) {
-        if (otrHandlers.at(opcode).second(&cmd)) {
-            return;
-        }
-    } else if (rdpHandlers.contains(opcode)) {
-        if (rdpHandlers.at(opcode).second(&cmd)) {
-            return;
-        }
-    } else if (ucode_handler_index < ucode_handlers.size()) {
-        if (ucode_handlers[ucode_handler_index]->contains(opcode)) {
-            if (ucode_handlers[ucode_handler_index]->at(opcode).second(&cmd)) {
-                return;
+    if constexpr (ucode == ucode_max) {
+        if (otrHandlers.contains(opcode)) {
+            if (otrHandlers.at(opcode).second(&cmd)) {
+                return false;
+            }
+        } else if (rdpHandlers.contains(opcode)) {
+            if (rdpHandlers.at(opcode).second(&cmd)) {
+                return false;
+            }
+        } else if (ucode_handler_index < ucode_handlers.size()) {
+            if (ucode_handlers[ucode_handler_index]->contains(opcode)) {
+                if (ucode_handlers[ucode_handler_index]->at(opcode).second(&cmd)) {
+                    return false;
+                }
+            } else {
+                SPDLOG_CRITICAL("Unhandled OP code: 0x{:X}, for loaded ucode: {}", (uint8_t)opcode,
+                                (uint32_t)ucode_handler_index);
             }
         } else {
-            SPDLOG_CRITICAL("Unhandled OP code: 0x{:X}, for loaded ucode: {}", (uint8_t)opcode,
+            SPDLOG_CRITICAL("Unhandled OP code: 0x{:X}, invalid ucode: {}", (uint8_t)opcode,
                             (uint32_t)ucode_handler_index);
         }
     } else {
-        SPDLOG_CRITICAL("Unhandled OP code: 0x{:X}, invalid ucode: {}", (uint8_t)opcode, (uint32_t)ucode_handler_index);
+        GfxOpcodeHandlerFunc handler = ucode_dispatch_handlers[ucode]->at(opcode).second;
+        if (handler != nullptr) {
+            if (handler(&cmd)) {
+                return false;
+            }
+        } else {
+            SPDLOG_CRITICAL("Unhandled OP code: 0x{:X}, for loaded ucode: {}", (uint8_t)opcode, (uint32_t)ucode);
+        }
+    }
+
+    // Multi word commands advance cmd themselves, capture every word they consumed
+    if (g_exec_stack.capture != nullptr && cmd > cmd0) {
+        g_exec_stack.capture->AddMemory(cmd0, (cmd - cmd0 + 1) * sizeof(F3DGfx));
     }
 
     ++cmd;
+    return false;
+}
+
+// Runs commands until the display list stack is empty, a breakpoint is hit or another microcode is loaded.
+// Returns false on a breakpoint.
+template <UcodeHandlers ucode> static bool gfx_run_loop(Interpreter* gfx, GfxDebugger* dbg) {
+    while (!g_exec_stack.cmd_stack.empty()) {
+        auto cmd = g_exec_stack.cmd_stack.top();
+
+        if (dbg->IsDebugging()) {
+            g_exec_stack.gfx_path.push_back(cmd);
+            if (dbg->HasBreakPoint(g_exec_stack.gfx_path)) {
+                // On a breakpoint with the active framebuffer still set, we need to reset back to prevent
+                // soft locking the renderer
+                if (gfx->mFbActive) {
+                    gfx->mFbActive = 0;
+                    gfx->StartDrawToFramebuffer(gfx->mRendersToFb ? gfx->mGameFb : 0, 1);
+                }
+
+                return false;
+            }
+            g_exec_stack.gfx_path.pop_back();
+        }
+
+        bool ucodeChanged;
+        if (g_exec_stack.stats != nullptr) {
+            int8_t opcode = (int8_t)(cmd->words.w0 >> 24);
+            auto start = std::chrono::steady_clock::now();
+            ucodeChanged = gfx_step<ucode>();
+            auto end = std::chrono::steady_clock::now();
+            gfx->mStats.AddCommand(opcode, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        } else {
+            ucodeChanged = gfx_step<ucode>();
+        }
+
+        if (ucode != ucode_max && ucodeChanged) {
+            return true;
+        }
+    }
+    return true;
+}
+
+// Picks the loop instantiation for the current microcode, called again whenever a command loads another one
+static bool gfx_run(Interpreter* gfx, GfxDebugger* dbg) {
+    if (!gfx->mSpecializedDispatch) {
+        return gfx_run_loop<ucode_max>(gfx, dbg);
+    }
+
+    switch (ucode_handler_index) {
+        case ucode_f3db:
+            return gfx_run_loop<ucode_f3db>(gfx, dbg);
+        case ucode_f3d:
+            return gfx_run_loop<ucode_f3d>(gfx, dbg);
+        case ucode_f3dex:
+            return gfx_run_loop<ucode_f3dex>(gfx, dbg);
+        case ucode_f3dexb:
+            return gfx_run_loop<ucode_f3dexb>(gfx, dbg);
+        case ucode_f3dex2:
+            return gfx_run_loop<ucode_f3dex2>(gfx, dbg);
+        case ucode_s2dex:
+            return gfx_run_loop<ucode_s2dex>(gfx, dbg);
+        default:
+            return gfx_run_loop<ucode_max>(gfx, dbg);
+    }
 }
 
 void Interpreter::SpReset() {
     mRsp->modelview_matrix_stack_size = 1;
+    mRsp->mp_matrix_dirty = true;
     mRsp->current_num_lights = 2;
     mRsp->lights_changed = true;
     mRsp->lookat[0].dir[0] = 0;
@@ -4202,18 +4916,19 @@ void Interpreter::Init(class GfxWindowBackend* wapi, class GfxRenderingAPI* rapi
         mSegmentPointers[i] = 0;
     }
 
-    if (mTexUploadBuffer == nullptr) {
-        // We cap texture max to 8k, because why would you need more?
-        int max_tex_size = std::min(8192, mRapi->GetMaxTextureSize());
-        mTexUploadBuffer = (uint8_t*)malloc(max_tex_size * max_tex_size * 4);
-    }
+    // We cap texture max to 8k, because why would you need more?
+    size_t max_tex_size = std::min(8192, mRapi->GetMaxTextureSize());
+    // In megabytes, 0 allows the largest texture
+    int32_t stagingCapMb = Ship::Context::GetInstance()->GetConsoleVariables()->GetInteger(CVAR_TEXTURE_STAGING_CAP, 0);
+    size_t stagingCap = (size_t)std::max(stagingCapMb, 0) * 1024 * 1024;
+    mTexStagingArena.SetCapacity(stagingCap != 0 ? stagingCap : max_tex_size * max_tex_size * 4);
 
     ucode_handler_index = UcodeHandlers::ucode_f3dex2;
 }
 
 void Interpreter::Destroy() {
     // TODO: should also destroy rapi, and any other resources acquired in fast3d
-    free(mTexUploadBuffer);
+    mTexStagingArena.Trim();
     mWapi->Destroy();
 
     // Texture cache and loaded textures store references to Resources which need to be unreferenced.
@@ -4306,28 +5021,36 @@ void Interpreter::RunGuiOnly() {
 
     mGetPixelDepthPending.clear();
     mGetPixelDepthCached.clear();
+    if (mMsaaResolvePending) {
+        mMsaaResolvePending = false;
+        mFbCopyStats.elided_resolves++;
+    }
 
     mRapi->UpdateFramebufferParameters(0, mGfxCurrentWindowDimensions.width, mGfxCurrentWindowDimensions.height, 1,
                                        false, true, true, !mRendersToFb);
     mRapi->StartFrame();
-    mRapi->StartDrawToFramebuffer(mRendersToFb ? mGameFb : 0, (float)mCurDimensions.height / mNativeDimensions.height);
+    StartDrawToFramebuffer(mRendersToFb ? mGameFb : 0, (float)mCurDimensions.height / mNativeDimensions.height);
     mRapi->ClearFramebuffer(false, true);
     mRdp->viewport_or_scissor_changed = true;
     mRenderingState.viewport = {};
     mRenderingState.scissor = {};
 
     Flush();
+    // Presenting reads the game framebuffer and later frames may read the copies
+    ResolveAllFbCopies();
     mGfxFrameBuffer = 0;
 
     if (mRendersToFb) {
-        mRapi->StartDrawToFramebuffer(0, 1);
+        StartDrawToFramebuffer(0, 1);
         mRapi->ClearFramebuffer(true, true);
         if (mMsaaLevel > 1) {
             if (!ViewportMatchesRendererResolution()) {
-                mRapi->ResolveMSAAColorBuffer(mGameFbMsaaResolved, mGameFb);
+                // Resolved by GetGfxFrameBuffer when the GUI presents the frame
+                mMsaaResolvePending = true;
                 mGfxFrameBuffer = (uintptr_t)mRapi->GetFramebufferTextureId(mGameFbMsaaResolved);
             } else {
                 mRapi->ResolveMSAAColorBuffer(0, mGameFb);
+                mFbCopyStats.resolves++;
             }
         } else {
             mGfxFrameBuffer = (uintptr_t)mRapi->GetFramebufferTextureId(mGameFb);
@@ -4335,64 +5058,103 @@ void Interpreter::RunGuiOnly() {
     } else if (mFbActive) {
         // Failsafe reset to main framebuffer to prevent softlocking the renderer
         mFbActive = 0;
-        mRapi->StartDrawToFramebuffer(0, 1);
+        StartDrawToFramebuffer(0, 1);
 
         assert(0 && "active framebuffer was never reset back to original");
     }
 }
 
 void Interpreter::Run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_replacements) {
+    mMtxReplacementTable.Clear();
+    mMtxReplacementTable.AddFrame(mtx_replacements);
+    mMtxReplacementTable.Finish();
+    Run(commands, mMtxReplacementTable, 0);
+}
+
+void Interpreter::Run(Gfx* commands, const GfxMtxReplacementTable& mtxReplacements, size_t frame) {
+    GfxAllocationCounter::Start();
     SpReset();
 
     mGetPixelDepthPending.clear();
     mGetPixelDepthCached.clear();
+    if (mMsaaResolvePending) {
+        mMsaaResolvePending = false;
+        mFbCopyStats.elided_resolves++;
+    }
 
-    mCurMtxReplacements = &mtx_replacements;
+    mCurMtxReplacements = &mtxReplacements;
+    mCurMtxReplacementFrame = frame;
+
+    // Custom shaders are read from the archives, which may have changed since they were cached
+    auto resourceManager = Ship::Context::GetInstance()->GetResourceManager();
+    const uint64_t resourceGeneration = resourceManager != nullptr ? resourceManager->GetGeneration() : 0;
+    if (resourceGeneration != mResourceGeneration) {
+        mResourceGeneration = resourceGeneration;
+        mShaderIdsByPath.clear();
+    }
 
     mRapi->UpdateFramebufferParameters(0, mGfxCurrentWindowDimensions.width, mGfxCurrentWindowDimensions.height, 1,
                                        false, true, true, !mRendersToFb);
     mRapi->StartFrame();
-    mRapi->StartDrawToFramebuffer(mRendersToFb ? mGameFb : 0, (float)mCurDimensions.height / mNativeDimensions.height);
+    StartDrawToFramebuffer(mRendersToFb ? mGameFb : 0, (float)mCurDimensions.height / mNativeDimensions.height);
     mRapi->ClearFramebuffer(false, true);
     mRdp->viewport_or_scissor_changed = true;
     mRenderingState.viewport = {};
     mRenderingState.scissor = {};
 
     auto dbg = Ship::Context::GetInstance()->GetGfxDebugger();
+    // Culling changes the call paths breakpoints refer to and the resources a capture has to record
+    mDisplayListCulling =
+        Ship::Context::GetInstance()->GetConsoleVariables()->GetInteger(CVAR_DISPLAY_LIST_CULLING, 0) &&
+        !dbg->IsDebugging() && !dbg->IsCaptureRequested();
+    // Lists unloaded since the last frame are dropped, their instructions may be reused by other lists
+    if (mDisplayListCulling) {
+        std::erase_if(mCullDisplayLists, [](const auto& entry) { return entry.second.expired(); });
+    } else {
+        mCullDisplayLists.clear();
+    }
+    // A frame stopped at a breakpoint has to show what was drawn up to it
+    mDrawQueueEnabled =
+        Ship::Context::GetInstance()->GetConsoleVariables()->GetInteger(CVAR_DRAW_QUEUE, 0) && !dbg->IsDebugging();
     g_exec_stack.start((F3DGfx*)commands);
-    while (!g_exec_stack.cmd_stack.empty()) {
-        auto cmd = g_exec_stack.cmd_stack.top();
-
-        if (dbg->IsDebugging()) {
-            g_exec_stack.gfx_path.push_back(cmd);
-            if (dbg->HasBreakPoint(g_exec_stack.gfx_path)) {
-                // On a breakpoint with the active framebuffer still set, we need to reset back to prevent
-                // soft locking the renderer
-                if (mFbActive) {
-                    mFbActive = 0;
-                    mRapi->StartDrawToFramebuffer(mRendersToFb ? mGameFb : 0, 1);
-                }
-
-                break;
-            }
-            g_exec_stack.gfx_path.pop_back();
-        }
-        gfx_step();
+    g_exec_stack.stats = nullptr;
+    if (mStats.IsEnabled() && !dbg->IsDebugging()) {
+        mStats.StartFrame((F3DGfx*)commands);
+        g_exec_stack.stats = &mStats;
+    }
+    g_exec_stack.capture = nullptr;
+    if (dbg->IsCaptureRequested() && !dbg->IsDebugging()) {
+        mCapture.Start(dbg->GetCapturePath(), GetCaptureSettings(commands));
+        dbg->ClearCaptureRequest();
+        g_exec_stack.capture = &mCapture;
+    }
+    while (!g_exec_stack.cmd_stack.empty() && gfx_run(this, dbg.get())) {
     }
 
     Flush();
+    ResolveAllFbCopies();
+    if (g_exec_stack.stats != nullptr) {
+        mStats.EndFrame();
+        g_exec_stack.stats = nullptr;
+    }
+    if (g_exec_stack.capture != nullptr) {
+        mCapture.Finish(mtxReplacements, frame);
+        g_exec_stack.capture = nullptr;
+    }
     mGfxFrameBuffer = 0;
-    currentDir = std::stack<std::string>();
+    currentDir.clear();
 
     if (mRendersToFb) {
-        mRapi->StartDrawToFramebuffer(0, 1);
+        StartDrawToFramebuffer(0, 1);
         mRapi->ClearFramebuffer(true, true);
         if (mMsaaLevel > 1) {
             if (!ViewportMatchesRendererResolution()) {
-                mRapi->ResolveMSAAColorBuffer(mGameFbMsaaResolved, mGameFb);
+                // Resolved by GetGfxFrameBuffer when the GUI presents the frame
+                mMsaaResolvePending = true;
                 mGfxFrameBuffer = (uintptr_t)mRapi->GetFramebufferTextureId(mGameFbMsaaResolved);
             } else {
                 mRapi->ResolveMSAAColorBuffer(0, mGameFb);
+                mFbCopyStats.resolves++;
             }
         } else {
             mGfxFrameBuffer = (uintptr_t)mRapi->GetFramebufferTextureId(mGameFb);
@@ -4400,10 +5162,37 @@ void Interpreter::Run(Gfx* commands, const std::unordered_map<Mtx*, MtxF>& mtx_r
     } else if (mFbActive) {
         // Failsafe reset to main framebuffer to prevent softlocking the renderer
         mFbActive = 0;
-        mRapi->StartDrawToFramebuffer(0, 1);
+        StartDrawToFramebuffer(0, 1);
 
         assert(0 && "active framebuffer was never reset back to original");
     }
+    // Backends may still hold merged draws, which have to land before the GUI draws over the game
+    mRapi->FinishRender();
+    mRunAllocations = GfxAllocationCounter::Stop();
+}
+
+GfxCaptureSettings Interpreter::GetCaptureSettings(Gfx* commands) const {
+    GfxCaptureSettings settings;
+    settings.ucode = ucode_handler_index;
+    settings.root = (uintptr_t)commands;
+    settings.windowWidth = mGfxCurrentWindowDimensions.width;
+    settings.windowHeight = mGfxCurrentWindowDimensions.height;
+    settings.width = mCurDimensions.width;
+    settings.height = mCurDimensions.height;
+    settings.viewportX = mGameWindowViewport.x;
+    settings.viewportY = mGameWindowViewport.y;
+    settings.viewportWidth = mGameWindowViewport.width;
+    settings.viewportHeight = mGameWindowViewport.height;
+    settings.nativeWidth = mNativeDimensions.width;
+    settings.nativeHeight = mNativeDimensions.height;
+    settings.internalMul = mCurDimensions.internal_mul;
+    settings.msaaLevel = mMsaaLevel;
+    settings.segments.assign(std::begin(mSegmentPointers), std::end(mSegmentPointers));
+    for (const auto& [id, fb] : mFrameBuffers) {
+        settings.frameBuffers.push_back(
+            { id, fb.orig_width, fb.orig_height, fb.native_width, fb.native_height, fb.resize });
+    }
+    return settings;
 }
 
 void Interpreter::EndFrame() {
@@ -4446,7 +5235,8 @@ int Interpreter::CreateFrameBuffer(uint32_t width, uint32_t height, uint32_t nat
 }
 
 void Interpreter::SetFrameBuffer(int fb, float noiseScale) {
-    mRapi->StartDrawToFramebuffer(fb, noiseScale);
+    StartDrawToFramebuffer(fb, noiseScale);
+    ResolveFbCopies(fb);
     mRapi->ClearFramebuffer(false, true);
 }
 
@@ -4461,39 +5251,87 @@ void Interpreter::CopyFrameBuffer(int fb_dst_id, int fb_src_id, bool copyOnce, b
         fb_src_id = mGameFb;
     }
 
-    int srcX0, srcY0, srcX1, srcY1;
-    int dstX0, dstY0, dstX1, dstY1;
+    PendingFbCopy copy;
+    copy.dst_id = fb_dst_id;
+    copy.src_id = fb_src_id;
 
     // When rendering to the main window buffer or MSAA is enabled with a buffer size equal to the view port,
     // then the source coordinates must account for any docked ImGui elements
     if (fb_src_id == 0 || (mMsaaLevel > 1 && mCurDimensions.width == mGameWindowViewport.width &&
                            mCurDimensions.height == mGameWindowViewport.height)) {
-        srcX0 = mGameWindowViewport.x;
-        srcY0 = mGameWindowViewport.y;
-        srcX1 = mGameWindowViewport.x + mGameWindowViewport.width;
-        srcY1 = mGameWindowViewport.y + mGameWindowViewport.height;
+        copy.src = mGameWindowViewport;
     } else {
-        srcX0 = 0;
-        srcY0 = 0;
-        srcX1 = mCurDimensions.width;
-        srcY1 = mCurDimensions.height;
+        copy.src = { 0, 0, mCurDimensions.width, mCurDimensions.height };
     }
 
-    dstX0 = 0;
-    dstY0 = 0;
-    dstX1 = mCurDimensions.width;
-    dstY1 = mCurDimensions.height;
-
-    mRapi->CopyFramebuffer(fb_dst_id, fb_src_id, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1);
+    copy.dst = { 0, 0, mCurDimensions.width, mCurDimensions.height };
 
     // Set the copied pointer if we have one
     if (hasCopiedPtr != nullptr) {
         *hasCopiedPtr = true;
     }
+
+    mFbCopyStats.requested++;
+    if (copy.dst_id == copy.src_id && copy.dst == copy.src) {
+        mFbCopyStats.elided++;
+        return;
+    }
+
+    // A pending copy to the same region is overwritten by this one, unless a copy after it reads its destination
+    bool read = copy.src_id == copy.dst_id;
+    for (size_t i = mPendingFbCopies.size(); i-- > 0;) {
+        const PendingFbCopy& pending = mPendingFbCopies[i];
+        if (!read && pending.dst_id == copy.dst_id && pending.dst == copy.dst) {
+            mPendingFbCopies.erase(mPendingFbCopies.begin() + i);
+            mFbCopyStats.elided++;
+        } else if (pending.src_id == copy.dst_id) {
+            read = true;
+        }
+    }
+    mPendingFbCopies.push_back(copy);
+}
+
+void Interpreter::ResolveFbCopies(int fbId) {
+    size_t end = 0;
+    for (size_t i = 0; i < mPendingFbCopies.size(); i++) {
+        if (mPendingFbCopies[i].dst_id == fbId || mPendingFbCopies[i].src_id == fbId) {
+            end = i + 1;
+        }
+    }
+
+    // The copies before the last one that involves the framebuffer may write what it reads, so they go first
+    for (size_t i = 0; i < end; i++) {
+        const PendingFbCopy& copy = mPendingFbCopies[i];
+        mRapi->CopyFramebuffer(copy.dst_id, copy.src_id, copy.src.x, copy.src.y, copy.src.x + copy.src.width,
+                               copy.src.y + copy.src.height, copy.dst.x, copy.dst.y, copy.dst.x + copy.dst.width,
+                               copy.dst.y + copy.dst.height);
+        mFbCopyStats.performed++;
+    }
+    mPendingFbCopies.erase(mPendingFbCopies.begin(), mPendingFbCopies.begin() + end);
+}
+
+void Interpreter::ResolveAllFbCopies() {
+    if (!mPendingFbCopies.empty()) {
+        ResolveFbCopies(mPendingFbCopies.back().dst_id);
+    }
+}
+
+void Interpreter::StartDrawToFramebuffer(int fbId, float noiseScale) {
+    mRapi->StartDrawToFramebuffer(fbId, noiseScale);
+    mDrawFb = fbId;
+}
+
+uintptr_t Interpreter::GetGfxFrameBuffer() {
+    if (mMsaaResolvePending) {
+        mRapi->ResolveMSAAColorBuffer(mGameFbMsaaResolved, mGameFb);
+        mMsaaResolvePending = false;
+        mFbCopyStats.resolves++;
+    }
+    return mGfxFrameBuffer;
 }
 
 void Interpreter::ResetFrameBuffer() {
-    mRapi->StartDrawToFramebuffer(0, (float)mCurDimensions.height / mNativeDimensions.height);
+    StartDrawToFramebuffer(0, (float)mCurDimensions.height / mNativeDimensions.height);
 }
 
 void Interpreter::AdjustPixelDepthCoordinates(float& x, float& y) {
@@ -4509,31 +5347,44 @@ void Interpreter::AdjustPixelDepthCoordinates(float& x, float& y) {
 
 void Interpreter::GetPixelDepthPrepare(float x, float y) {
     AdjustPixelDepthCoordinates(x, y);
-    mGetPixelDepthPending.emplace(x, y);
+    if (std::find(mGetPixelDepthPending.begin(), mGetPixelDepthPending.end(), std::make_pair(x, y)) ==
+        mGetPixelDepthPending.end()) {
+        mGetPixelDepthPending.emplace_back(x, y);
+    }
 }
 
 uint16_t Interpreter::GetPixelDepth(float x, float y) {
     AdjustPixelDepthCoordinates(x, y);
 
-    if (auto it = mGetPixelDepthCached.find(std::make_pair(x, y)); it != mGetPixelDepthCached.end()) {
+    const auto coord = std::make_pair(x, y);
+    auto findCached = [&]() {
+        return std::find_if(mGetPixelDepthCached.begin(), mGetPixelDepthCached.end(),
+                            [&](const auto& entry) { return entry.first == coord; });
+    };
+    if (auto it = findCached(); it != mGetPixelDepthCached.end()) {
         return it->second;
     }
 
-    mGetPixelDepthPending.emplace(x, y);
+    if (std::find(mGetPixelDepthPending.begin(), mGetPixelDepthPending.end(), coord) == mGetPixelDepthPending.end()) {
+        mGetPixelDepthPending.push_back(coord);
+    }
 
+    ResolveFbCopies(mRendersToFb ? mGameFb : 0);
     std::unordered_map<std::pair<float, float>, uint16_t, hash_pair_ff> res =
         mRapi->GetPixelDepth(mRendersToFb ? mGameFb : 0, mGetPixelDepthPending);
-    mGetPixelDepthCached.merge(res);
+    for (const auto& [resCoord, depth] : res) {
+        mGetPixelDepthCached.emplace_back(resCoord, depth);
+    }
     mGetPixelDepthPending.clear();
 
-    return mGetPixelDepthCached.find(std::make_pair(x, y))->second;
+    return findCached()->second;
 }
 
 void gfx_push_current_dir(char* path) {
     if (gfx_check_image_signature(path) == 1)
         path = &path[7];
 
-    currentDir.push(GetPathWithoutFileName(path));
+    currentDir.push_back(GetPathWithoutFileName(path));
 }
 
 int32_t gfx_check_image_signature(const char* imgData) {
@@ -4544,6 +5395,10 @@ int32_t gfx_check_image_signature(const char* imgData) {
     }
 
     if (i != 0) {
+        if (g_exec_stack.capture != nullptr) {
+            // Raw texture data is only captured when it is loaded, but the signature check reads it earlier
+            g_exec_stack.capture->AddMemory(imgData, 7);
+        }
         return Ship::Context::GetInstance()->GetResourceManager()->OtrSignatureCheck(imgData);
     }
 
@@ -4556,15 +5411,14 @@ void Interpreter::RegisterBlendedTexture(const char* name, uint8_t* mask, uint8_
     }
 
     if (gfx_check_image_signature(reinterpret_cast<char*>(replacement))) {
-        Fast::Texture* tex = std::static_pointer_cast<Fast::Texture>(
-                                 Ship::Context::GetInstance()->GetResourceManager()->LoadResourceProcess(
-                                     reinterpret_cast<char*>(replacement)))
-                                 .get();
+        Fast::Texture* tex =
+            std::static_pointer_cast<Fast::Texture>(gfx_load_resource(reinterpret_cast<char*>(replacement))).get();
 
         replacement = tex->ImageData;
     }
 
-    mMaskedTextures[name] = MaskedTextureEntry{ mask, replacement };
+    mMaskedTextures[CRC64(name)] = MaskedTextureEntry{ mask, replacement };
+    mMaskedTexturesGeneration = ++sMaskedTexturesGeneration;
 }
 
 void Interpreter::UnregisterBlendedTexture(const char* name) {
@@ -4572,7 +5426,8 @@ void Interpreter::UnregisterBlendedTexture(const char* name) {
         name += 7;
     }
 
-    mMaskedTextures.erase(name);
+    mMaskedTextures.erase(CRC64(name));
+    mMaskedTexturesGeneration = ++sMaskedTexturesGeneration;
 }
 
 // New getters and setters
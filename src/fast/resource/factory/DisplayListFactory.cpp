@@ -3,6 +3,7 @@
 #include "spdlog/spdlog.h"
 #include "libultraship/libultra/gbi.h"
 #include "fast/lus_gbi.h"
+#include <bitset>
 #include <tinyxml2.h>
 
 namespace Fast {
@@ -152,6 +153,213 @@ int8_t GetEndOpcodeByUCode(UcodeHandlers ucode) {
     return -1;
 }
 
+// Commands that only load vertices, draw triangles, call other lists or do nothing. Skipping them leaves the render
+// state the way the list found it.
+static bool IsGeometryCommand(int8_t opcode, bool f3dex2) {
+    switch (opcode) {
+        case OTR_G_VTX_OTR_HASH:
+        case OTR_G_VTX_OTR_FILEPATH:
+        case OTR_G_DL_OTR_HASH:
+        case OTR_G_DL_OTR_FILEPATH:
+        case OTR_G_TRI1_OTR:
+        case OTR_G_MARKER:
+        case RDP_G_RDPFULLSYNC:
+        case RDP_G_RDPTILESYNC:
+        case RDP_G_RDPPIPESYNC:
+        case RDP_G_RDPLOADSYNC:
+            return true;
+    }
+
+    if (f3dex2) {
+        switch (opcode) {
+            case F3DEX2_G_NOOP:
+            case F3DEX2_G_SPNOOP:
+            case F3DEX2_G_ENDDL:
+            case F3DEX2_G_CULLDL:
+            case F3DEX2_G_TRI1:
+            case F3DEX2_G_TRI2:
+            case F3DEX2_G_QUAD:
+                return true;
+        }
+    } else {
+        switch (opcode) {
+            case F3DEX_G_SPNOOP:
+            case F3DEX_G_ENDDL:
+            case F3DEX_G_CULLDL:
+            case F3DEX_G_TRI1:
+            case F3DEX_G_TRI2:
+            case F3DEX_G_QUAD:
+                return true;
+        }
+    }
+    return false;
+}
+
+// Records the vertex resources and display lists a display list references so the interpreter can compute its bounds
+// and skip it when it is outside the view frustum. Anything drawn without those vertices, like rectangles or vertices
+// loaded by the caller, as well as transform changes and calls through segments make the list uncullable. Every other
+// command that is not geometry marks the list as setting state, which culling has to keep.
+static void ReadCullingInfo(DisplayList* dl) {
+    if (dl->UCode != ucode_f3d && dl->UCode != ucode_f3db && dl->UCode != ucode_f3dex && dl->UCode != ucode_f3dexb &&
+        dl->UCode != ucode_f3dex2) {
+        return;
+    }
+
+    const bool f3dex2 = dl->UCode == ucode_f3dex2;
+    const bool f3d = dl->UCode == ucode_f3d || dl->UCode == ucode_f3db;
+    const size_t size = dl->Instructions.size();
+
+    // Vertex buffer slots written by this list, a called list may write any of them
+    std::bitset<256> loaded;
+    bool cullable = true;
+    bool setsState = false;
+    auto reads = [&](std::initializer_list<uint32_t> slots) {
+        for (uint32_t slot : slots) {
+            cullable = cullable && slot < loaded.size() && loaded[slot];
+        }
+    };
+    auto load = [&](size_t dest, size_t count) {
+        for (size_t slot = dest; slot < dest + count && slot < loaded.size(); slot++) {
+            loaded.set(slot);
+        }
+    };
+
+    for (size_t i = 0; i < size && cullable; i++) {
+        const uint32_t w0 = (uint32_t)dl->Instructions[i].words.w0;
+        const uint32_t w1 = (uint32_t)dl->Instructions[i].words.w1;
+        const int8_t opcode = (int8_t)(w0 >> 24);
+        setsState = setsState || !IsGeometryCommand(opcode, f3dex2);
+
+        switch (opcode) {
+            case OTR_G_VTX_OTR_HASH:
+            case OTR_G_VTX_OTR_FILEPATH:
+            case OTR_G_DL_OTR_HASH:
+            case OTR_G_SETTIMG_OTR_HASH:
+            case OTR_G_MARKER:
+            case OTR_G_MOVEMEM_HASH:
+                // Two part commands
+                if (++i >= size) {
+                    cullable = false;
+                    continue;
+                }
+                break;
+        }
+
+        const Gfx& next = dl->Instructions[i];
+        const uint64_t hash = ((uint64_t)next.words.w0 << 32) + (uint32_t)next.words.w1;
+
+        switch (opcode) {
+            case OTR_G_VTX_OTR_HASH: {
+                const size_t count = (w0 >> 12) & 0xFF;
+                const size_t end = (w0 >> 1) & 0x7F;
+                cullable = count <= end;
+                dl->CullVertices.push_back({ { hash, nullptr }, w1, count });
+                load(end - count, count);
+                break;
+            }
+            case OTR_G_VTX_OTR_FILEPATH: {
+                const char* path = (const char*)dl->Instructions[i - 1].words.w1;
+                const size_t count = (uint32_t)next.words.w0;
+                const size_t offset = ((uint32_t)next.words.w1 & 0xFFFF) * sizeof(Vtx);
+                dl->CullVertices.push_back({ { 0, path }, offset, count });
+                load((uint32_t)next.words.w1 >> 16, count);
+                break;
+            }
+            case OTR_G_DL_OTR_HASH:
+                dl->CullChildren.push_back({ hash, nullptr });
+                loaded.set();
+                break;
+            case OTR_G_DL_OTR_FILEPATH:
+                dl->CullChildren.push_back({ 0, (const char*)dl->Instructions[i].words.w1 });
+                loaded.set();
+                break;
+            case OTR_G_TRI1_OTR:
+                reads({ w0 & 0xFF, (w1 >> 16) & 0xFF, w1 & 0xFF });
+                break;
+            case OTR_G_MTX_OTR:
+            case OTR_G_MTX_OTR_FILEPATH:
+            case OTR_G_BRANCH_Z_OTR:
+            case OTR_G_DL_INDEX:
+            case OTR_G_PUSHCD:
+            case OTR_G_SETFB:
+            case OTR_G_RESETFB:
+            case OTR_G_COPYFB:
+            case OTR_G_READFB:
+            case OTR_G_INVALTEXCACHE:
+            case OTR_G_REGBLENDEDTEX:
+            case OTR_G_TEXRECT_WIDE:
+            case OTR_G_FILLWIDERECT:
+            case OTR_G_IMAGERECT:
+            case RDP_G_TEXRECT:
+            case RDP_G_TEXRECTFLIP:
+            case RDP_G_FILLRECT:
+                cullable = false;
+                break;
+            default:
+                if (f3dex2) {
+                    switch (opcode) {
+                        case F3DEX2_G_VTX:
+                        case F3DEX2_G_MODIFYVTX:
+                        case F3DEX2_G_MTX:
+                        case F3DEX2_G_POPMTX:
+                        case F3DEX2_G_DL:
+                        case F3DEX2_G_BRANCH_Z:
+                        case F3DEX2_G_LINE3D:
+                            cullable = false;
+                            break;
+                        case F3DEX2_G_TRI1:
+                            reads({ ((w0 >> 16) & 0xFF) / 2, ((w0 >> 8) & 0xFF) / 2, (w0 & 0xFF) / 2 });
+                            break;
+                        case F3DEX2_G_TRI2:
+                        case F3DEX2_G_QUAD:
+                            reads({ ((w0 >> 16) & 0xFF) / 2, ((w0 >> 8) & 0xFF) / 2, (w0 & 0xFF) / 2 });
+                            reads({ ((w1 >> 16) & 0xFF) / 2, ((w1 >> 8) & 0xFF) / 2, (w1 & 0xFF) / 2 });
+                            break;
+                    }
+                } else {
+                    switch (opcode) {
+                        case F3DEX_G_VTX:
+                        case F3DEX_G_MODIFYVTX:
+                        case F3DEX_G_MTX:
+                        case F3DEX_G_POPMTX:
+                        case F3DEX_G_DL:
+                        case F3DEX_G_BRANCH_Z:
+                            cullable = false;
+                            break;
+                        case F3DEX_G_MOVEWORD:
+                            cullable = (w0 & 0xFF) != G_MW_POINTS;
+                            break;
+                        case F3DEX_G_TRI1:
+                            if (f3d) {
+                                reads({ ((w1 >> 16) & 0xFF) / 10, ((w1 >> 8) & 0xFF) / 10, (w1 & 0xFF) / 10 });
+                            } else {
+                                reads({ (w1 >> 17) & 0x7F, (w1 >> 9) & 0x7F, (w1 >> 1) & 0x7F });
+                            }
+                            break;
+                        case F3DEX_G_TRI2:
+                            reads({ (w0 >> 17) & 0x7F, (w0 >> 9) & 0x7F, (w0 >> 1) & 0x7F });
+                            reads({ (w1 >> 17) & 0x7F, (w1 >> 9) & 0x7F, (w1 >> 1) & 0x7F });
+                            break;
+                        case F3DEX_G_QUAD:
+                            // Shares its opcode with G_LINE3D on F3D
+                            cullable = !f3d;
+                            reads({ ((w1 >> 24) & 0xFF) / 2, ((w1 >> 16) & 0xFF) / 2, ((w1 >> 8) & 0xFF) / 2,
+                                    (w1 & 0xFF) / 2 });
+                            break;
+                    }
+                }
+                break;
+        }
+    }
+
+    dl->Cullable = cullable && (!dl->CullVertices.empty() || !dl->CullChildren.empty());
+    dl->SetsState = setsState;
+    if (!dl->Cullable) {
+        dl->CullVertices.clear();
+        dl->CullChildren.clear();
+    }
+}
+
 std::shared_ptr<Ship::IResource>
 ResourceFactoryBinaryDisplayListV0::ReadResource(std::shared_ptr<Ship::File> file,
                                                  std::shared_ptr<Ship::ResourceInitData> initData) {
@@ -169,11 +377,17 @@ ResourceFactoryBinaryDisplayListV0::ReadResource(std::shared_ptr<Ship::File> fil
         reader->ReadInt8();
     }
 
+    // The commands run to the end of the file, read all of them at once and stop at the end command
+    const std::vector<uint32_t> words =
+        reader->ReadArray<uint32_t>((size_t)(reader->GetLength() - reader->GetBaseAddress()) / 4);
+
     size_t idx = 0;
-    while (true) {
+    size_t pos = 0;
+    bool ended = false;
+    while (pos + 2 <= words.size()) {
         Gfx command;
-        command.words.w0 = reader->ReadUInt32();
-        command.words.w1 = reader->ReadUInt32();
+        command.words.w0 = words[pos++];
+        command.words.w1 = words[pos++];
 
         int8_t opcode = (int8_t)(command.words.w0 >> 24);
         bool isExpanded = opcode == G_SETTIMG_OTR_HASH || opcode == G_DL_OTR_HASH || opcode == G_VTX_OTR_HASH ||
@@ -188,8 +402,11 @@ ResourceFactoryBinaryDisplayListV0::ReadResource(std::shared_ptr<Ship::File> fil
             command.words.trace.valid = true;
 #endif
             displayList->Instructions.push_back(command);
-            command.words.w0 = reader->ReadUInt32();
-            command.words.w1 = reader->ReadUInt32();
+            if (pos + 2 > words.size()) {
+                break;
+            }
+            command.words.w0 = words[pos++];
+            command.words.w1 = words[pos++];
         }
 
 #ifdef USE_GBI_TRACE
@@ -201,10 +418,18 @@ ResourceFactoryBinaryDisplayListV0::ReadResource(std::shared_ptr<Ship::File> fil
         displayList->Instructions.push_back(command);
 
         if (opcode == GetEndOpcodeByUCode(ucode)) {
+            ended = true;
             break;
         }
     }
 
+    if (!ended) {
+        SPDLOG_ERROR("Failed to load display list {}: it has no end command", initData->Path);
+        return nullptr;
+    }
+
+    ReadCullingInfo(displayList.get());
+
     return displayList;
 }
 
@@ -1152,6 +1377,8 @@ ResourceFactoryXMLDisplayListV0::ReadResource(std::shared_ptr<Ship::File> file,
     dl->UCode = ucode_f3d;
 #endif
 
+    ReadCullingInfo(dl.get());
+
     return dl;
 }
 } // namespace Fast
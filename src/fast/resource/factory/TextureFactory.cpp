@@ -1,8 +1,16 @@
 #include "fast/resource/factory/TextureFactory.h"
 #include "fast/resource/type/Texture.h"
+#include "ship/utils/StrHash64.h"
 #include "spdlog/spdlog.h"
 
 namespace Fast {
+// Both the texture and its alt asset replacement match what was registered for the texture
+static uint64_t HashBasePath(const std::string& path) {
+    if (path.starts_with(Ship::IResource::gAltAssetPrefix)) {
+        return CRC64(path.c_str() + Ship::IResource::gAltAssetPrefix.length());
+    }
+    return CRC64(path.c_str());
+}
 
 std::shared_ptr<Ship::IResource>
 ResourceFactoryBinaryTextureV0::ReadResource(std::shared_ptr<Ship::File> file,
@@ -12,12 +20,15 @@ ResourceFactoryBinaryTextureV0::ReadResource(std::shared_ptr<Ship::File> file,
     }
 
     auto texture = std::make_shared<Texture>(initData);
+    texture->BasePathHash = HashBasePath(initData->Path);
     auto reader = std::get<std::shared_ptr<Ship::BinaryReader>>(file->Reader);
 
-    texture->Type = (TextureType)reader->ReadUInt32();
-    texture->Width = reader->ReadUInt32();
-    texture->Height = reader->ReadUInt32();
-    texture->ImageDataSize = reader->ReadUInt32();
+    uint32_t header[4];
+    reader->ReadArray(header, 4);
+    texture->Type = (TextureType)header[0];
+    texture->Width = header[1];
+    texture->Height = header[2];
+    texture->ImageDataSize = header[3];
     texture->ImageData = new uint8_t[texture->ImageDataSize];
 
     reader->Read((char*)texture->ImageData, texture->ImageDataSize);
@@ -33,12 +44,15 @@ ResourceFactoryBinaryTextureV1::ReadResource(std::shared_ptr<Ship::File> file,
     }
 
     auto texture = std::make_shared<Texture>(initData);
+    texture->BasePathHash = HashBasePath(initData->Path);
     auto reader = std::get<std::shared_ptr<Ship::BinaryReader>>(file->Reader);
 
-    texture->Type = (TextureType)reader->ReadUInt32();
-    texture->Width = reader->ReadUInt32();
-    texture->Height = reader->ReadUInt32();
-    texture->Flags = reader->ReadUInt32();
+    uint32_t header[4];
+    reader->ReadArray(header, 4);
+    texture->Type = (TextureType)header[0];
+    texture->Width = header[1];
+    texture->Height = header[2];
+    texture->Flags = header[3];
     texture->HByteScale = reader->ReadFloat();
     texture->VPixelScale = reader->ReadFloat();
     texture->ImageDataSize = reader->ReadUInt32();
@@ -16,21 +16,26 @@ ResourceFactoryBinaryVertexV0::ReadResource(std::shared_ptr<Ship::File> file,
     auto reader = std::get<std::shared_ptr<Ship::BinaryReader>>(file->Reader);
 
     uint32_t count = reader->ReadUInt32();
-    vertex->VertexList.reserve(count);
+    vertex->VertexList.resize(count);
 
+    // A vertex is six 16 bit values followed by four color bytes, read as two more 16 bit values so that every vertex
+    // is swapped in one go. The color bytes come back out of them in the order they are stored.
+    std::vector<uint16_t> fields = reader->ReadArray<uint16_t>((size_t)count * 8);
+    const bool bigEndian = reader->GetEndianness() == Ship::Endianness::Big;
     for (uint32_t i = 0; i < count; i++) {
-        Vtx data;
-        data.v.ob[0] = reader->ReadInt16();
-        data.v.ob[1] = reader->ReadInt16();
-        data.v.ob[2] = reader->ReadInt16();
-        data.v.flag = reader->ReadUInt16();
-        data.v.tc[0] = reader->ReadInt16();
-        data.v.tc[1] = reader->ReadInt16();
-        data.v.cn[0] = reader->ReadUByte();
-        data.v.cn[1] = reader->ReadUByte();
-        data.v.cn[2] = reader->ReadUByte();
-        data.v.cn[3] = reader->ReadUByte();
-        vertex->VertexList.push_back(data);
+        const uint16_t* src = &fields[(size_t)i * 8];
+        Vtx& data = vertex->VertexList[i];
+        data.v.ob[0] = (int16_t)src[0];
+        data.v.ob[1] = (int16_t)src[1];
+        data.v.ob[2] = (int16_t)src[2];
+        data.v.flag = src[3];
+        data.v.tc[0] = (int16_t)src[4];
+        data.v.tc[1] = (int16_t)src[5];
+        for (int j = 0; j < 2; j++) {
+            const uint16_t colors = src[6 + j];
+            data.v.cn[j * 2] = bigEndian ? colors >> 8 : colors & 0xff;
+            data.v.cn[j * 2 + 1] = bigEndian ? colors & 0xff : colors >> 8;
+        }
     }
 
     return vertex;
@@ -1,5 +1,6 @@
 #include "fast/resource/type/DisplayList.h"
 #include <memory>
+#include <string.h>
 
 namespace Fast {
 DisplayList::DisplayList() : Resource(std::shared_ptr<Ship::ResourceInitData>()) {
@@ -18,4 +19,14 @@ Gfx* DisplayList::GetPointer() {
 size_t DisplayList::GetPointerSize() {
     return Instructions.size() * sizeof(Gfx);
 }
+
+size_t DisplayList::GetMemorySize() {
+    size_t size = sizeof(DisplayList) + Instructions.capacity() * sizeof(Gfx) +
+                  CullVertices.capacity() * sizeof(DisplayListVertexRef) +
+                  CullChildren.capacity() * sizeof(DisplayListResourceRef);
+    for (char* string : Strings) {
+        size += strlen(string) + 1;
+    }
+    return size;
+}
 } // namespace Fast
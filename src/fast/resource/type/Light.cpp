@@ -8,4 +8,8 @@ LightEntry* Light::GetPointer() {
 size_t Light::GetPointerSize() {
     return sizeof(mLight);
 }
+
+size_t Light::GetMemorySize() {
+    return sizeof(Light) + mLightData.capacity() * sizeof(LightData);
+}
 } // namespace Fast
\ No newline at end of file
@@ -11,4 +11,8 @@ Mtx* Matrix::GetPointer() {
 size_t Matrix::GetPointerSize() {
     return sizeof(Mtx);
 }
+
+size_t Matrix::GetMemorySize() {
+    return sizeof(Matrix);
+}
 } // namespace Fast
@@ -12,6 +12,10 @@ size_t Texture::GetPointerSize() {
     return ImageDataSize;
 }
 
+size_t Texture::GetMemorySize() {
+    return sizeof(Texture) + (ImageData != nullptr ? ImageDataSize : 0);
+}
+
 Texture::~Texture() {
     if (ImageData != nullptr) {
         delete[] ImageData;
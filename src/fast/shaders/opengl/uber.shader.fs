@@ -0,0 +1,205 @@
+@prism(type='fragment', name='Fast3D Uber Fragment Shader', version='1.0.0', description='Color combiner driven by uniforms, used while specialized shaders compile', author='Emill & Prism Team')
+
+@{GLSL_VERSION}
+
+@if(opengles)
+precision highp int;
+@end
+
+@if(core_opengl || opengles)
+out vec4 vOutColor;
+@end
+
+@for(i in 0..2)
+    @{attr} vec2 vTexCoord@{i};
+    @{attr} float vTexClampS@{i};
+    @{attr} float vTexClampT@{i};
+@end
+
+@{attr} vec4 vFog;
+@{attr} vec4 vGrayscaleColor;
+
+@for(i in 0..7)
+    @{attr} vec4 vInput@{i + 1};
+@end
+
+uniform sampler2D uTex0;
+uniform sampler2D uTex1;
+uniform sampler2D uTexMask0;
+uniform sampler2D uTexMask1;
+uniform sampler2D uTexBlend0;
+uniform sampler2D uTexBlend1;
+
+uniform int frame_count;
+uniform float noise_scale;
+
+uniform int texture_width[2];
+uniform int texture_height[2];
+uniform int texture_filtering[2];
+
+// Inputs a, b, c and d of (a - b) * c + d, indexed by cycle * 2 + 1 for the alpha combiner
+uniform ivec4 uCombiner[4];
+uniform int uFlags;
+
+#define TEX_OFFSET(off) @{texture}(tex, texCoord - off / texSize)
+#define WRAP(x, low, high) mod((x)-(low), (high)-(low)) + (low)
+#define TEX_SIZE(tex) vec2(texture_width[tex], texture_height[tex])
+
+bool hasFlag(int flag) {
+    return (uFlags & flag) != 0;
+}
+
+float random(in vec3 value) {
+    float random = dot(sin(value), vec3(12.9898, 78.233, 37.719));
+    return fract(sin(random) * 143758.5453);
+}
+
+float noise() {
+    return (random(vec3(floor(gl_FragCoord.xy * noise_scale), float(frame_count))) + 1.0) / 2.0;
+}
+
+vec4 fromLinear(vec4 linearRGB){
+    bvec3 cutoff = lessThan(linearRGB.rgb, vec3(0.0031308));
+    vec3 higher = vec3(1.055)*pow(linearRGB.rgb, vec3(1.0/2.4)) - vec3(0.055);
+    vec3 lower = linearRGB.rgb * vec3(12.92);
+    return vec4(mix(higher, lower, cutoff), linearRGB.a);
+}
+
+vec4 filter3point(in sampler2D tex, in vec2 texCoord, in vec2 texSize) {
+    vec2 offset = fract(texCoord*texSize - vec2(0.5));
+    offset -= step(1.0, offset.x + offset.y);
+    vec4 c0 = TEX_OFFSET(offset);
+    vec4 c1 = TEX_OFFSET(vec2(offset.x - sign(offset.x), offset.y));
+    vec4 c2 = TEX_OFFSET(vec2(offset.x, offset.y - sign(offset.y)));
+    return c0 + abs(offset.x)*(c1-c0) + abs(offset.y)*(c2-c0);
+}
+
+vec4 hookTexture2D(in int id, sampler2D tex, in vec2 uv, in vec2 texSize) {
+    if (hasFlag(@{UBER_THREE_POINT}) && texture_filtering[id] == @{FILTER_THREE_POINT}) {
+        return filter3point(tex, uv, texSize);
+    }
+    return @{texture}(tex, uv);
+}
+
+vec4 sampleTexture(in int id, sampler2D tex, sampler2D mask, sampler2D blend, in vec2 texCoord, in vec2 texClamp,
+                   in int flagShift) {
+    vec2 texSize = TEX_SIZE(id);
+
+    if (hasFlag(@{UBER_CLAMP_S0} << flagShift)) {
+        texCoord.s = clamp(texCoord.s, 0.5 / texSize.s, texClamp.s);
+    }
+    if (hasFlag(@{UBER_CLAMP_T0} << flagShift)) {
+        texCoord.t = clamp(texCoord.t, 0.5 / texSize.t, texClamp.t);
+    }
+
+    vec4 texVal = hookTexture2D(id, tex, texCoord, texSize);
+
+    if (hasFlag(@{UBER_MASK0} << flagShift)) {
+        vec2 maskSize = vec2(textureSize(mask, 0));
+        vec4 maskVal = hookTexture2D(id, mask, texCoord, maskSize);
+        vec4 blendVal = vec4(0.0, 0.0, 0.0, 0.0);
+        if (hasFlag(@{UBER_BLEND0} << flagShift)) {
+            blendVal = hookTexture2D(id, blend, texCoord, texSize);
+        }
+        texVal = mix(texVal, blendVal, maskVal.a);
+    }
+    return texVal;
+}
+
+// texA and texB are the texels the cycle reads as TEXEL0 and TEXEL1
+vec4 combinerInput(in int item, in vec4 texel, in vec4 texA, in vec4 texB) {
+    if (item == @{SHADER_1}) return vec4(1.0, 1.0, 1.0, 1.0);
+    if (item == @{SHADER_INPUT_1}) return vInput1;
+    if (item == @{SHADER_INPUT_2}) return vInput2;
+    if (item == @{SHADER_INPUT_3}) return vInput3;
+    if (item == @{SHADER_INPUT_4}) return vInput4;
+    if (item == @{SHADER_INPUT_5}) return vInput5;
+    if (item == @{SHADER_INPUT_6}) return vInput6;
+    if (item == @{SHADER_INPUT_7}) return vInput7;
+    if (item == @{SHADER_TEXEL0}) return texA;
+    if (item == @{SHADER_TEXEL0A}) return vec4(texA.a);
+    if (item == @{SHADER_TEXEL1}) return texB;
+    if (item == @{SHADER_TEXEL1A}) return vec4(texB.a);
+    if (item == @{SHADER_COMBINED}) return texel;
+    if (item == @{SHADER_NOISE}) return vec4(noise());
+    return vec4(0.0, 0.0, 0.0, 0.0);
+}
+
+void main() {
+    vec4 texVal0 = vec4(0.0, 0.0, 0.0, 0.0);
+    vec4 texVal1 = vec4(0.0, 0.0, 0.0, 0.0);
+    if (hasFlag(@{UBER_TEXTURE0})) {
+        texVal0 = sampleTexture(0, uTex0, uTexMask0, uTexBlend0, vTexCoord0, vec2(vTexClampS0, vTexClampT0), 0);
+    }
+    if (hasFlag(@{UBER_TEXTURE1})) {
+        texVal1 = sampleTexture(1, uTex1, uTexMask1, uTexBlend1, vTexCoord1, vec2(vTexClampS1, vTexClampT1), 1);
+    }
+
+    vec4 texel = vec4(0.0, 0.0, 0.0, 1.0);
+    int cycles = hasFlag(@{UBER_2CYC}) ? 2 : 1;
+    for (int c = 0; c < cycles; c++) {
+        ivec4 color = uCombiner[c * 2];
+        ivec4 alpha = uCombiner[c * 2 + 1];
+        // The second cycle reads the texels swapped, like the specialized shader
+        vec4 texA = c == 0 ? texVal0 : texVal1;
+        vec4 texB = c == 0 ? texVal1 : texVal0;
+
+        if (c == 1) {
+            if (alpha.z == @{SHADER_COMBINED}) {
+                texel.a = WRAP(texel.a, -1.01, 1.01);
+            } else {
+                texel.a = WRAP(texel.a, -0.51, 1.51);
+            }
+
+            if (color.z == @{SHADER_COMBINED}) {
+                texel.rgb = WRAP(texel.rgb, -1.01, 1.01);
+            } else {
+                texel.rgb = WRAP(texel.rgb, -0.51, 1.51);
+            }
+        }
+
+        vec3 rgb = (combinerInput(color.x, texel, texA, texB).rgb - combinerInput(color.y, texel, texA, texB).rgb) *
+                   combinerInput(color.z, texel, texA, texB).rgb + combinerInput(color.w, texel, texA, texB).rgb;
+        float a = (combinerInput(alpha.x, texel, texA, texB).a - combinerInput(alpha.y, texel, texA, texB).a) *
+                  combinerInput(alpha.z, texel, texA, texB).a + combinerInput(alpha.w, texel, texA, texB).a;
+        texel = vec4(rgb, hasFlag(@{UBER_ALPHA}) ? a : 1.0);
+    }
+
+    texel = WRAP(texel, -0.51, 1.51);
+    texel = clamp(texel, 0.0, 1.0);
+
+    if (hasFlag(@{UBER_FOG})) {
+        texel.rgb = mix(texel.rgb, vFog.rgb, vFog.a);
+    }
+
+    if (hasFlag(@{UBER_ALPHA})) {
+        if (hasFlag(@{UBER_TEXTURE_EDGE})) {
+            if (texel.a > 0.19) texel.a = 1.0; else discard;
+        }
+        if (hasFlag(@{UBER_NOISE})) {
+            texel.a *= floor(clamp(random(vec3(floor(gl_FragCoord.xy * noise_scale), float(frame_count))) + texel.a, 0.0, 1.0));
+        }
+    }
+
+    if (hasFlag(@{UBER_GRAYSCALE})) {
+        float intensity = (texel.r + texel.g + texel.b) / 3.0;
+        vec3 new_texel = vGrayscaleColor.rgb * intensity;
+        texel.rgb = mix(texel.rgb, new_texel, vGrayscaleColor.a);
+    }
+
+    if (hasFlag(@{UBER_ALPHA})) {
+        if (hasFlag(@{UBER_ALPHA_THRESHOLD})) {
+            if (texel.a < 8.0 / 256.0) discard;
+        }
+        if (hasFlag(@{UBER_INVISIBLE})) {
+            texel.a = 0.0;
+        }
+    } else {
+        texel.a = 1.0;
+    }
+    @{vOutColor} = texel;
+
+    @if(srgb_mode)
+        @{vOutColor} = fromLinear(@{vOutColor});
+    @end
+}
@@ -0,0 +1,42 @@
+@prism(type='vertex', name='Fast3D Uber Vertex Shader', version='1.0.0', description='Vertex shader with every input of the default shader, used while specialized shaders compile', author='Emill & Prism Team')
+
+@{GLSL_VERSION}
+
+@{attr} vec4 aVtxPos;
+
+@for(i in 0..2)
+    @{attr} vec2 aTexCoord@{i};
+    @{out} vec2 vTexCoord@{i};
+    @{attr} float aTexClampS@{i};
+    @{out} float vTexClampS@{i};
+    @{attr} float aTexClampT@{i};
+    @{out} float vTexClampT@{i};
+@end
+
+@{attr} vec4 aFog;
+@{out} vec4 vFog;
+
+@{attr} vec4 aGrayscaleColor;
+@{out} vec4 vGrayscaleColor;
+
+@for(i in 0..7)
+    @{attr} vec4 aInput@{i + 1};
+    @{out} vec4 vInput@{i + 1};
+@end
+
+void main() {
+    @for(i in 0..2)
+        vTexCoord@{i} = aTexCoord@{i};
+        vTexClampS@{i} = aTexClampS@{i};
+        vTexClampT@{i} = aTexClampT@{i};
+    @end
+    vFog = aFog;
+    vGrayscaleColor = aGrayscaleColor;
+    @for(i in 0..7)
+        vInput@{i + 1} = aInput@{i + 1};
+    @end
+    gl_Position = aVtxPos;
+    @if(opengles)
+        gl_Position.z *= 0.3f;
+    @end
+}
@@ -6,7 +6,10 @@
 #include "ship/window/Window.h"
 
 std::shared_ptr<Ship::IResource> ResourceLoad(const char* name) {
-    return Ship::Context::GetInstance()->GetResourceManager()->LoadResource(name);
+    auto resourceManager = Ship::Context::GetInstance()->GetResourceManager();
+    // Cache hits look the name up as it is, only a miss copies it into a string
+    auto resource = resourceManager->FindCachedResource(name);
+    return resource != nullptr ? resource : resourceManager->LoadResource(name);
 }
 
 std::shared_ptr<Ship::IResource> ResourceLoad(uint64_t crc) {
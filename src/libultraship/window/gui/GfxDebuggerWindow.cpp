@@ -9,6 +9,7 @@
 #include "fast/interpreter.h"
 #include "fast/Fast3dWindow.h"
 #include <optional>
+#include <algorithm>
 #ifdef GFX_DEBUG_DISASSEMBLER
 #include <gfxd.h>
 #endif
@@ -693,6 +694,142 @@ void GfxDebuggerWindow::DrawDisas() {
     ImGui::EndChild();
 }
 
+template <typename T, typename GetKey>
+static void SortByColumn(std::vector<T>& rows, const ImGuiTableColumnSortSpecs& spec, GetKey getKey) {
+    std::sort(rows.begin(), rows.end(), [&](const T& a, const T& b) {
+        auto ka = getKey(a, spec.ColumnIndex);
+        auto kb = getKey(b, spec.ColumnIndex);
+        return spec.SortDirection == ImGuiSortDirection_Ascending ? ka < kb : kb < ka;
+    });
+}
+
+void GfxDebuggerWindow::DrawStats() {
+    auto interpreter = mInterpreter.lock();
+    if (interpreter == nullptr) {
+        return;
+    }
+    GfxStats& stats = interpreter->mStats;
+
+    bool enabled = stats.IsEnabled();
+    if (ImGui::Checkbox("Collect Statistics", &enabled)) {
+        stats.SetEnabled(enabled);
+    }
+    if (!enabled) {
+        return;
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("Dump CSV")) {
+        stats.DumpOpcodeCsv(Ship::Context::GetPathRelativeToAppDirectory("gfx_opcode_stats.csv"));
+        stats.DumpDisplayListCsv(Ship::Context::GetPathRelativeToAppDirectory("gfx_dlist_stats.csv"));
+    }
+
+    const ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg |
+                                  ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+
+    if (ImGui::CollapsingHeader("Display Lists", ImGuiTreeNodeFlags_DefaultOpen)) {
+        std::vector<const GfxDisplayListStats*> rows;
+        for (const auto& dl : stats.GetDisplayListStats()) {
+            rows.push_back(&dl);
+        }
+
+        if (ImGui::BeginTable("##DisplayListStats", 10, flags, ImVec2(0.0f, 300.0f))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Display List", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Calls");
+            ImGui::TableSetupColumn("Commands");
+            ImGui::TableSetupColumn("Time (us)",
+                                    ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableSetupColumn("Triangles");
+            ImGui::TableSetupColumn("Vertices");
+            ImGui::TableSetupColumn("Flushes");
+            ImGui::TableSetupColumn("Tex Imports");
+            ImGui::TableSetupColumn("Culls");
+            ImGui::TableSetupColumn("Culled Cmds");
+            ImGui::TableHeadersRow();
+
+            ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
+            if (sortSpecs != nullptr && sortSpecs->SpecsCount > 0) {
+                const ImGuiTableColumnSortSpecs& spec = sortSpecs->Specs[0];
+                if (spec.ColumnIndex == 0) {
+                    SortByColumn(rows, spec, [](const GfxDisplayListStats* dl, int column) { return dl->name; });
+                } else {
+                    SortByColumn(rows, spec, [](const GfxDisplayListStats* dl, int column) {
+                        const uint64_t values[] = { 0,             dl->calls,         dl->commands, dl->time,
+                                                    dl->triangles, dl->vertices,      dl->flushes,  dl->textureImports,
+                                                    dl->culls,     dl->culledCommands };
+                        return values[column];
+                    });
+                }
+            }
+
+            for (const GfxDisplayListStats* dl : rows) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(dl->name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->calls);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->commands);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", dl->time / 1000.0);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->triangles);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->vertices);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->flushes);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->textureImports);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->culls);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)dl->culledCommands);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Opcodes")) {
+        const auto& opcodes = stats.GetOpcodeStats();
+        std::vector<size_t> rows;
+        for (size_t i = 0; i < opcodes.size(); i++) {
+            if (opcodes[i].count != 0) {
+                rows.push_back(i);
+            }
+        }
+
+        if (ImGui::BeginTable("##OpcodeStats", 3, flags, ImVec2(0.0f, 300.0f))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Opcode", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("Time (us)",
+                                    ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableHeadersRow();
+
+            ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs();
+            if (sortSpecs != nullptr && sortSpecs->SpecsCount > 0) {
+                SortByColumn(rows, sortSpecs->Specs[0], [&opcodes](size_t op, int column) {
+                    const uint64_t values[] = { op, opcodes[op].count, opcodes[op].time };
+                    return values[column];
+                });
+            }
+
+            for (size_t op : rows) {
+                const char* name = GetOpName((int8_t)op);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("0x%02X %s", (unsigned int)op, name != nullptr ? name : "UNK");
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)opcodes[op].count);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", opcodes[op].time / 1000.0);
+            }
+            ImGui::EndTable();
+        }
+    }
+}
+
 void GfxDebuggerWindow::DrawElement() {
     auto dbg = Ship::Context::GetInstance()->GetGfxDebugger();
     // const ImVec2 pos = ImGui::GetWindowPos();
@@ -702,6 +839,14 @@ void GfxDebuggerWindow::DrawElement() {
         if (ImGui::Button("Debug")) {
             dbg->RequestDebugging();
         }
+        ImGui::SameLine();
+        ImGui::BeginDisabled(dbg->IsCaptureRequested());
+        if (ImGui::Button("Capture Frame")) {
+            dbg->RequestCapture(Ship::Context::GetPathRelativeToAppDirectory("frame.gfxcap"));
+        }
+        ImGui::EndDisabled();
+
+        DrawStats();
     } else {
         bool resumed = false;
         if (ImGui::Button("Resume Game")) {
@@ -0,0 +1,247 @@
+#include "ship/resource/PrefetchManifest.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <spdlog/spdlog.h>
+#include "ship/utils/binarytools/BinaryReader.h"
+#include "ship/utils/binarytools/BinaryWriter.h"
+#include "ship/utils/binarytools/SpanStream.h"
+
+namespace Ship {
+
+PrefetchManifest::Area& PrefetchManifest::GetOrAddArea(const std::string& area) {
+    auto it = mAreaIndices.find(area);
+    if (it != mAreaIndices.end()) {
+        return mAreas[it->second];
+    }
+
+    mAreaIndices[area] = mAreas.size();
+    mAreas.push_back({ area, {}, {} });
+    return mAreas.back();
+}
+
+void PrefetchManifest::MarkArea(const std::string& area) {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    GetOrAddArea(area);
+    mCurrentArea = mAreaIndices[area];
+}
+
+void PrefetchManifest::Record(uint64_t hash, size_t size) {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    if (mCurrentArea == SIZE_MAX) {
+        GetOrAddArea("");
+        mCurrentArea = mAreaIndices[""];
+    }
+
+    Area& area = mAreas[mCurrentArea];
+    if (area.Recorded.insert(hash).second) {
+        area.Entries.push_back({ hash, (uint32_t)std::min(size, (size_t)UINT32_MAX) });
+    }
+}
+
+void PrefetchManifest::Clear() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    mAreas.clear();
+    mAreaIndices.clear();
+    mCurrentArea = SIZE_MAX;
+}
+
+std::vector<PrefetchEntry> PrefetchManifest::GetArea(const std::string& area) const {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mAreaIndices.find(area);
+    if (it == mAreaIndices.end()) {
+        return {};
+    }
+    return mAreas[it->second].Entries;
+}
+
+size_t PrefetchManifest::GetAreaCount() const {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mAreas.size();
+}
+
+size_t PrefetchManifest::GetEntryCount() const {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    size_t count = 0;
+    for (const Area& area : mAreas) {
+        count += area.Entries.size();
+    }
+    return count;
+}
+
+std::vector<char> PrefetchManifest::Serialize() const {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    BinaryWriter writer;
+    writer.SetEndianness(Endianness::Little);
+    writer.Write(MAGIC);
+    writer.Write(VERSION);
+    writer.Write((uint32_t)mAreas.size());
+    for (const Area& area : mAreas) {
+        writer.Write(area.Name);
+        writer.Write((uint32_t)area.Entries.size());
+        for (const PrefetchEntry& entry : area.Entries) {
+            writer.Write(entry.Hash);
+            writer.Write(entry.Size);
+        }
+    }
+    return writer.ToVector();
+}
+
+bool PrefetchManifest::Deserialize(const char* data, size_t size) {
+    std::vector<Area> areas;
+    try {
+        BinaryReader reader(std::make_shared<SpanStream>(data, size, nullptr));
+        reader.SetEndianness(Endianness::Little);
+        if (reader.ReadUInt32() != MAGIC || reader.ReadUInt32() != VERSION) {
+            SPDLOG_ERROR("Prefetch manifest has an unknown format");
+            return false;
+        }
+
+        const uint32_t areaCount = reader.ReadUInt32();
+        for (uint32_t i = 0; i < areaCount; i++) {
+            Area area = { reader.ReadString(), {}, {} };
+            const uint32_t entryCount = reader.ReadUInt32();
+            // Every entry takes 12 bytes, a count bigger than what is left means the file is broken
+            if (entryCount > (reader.GetLength() - reader.GetBaseAddress()) / 12) {
+                SPDLOG_ERROR("Prefetch manifest area {} is truncated", area.Name);
+                return false;
+            }
+            area.Entries.reserve(entryCount);
+            for (uint32_t j = 0; j < entryCount; j++) {
+                const uint64_t hash = reader.ReadUInt64();
+                const uint32_t entrySize = reader.ReadUInt32();
+                if (area.Recorded.insert(hash).second) {
+                    area.Entries.push_back({ hash, entrySize });
+                }
+            }
+            areas.push_back(std::move(area));
+        }
+    } catch (const std::exception& e) {
+        SPDLOG_ERROR("Failed to read prefetch manifest: {}", e.what());
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> lock(mMutex);
+    mAreas = std::move(areas);
+    mAreaIndices.clear();
+    for (size_t i = 0; i < mAreas.size(); i++) {
+        mAreaIndices[mAreas[i].Name] = i;
+    }
+    mCurrentArea = SIZE_MAX;
+    return true;
+}
+
+bool PrefetchManifest::Save(const std::string& filePath) const {
+    const std::vector<char> data = Serialize();
+    std::ofstream file(filePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        SPDLOG_ERROR("Failed to open prefetch manifest {} for writing", filePath);
+        return false;
+    }
+
+    file.write(data.data(), data.size());
+    if (!file.good()) {
+        SPDLOG_ERROR("Failed to write prefetch manifest {}", filePath);
+        return false;
+    }
+    return true;
+}
+
+bool PrefetchManifest::Load(const std::string& filePath) {
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        SPDLOG_TRACE("No prefetch manifest at {}", filePath);
+        return false;
+    }
+
+    const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return Deserialize(data.data(), data.size());
+}
+
+ResourcePrefetcher::ResourcePrefetcher(std::shared_ptr<BS::thread_pool> threadPool,
+                                       std::function<void(uint64_t hash)> load)
+    : mThreadPool(threadPool), mLoad(load) {
+}
+
+ResourcePrefetcher::~ResourcePrefetcher() {
+    // The tasks on the pool point back at this
+    Stop();
+    Wait();
+}
+
+void ResourcePrefetcher::Start(const std::vector<PrefetchEntry>& entries, size_t maxInFlightBytes) {
+    std::vector<PrefetchEntry> started;
+    {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mPending.assign(entries.begin(), entries.end());
+        mMaxInFlightBytes = maxInFlightBytes;
+        started = TakeStartable();
+    }
+    Submit(started);
+}
+
+void ResourcePrefetcher::Stop() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    mPending.clear();
+    if (mInFlightCount == 0) {
+        mIdle.notify_all();
+    }
+}
+
+void ResourcePrefetcher::Wait() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this]() { return mPending.empty() && mInFlightCount == 0; });
+}
+
+size_t ResourcePrefetcher::GetPendingCount() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mPending.size();
+}
+
+size_t ResourcePrefetcher::GetInFlightBytes() {
+    const std::lock_guard<std::mutex> lock(mMutex);
+    return mInFlightBytes;
+}
+
+std::vector<PrefetchEntry> ResourcePrefetcher::TakeStartable() {
+    std::vector<PrefetchEntry> started;
+    while (!mPending.empty() && (mInFlightCount == 0 || mInFlightBytes + mPending.front().Size <= mMaxInFlightBytes)) {
+        started.push_back(mPending.front());
+        mInFlightBytes += mPending.front().Size;
+        mInFlightCount++;
+        mPending.pop_front();
+    }
+    return started;
+}
+
+void ResourcePrefetcher::Submit(const std::vector<PrefetchEntry>& entries) {
+    // Called after unlocking, a pool may run the tasks right away on this thread
+    for (const PrefetchEntry& entry : entries) {
+        mThreadPool->detach_task(
+            [this, entry]() {
+                try {
+                    mLoad(entry.Hash);
+                } catch (const std::exception& e) {
+                    SPDLOG_ERROR("Failed to prefetch resource {:016X}: {}", entry.Hash, e.what());
+                }
+
+                std::vector<PrefetchEntry> started;
+                {
+                    const std::lock_guard<std::mutex> lock(mMutex);
+                    mInFlightBytes -= entry.Size;
+                    mInFlightCount--;
+                    started = TakeStartable();
+                    // Nothing touches this once it is idle, Wait may return and the prefetcher go away
+                    if (mPending.empty() && mInFlightCount == 0) {
+                        mIdle.notify_all();
+                    }
+                }
+                // Entries were started, so the prefetcher cannot be idle and is still alive
+                if (!started.empty()) {
+                    Submit(started);
+                }
+            },
+            BS::pr::low);
+    }
+}
+} // namespace Ship
@@ -9,6 +9,10 @@ IResource::~IResource() {
     SPDLOG_TRACE("Resource Unloaded: {}\n", GetInitData()->Path);
 }
 
+size_t IResource::GetMemorySize() {
+    return GetPointerSize();
+}
+
 bool IResource::IsDirty() {
     return mIsDirty;
 }
@@ -17,6 +21,14 @@ void IResource::Dirty() {
     mIsDirty = true;
 }
 
+void IResource::Pin() {
+    mIsPinned.store(true, std::memory_order_relaxed);
+}
+
+bool IResource::IsPinned() {
+    return mIsPinned.load(std::memory_order_relaxed);
+}
+
 std::shared_ptr<ResourceInitData> IResource::GetInitData() {
     return mInitData;
 }
@@ -0,0 +1,58 @@
+#include "ship/resource/ResourceCache.h"
+#include "ship/utils/Utils.h"
+
+namespace Ship {
+
+size_t ResourceIdentifier::GetHash() const {
+    return mHash;
+}
+
+ResourceIdentifier::ResourceIdentifier(const std::string& path, const uintptr_t owner,
+                                       const std::shared_ptr<Archive> parent)
+    : Path(path), Owner(owner), Parent(parent) {
+    mHash = CalculateHash(Path, Owner, Parent.get());
+}
+
+bool ResourceIdentifier::operator==(const ResourceIdentifier& rhs) const {
+    return Owner == rhs.Owner && Path == rhs.Path && Parent == rhs.Parent;
+}
+
+size_t ResourceIdentifier::CalculateHash(std::string_view path, uintptr_t owner, const Archive* parent) {
+    // Identifiers compare their parents by address, hashing the address spares hashing the archive path as well
+    size_t hash = Math::HashCombine(std::hash<std::string_view>{}(path), std::hash<std::uintptr_t>{}(owner));
+    if (parent != nullptr) {
+        hash = Math::HashCombine(hash, std::hash<const Archive*>{}(parent));
+    }
+    return hash;
+}
+
+ResourceIdentifierView::ResourceIdentifierView(std::string_view path, uintptr_t owner, const Archive* parent)
+    : Path(path), Owner(owner), Parent(parent), Hash(ResourceIdentifier::CalculateHash(path, owner, parent)) {
+}
+
+ResourceIdentifierView::ResourceIdentifierView(const ResourceIdentifier& identifier)
+    : Path(identifier.Path), Owner(identifier.Owner), Parent(identifier.Parent.get()),
+      Hash(ResourceIdentifierHash()(identifier)) {
+}
+
+size_t ResourceIdentifierHash::operator()(const ResourceIdentifier& rcd) const {
+    return rcd.GetHash();
+}
+
+size_t ResourceIdentifierHash::operator()(const ResourceIdentifierView& rcd) const {
+    return rcd.Hash;
+}
+
+bool ResourceIdentifierEqual::operator()(const ResourceIdentifier& lhs, const ResourceIdentifier& rhs) const {
+    return lhs == rhs;
+}
+
+bool ResourceIdentifierEqual::operator()(const ResourceIdentifier& lhs, const ResourceIdentifierView& rhs) const {
+    return lhs.Owner == rhs.Owner && lhs.Path == rhs.Path && lhs.Parent.get() == rhs.Parent;
+}
+
+bool ResourceIdentifierEqual::operator()(const ResourceIdentifierView& lhs, const ResourceIdentifier& rhs) const {
+    return (*this)(rhs, lhs);
+}
+
+} // namespace Ship
@@ -4,7 +4,7 @@
 #include "ship/resource/Resource.h"
 #include "ship/resource/File.h"
 #include "ship/Context.h"
-#include "ship/utils/binarytools/MemoryStream.h"
+#include "ship/utils/binarytools/SpanStream.h"
 #include "ship/utils/binarytools/BinaryReader.h"
 #include "ship/resource/factory/JsonFactory.h"
 #include "ship/resource/factory/ShaderFactory.h"
@@ -82,13 +82,22 @@ std::shared_ptr<ResourceFactory> ResourceLoader::GetFactory(uint32_t format, std
     return GetFactory(format, mResourceTypes[typeName], version);
 }
 
+// Reads the file where it is, the stream keeps whatever holds its bytes alive
+static std::shared_ptr<Stream> CreateFileStream(std::shared_ptr<File> file) {
+    std::shared_ptr<const void> owner = file->Mapping;
+    if (owner == nullptr) {
+        owner = file->Buffer;
+    }
+    return std::make_shared<SpanStream>(file->GetData(), file->GetSize(), owner);
+}
+
 std::shared_ptr<ResourceInitData> ResourceLoader::ReadResourceInitDataLegacy(const std::string& filePath,
                                                                              std::shared_ptr<File> fileToLoad) {
     // Determine if file is binary or XML...
-    if (fileToLoad->Buffer->at(0) == '<') {
+    if (fileToLoad->GetSize() > 0 && fileToLoad->GetData()[0] == '<') {
         // File is XML
         // Read the xml document
-        auto stream = std::make_shared<MemoryStream>(fileToLoad->Buffer);
+        auto stream = CreateFileStream(fileToLoad);
         auto binaryReader = std::make_shared<BinaryReader>(stream);
 
         auto xmlReader = std::make_shared<tinyxml2::XMLDocument>();
@@ -100,31 +109,35 @@ std::shared_ptr<ResourceInitData> ResourceLoader::ReadResourceInitDataLegacy(con
         }
         return ReadResourceInitDataXml(filePath, xmlReader);
     } else {
-        auto headerBuffer = std::make_shared<std::vector<char>>(fileToLoad->Buffer->begin(),
-                                                                fileToLoad->Buffer->begin() + OTR_HEADER_SIZE);
-
-        if (headerBuffer->size() < OTR_HEADER_SIZE) {
+        const char* data = fileToLoad->GetData();
+        const size_t size = fileToLoad->GetSize();
+        if (size < OTR_HEADER_SIZE) {
             SPDLOG_ERROR("Failed to parse ResourceInitData, buffer size too small. File: {}. Got {} bytes and "
                          "needed {} bytes.",
-                         filePath, headerBuffer->size(), OTR_HEADER_SIZE);
+                         filePath, size, OTR_HEADER_SIZE);
             return nullptr;
         }
 
-        // Factories expect the buffer to not include the header,
-        // so we need to remove it from the buffer on the file
-        fileToLoad->Buffer = std::make_shared<std::vector<char>>(fileToLoad->Buffer->begin() + OTR_HEADER_SIZE,
-                                                                 fileToLoad->Buffer->end());
-
         // Create a reader for the header buffer
-        auto headerStream = std::make_shared<MemoryStream>(headerBuffer);
+        auto headerStream = std::make_shared<SpanStream>(data, OTR_HEADER_SIZE);
         auto headerReader = std::make_shared<BinaryReader>(headerStream);
-        return ReadResourceInitDataBinary(filePath, headerReader);
+        auto initData = ReadResourceInitDataBinary(filePath, headerReader);
+
+        // Factories expect the buffer to not include the header,
+        // so we need to remove it from the buffer on the file
+        if (fileToLoad->Data != nullptr) {
+            fileToLoad->Data = data + OTR_HEADER_SIZE;
+            fileToLoad->Size = size - OTR_HEADER_SIZE;
+        } else {
+            fileToLoad->Buffer->erase(fileToLoad->Buffer->begin(), fileToLoad->Buffer->begin() + OTR_HEADER_SIZE);
+        }
+        return initData;
     }
 }
 
 std::shared_ptr<BinaryReader> ResourceLoader::CreateBinaryReader(std::shared_ptr<File> fileToLoad,
                                                                  std::shared_ptr<ResourceInitData> initData) {
-    auto stream = std::make_shared<MemoryStream>(fileToLoad->Buffer);
+    auto stream = CreateFileStream(fileToLoad);
     auto reader = std::make_shared<BinaryReader>(stream);
     reader->SetEndianness(initData->ByteOrder);
     return reader;
@@ -132,7 +145,7 @@ std::shared_ptr<BinaryReader> ResourceLoader::CreateBinaryReader(std::shared_ptr
 
 std::shared_ptr<tinyxml2::XMLDocument> ResourceLoader::CreateXMLReader(std::shared_ptr<File> fileToLoad,
                                                                        std::shared_ptr<ResourceInitData> initData) {
-    auto stream = std::make_shared<MemoryStream>(fileToLoad->Buffer);
+    auto stream = CreateFileStream(fileToLoad);
     auto binaryReader = std::make_shared<BinaryReader>(stream);
 
     auto xmlReader = std::make_shared<tinyxml2::XMLDocument>();
@@ -164,7 +177,7 @@ std::shared_ptr<ResourceInitData> ResourceLoader::ReadResourceInitData(const std
     // just using metaFileToLoad->Buffer->data() leads to garbage at the end
     // that causes nlohmann to fail parsing, following the pattern used for
     // xml resolves that issue
-    auto stream = std::make_shared<MemoryStream>(metaFileToLoad->Buffer);
+    auto stream = CreateFileStream(metaFileToLoad);
     auto binaryReader = std::make_shared<BinaryReader>(stream);
     auto parsed = nlohmann::json::parse(binaryReader->ReadCString());
 
@@ -3,45 +3,27 @@
 #include "ship/resource/File.h"
 #include "ship/resource/archive/Archive.h"
 #include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <thread>
+#include <tuple>
 #include "ship/utils/StringHelper.h"
 #include "ship/utils/Utils.h"
+#include "ship/utils/StrHash64.h"
 #include "ship/config/ConsoleVariable.h"
 #include "ship/Context.h"
 
 namespace Ship {
 
+// Set on the pool threads while they prefetch, so that prefetched resources are not recorded as loaded on demand
+static thread_local bool sIsPrefetching = false;
+
 ResourceFilter::ResourceFilter(const std::list<std::string>& includeMasks, const std::list<std::string>& excludeMasks,
                                const uintptr_t owner, const std::shared_ptr<Archive> parent)
     : IncludeMasks(includeMasks), ExcludeMasks(excludeMasks), Owner(owner), Parent(parent) {
 }
 
-size_t ResourceIdentifier::GetHash() const {
-    return mHash;
-}
-
-ResourceIdentifier::ResourceIdentifier(const std::string& path, const uintptr_t owner,
-                                       const std::shared_ptr<Archive> parent)
-    : Path(path), Owner(owner), Parent(parent) {
-    mHash = CalculateHash();
-}
-
-bool ResourceIdentifier::operator==(const ResourceIdentifier& rhs) const {
-    return Owner == rhs.Owner && Path == rhs.Path && Parent == rhs.Parent;
-}
-
-size_t ResourceIdentifier::CalculateHash() {
-    size_t hash = Math::HashCombine(std::hash<std::string>{}(Path), std::hash<std::uintptr_t>{}(Owner));
-    if (Parent != nullptr) {
-        hash = Math::HashCombine(hash, std::hash<std::string>{}(Parent->GetPath()));
-    }
-    return hash;
-}
-
-size_t ResourceIdentifierHash::operator()(const ResourceIdentifier& rcd) const {
-    return rcd.GetHash();
-}
-
 ResourceManager::ResourceManager() {
 }
 
@@ -59,6 +41,17 @@ void ResourceManager::Init(const std::vector<std::string>& archivePaths,
         // Nothing ever unpauses the thread pool since nothing will ever try to load the archive again.
         mThreadPool->pause();
     }
+
+    mPrefetcher = std::make_unique<ResourcePrefetcher>(mThreadPool, [this](uint64_t hash) {
+        // The archives may have changed since the manifest was recorded
+        const std::string* path = GetArchiveManager()->HashToString(hash);
+        if (path == nullptr) {
+            return;
+        }
+        sIsPrefetching = true;
+        LoadResourceProcess(*path, true);
+        sIsPrefetching = false;
+    });
 }
 
 ResourceManager::~ResourceManager() {
@@ -141,7 +134,7 @@ std::shared_ptr<IResource> ResourceManager::LoadResourceProcess(const ResourceId
     auto file = LoadFileProcess(identifier.Path);
     if (file == nullptr) {
         SPDLOG_TRACE("Failed to load resource file at path {}", identifier.Path);
-        mResourceCache[identifier] = ResourceLoadError::NotFound;
+        mResourceCache.Set(identifier, ResourceLoadError::NotFound);
         return nullptr;
     }
 
@@ -151,22 +144,20 @@ std::shared_ptr<IResource> ResourceManager::LoadResourceProcess(const ResourceId
     // Another thread could have loaded the resource while we were processing, so we want to check before setting to
     // the cache.
     cachedResource = GetCachedResource(identifier, true);
+    if (cachedResource != nullptr) {
+        // If another thread has already loaded this resource, discard the work we already did and return from
+        // cache.
+        resource = cachedResource;
+    }
 
-    {
-        const std::lock_guard<std::mutex> lock(mMutex);
-
-        if (cachedResource != nullptr) {
-            // If another thread has already loaded this resource, discard the work we already did and return from
-            // cache.
-            resource = cachedResource;
-        }
-
-        // Set the cache to the loaded resource
-        if (resource != nullptr) {
-            mResourceCache[identifier] = resource;
-        } else {
-            mResourceCache[identifier] = ResourceLoadError::NotFound;
+    // Set the cache to the loaded resource
+    if (resource != nullptr) {
+        mResourceCache.Set(identifier, resource, resource->GetMemorySize());
+        if (mIsRecordingPrefetch && !sIsPrefetching) {
+            mPrefetchRecording->Record(CRC64(identifier.Path.c_str()), file->GetSize());
         }
+    } else {
+        mResourceCache.Set(identifier, ResourceLoadError::NotFound);
     }
 
     if (resource != nullptr) {
@@ -186,20 +177,26 @@ std::shared_ptr<IResource> ResourceManager::LoadResourceProcess(const std::strin
 std::shared_future<std::shared_ptr<IResource>>
 ResourceManager::LoadResourceAsync(const ResourceIdentifier& identifier, bool loadExact, BS::priority_t priority,
                                    std::shared_ptr<ResourceInitData> initData) {
-    // Check for and remove the OTR signature
-    if (OtrSignatureCheck(identifier.Path.c_str())) {
-        auto newFilePath = identifier.Path.substr(7);
-        return LoadResourceAsync({ newFilePath, identifier.Owner, identifier.Parent }, loadExact, priority);
-    }
-
-    // Check the cache before queueing the job.
-    auto cacheCheck = GetCachedResource(identifier, loadExact);
+    // Check the cache before queueing the job. The OTR signature is skipped by the lookup.
+    auto cacheCheck = FindCachedResource(ResourceIdentifierView(identifier), loadExact);
     if (cacheCheck) {
         auto promise = std::make_shared<std::promise<std::shared_ptr<IResource>>>();
         promise->set_value(cacheCheck);
         return promise->get_future().share();
     }
 
+    return QueueResourceLoad(identifier, loadExact, priority, initData);
+}
+
+std::shared_future<std::shared_ptr<IResource>>
+ResourceManager::QueueResourceLoad(const ResourceIdentifier& identifier, bool loadExact, BS::priority_t priority,
+                                   std::shared_ptr<ResourceInitData> initData) {
+    // Check for and remove the OTR signature
+    if (OtrSignatureCheck(identifier.Path.c_str())) {
+        auto newFilePath = identifier.Path.substr(7);
+        return QueueResourceLoad({ newFilePath, identifier.Owner, identifier.Parent }, loadExact, priority, initData);
+    }
+
     return mThreadPool->submit_task(
         [this, identifier, loadExact, initData]() -> std::shared_ptr<IResource> {
             return LoadResourceProcess(identifier, loadExact, initData);
@@ -215,16 +212,39 @@ ResourceManager::LoadResourceAsync(const std::string& filePath, bool loadExact,
 
 std::shared_ptr<IResource> ResourceManager::LoadResource(const ResourceIdentifier& identifier, bool loadExact,
                                                          std::shared_ptr<ResourceInitData> initData) {
-    auto resource = LoadResourceAsync(identifier, loadExact, BS::pr::highest, initData).get();
-    if (resource == nullptr) {
-        SPDLOG_TRACE("Failed to load resource file at path {}", identifier.Path);
+    // Hits are returned straight from the cache, only a miss goes through a future
+    auto resource = FindCachedResource(ResourceIdentifierView(identifier), loadExact);
+    if (resource != nullptr) {
+        return resource;
     }
-    return resource;
+
+    return LoadUncachedResource(identifier, loadExact, initData);
 }
 
 std::shared_ptr<IResource> ResourceManager::LoadResource(const std::string& filePath, bool loadExact,
                                                          std::shared_ptr<ResourceInitData> initData) {
-    return LoadResource({ filePath, mDefaultCacheOwner, mDefaultCacheArchive }, loadExact, initData);
+    return LoadResourceByPath(filePath, loadExact, initData);
+}
+
+std::shared_ptr<IResource> ResourceManager::LoadResourceByPath(std::string_view filePath, bool loadExact,
+                                                               std::shared_ptr<ResourceInitData> initData) {
+    // Only a miss copies the path into an identifier
+    auto resource = FindCachedResource(filePath, loadExact);
+    if (resource != nullptr) {
+        return resource;
+    }
+
+    return LoadUncachedResource({ std::string(filePath), mDefaultCacheOwner, mDefaultCacheArchive }, loadExact,
+                                initData);
+}
+
+std::shared_ptr<IResource> ResourceManager::LoadUncachedResource(const ResourceIdentifier& identifier, bool loadExact,
+                                                                 std::shared_ptr<ResourceInitData> initData) {
+    auto resource = QueueResourceLoad(identifier, loadExact, BS::pr::highest, initData).get();
+    if (resource == nullptr) {
+        SPDLOG_TRACE("Failed to load resource file at path {}", identifier.Path);
+    }
+    return resource;
 }
 
 std::shared_ptr<IResource> ResourceManager::LoadResource(uint64_t crc, bool loadExact,
@@ -251,14 +271,12 @@ ResourceManager::CheckCache(const ResourceIdentifier& identifier, bool loadExact
         }
     }
 
-    const std::lock_guard<std::mutex> lock(mMutex);
-
-    auto cacheFind = mResourceCache.find(identifier);
-    if (cacheFind == mResourceCache.end()) {
+    std::variant<ResourceLoadError, std::shared_ptr<IResource>> cacheLine;
+    if (!mResourceCache.Find(identifier, cacheLine)) {
         return ResourceLoadError::NotCached;
     }
 
-    return cacheFind->second;
+    return cacheLine;
 }
 
 std::variant<ResourceManager::ResourceLoadError, std::shared_ptr<IResource>>
@@ -276,6 +294,46 @@ std::shared_ptr<IResource> ResourceManager::GetCachedResource(const std::string&
     return GetCachedResource({ filePath, mDefaultCacheOwner, mDefaultCacheArchive }, loadExact);
 }
 
+std::shared_ptr<IResource> ResourceManager::FindCachedResource(std::string_view filePath, bool loadExact) {
+    return FindCachedResource({ filePath, mDefaultCacheOwner, mDefaultCacheArchive.get() }, loadExact);
+}
+
+std::shared_ptr<IResource> ResourceManager::FindCachedResource(const ResourceIdentifierView& identifier,
+                                                               bool loadExact) {
+    static constexpr std::string_view sOtrSignature = "__OTR__";
+    if (identifier.Path.starts_with(sOtrSignature)) {
+        return FindCachedResource(
+            { identifier.Path.substr(sOtrSignature.size()), identifier.Owner, identifier.Parent }, loadExact);
+    }
+
+    // A cached alternate asset is used over the standard one, the same way CheckCache picks it
+    std::variant<ResourceLoadError, std::shared_ptr<IResource>> cacheLine;
+    const std::string& altPrefix = IResource::gAltAssetPrefix;
+    if (!loadExact && mAltAssetsEnabled && !identifier.Path.starts_with(altPrefix)) {
+        // Put together on the stack, only paths longer than any the games use go through the heap
+        char altBuffer[256];
+        std::string altLongPath;
+        std::string_view altPath;
+        if (altPrefix.size() + identifier.Path.size() <= sizeof(altBuffer)) {
+            memcpy(altBuffer, altPrefix.data(), altPrefix.size());
+            memcpy(altBuffer + altPrefix.size(), identifier.Path.data(), identifier.Path.size());
+            altPath = std::string_view(altBuffer, altPrefix.size() + identifier.Path.size());
+        } else {
+            altLongPath = altPrefix + std::string(identifier.Path);
+            altPath = altLongPath;
+        }
+        if (mResourceCache.Find(ResourceIdentifierView(altPath, identifier.Owner, identifier.Parent), cacheLine) &&
+            std::holds_alternative<std::shared_ptr<IResource>>(cacheLine)) {
+            return GetCachedResource(std::move(cacheLine));
+        }
+    }
+
+    if (!mResourceCache.Find(identifier, cacheLine)) {
+        return nullptr;
+    }
+    return GetCachedResource(std::move(cacheLine));
+}
+
 std::shared_ptr<IResource>
 ResourceManager::GetCachedResource(std::variant<ResourceLoadError, std::shared_ptr<IResource>> cacheLine) {
     // Gets the cached resource based on a cache line std::variant from the cache map.
@@ -300,33 +358,163 @@ ResourceManager::GetCachedResource(std::variant<ResourceLoadError, std::shared_p
     return nullptr;
 }
 
+struct ResourceManager::ResourceBatch {
+    ResourceBatch(const ResourceFilter& filter) : Filter(filter) {
+    }
+
+    const ResourceFilter Filter;
+    std::shared_ptr<ResourceLoadProgress> Progress;
+    std::vector<std::string> Files;
+    // Indices into Files, grouped by archive and in the order each archive stores them
+    std::vector<size_t> Order;
+    size_t ChunkSize = 0;
+    size_t ChunkCount = 0;
+    std::atomic<size_t> NextChunk = 0;
+
+    // Indexed like Files, every chunk only writes to its own
+    std::vector<std::variant<ResourceLoadError, std::shared_ptr<IResource>>> Results;
+    // Loaded by the batch rather than found in the cache
+    std::vector<uint8_t> Loaded;
+    std::vector<size_t> FileSizes;
+
+    std::mutex Mutex;
+    std::condition_variable Finished;
+    size_t FinishedChunks = 0;
+};
+
+void ResourceManager::LoadResourceBatchChunks(std::shared_ptr<ResourceBatch> batch) {
+    for (size_t chunk = batch->NextChunk++; chunk < batch->ChunkCount; chunk = batch->NextChunk++) {
+        const size_t end = std::min(batch->Order.size(), (chunk + 1) * batch->ChunkSize);
+        for (size_t i = chunk * batch->ChunkSize; i < end; i++) {
+            const size_t index = batch->Order[i];
+            const ResourceIdentifier identifier(batch->Files[index], batch->Filter.Owner, batch->Filter.Parent);
+            std::shared_ptr<IResource> resource;
+            try {
+                resource = GetCachedResource(identifier);
+                if (resource == nullptr && mAltAssetsEnabled) {
+                    // Keeps the alternate asset lookups of single loads
+                    resource = LoadResourceProcess(identifier);
+                } else if (resource == nullptr) {
+                    auto file = LoadFileProcess(identifier.Path);
+                    if (file != nullptr) {
+                        // Taken before the loader skips the header
+                        batch->FileSizes[index] = file->GetSize();
+                        resource = GetResourceLoader()->LoadResource(identifier.Path, file);
+                    }
+                    batch->Loaded[index] = true;
+                }
+            } catch (const std::exception& e) {
+                SPDLOG_ERROR("Failed to load resource {}: {}", identifier.Path, e.what());
+                batch->Loaded[index] = true;
+            }
+
+            if (resource != nullptr) {
+                batch->Results[index] = resource;
+            } else {
+                batch->Results[index] = ResourceLoadError::NotFound;
+            }
+            if (batch->Progress != nullptr) {
+                batch->Progress->Loaded++;
+            }
+        }
+
+        const std::lock_guard<std::mutex> lock(batch->Mutex);
+        if (++batch->FinishedChunks == batch->ChunkCount) {
+            batch->Finished.notify_all();
+        }
+    }
+}
+
 std::shared_ptr<std::vector<std::shared_ptr<IResource>>>
-ResourceManager::LoadResourcesProcess(const ResourceFilter& filter) {
-    auto loadedList = std::make_shared<std::vector<std::shared_ptr<IResource>>>();
-    auto fileList = GetArchiveManager()->ListFiles(filter.IncludeMasks, filter.ExcludeMasks);
-    loadedList->reserve(fileList->size());
+ResourceManager::LoadResourcesProcess(const ResourceFilter& filter, std::shared_ptr<ResourceLoadProgress> progress) {
+    auto batch = std::make_shared<ResourceBatch>(filter);
+    batch->Progress = progress;
+    batch->Files = std::move(*GetArchiveManager()->ListFiles(filter.IncludeMasks, filter.ExcludeMasks));
+    const size_t fileCount = batch->Files.size();
+    batch->Results.resize(fileCount);
+    batch->Loaded.assign(fileCount, false);
+    batch->FileSizes.assign(fileCount, 0);
+    if (progress != nullptr) {
+        progress->Total = fileCount;
+        progress->Loaded = 0;
+    }
 
-    for (size_t i = 0; i < fileList->size(); i++) {
-        auto fileName = std::string(fileList->operator[](i));
-        auto resource = LoadResource({ fileName, filter.Owner, filter.Parent });
-        loadedList->push_back(resource);
+    // Reading every archive front to back keeps the reads sequential
+    std::vector<std::tuple<uintptr_t, uint64_t, size_t>> order;
+    order.reserve(fileCount);
+    for (size_t i = 0; i < fileCount; i++) {
+        auto archive = GetArchiveManager()->GetArchiveFromFile(batch->Files[i]);
+        const uint64_t offset = archive != nullptr ? archive->GetFileOffset(CRC64(batch->Files[i].c_str())) : 0;
+        order.emplace_back((uintptr_t)archive.get(), offset, i);
+    }
+    std::sort(order.begin(), order.end());
+    batch->Order.reserve(fileCount);
+    for (const auto& [archive, offset, index] : order) {
+        batch->Order.push_back(index);
+    }
+
+    // A few chunks per thread, so that threads finishing early take over from slow ones
+    const size_t threadCount = mThreadPool->get_thread_count() + 1;
+    batch->ChunkSize = std::max<size_t>(16, fileCount / (threadCount * 4));
+    batch->ChunkCount = (fileCount + batch->ChunkSize - 1) / batch->ChunkSize;
+
+    // This thread takes chunks as well, so it only ever waits on chunks that are loading and never on queued tasks,
+    // even when it runs on the pool itself
+    const size_t helperCount = std::min(batch->ChunkCount, threadCount) - (batch->ChunkCount != 0 ? 1 : 0);
+    for (size_t i = 0; i < helperCount; i++) {
+        mThreadPool->detach_task([this, batch]() { LoadResourceBatchChunks(batch); }, BS::pr::high);
+    }
+    LoadResourceBatchChunks(batch);
+    {
+        std::unique_lock<std::mutex> lock(batch->Mutex);
+        batch->Finished.wait(lock, [&batch]() { return batch->FinishedChunks == batch->ChunkCount; });
+    }
+
+    // Everything the batch loaded goes into the cache in one pass, resources another thread cached meanwhile win
+    std::deque<ResourceIdentifier> identifiers;
+    std::vector<ResourceCache<std::variant<ResourceLoadError, std::shared_ptr<IResource>>>::BatchLine> lines;
+    for (size_t i = 0; i < fileCount; i++) {
+        if (!batch->Loaded[i]) {
+            continue;
+        }
+        auto resource = std::get_if<std::shared_ptr<IResource>>(&batch->Results[i]);
+        identifiers.emplace_back(batch->Files[i], filter.Owner, filter.Parent);
+        const size_t bytes = resource != nullptr ? (*resource)->GetMemorySize() : 0;
+        lines.push_back({ &identifiers.back(), &batch->Results[i], bytes });
+        if (resource != nullptr && mIsRecordingPrefetch && !sIsPrefetching) {
+            mPrefetchRecording->Record(CRC64(batch->Files[i].c_str()), batch->FileSizes[i]);
+        }
+    }
+    mResourceCache.SetBatch(lines, [](const std::variant<ResourceLoadError, std::shared_ptr<IResource>>& cacheLine) {
+        auto resource = std::get_if<std::shared_ptr<IResource>>(&cacheLine);
+        return resource != nullptr && *resource != nullptr && !(*resource)->IsDirty();
+    });
+    SPDLOG_TRACE("Loaded {} of {} resources in {} chunks", lines.size(), fileCount, batch->ChunkCount);
+
+    auto loadedList = std::make_shared<std::vector<std::shared_ptr<IResource>>>();
+    loadedList->reserve(fileCount);
+    for (const auto& result : batch->Results) {
+        auto resource = std::get_if<std::shared_ptr<IResource>>(&result);
+        loadedList->push_back(resource != nullptr ? *resource : nullptr);
     }
 
     return loadedList;
 }
 
 std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<IResource>>>>
-ResourceManager::LoadResourcesAsync(const ResourceFilter& filter, BS::priority_t priority) {
+ResourceManager::LoadResourcesAsync(const ResourceFilter& filter, BS::priority_t priority,
+                                    std::shared_ptr<ResourceLoadProgress> progress) {
     return mThreadPool->submit_task(
-        [this, filter]() -> std::shared_ptr<std::vector<std::shared_ptr<IResource>>> {
-            return LoadResourcesProcess(filter);
+        [this, filter, progress]() -> std::shared_ptr<std::vector<std::shared_ptr<IResource>>> {
+            return LoadResourcesProcess(filter, progress);
         },
         priority);
 }
 
 std::shared_future<std::shared_ptr<std::vector<std::shared_ptr<IResource>>>>
-ResourceManager::LoadResourcesAsync(const std::string& searchMask, BS::priority_t priority) {
-    return LoadResourcesAsync({ { searchMask }, {}, mDefaultCacheOwner, mDefaultCacheArchive }, priority);
+ResourceManager::LoadResourcesAsync(const std::string& searchMask, BS::priority_t priority,
+                                    std::shared_ptr<ResourceLoadProgress> progress) {
+    return LoadResourcesAsync({ { searchMask }, {}, mDefaultCacheOwner, mDefaultCacheArchive }, priority, progress);
 }
 
 std::shared_ptr<std::vector<std::shared_ptr<IResource>>> ResourceManager::LoadResources(const std::string& searchMask) {
@@ -346,6 +534,7 @@ void ResourceManager::DirtyResources(const ResourceFilter& filter) {
             // If it's a resource, we will set the dirty flag, else we will just unload it.
             if (resource != nullptr) {
                 resource->Dirty();
+                mUnloadGeneration++;
             } else {
                 UnloadResource({ key, filter.Owner, filter.Parent });
             }
@@ -390,18 +579,93 @@ std::shared_ptr<ResourceLoader> ResourceManager::GetResourceLoader() {
 }
 
 size_t ResourceManager::UnloadResource(const ResourceIdentifier& identifier) {
-    // Store a shared pointer here so that erase doesn't destruct the resource.
-    // The resource will attempt to load other resources on the destructor, and this will fail because we already hold
-    // the mutex.
-    std::variant<ResourceLoadError, std::shared_ptr<IResource>> value = nullptr;
-    size_t ret = 0;
-    // We can only erase the resource if we have any resources for that owner.
-    if (mResourceCache.contains(identifier)) {
-        const std::lock_guard<std::mutex> lock(mMutex);
-        mResourceCache.erase(identifier);
+    // The cache destroys the resource after unlocking, it may load or unload other resources on the way out.
+    mResourceCache.Erase(identifier);
+    mUnloadGeneration++;
+    return 0;
+}
+
+uint64_t ResourceManager::GetGeneration() {
+    return mUnloadGeneration + (mArchiveManager != nullptr ? mArchiveManager->GetGeneration() : 0);
+}
+
+void ResourceManager::EndFrame() {
+    // In megabytes, 0 keeps everything
+    auto consoleVariables = Context::GetInstance()->GetConsoleVariables();
+    const int32_t budgetMb =
+        consoleVariables != nullptr ? consoleVariables->GetInteger(CVAR_RESOURCE_CACHE_BUDGET, 0) : 0;
+    mResourceCache.SetBudget((size_t)std::max(budgetMb, 0) * 1024 * 1024);
+
+    // Destroyed once the cache is unlocked, resources may load or unload others when they go away
+    std::vector<std::variant<ResourceLoadError, std::shared_ptr<IResource>>> evicted;
+    const size_t count = mResourceCache.Evict(
+        [](const std::variant<ResourceLoadError, std::shared_ptr<IResource>>& cacheLine) {
+            // Only resources the cache alone references, a failed load costs nothing to keep
+            auto resource = std::get_if<std::shared_ptr<IResource>>(&cacheLine);
+            return resource != nullptr && *resource != nullptr && resource->use_count() == 1;
+        },
+        [](const std::variant<ResourceLoadError, std::shared_ptr<IResource>>& cacheLine) {
+            auto resource = std::get_if<std::shared_ptr<IResource>>(&cacheLine);
+            return resource != nullptr && *resource != nullptr && (*resource)->IsPinned();
+        },
+        evicted);
+    if (count != 0) {
+        SPDLOG_TRACE("Evicted {} resources to fit the resource cache budget", count);
+    }
+
+    mResourceCache.AdvanceFrame();
+}
+
+ResourceCacheStats ResourceManager::GetCacheStats() {
+    return mResourceCache.GetStats();
+}
+
+void ResourceManager::StartPrefetchRecording() {
+    mIsRecordingPrefetch = true;
+}
+
+void ResourceManager::StopPrefetchRecording() {
+    mIsRecordingPrefetch = false;
+}
+
+bool ResourceManager::SavePrefetchManifest(const std::string& filePath) {
+    SPDLOG_INFO("Saving prefetch manifest with {} resources in {} areas to {}", mPrefetchRecording->GetEntryCount(),
+                mPrefetchRecording->GetAreaCount(), filePath);
+    return mPrefetchRecording->Save(filePath);
+}
+
+bool ResourceManager::LoadPrefetchManifest(const std::string& filePath) {
+    auto manifest = std::make_shared<PrefetchManifest>();
+    if (!manifest->Load(filePath)) {
+        return false;
     }
 
-    return ret;
+    SPDLOG_INFO("Loaded prefetch manifest with {} resources in {} areas from {}", manifest->GetEntryCount(),
+                manifest->GetAreaCount(), filePath);
+    mPrefetchManifest = manifest;
+    return true;
+}
+
+void ResourceManager::MarkPrefetchArea(const std::string& area) {
+    if (mIsRecordingPrefetch) {
+        mPrefetchRecording->MarkArea(area);
+    }
+
+    // A paused pool would never run the prefetches
+    if (mPrefetchManifest == nullptr || mPrefetcher == nullptr || !IsLoaded()) {
+        return;
+    }
+
+    auto consoleVariables = Context::GetInstance()->GetConsoleVariables();
+    const int32_t inFlightMb =
+        consoleVariables != nullptr ? consoleVariables->GetInteger(CVAR_RESOURCE_PREFETCH_IN_FLIGHT, 8) : 8;
+    auto entries = mPrefetchManifest->GetArea(area);
+    SPDLOG_TRACE("Prefetching {} resources for area {}", entries.size(), area);
+    mPrefetcher->Start(entries, (size_t)std::max(inFlightMb, 1) * 1024 * 1024);
+}
+
+std::shared_ptr<PrefetchManifest> ResourceManager::GetPrefetchRecording() {
+    return mPrefetchRecording;
 }
 
 size_t ResourceManager::UnloadResource(const std::string& filePath) {
@@ -430,7 +694,7 @@ size_t ResourceManager::GetResourceSize(std::shared_ptr<IResource> resource) {
 }
 
 size_t ResourceManager::GetResourceSize(const char* name) {
-    auto resource = LoadResource(name);
+    auto resource = LoadResourceByPath(name);
 
     return GetResourceSize(resource);
 }
@@ -450,7 +714,7 @@ bool ResourceManager::GetResourceIsCustom(std::shared_ptr<IResource> resource) {
 }
 
 bool ResourceManager::GetResourceIsCustom(const char* name) {
-    auto resource = LoadResource(name);
+    auto resource = LoadResourceByPath(name);
 
     return GetResourceIsCustom(resource);
 }
@@ -466,11 +730,12 @@ void* ResourceManager::GetResourceRawPointer(std::shared_ptr<IResource> resource
         return nullptr;
     }
 
+    resource->Pin();
     return resource->GetRawPointer();
 }
 
 void* ResourceManager::GetResourceRawPointer(const char* name) {
-    auto resource = LoadResource(name);
+    auto resource = LoadResourceByPath(name);
 
     return GetResourceRawPointer(resource);
 }
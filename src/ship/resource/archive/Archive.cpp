@@ -6,6 +6,7 @@
 #include "ship/resource/File.h"
 #include "ship/resource/ResourceLoader.h"
 #include "ship/resource/ResourceType.h"
+#include "ship/resource/archive/ArchiveIndex.h"
 #include "ship/utils/binarytools/MemoryStream.h"
 #include "ship/utils/glob.h"
 #include "ship/utils/StrHash64.h"
@@ -34,7 +35,7 @@ void Archive::Load() {
     bool isGameVersionValid = false;
     if (t != nullptr && t->IsLoaded) {
         mHasGameVersion = true;
-        auto stream = std::make_shared<MemoryStream>(t->Buffer->data(), t->Buffer->size());
+        auto stream = std::make_shared<MemoryStream>((char*)t->GetData(), t->GetSize());
         auto reader = std::make_shared<BinaryReader>(stream);
         Endianness endianness = (Endianness)reader->ReadUByte();
         reader->SetEndianness(endianness);
@@ -54,6 +55,14 @@ void Archive::Load() {
     }
 }
 
+uint64_t Archive::GetFileOffset(uint64_t hash) {
+    return 0;
+}
+
+std::shared_ptr<File> Archive::LoadFileInPlace(uint64_t hash) {
+    return LoadFile(hash);
+}
+
 void Archive::Unload() {
     Close();
     SetLoaded(false);
@@ -115,6 +124,19 @@ void Archive::IndexFile(const std::string& filePath) {
     (*mHashes)[CRC64(filePath.c_str())] = filePath;
 }
 
+void Archive::IndexFiles(const ArchiveIndex& index) {
+    mHashes->reserve(mHashes->size() + index.GetEntries().size());
+    for (const ArchiveIndex::Entry& entry : index.GetEntries()) {
+        const std::string_view filePath = index.GetName(entry);
+        // Indexed under the path of the file they describe, which the index does not have the hash of
+        if (filePath.ends_with(".meta")) {
+            IndexFile(std::string(filePath));
+            continue;
+        }
+        mHashes->insert_or_assign(entry.Hash, std::string(filePath));
+    }
+}
+
 std::shared_ptr<File> Archive::LoadFile(uint64_t hash) {
     const std::string& filePath =
         *Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToString(hash);
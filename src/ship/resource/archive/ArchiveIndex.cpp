@@ -0,0 +1,135 @@
+#include "ship/resource/archive/ArchiveIndex.h"
+#include <algorithm>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include "ship/utils/StrHash64.h"
+#include "ship/utils/binarytools/endianness.h"
+
+namespace Ship {
+
+static void WriteLE32(std::vector<char>& out, uint32_t value) {
+    value = LE32SWAP(value);
+    out.insert(out.end(), (const char*)&value, (const char*)&value + sizeof(value));
+}
+
+static void WriteLE64(std::vector<char>& out, uint64_t value) {
+    value = LE64SWAP(value);
+    out.insert(out.end(), (const char*)&value, (const char*)&value + sizeof(value));
+}
+
+static uint32_t ReadLE32(const char* data) {
+    uint32_t value;
+    memcpy(&value, data, sizeof(value));
+    return LE32SWAP(value);
+}
+
+static uint64_t ReadLE64(const char* data) {
+    uint64_t value;
+    memcpy(&value, data, sizeof(value));
+    return LE64SWAP(value);
+}
+
+uint64_t ArchiveIndex::HashListFile(std::string_view listFile) {
+    const Crc64Kernel& kernel = Crc64GetKernel();
+    uint64_t crc = INITIAL_CRC64;
+    while (!listFile.empty()) {
+        const size_t lineEnd = std::min(listFile.find('\n'), listFile.size());
+        std::string_view line = listFile.substr(0, lineEnd);
+        listFile.remove_prefix(std::min(lineEnd + 1, listFile.size()));
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        // The index is added to the list file after it is built
+        if (line.empty() || line == PATH) {
+            continue;
+        }
+        crc = kernel.Update(crc, line.data(), line.size());
+        crc = kernel.Update(crc, "\n", 1);
+    }
+    return ~crc;
+}
+
+std::vector<char> ArchiveIndex::Build(const std::vector<std::pair<std::string, uint64_t>>& files,
+                                      uint64_t fingerprint) {
+    std::vector<Entry> entries;
+    std::string names;
+    entries.reserve(files.size());
+    for (const auto& [name, index] : files) {
+        entries.push_back({ CRC64(name.c_str()), (uint32_t)names.size(), (uint32_t)name.size(), index });
+        names += name;
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.Hash != b.Hash ? a.Hash < b.Hash : a.Index < b.Index;
+    });
+
+    std::vector<char> data;
+    data.reserve(HEADER_SIZE + entries.size() * sizeof(Entry) + names.size());
+    WriteLE32(data, MAGIC);
+    WriteLE32(data, VERSION);
+    WriteLE64(data, fingerprint);
+    WriteLE32(data, (uint32_t)entries.size());
+    WriteLE32(data, (uint32_t)names.size());
+    for (const Entry& entry : entries) {
+        WriteLE64(data, entry.Hash);
+        WriteLE32(data, entry.NameOffset);
+        WriteLE32(data, entry.NameLength);
+        WriteLE64(data, entry.Index);
+    }
+    data.insert(data.end(), names.begin(), names.end());
+    return data;
+}
+
+bool ArchiveIndex::Parse(const char* data, size_t size) {
+    if (size < HEADER_SIZE || ReadLE32(data) != MAGIC || ReadLE32(data + 4) != VERSION) {
+        SPDLOG_WARN("Archive index has an unknown format");
+        return false;
+    }
+
+    const uint64_t fingerprint = ReadLE64(data + 8);
+    const size_t entryCount = ReadLE32(data + 16);
+    const size_t namesSize = ReadLE32(data + 20);
+    if ((size - HEADER_SIZE) / sizeof(Entry) < entryCount ||
+        size - HEADER_SIZE - entryCount * sizeof(Entry) != namesSize) {
+        SPDLOG_WARN("Archive index is {} bytes, which does not fit {} entries and {} bytes of names", size, entryCount,
+                    namesSize);
+        return false;
+    }
+
+    // One copy for all entries, they are only swapped on big endian hosts
+    std::vector<Entry> entries(entryCount);
+    memcpy(entries.data(), data + HEADER_SIZE, entryCount * sizeof(Entry));
+#ifdef IS_BIGENDIAN
+    for (Entry& entry : entries) {
+        entry.Hash = BSWAP64(entry.Hash);
+        entry.NameOffset = BSWAP32(entry.NameOffset);
+        entry.NameLength = BSWAP32(entry.NameLength);
+        entry.Index = BSWAP64(entry.Index);
+    }
+#endif
+
+    for (size_t i = 0; i < entryCount; i++) {
+        if ((i > 0 && entries[i].Hash < entries[i - 1].Hash) || entries[i].NameOffset > namesSize ||
+            entries[i].NameLength > namesSize - entries[i].NameOffset) {
+            SPDLOG_WARN("Archive index entry {} is out of order or out of bounds", i);
+            return false;
+        }
+    }
+
+    mFingerprint = fingerprint;
+    mEntries = std::move(entries);
+    mNames.assign(data + HEADER_SIZE + entryCount * sizeof(Entry), namesSize);
+    return true;
+}
+
+uint64_t ArchiveIndex::GetFingerprint() const {
+    return mFingerprint;
+}
+
+const std::vector<ArchiveIndex::Entry>& ArchiveIndex::GetEntries() const {
+    return mEntries;
+}
+
+std::string_view ArchiveIndex::GetName(const Entry& entry) const {
+    return std::string_view(mNames).substr(entry.NameOffset, entry.NameLength);
+}
+} // namespace Ship
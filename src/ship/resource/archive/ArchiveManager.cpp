@@ -48,12 +48,30 @@ std::shared_ptr<File> ArchiveManager::LoadFile(const std::string& filePath) {
 }
 
 std::shared_ptr<File> ArchiveManager::LoadFile(uint64_t hash) {
-    auto archive = mFileToArchive[hash];
-    if (archive == nullptr) {
+    // Looked up without inserting, resources load from many threads at once
+    auto it = mFileToArchive.find(hash);
+    if (it == mFileToArchive.end() || it->second == nullptr) {
         return nullptr;
     }
 
-    return archive->LoadFile(hash);
+    return it->second->LoadFile(hash);
+}
+
+std::shared_ptr<File> ArchiveManager::LoadFileInPlace(const std::string& filePath) {
+    if (filePath == "") {
+        return nullptr;
+    }
+
+    return LoadFileInPlace(CRC64(filePath.c_str()));
+}
+
+std::shared_ptr<File> ArchiveManager::LoadFileInPlace(uint64_t hash) {
+    auto it = mFileToArchive.find(hash);
+    if (it == mFileToArchive.end() || it->second == nullptr) {
+        return nullptr;
+    }
+
+    return it->second->LoadFileInPlace(hash);
 }
 
 bool ArchiveManager::HasFile(const std::string& filePath) {
@@ -65,7 +83,8 @@ bool ArchiveManager::HasFile(uint64_t hash) {
 }
 
 std::shared_ptr<Archive> ArchiveManager::GetArchiveFromFile(const std::string& filePath) {
-    return mFileToArchive[CRC64(filePath.c_str())];
+    auto it = mFileToArchive.find(CRC64(filePath.c_str()));
+    return it != mFileToArchive.end() ? it->second : nullptr;
 }
 
 std::shared_ptr<std::vector<std::string>> ArchiveManager::ListFiles(const std::string& searchMask) {
@@ -140,6 +159,7 @@ void ArchiveManager::ResetVirtualFileSystem() {
     // The re-add will trigger the file virtual file system to get populated.
     auto archives = mArchives;
     mArchives.clear();
+    mGeneration++;
     mGameVersions.clear();
     mHashes.clear();
     mFileToArchive.clear();
@@ -278,10 +298,13 @@ std::shared_ptr<Archive> ArchiveManager::AddArchive(std::shared_ptr<Archive> arc
     SPDLOG_INFO("Adding Archive {} to Archive Manager", archive->GetPath());
 
     mArchives.push_back(archive);
+    mGeneration++;
     if (archive->HasGameVersion()) {
         mGameVersions.push_back(archive->GetGameVersion());
     }
     const auto fileList = archive->ListFiles();
+    mHashes.reserve(mHashes.size() + fileList->size());
+    mFileToArchive.reserve(mFileToArchive.size() + fileList->size());
     for (auto& [hash, filename] : *fileList.get()) {
         mHashes[hash] = filename;
         mFileToArchive[hash] = archive;
@@ -295,6 +318,10 @@ std::shared_ptr<Archive> ArchiveManager::AddArchive(std::shared_ptr<Archive> arc
     return archive;
 }
 
+uint64_t ArchiveManager::GetGeneration() const {
+    return mGeneration;
+}
+
 bool ArchiveManager::IsGameVersionValid(uint32_t gameVersion) {
     return mValidGameVersions.empty() || mValidGameVersions.contains(gameVersion);
 }
@@ -1,6 +1,11 @@
 #include "ship/resource/archive/O2rArchive.h"
+#include "ship/resource/archive/ArchiveIndex.h"
+
+#include <algorithm>
+#include <thread>
 
 #include "ship/Context.h"
+#include "ship/utils/StrHash64.h"
 #include "ship/window/Window.h"
 #include "spdlog/spdlog.h"
 
@@ -14,26 +19,168 @@ O2rArchive::~O2rArchive() {
 }
 
 std::shared_ptr<File> O2rArchive::LoadFile(uint64_t hash) {
+    return LoadHashedFile(hash, false);
+}
+
+std::shared_ptr<File> O2rArchive::LoadFileInPlace(uint64_t hash) {
+    return LoadHashedFile(hash, true);
+}
+
+std::shared_ptr<File> O2rArchive::LoadHashedFile(uint64_t hash, bool inPlace) {
+    const std::shared_lock<std::shared_mutex> lock(mMutex);
+    if (mDirectory.IsOpen()) {
+        const ZipDirectory::Entry* entry = mDirectory.Find(hash);
+        if (entry == nullptr) {
+            SPDLOG_TRACE("Failed to find file with hash {:X} in zip archive {}.", hash, GetPath());
+            return nullptr;
+        }
+        return LoadEntry(*entry, inPlace);
+    }
+
     const std::string& filePath =
         *Context::GetInstance()->GetResourceManager()->GetArchiveManager()->HashToString(hash);
-    return LoadFile(filePath);
+    return LoadZipFile(filePath);
 }
 
 std::shared_ptr<File> O2rArchive::LoadFile(const std::string& filePath) {
-    if (mZipArchive == nullptr) {
+    const std::shared_lock<std::shared_mutex> lock(mMutex);
+    if (mDirectory.IsOpen()) {
+        const ZipDirectory::Entry* entry = mDirectory.Find(CRC64(filePath.c_str()));
+        if (entry == nullptr) {
+            SPDLOG_TRACE("Failed to find file {} in zip archive {}.", filePath, GetPath());
+            return nullptr;
+        }
+        return LoadEntry(*entry, false);
+    }
+
+    return LoadZipFile(filePath);
+}
+
+uint64_t O2rArchive::GetFileOffset(uint64_t hash) {
+    const std::shared_lock<std::shared_mutex> lock(mMutex);
+    const ZipDirectory::Entry* entry = mDirectory.IsOpen() ? mDirectory.Find(hash) : nullptr;
+    return entry != nullptr ? entry->LocalHeaderOffset : 0;
+}
+
+bool O2rArchive::IsIndexed() {
+    const std::shared_lock<std::shared_mutex> lock(mMutex);
+    return mDirectory.GetIndex() != nullptr;
+}
+
+std::shared_ptr<File> O2rArchive::LoadZipFile(const std::string& filePath) {
+    zip_t* zipArchive = AcquireReadHandle();
+    if (zipArchive == nullptr) {
         SPDLOG_TRACE("Failed to open file {} from zip archive {}. Archive not open.", filePath, GetPath());
         return nullptr;
     }
 
-    auto zipEntryIndex = zip_name_locate(mZipArchive, filePath.c_str(), 0);
+    std::shared_ptr<File> fileToLoad = nullptr;
+    auto zipEntryIndex = zip_name_locate(zipArchive, filePath.c_str(), 0);
     if (zipEntryIndex < 0) {
         SPDLOG_TRACE("Failed to find file {} in zip archive  {}.", filePath, GetPath());
+    } else {
+        fileToLoad = LoadZipEntry(zipArchive, zipEntryIndex, filePath);
+    }
+
+    ReleaseReadHandle(zipArchive);
+    return fileToLoad;
+}
+
+std::shared_ptr<File> O2rArchive::LoadEntry(const ZipDirectory::Entry& entry, bool inPlace) {
+    // Filesize 0, no logging needed
+    if (entry.Size == 0) {
+        return nullptr;
+    }
+
+    if (entry.Encrypted || (entry.Method != ZIP_CM_STORE && entry.Method != ZIP_CM_DEFLATE)) {
+        zip_t* zipArchive = AcquireReadHandle();
+        auto fileToLoad = LoadZipEntry(zipArchive, entry.Index, "#" + std::to_string(entry.Index));
+        ReleaseReadHandle(zipArchive);
+        return fileToLoad;
+    }
+
+    auto fileToLoad = std::make_shared<File>();
+    if (entry.Method == ZIP_CM_STORE) {
+        const char* data = mDirectory.GetEntryData(entry);
+        if (data == nullptr || entry.CompressedSize != entry.Size) {
+            SPDLOG_TRACE("Error reading entry {} in zip archive {}.", entry.Index, GetPath());
+            return nullptr;
+        }
+        if (inPlace) {
+            // The mapping stays alive as long as the file
+            fileToLoad->Data = data;
+            fileToLoad->Size = entry.Size;
+            fileToLoad->Mapping = mDirectory.GetMapping();
+        } else {
+            fileToLoad->Buffer = std::make_shared<std::vector<char>>(data, data + entry.Size);
+        }
+        if (!ZipDirectory::CheckCrc32(entry, fileToLoad->GetData())) {
+            SPDLOG_TRACE("Error reading entry {} in zip archive {}.", entry.Index, GetPath());
+            return nullptr;
+        }
+    } else {
+        fileToLoad->Buffer = std::make_shared<std::vector<char>>(entry.Size);
+        if (!mDirectory.Inflate(entry, fileToLoad->Buffer->data())) {
+            SPDLOG_TRACE("Error inflating entry {} in zip archive {}.", entry.Index, GetPath());
+            return nullptr;
+        }
+    }
+
+    fileToLoad->IsLoaded = true;
+
+    return fileToLoad;
+}
+
+zip_t* O2rArchive::AcquireReadHandle() {
+    {
+        const std::lock_guard<std::mutex> lock(mReadHandlesMutex);
+        if (!mIdleReadHandles.empty()) {
+            zip_t* zipArchive = mIdleReadHandles.back();
+            mIdleReadHandles.pop_back();
+            return zipArchive;
+        }
+    }
+
+    // An archive that does not exist on disk yet has nothing to read, try again once it is written
+    return zip_open(GetPath().c_str(), ZIP_RDONLY, nullptr);
+}
+
+void O2rArchive::ReleaseReadHandle(zip_t* zipArchive) {
+    if (zipArchive == nullptr) {
+        return;
+    }
+
+    // Only the threads loading at the same time need a handle each, anything beyond that is closed
+    static const size_t sMaxIdleReadHandles = std::max(1u, std::thread::hardware_concurrency());
+    {
+        const std::lock_guard<std::mutex> lock(mReadHandlesMutex);
+        if (mIdleReadHandles.size() < sMaxIdleReadHandles) {
+            mIdleReadHandles.push_back(zipArchive);
+            return;
+        }
+    }
+    zip_discard(zipArchive);
+}
+
+void O2rArchive::CloseReadHandles() {
+    // Loads hold mMutex shared, so with it held exclusively every handle is idle
+    const std::lock_guard<std::mutex> lock(mReadHandlesMutex);
+    for (zip_t* zipArchive : mIdleReadHandles) {
+        zip_discard(zipArchive);
+    }
+    mIdleReadHandles.clear();
+}
+
+std::shared_ptr<File> O2rArchive::LoadZipEntry(zip_t* zipArchive, zip_int64_t zipEntryIndex,
+                                               const std::string& filePath) {
+    if (zipArchive == nullptr) {
+        SPDLOG_TRACE("Failed to open file {} from zip archive {}. Archive not open.", filePath, GetPath());
         return nullptr;
     }
 
     struct zip_stat zipEntryStat;
     zip_stat_init(&zipEntryStat);
-    if (zip_stat_index(mZipArchive, zipEntryIndex, 0, &zipEntryStat) != 0) {
+    if (zip_stat_index(zipArchive, zipEntryIndex, 0, &zipEntryStat) != 0) {
         SPDLOG_TRACE("Failed to get entry information for file {} in zip archive  {}.", filePath, GetPath());
         return nullptr;
     }
@@ -44,7 +191,7 @@ std::shared_ptr<File> O2rArchive::LoadFile(const std::string& filePath) {
         return nullptr;
     }
 
-    struct zip_file* zipEntryFile = zip_fopen_index(mZipArchive, zipEntryIndex, 0);
+    struct zip_file* zipEntryFile = zip_fopen_index(zipArchive, zipEntryIndex, 0);
     if (!zipEntryFile) {
         SPDLOG_TRACE("Failed to open file {} in zip archive  {}.", filePath, GetPath());
         return nullptr;
@@ -67,6 +214,15 @@ std::shared_ptr<File> O2rArchive::LoadFile(const std::string& filePath) {
 }
 
 bool O2rArchive::Open() {
+    const std::unique_lock<std::shared_mutex> lock(mMutex);
+    // Archives that do not exist yet or that the reader does not support are read through libzip
+    mDirectory.Open(GetPath());
+    if (mDirectory.GetIndex() != nullptr) {
+        // Nothing has to be hashed, and libzip is only opened once something is written
+        IndexFiles(*mDirectory.GetIndex());
+        return true;
+    }
+
     mZipArchive = zip_open(GetPath().c_str(), ZIP_CREATE, nullptr);
     if (mZipArchive == nullptr) {
         SPDLOG_ERROR("Failed to load zip file \"{}\"", GetPath());
@@ -79,7 +235,7 @@ bool O2rArchive::Open() {
 
         // It is possible for directories to have entries in a zip
         // file, we don't want those indexed as files in the archive
-        if (zipEntryName[strlen(zipEntryName) - 1] == '/') {
+        if (zipEntryName[strlen(zipEntryName) - 1] == '/' || strcmp(zipEntryName, ArchiveIndex::PATH) == 0) {
             continue;
         }
 
@@ -90,6 +246,14 @@ bool O2rArchive::Open() {
 }
 
 bool O2rArchive::Close() {
+    const std::unique_lock<std::shared_mutex> lock(mMutex);
+    const bool wasMapped = mDirectory.IsOpen();
+    mDirectory.Close();
+    CloseReadHandles();
+    if (mZipArchive == nullptr && wasMapped) {
+        // Opened through its index and never written to
+        return true;
+    }
     if (mZipArchive == nullptr) {
         SPDLOG_ERROR("Cannot close zip file. Zip file not loaded. \"{}\"", GetPath());
         return false;
@@ -105,6 +269,17 @@ bool O2rArchive::Close() {
 }
 
 bool O2rArchive::WriteFile(const std::string& filePath, const std::vector<uint8_t>& data) {
+    const std::unique_lock<std::shared_mutex> lock(mMutex);
+#ifdef _WIN32
+    // Windows cannot replace a file that is still mapped, and files read in place keep the mapping alive
+    if (mDirectory.GetMapping() != nullptr && mDirectory.GetMapping().use_count() > 1) {
+        SPDLOG_ERROR("Cannot write to zip archive \"{}\" while files read in place from it are loaded", GetPath());
+        return false;
+    }
+#endif
+    if (!mZipArchive && mDirectory.IsOpen()) {
+        mZipArchive = zip_open(GetPath().c_str(), ZIP_CREATE, nullptr);
+    }
     if (!mZipArchive) {
         SPDLOG_ERROR("Cannot write to zip: Archive is not open.");
         return false;
@@ -124,12 +299,23 @@ bool O2rArchive::WriteFile(const std::string& filePath, const std::vector<uint8_
         return false;
     }
 
+    // The index only lists what was in the archive when it was built
+    const zip_int64_t indexEntry = zip_name_locate(mZipArchive, ArchiveIndex::PATH, 0);
+    if (filePath != ArchiveIndex::PATH && indexEntry >= 0 && zip_delete(mZipArchive, indexEntry) != 0) {
+        SPDLOG_WARN("Failed to remove the archive index from zip archive \"{}\"", GetPath());
+    }
+
+    // The archive is rewritten, it is mapped again once libzip has replaced it
+    mDirectory.Close();
+    CloseReadHandles();
+
     // Save changes to disk
     if (zip_close(mZipArchive) < 0) {
         zip_error_t* error = zip_get_error(mZipArchive);
         SPDLOG_ERROR("Failed to save changes to zip archive: {} ({})", zip_error_strerror(error),
                      zip_error_code_zip(error));
         zip_discard(mZipArchive); // Close zip and discard changes
+        mZipArchive = nullptr;
         return false;
     }
 
@@ -143,6 +329,7 @@ bool O2rArchive::WriteFile(const std::string& filePath, const std::vector<uint8_
     }
 
     IndexFile(filePath);
+    mDirectory.Open(GetPath());
 
     // Success
     return true;
@@ -1,6 +1,7 @@
 #ifdef INCLUDE_MPQ_SUPPORT
 
 #include "ship/resource/archive/OtrArchive.h"
+#include "ship/resource/archive/ArchiveIndex.h"
 
 #include "ship/Context.h"
 #include "ship/utils/filesystemtools/FileHelper.h"
@@ -81,14 +82,30 @@ bool OtrArchive::Open() {
     // This can also be done via the StormLib API, but this was copied from the LUS1.x implementation in GenerateCrcMap.
     auto listFile = LoadFile("(listfile)");
 
+    // An index written for this list file spares hashing every line of it
+    if (SFileHasFile(mHandle, ArchiveIndex::PATH)) {
+        auto indexFile = LoadFile(ArchiveIndex::PATH);
+        ArchiveIndex index;
+        if (indexFile != nullptr && index.Parse(indexFile->GetData(), indexFile->GetSize()) &&
+            index.GetFingerprint() ==
+                ArchiveIndex::HashListFile(std::string_view(listFile->GetData(), listFile->GetSize()))) {
+            IndexFiles(index);
+            return opened;
+        }
+        SPDLOG_WARN("Ignoring the stale file index of mpq file \"{}\"", GetPath());
+    }
+
     // Use std::string_view to avoid unnecessary string copies
     std::vector<std::string_view> lines =
-        StringHelper::Split(std::string_view(listFile->Buffer->data(), listFile->Buffer->size()), "\n");
+        StringHelper::Split(std::string_view(listFile->GetData(), listFile->GetSize()), "\n");
 
     for (size_t i = 0; i < lines.size(); i++) {
         // Use std::string_view to avoid unnecessary string copies
         std::string_view line = lines[i].substr(0, lines[i].length() - 1); // Trim \r
         std::string lineStr = std::string(line);
+        if (lineStr == ArchiveIndex::PATH) {
+            continue;
+        }
 
         IndexFile(lineStr);
     }
@@ -0,0 +1,387 @@
+#include "ship/resource/archive/ZipDirectory.h"
+
+#include <algorithm>
+#include <zlib.h>
+
+#include "ship/utils/StrHash64.h"
+#include "spdlog/spdlog.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Ship {
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (mData != nullptr) {
+        UnmapViewOfFile(mData);
+    }
+    if (mMappingHandle != nullptr) {
+        CloseHandle(mMappingHandle);
+    }
+    if (mFileHandle != nullptr) {
+        CloseHandle(mFileHandle);
+    }
+#else
+    if (mData != nullptr) {
+        munmap((void*)mData, mSize);
+    }
+#endif
+}
+
+std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path) {
+    std::shared_ptr<MappedFile> file(new MappedFile());
+#ifdef _WIN32
+    HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                                    OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    file->mFileHandle = fileHandle;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(fileHandle, &size) || size.QuadPart == 0) {
+        return nullptr;
+    }
+    file->mMappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (file->mMappingHandle == nullptr) {
+        return nullptr;
+    }
+    file->mData = (const char*)MapViewOfFile(file->mMappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (file->mData == nullptr) {
+        return nullptr;
+    }
+    file->mSize = (size_t)size.QuadPart;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    void* data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file referenced on its own
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    file->mData = (const char*)data;
+    file->mSize = (size_t)st.st_size;
+#endif
+    return file;
+}
+
+const char* MappedFile::GetData() const {
+    return mData;
+}
+
+size_t MappedFile::GetSize() const {
+    return mSize;
+}
+
+// Zip fields are little endian, whatever the host is
+static uint16_t ReadLE16(const char* p) {
+    const uint8_t* b = (const uint8_t*)p;
+    return (uint16_t)(b[0] | (b[1] << 8));
+}
+
+static uint32_t ReadLE32(const char* p) {
+    const uint8_t* b = (const uint8_t*)p;
+    return (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+static uint64_t ReadLE64(const char* p) {
+    return (uint64_t)ReadLE32(p) | ((uint64_t)ReadLE32(p + 4) << 32);
+}
+
+static constexpr uint32_t LOCAL_HEADER_SIGNATURE = 0x04034b50;
+static constexpr uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014b50;
+static constexpr uint32_t END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06054b50;
+static constexpr uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE = 0x06064b50;
+static constexpr uint32_t ZIP64_LOCATOR_SIGNATURE = 0x07064b50;
+static constexpr size_t LOCAL_HEADER_SIZE = 30;
+static constexpr size_t CENTRAL_HEADER_SIZE = 46;
+static constexpr size_t END_OF_CENTRAL_DIRECTORY_SIZE = 22;
+static constexpr size_t ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE = 56;
+static constexpr size_t ZIP64_LOCATOR_SIZE = 20;
+static constexpr uint16_t ZIP64_EXTRA_FIELD = 0x0001;
+static constexpr uint16_t METHOD_STORE = 0;
+static constexpr uint16_t METHOD_DEFLATE = 8;
+
+bool ZipDirectory::Open(const std::string& path) {
+    Close();
+    mMapping = MappedFile::Open(path);
+    if (mMapping == nullptr) {
+        SPDLOG_TRACE("Failed to map zip file {}", path);
+        return false;
+    }
+    if (!ReadCentralDirectory()) {
+        SPDLOG_WARN("Failed to read the central directory of zip file {}, it is read through libzip", path);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ZipDirectory::Close() {
+    mMapping = nullptr;
+    mIndex = nullptr;
+    mEntries.clear();
+}
+
+bool ZipDirectory::IsOpen() const {
+    return mMapping != nullptr;
+}
+
+bool ZipDirectory::ReadCentralDirectory() {
+    const char* data = mMapping->GetData();
+    const size_t size = mMapping->GetSize();
+    if (size < END_OF_CENTRAL_DIRECTORY_SIZE) {
+        return false;
+    }
+
+    // The end of central directory record is followed by a comment of up to 64 KiB
+    const char* eocd = nullptr;
+    const size_t lowest = size > END_OF_CENTRAL_DIRECTORY_SIZE + 0xffff ? size - END_OF_CENTRAL_DIRECTORY_SIZE - 0xffff
+                                                                         : 0;
+    for (size_t pos = size - END_OF_CENTRAL_DIRECTORY_SIZE + 1; pos-- > lowest;) {
+        if (ReadLE32(data + pos) == END_OF_CENTRAL_DIRECTORY_SIGNATURE &&
+            pos + END_OF_CENTRAL_DIRECTORY_SIZE + ReadLE16(data + pos + 20) == size) {
+            eocd = data + pos;
+            break;
+        }
+    }
+    if (eocd == nullptr || ReadLE16(eocd + 4) != 0 || ReadLE16(eocd + 6) != 0) {
+        // Not a zip file, or one split across disks
+        return false;
+    }
+
+    uint64_t count = ReadLE16(eocd + 10);
+    uint64_t directorySize = ReadLE32(eocd + 12);
+    uint64_t directoryOffset = ReadLE32(eocd + 16);
+    if (count == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff) {
+        const size_t eocdPos = eocd - data;
+        if (eocdPos < ZIP64_LOCATOR_SIZE || ReadLE32(eocd - ZIP64_LOCATOR_SIZE) != ZIP64_LOCATOR_SIGNATURE) {
+            return false;
+        }
+        const uint64_t zip64Pos = ReadLE64(eocd - ZIP64_LOCATOR_SIZE + 8);
+        if (size < ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE || zip64Pos > size - ZIP64_END_OF_CENTRAL_DIRECTORY_SIZE ||
+            ReadLE32(data + zip64Pos) != ZIP64_END_OF_CENTRAL_DIRECTORY_SIGNATURE) {
+            return false;
+        }
+        count = ReadLE64(data + zip64Pos + 32);
+        directorySize = ReadLE64(data + zip64Pos + 40);
+        directoryOffset = ReadLE64(data + zip64Pos + 48);
+    }
+    if (directoryOffset > size || directorySize > size - directoryOffset) {
+        return false;
+    }
+
+    // Hashed once every entry is read, the archive may carry the hashes itself
+    std::vector<Entry> records;
+    std::vector<std::string_view> names;
+    records.reserve(std::min<uint64_t>(count, directorySize / CENTRAL_HEADER_SIZE));
+    names.reserve(records.capacity());
+    size_t fileCount = 0;
+    const char* pos = data + directoryOffset;
+    const char* end = pos + directorySize;
+    for (uint64_t i = 0; i < count; i++) {
+        if ((size_t)(end - pos) < CENTRAL_HEADER_SIZE || ReadLE32(pos) != CENTRAL_HEADER_SIGNATURE) {
+            return false;
+        }
+        const size_t nameLength = ReadLE16(pos + 28);
+        const size_t extraLength = ReadLE16(pos + 30);
+        const size_t commentLength = ReadLE16(pos + 32);
+        const char* name = pos + CENTRAL_HEADER_SIZE;
+        const char* extra = name + nameLength;
+        const char* next = extra + extraLength + commentLength;
+        if (next > end) {
+            return false;
+        }
+
+        Entry entry;
+        entry.Index = i;
+        entry.Encrypted = (ReadLE16(pos + 8) & 1) != 0;
+        entry.Method = ReadLE16(pos + 10);
+        entry.Crc32 = ReadLE32(pos + 16);
+        entry.CompressedSize = ReadLE32(pos + 20);
+        entry.Size = ReadLE32(pos + 24);
+        entry.LocalHeaderOffset = ReadLE32(pos + 42);
+
+        // Sizes and offsets that do not fit in 32 bits are in the zip64 extra field, in this order
+        for (const char* field = extra; field + 4 <= extra + extraLength;) {
+            const uint16_t id = ReadLE16(field);
+            const uint16_t length = ReadLE16(field + 2);
+            const char* value = field + 4;
+            const char* valueEnd = value + length;
+            if (valueEnd > extra + extraLength) {
+                break;
+            }
+            if (id == ZIP64_EXTRA_FIELD) {
+                if (entry.Size == 0xffffffff && value + 8 <= valueEnd) {
+                    entry.Size = ReadLE64(value);
+                    value += 8;
+                }
+                if (entry.CompressedSize == 0xffffffff && value + 8 <= valueEnd) {
+                    entry.CompressedSize = ReadLE64(value);
+                    value += 8;
+                }
+                if (entry.LocalHeaderOffset == 0xffffffff && value + 8 <= valueEnd) {
+                    entry.LocalHeaderOffset = ReadLE64(value);
+                }
+                break;
+            }
+            field = valueEnd;
+        }
+
+        records.push_back(entry);
+        names.emplace_back(name, nameLength);
+        // Directories are not files
+        if (nameLength > 0 && name[nameLength - 1] != '/') {
+            fileCount++;
+        }
+        pos = next;
+    }
+
+    if (ReadIndex(records, names, fileCount)) {
+        return true;
+    }
+    mEntries.reserve(fileCount);
+    for (size_t i = 0; i < records.size(); i++) {
+        // CRC64 of a name is crc64 of its bytes without the final inversion
+        if (!names[i].empty() && names[i].back() != '/') {
+            mEntries[~crc64(names[i].data(), (uint32_t)names[i].size())] = records[i];
+        }
+    }
+
+    return true;
+}
+
+bool ZipDirectory::ReadIndex(const std::vector<Entry>& records, const std::vector<std::string_view>& names,
+                             size_t fileCount) {
+    // Written last, so it is usually found first from the back
+    size_t indexRecord = records.size();
+    for (size_t i = records.size(); i-- > 0;) {
+        if (names[i] == ArchiveIndex::PATH) {
+            indexRecord = i;
+            break;
+        }
+    }
+    if (indexRecord == records.size()) {
+        return false;
+    }
+
+    const Entry& record = records[indexRecord];
+    std::vector<char> inflated;
+    const char* data = nullptr;
+    if (!record.Encrypted && record.Method == METHOD_STORE) {
+        data = GetEntryData(record);
+        data = data != nullptr && CheckCrc32(record, data) ? data : nullptr;
+    } else if (!record.Encrypted && record.Method == METHOD_DEFLATE) {
+        inflated.resize(record.Size);
+        data = Inflate(record, inflated.data()) ? inflated.data() : nullptr;
+    }
+    auto index = std::make_shared<ArchiveIndex>();
+    if (data == nullptr || !index->Parse(data, record.Size)) {
+        return false;
+    }
+
+    // Anything added, removed or renamed since the index was built makes it stale. Comparing names is much cheaper
+    // than hashing them.
+    if (index->GetFingerprint() != records.size() || index->GetEntries().size() + 1 != fileCount) {
+        SPDLOG_WARN("Ignoring a stale archive index, the zip file has {} entries and the index was built for {}",
+                    records.size(), index->GetFingerprint());
+        return false;
+    }
+    for (const ArchiveIndex::Entry& entry : index->GetEntries()) {
+        if (entry.Index >= records.size() || names[entry.Index] != index->GetName(entry)) {
+            SPDLOG_WARN("Ignoring a stale archive index, it does not match zip entry {}", entry.Index);
+            return false;
+        }
+    }
+
+    mEntries.reserve(fileCount);
+    for (const ArchiveIndex::Entry& entry : index->GetEntries()) {
+        mEntries[entry.Hash] = records[entry.Index];
+    }
+    mEntries[CRC64(ArchiveIndex::PATH)] = record;
+    mIndex = index;
+    return true;
+}
+
+const std::shared_ptr<ArchiveIndex>& ZipDirectory::GetIndex() const {
+    return mIndex;
+}
+
+const ZipDirectory::Entry* ZipDirectory::Find(uint64_t hash) const {
+    auto it = mEntries.find(hash);
+    return it != mEntries.end() ? &it->second : nullptr;
+}
+
+size_t ZipDirectory::GetEntryCount() const {
+    return mEntries.size();
+}
+
+const char* ZipDirectory::GetEntryData(const Entry& entry) const {
+    const char* data = mMapping->GetData();
+    const size_t size = mMapping->GetSize();
+    if (size < LOCAL_HEADER_SIZE || entry.LocalHeaderOffset > size - LOCAL_HEADER_SIZE ||
+        ReadLE32(data + entry.LocalHeaderOffset) != LOCAL_HEADER_SIGNATURE) {
+        return nullptr;
+    }
+
+    // The name and extra field of the local header may differ from the ones in the central directory
+    const uint64_t offset = entry.LocalHeaderOffset + LOCAL_HEADER_SIZE +
+                            ReadLE16(data + entry.LocalHeaderOffset + 26) +
+                            ReadLE16(data + entry.LocalHeaderOffset + 28);
+    if (offset > size || entry.CompressedSize > size - offset) {
+        return nullptr;
+    }
+    return data + offset;
+}
+
+bool ZipDirectory::Inflate(const Entry& entry, char* dest) const {
+    const char* src = GetEntryData(entry);
+    if (src == nullptr || entry.CompressedSize > UINT32_MAX || entry.Size > UINT32_MAX) {
+        return false;
+    }
+
+    z_stream stream = {};
+    // Negative window bits read a raw deflate stream, without the zlib header
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    stream.next_in = (Bytef*)src;
+    stream.avail_in = (uInt)entry.CompressedSize;
+    stream.next_out = (Bytef*)dest;
+    stream.avail_out = (uInt)entry.Size;
+    const int result = inflate(&stream, Z_FINISH);
+    const bool complete = result == Z_STREAM_END && stream.total_out == entry.Size;
+    inflateEnd(&stream);
+    return complete && CheckCrc32(entry, dest);
+}
+
+bool ZipDirectory::CheckCrc32(const Entry& entry, const char* data) {
+    // zlib takes at most 4 GiB at a time
+    uLong crc = crc32(0, Z_NULL, 0);
+    for (uint64_t done = 0; done < entry.Size;) {
+        const uInt length = (uInt)std::min<uint64_t>(entry.Size - done, UINT32_MAX);
+        crc = crc32(crc, (const Bytef*)data + done, length);
+        done += length;
+    }
+    return (uint32_t)crc == entry.Crc32;
+}
+
+const std::shared_ptr<MappedFile>& ZipDirectory::GetMapping() const {
+    return mMapping;
+}
+} // namespace Ship
@@ -11,4 +11,8 @@ void* Blob::GetPointer() {
 size_t Blob::GetPointerSize() {
     return Data.size() * sizeof(uint8_t);
 }
+
+size_t Blob::GetMemorySize() {
+    return sizeof(Blob) + Data.capacity() * sizeof(uint8_t);
+}
 } // namespace Ship
@@ -11,4 +11,9 @@ void* Json::GetPointer() {
 size_t Json::GetPointerSize() {
     return DataSize * sizeof(char);
 }
+
+size_t Json::GetMemorySize() {
+    // The parsed document is not measured, the text it was parsed from stands in for it
+    return sizeof(Json) + DataSize * sizeof(char);
+}
 } // namespace Ship
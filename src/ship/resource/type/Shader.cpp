@@ -11,4 +11,8 @@ void* Shader::GetPointer() {
 size_t Shader::GetPointerSize() {
     return Data.size();
 }
+
+size_t Shader::GetMemorySize() {
+    return sizeof(Shader) + Data.capacity();
+}
 } // namespace Ship
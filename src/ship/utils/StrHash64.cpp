@@ -82,7 +82,28 @@
  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "ship/utils/StrHash64.h"
+
 #include <stdint.h>
+#include <string.h>
+#include <array>
+
+#include "ship/utils/binarytools/endianness.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC64_CLMUL
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC64_TARGET_CLMUL
+#else
+#define CRC64_TARGET_CLMUL __attribute__((target("pclmul,ssse3")))
+#endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+// PMULL is part of the crypto extension, only used when the compiler may assume it
+#define CRC64_PMULL
+#include <arm_neon.h>
+#endif
 
 #define u8 uint8_t
 #define u16 uint16_t
@@ -160,13 +181,212 @@ static const u64 CRC64_Table[256] = {
     CONST64(0x5dedc41a34bbeeb2), CONST64(0x1f1d25f19d51d821), CONST64(0xd80c07cd676f8394), CONST64(0x9afce626ce85b507)
 };
 
-uint64_t update_crc64(const void* buf, unint len, u64 crc) {
+#define CRC64_POLY CONST64(0x42f0e1eba9ea3693)
+
+// x^n mod P, the polynomial with bit i as the coefficient of x^i
+static constexpr u64 XPowMod(unint n) {
+    u64 r = 1;
+    for (unint i = 0; i < n; i++) {
+        r = (r << 1) ^ ((r >> 63) != 0 ? CRC64_POLY : 0);
+    }
+    return r;
+}
+
+// Slice k holds b * x^(64 + 8k) mod P, slice 0 is CRC64_Table
+static constexpr std::array<std::array<u64, 256>, 8> MakeSlices() {
+    std::array<std::array<u64, 256>, 8> slices = {};
+    for (unint b = 0; b < 256; b++) {
+        u64 crc = (u64)b << 56;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc << 1) ^ ((crc >> 63) != 0 ? CRC64_POLY : 0);
+        }
+        slices[0][b] = crc;
+    }
+    for (int k = 1; k < 8; k++) {
+        for (unint b = 0; b < 256; b++) {
+            slices[k][b] = (slices[k - 1][b] << 8) ^ slices[0][slices[k - 1][b] >> 56];
+        }
+    }
+    return slices;
+}
+
+static constexpr std::array<std::array<u64, 256>, 8> CRC64_Slices = MakeSlices();
+
+static u64 Crc64UpdateTable(u64 crc, const void* buf, size_t len) {
+    const u8* b = (const u8*)buf;
+    for (size_t i = 0; i < len; i++) {
+        crc = CRC64_Table[(u8)(crc >> 56) ^ b[i]] ^ (crc << 8);
+    }
+    return crc;
+}
+
+// v * x^64 mod P, the state after eight bytes that were xored into the state v
+static inline u64 Crc64Step(u64 v) {
+    return CRC64_Slices[7][v >> 56] ^ CRC64_Slices[6][(u8)(v >> 48)] ^ CRC64_Slices[5][(u8)(v >> 40)] ^
+           CRC64_Slices[4][(u8)(v >> 32)] ^ CRC64_Slices[3][(u8)(v >> 24)] ^ CRC64_Slices[2][(u8)(v >> 16)] ^
+           CRC64_Slices[1][(u8)(v >> 8)] ^ CRC64_Slices[0][(u8)v];
+}
+
+static u64 Crc64UpdateSlice8(u64 crc, const void* buf, size_t len) {
+    const u8* b = (const u8*)buf;
+    for (; len >= 8; b += 8, len -= 8) {
+        u64 word;
+        memcpy(&word, b, sizeof(word));
+        crc = Crc64Step(crc ^ BE64SWAP(word));
+    }
+    return Crc64UpdateTable(crc, b, len);
+}
+
+// The carry-less multiply kernels fold 16 byte blocks, read as 128 bit polynomials with the first byte highest, into
+// four running blocks 64 bytes ahead, then into one: H * x^64 + L moves d bits ahead as
+// H * (x^(d + 64) mod P) + L * (x^d mod P). The last block is reduced with two slice by 8 steps. Below two blocks
+// slice by 8 alone is as quick.
+#define CRC64_FOLD_MIN_LENGTH 32
+
+// Fold constants for 16 and 64 bytes ahead, for the high and the low half of a block
+static constexpr u64 CRC64_Fold128[2] = { XPowMod(192), XPowMod(128) };
+static constexpr u64 CRC64_Fold512[2] = { XPowMod(576), XPowMod(512) };
+
+#ifdef CRC64_CLMUL
+CRC64_TARGET_CLMUL static inline __m128i Crc64LoadBlock(const u8* b) {
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)b),
+                            _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+CRC64_TARGET_CLMUL static inline __m128i Crc64Fold(__m128i x, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00));
+}
+
+CRC64_TARGET_CLMUL static u64 Crc64UpdateClmul(u64 crc, const void* buf, size_t len) {
+    if (len < CRC64_FOLD_MIN_LENGTH) {
+        return Crc64UpdateSlice8(crc, buf, len);
+    }
+
     const u8* b = (const u8*)buf;
-    unint i;
-    for (i = 0; i < len; i++) {
-        crc = CRC64_Table[(u8)(crc >> 56) ^ *b++] ^ (crc << 8);
+    const __m128i k128 = _mm_set_epi64x((long long)CRC64_Fold128[0], (long long)CRC64_Fold128[1]);
+    __m128i x = _mm_xor_si128(Crc64LoadBlock(b), _mm_set_epi64x((long long)crc, 0));
+    b += 16;
+    len -= 16;
+    if (len >= 48) {
+        const __m128i k512 = _mm_set_epi64x((long long)CRC64_Fold512[0], (long long)CRC64_Fold512[1]);
+        __m128i x1 = Crc64LoadBlock(b);
+        __m128i x2 = Crc64LoadBlock(b + 16);
+        __m128i x3 = Crc64LoadBlock(b + 32);
+        for (b += 48, len -= 48; len >= 64; b += 64, len -= 64) {
+            x = _mm_xor_si128(Crc64Fold(x, k512), Crc64LoadBlock(b));
+            x1 = _mm_xor_si128(Crc64Fold(x1, k512), Crc64LoadBlock(b + 16));
+            x2 = _mm_xor_si128(Crc64Fold(x2, k512), Crc64LoadBlock(b + 32));
+            x3 = _mm_xor_si128(Crc64Fold(x3, k512), Crc64LoadBlock(b + 48));
+        }
+        x = _mm_xor_si128(Crc64Fold(x, k128), x1);
+        x = _mm_xor_si128(Crc64Fold(x, k128), x2);
+        x = _mm_xor_si128(Crc64Fold(x, k128), x3);
     }
-    return ~crc;
+    for (; len >= 16; b += 16, len -= 16) {
+        x = _mm_xor_si128(Crc64Fold(x, k128), Crc64LoadBlock(b));
+    }
+
+    const u64 hi = (u64)_mm_cvtsi128_si64(_mm_srli_si128(x, 8));
+    const u64 lo = (u64)_mm_cvtsi128_si64(x);
+    return Crc64UpdateSlice8(Crc64Step(Crc64Step(hi) ^ lo), b, len);
+}
+
+static bool CpuSupportsClmul() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    // PCLMULQDQ and SSSE3
+    return (info[2] & (1 << 1)) != 0 && (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+#endif
+}
+#endif
+
+#ifdef CRC64_PMULL
+static inline uint64x2_t Crc64LoadBlock(const u8* b) {
+    // Both halves read big endian, then swapped so the first one is the high lane
+    const uint64x2_t halves = vreinterpretq_u64_u8(vrev64q_u8(vld1q_u8(b)));
+    return vextq_u64(halves, halves, 1);
+}
+
+static inline uint64x2_t Crc64Fold(uint64x2_t x, poly64x2_t k) {
+    const poly64x2_t px = vreinterpretq_p64_u64(x);
+    const uint64x2_t lo = vreinterpretq_u64_p128(vmull_p64(vgetq_lane_p64(px, 0), vgetq_lane_p64(k, 0)));
+    const uint64x2_t hi = vreinterpretq_u64_p128(vmull_high_p64(px, k));
+    return veorq_u64(lo, hi);
+}
+
+static inline poly64x2_t Crc64FoldConstant(const u64 k[2]) {
+    return vreinterpretq_p64_u64(vcombine_u64(vcreate_u64(k[1]), vcreate_u64(k[0])));
+}
+
+static u64 Crc64UpdatePmull(u64 crc, const void* buf, size_t len) {
+    if (len < CRC64_FOLD_MIN_LENGTH) {
+        return Crc64UpdateSlice8(crc, buf, len);
+    }
+
+    const u8* b = (const u8*)buf;
+    const poly64x2_t k128 = Crc64FoldConstant(CRC64_Fold128);
+    uint64x2_t x = veorq_u64(Crc64LoadBlock(b), vcombine_u64(vcreate_u64(0), vcreate_u64(crc)));
+    b += 16;
+    len -= 16;
+    if (len >= 48) {
+        const poly64x2_t k512 = Crc64FoldConstant(CRC64_Fold512);
+        uint64x2_t x1 = Crc64LoadBlock(b);
+        uint64x2_t x2 = Crc64LoadBlock(b + 16);
+        uint64x2_t x3 = Crc64LoadBlock(b + 32);
+        for (b += 48, len -= 48; len >= 64; b += 64, len -= 64) {
+            x = veorq_u64(Crc64Fold(x, k512), Crc64LoadBlock(b));
+            x1 = veorq_u64(Crc64Fold(x1, k512), Crc64LoadBlock(b + 16));
+            x2 = veorq_u64(Crc64Fold(x2, k512), Crc64LoadBlock(b + 32));
+            x3 = veorq_u64(Crc64Fold(x3, k512), Crc64LoadBlock(b + 48));
+        }
+        x = veorq_u64(Crc64Fold(x, k128), x1);
+        x = veorq_u64(Crc64Fold(x, k128), x2);
+        x = veorq_u64(Crc64Fold(x, k128), x3);
+    }
+    for (; len >= 16; b += 16, len -= 16) {
+        x = veorq_u64(Crc64Fold(x, k128), Crc64LoadBlock(b));
+    }
+
+    return Crc64UpdateSlice8(Crc64Step(Crc64Step(vgetq_lane_u64(x, 1)) ^ vgetq_lane_u64(x, 0)), b, len);
+}
+#endif
+
+static const Crc64Kernel sTableKernel = { "table", Crc64UpdateTable };
+static const Crc64Kernel sSlice8Kernel = { "slice8", Crc64UpdateSlice8 };
+#ifdef CRC64_CLMUL
+static const Crc64Kernel sClmulKernel = { "pclmul", Crc64UpdateClmul };
+#endif
+#ifdef CRC64_PMULL
+static const Crc64Kernel sPmullKernel = { "pmull", Crc64UpdatePmull };
+#endif
+
+const Crc64Kernel& Crc64TableKernel() {
+    return sTableKernel;
+}
+
+std::vector<const Crc64Kernel*> Crc64AvailableKernels() {
+    std::vector<const Crc64Kernel*> kernels = { &sTableKernel, &sSlice8Kernel };
+#ifdef CRC64_CLMUL
+    if (CpuSupportsClmul()) {
+        kernels.push_back(&sClmulKernel);
+    }
+#endif
+#ifdef CRC64_PMULL
+    kernels.push_back(&sPmullKernel);
+#endif
+    return kernels;
+}
+
+const Crc64Kernel& Crc64GetKernel() {
+    static const Crc64Kernel& kernel = *Crc64AvailableKernels().back();
+    return kernel;
+}
+
+uint64_t update_crc64(const void* buf, unint len, u64 crc) {
+    return ~Crc64GetKernel().Update(crc, buf, len);
 }
 
 u64 crc64(const void* buf, unint len) {
@@ -174,10 +394,5 @@ u64 crc64(const void* buf, unint len) {
 }
 
 u64 CRC64(const char* t) {
-    u64 crc = INITIAL_CRC64;
-    const u8* s = (const u8*)t;
-    while (*s) {
-        crc = CRC64_Table[(u8)(crc >> 56) ^ *s++] ^ (crc << 8);
-    }
-    return crc;
-}
\ No newline at end of file
+    return Crc64GetKernel().Update(INITIAL_CRC64, t, strlen(t));
+}
@@ -35,6 +35,10 @@ uint32_t Ship::BinaryReader::GetBaseAddress() {
     return mStream->GetBaseAddress();
 }
 
+uint64_t Ship::BinaryReader::GetLength() {
+    return mStream->GetLength();
+}
+
 void Ship::BinaryReader::Read(int32_t length) {
     mStream->Read(length);
 }
@@ -0,0 +1,100 @@
+#include "ship/utils/binarytools/ByteSwap.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ship/utils/binarytools/endianness.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BYTESWAP_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define BYTESWAP_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Ship {
+// The values are copied in and out so that any type can be swapped through a void pointer
+template <typename T, T (*Swap)(T)> static void ByteSwapScalar(char* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        T value;
+        memcpy(&value, data + i * sizeof(T), sizeof(T));
+        value = Swap(value);
+        memcpy(data + i * sizeof(T), &value, sizeof(T));
+    }
+}
+
+static uint16_t Swap16(uint16_t value) {
+    return BSWAP16(value);
+}
+
+static uint32_t Swap32(uint32_t value) {
+    return BSWAP32(value);
+}
+
+static uint64_t Swap64(uint64_t value) {
+    return BSWAP64(value);
+}
+
+#ifdef BYTESWAP_SSE2
+// SSE2 has no byte shuffle, the bytes of every 16 bit lane are swapped with shifts
+static __m128i SwapLanes16(__m128i v) {
+    return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+#endif
+
+void ByteSwapArray16(void* data, size_t count) {
+    char* bytes = (char*)data;
+    size_t i = 0;
+#ifdef BYTESWAP_SSE2
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(bytes + i * 2));
+        _mm_storeu_si128((__m128i*)(bytes + i * 2), SwapLanes16(v));
+    }
+#elif defined(BYTESWAP_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(bytes + i * 2));
+        vst1q_u8((uint8_t*)(bytes + i * 2), vrev16q_u8(v));
+    }
+#endif
+    ByteSwapScalar<uint16_t, Swap16>(bytes + i * 2, count - i);
+}
+
+void ByteSwapArray32(void* data, size_t count) {
+    char* bytes = (char*)data;
+    size_t i = 0;
+#ifdef BYTESWAP_SSE2
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(bytes + i * 4));
+        // Swap the 16 bit halves of every value, then the bytes of every half
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xb1), 0xb1);
+        _mm_storeu_si128((__m128i*)(bytes + i * 4), SwapLanes16(v));
+    }
+#elif defined(BYTESWAP_NEON)
+    for (; i + 4 <= count; i += 4) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(bytes + i * 4));
+        vst1q_u8((uint8_t*)(bytes + i * 4), vrev32q_u8(v));
+    }
+#endif
+    ByteSwapScalar<uint32_t, Swap32>(bytes + i * 4, count - i);
+}
+
+void ByteSwapArray64(void* data, size_t count) {
+    char* bytes = (char*)data;
+    size_t i = 0;
+#ifdef BYTESWAP_SSE2
+    for (; i + 2 <= count; i += 2) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(bytes + i * 8));
+        // Reverse the 16 bit quarters of every value, then the bytes of every quarter
+        v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0x1b), 0x1b);
+        _mm_storeu_si128((__m128i*)(bytes + i * 8), SwapLanes16(v));
+    }
+#elif defined(BYTESWAP_NEON)
+    for (; i + 2 <= count; i += 2) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(bytes + i * 8));
+        vst1q_u8((uint8_t*)(bytes + i * 8), vrev64q_u8(v));
+    }
+#endif
+    ByteSwapScalar<uint64_t, Swap64>(bytes + i * 8, count - i);
+}
+} // namespace Ship
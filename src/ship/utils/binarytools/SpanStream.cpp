@@ -0,0 +1,64 @@
+#include "ship/utils/binarytools/SpanStream.h"
+#include <cstring>
+#include <stdexcept>
+
+Ship::SpanStream::SpanStream(const char* data, size_t size, std::shared_ptr<const void> owner)
+    : mData(data), mSize(size), mOwner(owner) {
+    mBaseAddress = 0;
+}
+
+uint64_t Ship::SpanStream::GetLength() {
+    return mSize;
+}
+
+void Ship::SpanStream::Seek(int32_t offset, SeekOffsetType seekType) {
+    if (seekType == SeekOffsetType::Start) {
+        mBaseAddress = offset;
+    } else if (seekType == SeekOffsetType::Current) {
+        mBaseAddress += offset;
+    } else if (seekType == SeekOffsetType::End) {
+        mBaseAddress = mSize - 1 - offset;
+    }
+}
+
+std::unique_ptr<char[]> Ship::SpanStream::Read(size_t length) {
+    std::unique_ptr<char[]> result = std::make_unique<char[]>(length);
+    Read(result.get(), length);
+    return result;
+}
+
+void Ship::SpanStream::Read(const char* dest, size_t length) {
+    // One check for the whole read instead of one per byte
+    if (mBaseAddress > mSize || length > mSize - mBaseAddress) {
+        throw std::out_of_range("SpanStream::Read(): Read past the end of the stream");
+    }
+
+    memcpy((void*)dest, mData + mBaseAddress, length);
+    mBaseAddress += length;
+}
+
+int8_t Ship::SpanStream::ReadByte() {
+    if (mBaseAddress >= mSize) {
+        throw std::out_of_range("SpanStream::ReadByte(): Read past the end of the stream");
+    }
+
+    return mData[mBaseAddress++];
+}
+
+void Ship::SpanStream::Write(char* srcBuffer, size_t length) {
+    throw std::runtime_error("SpanStream::Write(): Stream is read only");
+}
+
+void Ship::SpanStream::WriteByte(int8_t value) {
+    throw std::runtime_error("SpanStream::WriteByte(): Stream is read only");
+}
+
+std::vector<char> Ship::SpanStream::ToVector() {
+    return std::vector<char>(mData, mData + mSize);
+}
+
+void Ship::SpanStream::Flush() {
+}
+
+void Ship::SpanStream::Close() {
+}
@@ -1,6 +1,8 @@
 #include "ship/window/gui/StatsWindow.h"
 #include <imgui.h>
 #include "spdlog/spdlog.h"
+#include "ship/Context.h"
+#include "ship/resource/ResourceManager.h"
 
 namespace Ship {
 StatsWindow::~StatsWindow() {
@@ -27,6 +29,19 @@ void StatsWindow::DrawElement() {
     ImGui::Text("Platform: Unknown");
 #endif
     ImGui::Text("Status: %.3f ms/frame (%.1f FPS)", deltatime * 1000.0f, framerate);
+
+    auto resourceManager = Context::GetInstance()->GetResourceManager();
+    if (resourceManager != nullptr) {
+        const ResourceCacheStats stats = resourceManager->GetCacheStats();
+        if (stats.Budget != 0) {
+            ImGui::Text("Resource cache: %zu resources, %.1f of %.1f MB", stats.Lines, stats.Bytes / 1048576.0,
+                        stats.Budget / 1048576.0);
+        } else {
+            ImGui::Text("Resource cache: %zu resources, %.1f MB", stats.Lines, stats.Bytes / 1048576.0);
+        }
+        ImGui::Text("Evicted: %llu resources, %.1f MB, %llu reloaded", (unsigned long long)stats.Evictions,
+                    stats.EvictedBytes / 1048576.0, (unsigned long long)stats.Reloads);
+    }
     ImGui::PopStyleColor();
 }
 
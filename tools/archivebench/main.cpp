@@ -0,0 +1,216 @@
+// Checks O2rArchive against libzip on a generated archive and times both ways of reading it.
+//
+// Usage: archivebench [--entries N] [--rounds N] [--threads N] [--path FILE]
+//
+// Writes an archive of N entries, stored, deflated, and compressed with a method only libzip reads when this libzip
+// supports one. Every entry is loaded through O2rArchive and through zip_name_locate/zip_fopen_index/zip_fread, then
+// from --threads threads at once, each going through all of them in its own order. It fails when any bytes differ.
+// Both ways are timed over the given number of rounds, and the loads through O2rArchive are timed again split between
+// 1, 2, 4 and so on up to --threads threads.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zip.h"
+
+#include "common/ZipFixture.h"
+#include "ship/resource/archive/O2rArchive.h"
+
+static std::vector<char> EntryContents(size_t index, std::mt19937& rng) {
+    // Resource sized, and repetitive enough for deflate to be worth it
+    std::vector<char> contents(256 + rng() % 16384);
+    for (size_t i = 0; i < contents.size(); i++) {
+        contents[i] = (char)((i % 64) < 48 ? index + i / 64 : rng());
+    }
+    return contents;
+}
+
+static std::string EntryName(size_t index) {
+    return "objects/bench/entry_" + std::to_string(index);
+}
+
+// A compression method O2rArchive leaves to its per thread libzip handles, ZIP_CM_DEFLATE when there is none
+static zip_int32_t LibzipOnlyMethod() {
+    for (zip_int32_t method : { ZIP_CM_BZIP2, ZIP_CM_XZ, ZIP_CM_ZSTD }) {
+        if (zip_compression_method_supported(method, 1) && zip_compression_method_supported(method, 0)) {
+            return method;
+        }
+    }
+    return ZIP_CM_DEFLATE;
+}
+
+static bool ReadWithLibzip(zip_t* archive, const std::string& name, std::vector<char>& out) {
+    zip_int64_t index = zip_name_locate(archive, name.c_str(), 0);
+    struct zip_stat stat;
+    zip_stat_init(&stat);
+    if (index < 0 || zip_stat_index(archive, index, 0, &stat) != 0) {
+        return false;
+    }
+    zip_file_t* file = zip_fopen_index(archive, index, 0);
+    if (file == nullptr) {
+        return false;
+    }
+    out.resize(stat.size);
+    bool read = zip_fread(file, out.data(), stat.size) == (zip_int64_t)stat.size;
+    zip_fclose(file);
+    return read;
+}
+
+// Loads every entry from each thread at once, every thread starting at a different entry
+static bool StressThreads(Ship::O2rArchive& archive, const std::vector<std::vector<char>>& entries,
+                          unsigned int threadCount) {
+    std::vector<int> failures(threadCount, 0);
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            for (size_t n = 0; n < entries.size(); n++) {
+                size_t i = (n * 7 + t * entries.size() / threadCount) % entries.size();
+                if (!FileMatches(archive.LoadFile(EntryName(i)), entries[i].data(), entries[i].size())) {
+                    failures[t]++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    bool passed = true;
+    for (unsigned int t = 0; t < threadCount; t++) {
+        if (failures[t] != 0) {
+            std::cout << "FAILED: thread " << t << " read " << failures[t] << " entries wrong" << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+// Splits rounds of loading every entry between the threads and returns the time per entry
+static double TimeThreads(Ship::O2rArchive& archive, size_t entryCount, int rounds, unsigned int threadCount) {
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < threadCount; t++) {
+        threads.emplace_back([&, t]() {
+            for (int round = 0; round < rounds; round++) {
+                for (size_t i = t; i < entryCount; i += threadCount) {
+                    archive.LoadFile(EntryName(i));
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const auto time = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(time).count() / ((double)entryCount * rounds);
+}
+
+int main(int argc, char** argv) {
+    size_t entryCount = 1000;
+    int rounds = 1;
+    unsigned int threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::string path = "archivebench.o2r";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--entries") == 0 && i + 1 < argc) {
+            entryCount = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            std::cerr << "Usage: archivebench [--entries N] [--rounds N] [--threads N] [--path FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(1234);
+    std::vector<std::vector<char>> entries;
+    for (size_t i = 0; i < entryCount; i++) {
+        entries.push_back(EntryContents(i, rng));
+    }
+    const zip_int32_t methods[] = { ZIP_CM_STORE, ZIP_CM_DEFLATE, LibzipOnlyMethod() };
+    if (!WriteZipFixture(path, entries, EntryName, [&methods](size_t i) { return methods[i % 3]; })) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return 1;
+    }
+
+    Ship::O2rArchive archive(path);
+    zip_t* zip = zip_open(path.c_str(), ZIP_RDONLY, nullptr);
+    if (!archive.Open() || zip == nullptr) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return 1;
+    }
+
+    int result = 0;
+    std::vector<char> expected;
+    for (size_t i = 0; i < entryCount; i++) {
+        auto file = archive.LoadFile(EntryName(i));
+        if (!ReadWithLibzip(zip, EntryName(i), expected) || expected != entries[i] ||
+            !FileMatches(file, expected.data(), expected.size())) {
+            std::cout << "FAILED: " << EntryName(i) << " differs" << std::endl;
+            result = 1;
+        }
+    }
+    std::cout << (result == 0 ? "ok" : "FAILED") << ": " << entryCount << " entries" << std::endl;
+
+    if (!StressThreads(archive, entries, threadCount)) {
+        result = 1;
+    }
+    std::cout << (result == 0 ? "ok" : "FAILED") << ": " << entryCount << " entries from " << threadCount
+              << " threads" << std::endl;
+
+    using Clock = std::chrono::steady_clock;
+    size_t checksum = 0;
+    auto start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < entryCount; i++) {
+            if (ReadWithLibzip(zip, EntryName(i), expected)) {
+                checksum += expected.size();
+            }
+        }
+    }
+    auto libzipTime = Clock::now() - start;
+
+    start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < entryCount; i++) {
+            auto file = archive.LoadFile(EntryName(i));
+            if (file != nullptr) {
+                checksum += file->GetSize();
+            }
+        }
+    }
+    auto archiveTime = Clock::now() - start;
+
+    const double loads = (double)entryCount * (rounds > 0 ? rounds : 1);
+    std::cout << "libzip: " << std::chrono::duration<double, std::micro>(libzipTime).count() / loads
+              << " us per entry" << std::endl;
+    std::cout << "O2rArchive: " << std::chrono::duration<double, std::micro>(archiveTime).count() / loads
+              << " us per entry" << std::endl;
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+
+    if (rounds > 0) {
+        for (unsigned int threads = 1;; threads = std::min(threads * 2, threadCount)) {
+            std::cout << "O2rArchive, " << threads << " threads: " << TimeThreads(archive, entryCount, rounds, threads)
+                      << " us per entry" << std::endl;
+            if (threads == threadCount) {
+                break;
+            }
+        }
+    }
+
+    zip_close(zip);
+    archive.Close();
+    std::remove(path.c_str());
+    return result;
+}
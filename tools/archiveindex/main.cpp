@@ -0,0 +1,270 @@
+// Writes the ArchiveIndex of O2R (and OTR) archives into them, so that opening them does not have to hash every path.
+//
+// Usage: archiveindex ARCHIVE...
+//        archiveindex --test [--entries N] [--rounds N] [--path FILE]
+//
+// Run it on an archive after everything else has been written to it, the index is ignored as soon as files are
+// added, removed or renamed, and O2rArchive::WriteFile removes it. --test writes an archive of N files, opens it with
+// and without an index and times both. It fails when the two list different files or read different data, when the
+// index is not used, or when it is still used after a file was written through O2rArchive.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "zip.h"
+
+#include "common/ZipFixture.h"
+#include "ship/resource/archive/ArchiveIndex.h"
+#include "ship/resource/archive/O2rArchive.h"
+#ifdef INCLUDE_MPQ_SUPPORT
+#include <StormLib.h>
+#endif
+
+static bool WriteZipIndex(const std::string& path) {
+    zip_t* archive = zip_open(path.c_str(), 0, nullptr);
+    if (archive == nullptr) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> files;
+    const zip_int64_t entryCount = zip_get_num_entries(archive, 0);
+    for (zip_int64_t i = 0; i < entryCount; i++) {
+        const char* name = zip_get_name(archive, i, 0);
+        if (name != nullptr && name[0] != '\0' && name[strlen(name) - 1] != '/' &&
+            strcmp(name, Ship::ArchiveIndex::PATH) != 0) {
+            files.emplace_back(name, i);
+        }
+    }
+
+    // The fingerprint is the number of entries once the index is in, an existing index is replaced where it is
+    const bool hasIndex = zip_name_locate(archive, Ship::ArchiveIndex::PATH, 0) >= 0;
+    const std::vector<char> index = Ship::ArchiveIndex::Build(files, entryCount + (hasIndex ? 0 : 1));
+    zip_source_t* source = zip_source_buffer(archive, index.data(), index.size(), 0);
+    const zip_int64_t added =
+        source != nullptr ? zip_file_add(archive, Ship::ArchiveIndex::PATH, source, ZIP_FL_OVERWRITE) : -1;
+    if (added < 0) {
+        std::cerr << "Failed to add the index to " << path << ": " << zip_strerror(archive) << std::endl;
+        zip_source_free(source);
+        zip_discard(archive);
+        return false;
+    }
+    zip_set_file_compression(archive, added, ZIP_CM_STORE, 0);
+    if (zip_close(archive) != 0) {
+        std::cerr << "Failed to write " << path << ": " << zip_strerror(archive) << std::endl;
+        zip_discard(archive);
+        return false;
+    }
+
+    std::cout << path << ": indexed " << files.size() << " files" << std::endl;
+    return true;
+}
+
+#ifdef INCLUDE_MPQ_SUPPORT
+static bool ReadMpqFile(HANDLE archive, const char* name, std::vector<char>& data) {
+    HANDLE file;
+    if (!SFileOpenFileEx(archive, name, 0, &file)) {
+        return false;
+    }
+    data.resize(SFileGetFileSize(file, nullptr));
+    DWORD read = 0;
+    const bool ok = SFileReadFile(file, data.data(), (DWORD)data.size(), &read, nullptr) && read == data.size();
+    SFileCloseFile(file);
+    return ok;
+}
+
+static bool WriteMpqFile(HANDLE archive, const std::vector<char>& data) {
+    HANDLE file;
+    if (!SFileCreateFile(archive, Ship::ArchiveIndex::PATH, 0, (DWORD)data.size(), 0, MPQ_FILE_REPLACEEXISTING,
+                         &file)) {
+        return false;
+    }
+    const bool written = SFileWriteFile(file, data.data(), (DWORD)data.size(), 0);
+    return SFileFinishFile(file) && written;
+}
+
+static bool WriteMpqIndex(const std::string& path) {
+    HANDLE archive;
+    if (!SFileOpenArchive(path.c_str(), 0, 0, &archive)) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+
+    std::vector<char> listFile;
+    bool written = ReadMpqFile(archive, "(listfile)", listFile);
+    std::vector<std::pair<std::string, uint64_t>> files;
+    size_t lineStart = 0;
+    for (size_t i = 0; written && i <= listFile.size(); i++) {
+        if (i == listFile.size() || listFile[i] == '\n') {
+            std::string line(listFile.data() + lineStart, i - lineStart);
+            line = line.substr(0, line.empty() ? 0 : line.length() - 1);
+            if (!line.empty() && line != Ship::ArchiveIndex::PATH) {
+                files.emplace_back(line, files.size());
+            }
+            lineStart = i + 1;
+        }
+    }
+    // The fingerprint leaves the index out of the list file, adding it does not change it
+    const uint64_t fingerprint = Ship::ArchiveIndex::HashListFile(std::string_view(listFile.data(), listFile.size()));
+    written = written && WriteMpqFile(archive, Ship::ArchiveIndex::Build(files, fingerprint));
+
+    const bool closed = SFileCloseArchive(archive);
+    if (!written || !closed) {
+        std::cerr << "Failed to add the index to " << path << std::endl;
+        return false;
+    }
+    std::cout << path << ": indexed " << files.size() << " files" << std::endl;
+    return true;
+}
+#endif
+
+static std::string EntryName(size_t index) {
+    return "objects/archiveindex/dir_" + std::to_string(index % 64) + "/entry_" + std::to_string(index);
+}
+
+struct OpenResult {
+    std::shared_ptr<std::unordered_map<uint64_t, std::string>> Files;
+    bool Indexed = false;
+    bool DataMatches = true;
+    std::chrono::steady_clock::duration Time = {};
+};
+
+static OpenResult OpenArchive(const std::string& path, size_t entryCount) {
+    OpenResult result;
+    Ship::O2rArchive archive(path);
+    const auto start = std::chrono::steady_clock::now();
+    archive.Open();
+    result.Time = std::chrono::steady_clock::now() - start;
+    result.Files = archive.ListFiles();
+    result.Indexed = archive.IsIndexed();
+
+    for (size_t i = 0; i < entryCount; i += std::max<size_t>(1, entryCount / 100)) {
+        const std::string name = EntryName(i);
+        auto file = archive.LoadFile(name);
+        result.DataMatches &= FileMatches(file, name.data(), name.size());
+    }
+    archive.Close();
+    return result;
+}
+
+static bool SameFiles(const OpenResult& a, const OpenResult& b) {
+    return a.Files != nullptr && b.Files != nullptr && *a.Files == *b.Files;
+}
+
+static int RunTest(const std::string& path, size_t entryCount, int rounds) {
+    // Every file holds its own name
+    std::vector<std::vector<char>> entries;
+    for (size_t i = 0; i < entryCount; i++) {
+        const std::string name = EntryName(i);
+        entries.emplace_back(name.begin(), name.end());
+    }
+    if (!WriteZipFixture(path, entries, EntryName)) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return 1;
+    }
+
+    int result = 0;
+    std::chrono::steady_clock::duration hashedTime = {};
+    std::chrono::steady_clock::duration indexedTime = {};
+    OpenResult hashed;
+    for (int round = 0; round < rounds; round++) {
+        hashed = OpenArchive(path, entryCount);
+        hashedTime += hashed.Time;
+    }
+    if (hashed.Indexed || !hashed.DataMatches || hashed.Files->size() != entryCount) {
+        std::cout << "FAILED: the archive without an index lists " << hashed.Files->size() << " of " << entryCount
+                  << " files" << std::endl;
+        result = 1;
+    }
+
+    if (!WriteZipIndex(path)) {
+        return 1;
+    }
+    OpenResult indexed;
+    for (int round = 0; round < rounds; round++) {
+        indexed = OpenArchive(path, entryCount);
+        indexedTime += indexed.Time;
+    }
+    if (!indexed.Indexed || !indexed.DataMatches || !SameFiles(hashed, indexed)) {
+        std::cout << "FAILED: the indexed archive " << (indexed.Indexed ? "lists other files" : "was hashed")
+                  << std::endl;
+        result = 1;
+    }
+
+    // Writing a file removes the index, the new file has to be found anyway
+    {
+        Ship::O2rArchive archive(path);
+        archive.Open();
+        const std::string name = EntryName(entryCount);
+        archive.WriteFile(name, std::vector<uint8_t>(name.begin(), name.end()));
+        archive.Close();
+    }
+    const OpenResult stale = OpenArchive(path, entryCount + 1);
+    if (stale.Indexed || !stale.DataMatches || stale.Files->size() != entryCount + 1) {
+        std::cout << "FAILED: the stale index " << (stale.Indexed ? "was used" : "lost files") << std::endl;
+        result = 1;
+    }
+    std::remove(path.c_str());
+
+    const double hashedMs = std::chrono::duration<double, std::milli>(hashedTime).count() / rounds;
+    const double indexedMs = std::chrono::duration<double, std::milli>(indexedTime).count() / rounds;
+    std::cout << "hashed: " << hashedMs << " ms to open " << entryCount << " files" << std::endl;
+    std::cout << "indexed: " << indexedMs << " ms to open, " << hashedMs / indexedMs << "x faster" << std::endl;
+    std::cout << (result == 0 ? "ok" : "FAILED") << ": opened with and without an index" << std::endl;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    bool test = false;
+    size_t entryCount = 20000;
+    int rounds = 1;
+    std::string testPath = "archiveindex.o2r";
+    std::vector<std::string> archives;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--test") == 0) {
+            test = true;
+        } else if (strcmp(argv[i], "--entries") == 0 && i + 1 < argc) {
+            entryCount = std::max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            testPath = argv[++i];
+        } else if (argv[i][0] != '-') {
+            archives.push_back(argv[i]);
+        } else {
+            archives.clear();
+            break;
+        }
+    }
+    if (test) {
+        return RunTest(testPath, entryCount, rounds);
+    }
+    if (archives.empty()) {
+        std::cerr << "Usage: archiveindex ARCHIVE...\n"
+                     "       archiveindex --test [--entries N] [--rounds N] [--path FILE]"
+                  << std::endl;
+        return 1;
+    }
+
+    int result = 0;
+    for (const std::string& path : archives) {
+        const std::string extension = path.substr(std::min(path.size(), path.find_last_of('.')));
+#ifdef INCLUDE_MPQ_SUPPORT
+        if (extension == ".otr" || extension == ".mpq") {
+            result |= WriteMpqIndex(path) ? 0 : 1;
+            continue;
+        }
+#endif
+        result |= WriteZipIndex(path) ? 0 : 1;
+    }
+    return result;
+}
@@ -0,0 +1,172 @@
+// Loads a directory of a generated O2R archive one resource at a time and as a batch, checks both and times them.
+//
+// Usage: batchbench [--entries N] [--rounds N] [--path FILE]
+//
+// Writes an archive of N binary blob resources, half of them stored and half deflated, and loads it through a
+// ResourceManager. Every round first loads the directory the way LoadResourcesProcess used to, calling LoadResource
+// on every file in turn, then unloads it and loads it again through LoadResourcesAsync, watching its progress. It
+// fails when a resource is missing or its data differs, when the batch returns the files in another order than the
+// archive lists them, when a resource it returns is not the one cached, or when its progress does not reach the total.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zip.h"
+
+#include "common/ZipFixture.h"
+#include "ship/Context.h"
+#include "ship/resource/ResourceManager.h"
+#include "ship/resource/ResourceType.h"
+#include "ship/resource/factory/BlobFactory.h"
+#include "ship/resource/type/Blob.h"
+
+static const char* sDirectory = "objects/batchbench/*";
+
+static std::string EntryName(size_t index) {
+    return "objects/batchbench/blob_" + std::to_string(index);
+}
+
+static std::vector<uint8_t> BlobData(size_t index, std::mt19937& rng) {
+    std::vector<uint8_t> data(128 + rng() % 8192);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = (uint8_t)((i % 32) < 24 ? index + i / 32 : rng());
+    }
+    return data;
+}
+
+static bool Matches(const std::shared_ptr<Ship::IResource>& resource, const std::vector<uint8_t>& expected) {
+    auto blob = std::dynamic_pointer_cast<Ship::Blob>(resource);
+    return blob != nullptr && blob->Data == expected;
+}
+
+static size_t EntryIndex(const std::string& name) {
+    return strtoul(name.c_str() + name.find_last_of('_') + 1, nullptr, 10);
+}
+
+// How LoadResourcesProcess loaded a directory before it loaded batches
+static std::vector<std::shared_ptr<Ship::IResource>> LoadOneByOne(Ship::ResourceManager& resourceManager,
+                                                                   const std::vector<std::string>& files) {
+    std::vector<std::shared_ptr<Ship::IResource>> resources;
+    resources.reserve(files.size());
+    for (const std::string& file : files) {
+        resources.push_back(resourceManager.LoadResource(file));
+    }
+    return resources;
+}
+
+int main(int argc, char** argv) {
+    size_t entryCount = 10000;
+    int rounds = 1;
+    std::string path = "batchbench.o2r";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--entries") == 0 && i + 1 < argc) {
+            entryCount = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            std::cerr << "Usage: batchbench [--entries N] [--rounds N] [--path FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(1234);
+    std::vector<std::vector<uint8_t>> blobs;
+    std::vector<std::vector<char>> resources;
+    for (size_t i = 0; i < entryCount; i++) {
+        blobs.push_back(BlobData(i, rng));
+        resources.push_back(BlobResource(i, blobs.back()));
+    }
+    if (!WriteZipFixture(path, resources, EntryName,
+                         [](size_t i) { return i % 2 == 0 ? ZIP_CM_STORE : ZIP_CM_DEFLATE; })) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return 1;
+    }
+
+    // Resources find their loader through the context
+    auto context = Ship::Context::CreateUninitializedInstance("batchbench", "batchbench", "batchbench.json");
+    if (!context->InitConfiguration() || !context->InitResourceManager({ path }, {}, 0, true) ||
+        !context->GetResourceManager()->IsLoaded()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return 1;
+    }
+    auto resourceManager = context->GetResourceManager();
+    resourceManager->GetResourceLoader()->RegisterResourceFactory(std::make_shared<Ship::ResourceFactoryBinaryBlobV0>(),
+                                                                  RESOURCE_FORMAT_BINARY, "Blob",
+                                                                  (uint32_t)Ship::ResourceType::Blob, 0);
+    const auto files = resourceManager->GetArchiveManager()->ListFiles(sDirectory);
+
+    int result = 0;
+    using Clock = std::chrono::steady_clock;
+    Clock::duration oneByOneTime = {};
+    Clock::duration batchTime = {};
+    for (int round = 0; round < rounds; round++) {
+        resourceManager->UnloadResources(sDirectory);
+        auto start = Clock::now();
+        const auto oneByOne = LoadOneByOne(*resourceManager, *files);
+        oneByOneTime += Clock::now() - start;
+        resourceManager->UnloadResources(sDirectory);
+
+        auto progress = std::make_shared<Ship::ResourceLoadProgress>();
+        start = Clock::now();
+        auto future = resourceManager->LoadResourcesAsync(sDirectory, BS::pr::normal, progress);
+        size_t progressUpdates = 0;
+        size_t lastLoaded = 0;
+        while (future.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready) {
+            const size_t loaded = progress->Loaded.load();
+            if (loaded < lastLoaded || loaded > progress->Total.load()) {
+                std::cout << "FAILED: progress went from " << lastLoaded << " to " << loaded << " of "
+                          << progress->Total << std::endl;
+                result = 1;
+            }
+            progressUpdates += loaded != lastLoaded ? 1 : 0;
+            lastLoaded = loaded;
+        }
+        const auto batch = future.get();
+        batchTime += Clock::now() - start;
+
+        if (progress->Total != entryCount || progress->Loaded != entryCount) {
+            std::cout << "FAILED: progress ended at " << progress->Loaded << " of " << progress->Total << std::endl;
+            result = 1;
+        }
+        if (batch == nullptr || batch->size() != files->size() || oneByOne.size() != files->size()) {
+            std::cout << "FAILED: " << (batch != nullptr ? batch->size() : 0) << " resources loaded as a batch and "
+                      << oneByOne.size() << " one by one, out of " << files->size() << std::endl;
+            return 1;
+        }
+        size_t failures = 0;
+        for (size_t i = 0; i < files->size(); i++) {
+            const auto& expected = blobs[EntryIndex((*files)[i])];
+            // The list is in the order the archive listed the files, and what is cached is what was returned
+            if (!Matches(oneByOne[i], expected) || !Matches((*batch)[i], expected) ||
+                resourceManager->GetCachedResource((*files)[i]) != (*batch)[i]) {
+                failures++;
+            }
+        }
+        if (failures != 0) {
+            std::cout << "FAILED: " << failures << " resources differ" << std::endl;
+            result = 1;
+        }
+        if (round == 0) {
+            std::cout << (result == 0 ? "ok" : "FAILED") << ": " << files->size() << " resources, "
+                      << progressUpdates << " progress updates" << std::endl;
+        }
+    }
+
+    const double oneByOneUs = std::chrono::duration<double, std::micro>(oneByOneTime).count();
+    const double batchUs = std::chrono::duration<double, std::micro>(batchTime).count();
+    std::cout << "one by one: " << oneByOneUs / rounds / 1000.0 << " ms per directory" << std::endl;
+    std::cout << "batch: " << batchUs / rounds / 1000.0 << " ms per directory, " << oneByOneUs / batchUs
+              << "x faster on " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    return result;
+}
@@ -0,0 +1,319 @@
+// Checks the sharded resource cache under contention and times its hits against a map behind a single mutex.
+//
+// Usage: cachebench [--milliseconds N] [--loaders N] [--resources N]
+//
+// A render thread looks up a fixed set of cached resources in a loop while loader threads keep adding new ones and
+// removing them again, the way ResourceManager's thread pool does while a scene streams in. Both caches run the same
+// workload for the given time and the render thread's time per hit is printed for each. It fails when a hit misses or
+// finds the wrong resource, or when a cache ends up with a different number of lines than was left in it.
+//
+// The budget of the sharded cache is checked on its own: eviction has to keep the lines used in the current frame and
+// the ones still referenced outside the cache, drop the least recently used ones first, count the evicted lines that
+// are set again as reloads, only look at the lines it evicts rather than at every line in the cache, and keep pinned
+// lines without looking at them again.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ship/resource/ResourceCache.h"
+
+typedef std::shared_ptr<size_t> Line;
+
+// The cache ResourceManager used before it was sharded
+class SingleLockCache {
+  public:
+    bool Find(const Ship::ResourceIdentifier& identifier, Line& value) {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mLines.find(identifier);
+        if (it == mLines.end()) {
+            return false;
+        }
+        value = it->second;
+        return true;
+    }
+    void Set(const Ship::ResourceIdentifier& identifier, Line value) {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mLines.insert_or_assign(identifier, std::move(value));
+    }
+    bool Erase(const Ship::ResourceIdentifier& identifier) {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        return mLines.erase(identifier) != 0;
+    }
+    size_t GetSize() {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        return mLines.size();
+    }
+
+  private:
+    std::mutex mMutex;
+    std::unordered_map<Ship::ResourceIdentifier, Line, Ship::ResourceIdentifierHash> mLines;
+};
+
+static std::string ResourcePath(size_t index) {
+    return "objects/gameplay_keep/gameplay_keep_dl_" + std::to_string(index);
+}
+
+struct RunResult {
+    double nanosecondsPerHit;
+    uint64_t hits;
+    uint64_t misses;
+    size_t size;
+    size_t expectedSize;
+};
+
+template <typename Cache>
+static RunResult Run(Cache& cache, int milliseconds, unsigned int loaderCount, size_t resourceCount) {
+    // The identifiers a render thread keeps, built once like the ones display list commands cache
+    std::vector<Ship::ResourceIdentifier> hot;
+    for (size_t i = 0; i < resourceCount; i++) {
+        hot.emplace_back(ResourcePath(i), 0, nullptr);
+        cache.Set(hot.back(), std::make_shared<size_t>(i));
+    }
+
+    std::atomic<bool> stop = false;
+    std::vector<size_t> loaded(loaderCount, 0);
+    std::vector<std::thread> loaders;
+    for (unsigned int t = 0; t < loaderCount; t++) {
+        loaders.emplace_back([&, t]() {
+            // Every miss adds a new line, the odd ones are unloaded again right away
+            size_t i = 0;
+            for (; !stop.load(std::memory_order_relaxed); i++) {
+                Ship::ResourceIdentifier identifier(ResourcePath(resourceCount + t * 1000000000ull + i), 0, nullptr);
+                Line line;
+                if (!cache.Find(identifier, line)) {
+                    cache.Set(identifier, std::make_shared<size_t>(i));
+                }
+                if (i % 2 == 1) {
+                    cache.Erase(identifier);
+                }
+            }
+            loaded[t] = i;
+        });
+    }
+
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    const auto start = std::chrono::steady_clock::now();
+    const auto end = start + std::chrono::milliseconds(milliseconds);
+    auto now = start;
+    while (now < end) {
+        for (size_t i = 0; i < hot.size(); i++) {
+            Line line;
+            if (cache.Find(hot[i], line) && line != nullptr && *line == i) {
+                hits++;
+            } else {
+                misses++;
+            }
+        }
+        now = std::chrono::steady_clock::now();
+    }
+    stop = true;
+    for (std::thread& loader : loaders) {
+        loader.join();
+    }
+
+    size_t expectedSize = resourceCount;
+    for (size_t count : loaded) {
+        expectedSize += (count + 1) / 2;
+    }
+    const double nanoseconds = std::chrono::duration<double, std::nano>(now - start).count();
+    return { nanoseconds / (double)(hits + misses), hits, misses, cache.GetSize(), expectedSize };
+}
+
+static bool CheckEviction() {
+    constexpr size_t LINE_BYTES = 1024;
+    constexpr size_t LINE_COUNT = 100;
+    Ship::ResourceCache<Line> cache;
+    std::vector<Ship::ResourceIdentifier> identifiers;
+    for (size_t i = 0; i < LINE_COUNT; i++) {
+        identifiers.emplace_back(ResourcePath(i), 0, nullptr);
+        cache.Set(identifiers.back(), std::make_shared<size_t>(i), LINE_BYTES);
+    }
+
+    // Every line is used once in frame i, so line 0 is the least recently used one
+    for (size_t i = 0; i < LINE_COUNT; i++) {
+        cache.AdvanceFrame();
+        Line line;
+        cache.Find(identifiers[i], line);
+    }
+    // Line 1 is still referenced outside the cache
+    Line held;
+    cache.Find(identifiers[1], held);
+    cache.AdvanceFrame();
+    // Line 2 is used in the frame that evicts
+    Line used;
+    cache.Find(identifiers[2], used);
+    used = nullptr;
+
+    const size_t budget = LINE_COUNT / 2 * LINE_BYTES;
+    cache.SetBudget(budget);
+    std::vector<Line> evicted;
+    const auto canEvict = [](const Line& line) { return line.use_count() == 1; };
+    const size_t count = cache.Evict(canEvict, evicted);
+    bool passed = true;
+    Ship::ResourceCacheStats stats = cache.GetStats();
+    if (stats.Bytes > budget || count != evicted.size() || stats.Evictions != count ||
+        stats.EvictedBytes != count * LINE_BYTES || stats.Lines != LINE_COUNT - count) {
+        std::cout << "FAILED: " << stats.Bytes << " bytes in " << stats.Lines << " lines after evicting " << count
+                  << " with a budget of " << budget << std::endl;
+        passed = false;
+    }
+    if (!cache.Contains(identifiers[1]) || !cache.Contains(identifiers[2])) {
+        std::cout << "FAILED: a referenced line or one used this frame was evicted" << std::endl;
+        passed = false;
+    }
+    // Apart from the two kept ones, the oldest lines go first
+    for (size_t i = 0; i < LINE_COUNT; i++) {
+        const bool expected = i == 1 || i == 2 || i >= count + 2;
+        if (cache.Contains(identifiers[i]) != expected) {
+            std::cout << "FAILED: line " << i << (expected ? " was" : " was not") << " evicted" << std::endl;
+            passed = false;
+            break;
+        }
+    }
+
+    cache.Set(identifiers[0], std::make_shared<size_t>(0), LINE_BYTES);
+    cache.Set(identifiers[0], std::make_shared<size_t>(0), LINE_BYTES);
+    if (cache.GetStats().Reloads != 1) {
+        std::cout << "FAILED: " << cache.GetStats().Reloads << " reloads instead of 1" << std::endl;
+        passed = false;
+    }
+
+    std::cout << (passed ? "ok" : "FAILED") << ": budgeted cache evicted " << count << " lines" << std::endl;
+    return passed;
+}
+
+static bool CheckEvictionCost() {
+    constexpr size_t LINE_COUNT = 100000;
+    constexpr size_t EVICT_COUNT = 10;
+    Ship::ResourceCache<Line> cache;
+    std::vector<Ship::ResourceIdentifier> identifiers;
+    for (size_t i = 0; i < LINE_COUNT; i++) {
+        identifiers.emplace_back(ResourcePath(i), 0, nullptr);
+        cache.Set(identifiers.back(), std::make_shared<size_t>(i), 1);
+    }
+    // Every line but the first few is used again in a later frame
+    cache.AdvanceFrame();
+    for (size_t i = EVICT_COUNT; i < LINE_COUNT; i++) {
+        Line line;
+        cache.Find(identifiers[i], line);
+    }
+    cache.AdvanceFrame();
+
+    cache.SetBudget(LINE_COUNT - EVICT_COUNT);
+    std::vector<Line> evicted;
+    size_t checked = 0;
+    const size_t count = cache.Evict(
+        [&checked](const Line& line) {
+            checked++;
+            return line.use_count() == 1;
+        },
+        evicted);
+    // Besides the evicted lines, every pass over the shards looks at the oldest line left in each of them
+    bool passed = count == EVICT_COUNT && checked <= EVICT_COUNT + 2 * Ship::ResourceCache<Line>::SHARD_COUNT;
+    for (size_t i = 0; i < EVICT_COUNT; i++) {
+        passed &= !cache.Contains(identifiers[i]);
+    }
+    std::cout << (passed ? "ok" : "FAILED") << ": evicting " << count << " of " << LINE_COUNT << " lines checked "
+              << checked << " of them" << std::endl;
+    return passed;
+}
+
+static bool CheckPinning() {
+    constexpr size_t LINE_COUNT = 10000;
+    constexpr size_t UNPINNED_COUNT = 100;
+    Ship::ResourceCache<Line> cache;
+    std::vector<Ship::ResourceIdentifier> identifiers;
+    for (size_t i = 0; i < LINE_COUNT; i++) {
+        identifiers.emplace_back(ResourcePath(i), 0, nullptr);
+        cache.Set(identifiers.back(), std::make_shared<size_t>(i), 1);
+    }
+    // The pinned lines are the oldest ones, every eviction has to get past them
+    cache.AdvanceFrame();
+    for (size_t i = LINE_COUNT - UNPINNED_COUNT; i < LINE_COUNT; i++) {
+        Line line;
+        cache.Find(identifiers[i], line);
+    }
+    cache.AdvanceFrame();
+
+    std::vector<Line> evicted;
+    size_t pinnedChecks = 0;
+    const auto canEvict = [](const Line& line) { return line.use_count() == 1; };
+    const auto isPinned = [&pinnedChecks](const Line& line) {
+        pinnedChecks++;
+        return *line < LINE_COUNT - UNPINNED_COUNT;
+    };
+    size_t count = 0;
+    size_t lastPinnedChecks = 0;
+    for (size_t frame = 0; frame < 10; frame++) {
+        cache.SetBudget(LINE_COUNT - count - 1);
+        pinnedChecks = 0;
+        count += cache.Evict(canEvict, isPinned, evicted);
+        lastPinnedChecks = pinnedChecks;
+        cache.AdvanceFrame();
+    }
+
+    // Once they are out of the lists, a frame only checks the lines it evicts and the head of each shard
+    bool passed = count == 10 && lastPinnedChecks <= 1 + 2 * Ship::ResourceCache<Line>::SHARD_COUNT;
+    for (size_t i = 0; i < LINE_COUNT - UNPINNED_COUNT; i++) {
+        passed &= cache.Contains(identifiers[i]);
+    }
+    std::cout << (passed ? "ok" : "FAILED") << ": evicted " << count << " unpinned lines, the last frame checked "
+              << lastPinnedChecks << " lines for pins" << std::endl;
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    int milliseconds = 500;
+    unsigned int loaderCount = std::max(3u, std::thread::hardware_concurrency()) - 2;
+    size_t resourceCount = 2000;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--milliseconds") == 0 && i + 1 < argc) {
+            milliseconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--loaders") == 0 && i + 1 < argc) {
+            loaderCount = (unsigned int)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--resources") == 0 && i + 1 < argc) {
+            resourceCount = strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: cachebench [--milliseconds N] [--loaders N] [--resources N]" << std::endl;
+            return 1;
+        }
+    }
+
+    int result = 0;
+    SingleLockCache single;
+    RunResult singleResult = Run(single, milliseconds, loaderCount, resourceCount);
+    Ship::ResourceCache<Line> sharded;
+    RunResult shardedResult = Run(sharded, milliseconds, loaderCount, resourceCount);
+
+    for (const auto& [name, run] : { std::pair("single lock", singleResult), std::pair("sharded", shardedResult) }) {
+        std::cout << name << ": " << run.nanosecondsPerHit << " ns per hit, " << run.hits << " hits with "
+                  << loaderCount << " loaders" << std::endl;
+        if (run.misses != 0) {
+            std::cout << "FAILED: " << name << " missed " << run.misses << " cached resources" << std::endl;
+            result = 1;
+        }
+        // The hot set and every even line a loader added stay
+        if (run.size != run.expectedSize) {
+            std::cout << "FAILED: " << name << " holds " << run.size << " lines instead of " << run.expectedSize
+                      << std::endl;
+            result = 1;
+        }
+    }
+    std::cout << (result == 0 ? "ok" : "FAILED") << ": sharded cache under contention" << std::endl;
+
+    if (!CheckEviction() || !CheckEvictionCost() || !CheckPinning()) {
+        result = 1;
+    }
+
+    return result;
+}
@@ -0,0 +1,130 @@
+#include "common/AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+#include "fast/debug/GfxAllocationCounter.h"
+
+static thread_local uint64_t sAllocations = 0;
+
+uint64_t GetThreadAllocationCount() {
+    return sAllocations;
+}
+
+// Set before main runs, so the tools can check for it while parsing their arguments
+static const bool sIsSourceSet = [] {
+    Fast::GfxAllocationCounter::SetSource(GetThreadAllocationCount);
+    return true;
+}();
+
+static void* CountedAlloc(std::size_t size) {
+    sAllocations++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* CountedAlignedAlloc(std::size_t size, std::align_val_t alignment) {
+    sAllocations++;
+    const std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+    // aligned_alloc wants a multiple of the alignment
+    return std::aligned_alloc(align, size == 0 ? align : (size + align - 1) / align * align);
+#endif
+}
+
+static void AlignedFree(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+void* operator new(std::size_t size) {
+    void* ptr = CountedAlloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* ptr = CountedAlignedAlloc(size, alignment);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlignedAlloc(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlignedAlloc(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+    AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+    AlignedFree(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    AlignedFree(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    AlignedFree(ptr);
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+// Linking AllocationCounter.cpp into a tool replaces the global operator new and delete, in every form, with ones that
+// count the allocations of each thread. It also hands the count to Fast::GfxAllocationCounter. The library itself never
+// replaces them.
+
+// The number of allocations the calling thread has made so far
+uint64_t GetThreadAllocationCount();
@@ -0,0 +1,44 @@
+#include "common/ZipFixture.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "ship/resource/archive/Archive.h"
+
+bool WriteZipFixture(const std::string& path, const std::vector<std::vector<char>>& entries, ZipFixtureNamer name,
+                     const std::function<zip_int32_t(size_t index)>& method) {
+    std::remove(path.c_str());
+    zip_t* archive = zip_open(path.c_str(), ZIP_CREATE | ZIP_TRUNCATE, nullptr);
+    if (archive == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < entries.size(); i++) {
+        zip_source_t* source = zip_source_buffer(archive, entries[i].data(), entries[i].size(), 0);
+        zip_int64_t index = source != nullptr ? zip_file_add(archive, name(i).c_str(), source, 0) : -1;
+        if (index < 0) {
+            zip_source_free(source);
+            zip_discard(archive);
+            return false;
+        }
+        if (method != nullptr) {
+            zip_set_file_compression(archive, index, method(i), 0);
+        }
+    }
+    return zip_close(archive) == 0;
+}
+
+std::vector<char> BlobResource(uint64_t id, const std::vector<uint8_t>& data) {
+    std::vector<char> resource(OTR_HEADER_SIZE, 0);
+    resource[0] = (char)Ship::Endianness::Little;
+    const uint32_t type = (uint32_t)Ship::ResourceType::Blob;
+    memcpy(&resource[4], &type, sizeof(type));
+    memcpy(&resource[12], &id, sizeof(id));
+    const uint32_t size = (uint32_t)data.size();
+    resource.insert(resource.end(), (const char*)&size, (const char*)&size + sizeof(size));
+    resource.insert(resource.end(), data.begin(), data.end());
+    return resource;
+}
+
+bool FileMatches(const std::shared_ptr<Ship::File>& file, const char* data, size_t size) {
+    return file != nullptr && file->GetSize() == size && memcmp(file->GetData(), data, size) == 0;
+}
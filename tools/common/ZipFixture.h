@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "zip.h"
+
+#include "ship/resource/File.h"
+
+// Generated zip archives for the tools to test and time the archive and resource code on
+
+// Names entry i of an archive
+using ZipFixtureNamer = std::string (*)(size_t index);
+
+// Writes a new archive at path, replacing any file there, holding entries[i] as the entry named name(i). Entries are
+// compressed with method(i), or the libzip default without one.
+bool WriteZipFixture(const std::string& path, const std::vector<std::vector<char>>& entries, ZipFixtureNamer name,
+                     const std::function<zip_int32_t(size_t index)>& method = nullptr);
+
+// A little endian OTR header for a version 0 blob, followed by its size and data
+std::vector<char> BlobResource(uint64_t id, const std::vector<uint8_t>& data);
+
+// Whether the file was loaded and holds exactly size bytes equal to data
+bool FileMatches(const std::shared_ptr<Ship::File>& file, const char* data, size_t size);
@@ -0,0 +1,159 @@
+// Checks the CRC64 kernels the CPU supports against the byte at a time table walk and times them.
+//
+// Usage: crc64bench [--max-length N] [--benchmark N]
+//
+// Every kernel has to give the same CRC64 as the table walk for every one and two byte input, for every length up to
+// --max-length at every alignment of a 16 byte block with a random starting value, and for inputs hashed in two
+// pieces. The public functions are checked against the table walk and against the CRC-64/WE check value. With
+// --benchmark every kernel hashes N asset paths of realistic lengths and a large buffer, and its time is printed. It
+// fails when any result differs.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ship/utils/StrHash64.h"
+
+// CRC-64/WE of "123456789", which is what crc64 computes
+static constexpr uint64_t CHECK_VALUE = 0x62ec59e3f1a4f00aull;
+
+static size_t CheckShortInputs(const Crc64Kernel& kernel, const Crc64Kernel& reference) {
+    size_t failures = 0;
+    for (uint32_t i = 0; i < 0x10000; i++) {
+        const uint8_t bytes[2] = { (uint8_t)i, (uint8_t)(i >> 8) };
+        if ((i < 0x100 && kernel.Update(INITIAL_CRC64, bytes, 1) != reference.Update(INITIAL_CRC64, bytes, 1)) ||
+            kernel.Update(INITIAL_CRC64, bytes, 2) != reference.Update(INITIAL_CRC64, bytes, 2)) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+static size_t CheckLengths(const Crc64Kernel& kernel, const Crc64Kernel& reference, const std::vector<uint8_t>& data,
+                           size_t maxLength, std::mt19937_64& rng) {
+    size_t failures = 0;
+    for (size_t offset = 0; offset < 16; offset++) {
+        for (size_t length = 0; length <= maxLength; length++) {
+            const uint64_t start = (length % 3) == 0 ? INITIAL_CRC64 : rng();
+            const uint8_t* bytes = data.data() + offset;
+            if (kernel.Update(start, bytes, length) != reference.Update(start, bytes, length)) {
+                failures++;
+            }
+            // Hashing in two pieces has to carry the state over
+            const size_t split = length == 0 ? 0 : rng() % length;
+            if (kernel.Update(kernel.Update(start, bytes, split), bytes + split, length - split) !=
+                reference.Update(start, bytes, length)) {
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+static std::vector<std::string> AssetPaths(size_t count, std::mt19937_64& rng) {
+    static const char* sDirectories[] = { "objects/gameplay_keep/", "objects/object_link_boy/", "scenes/shared/",
+                                          "textures/icon_item_static/", "overlays/ovl_En_Test/", "misc/" };
+    static const char* sNames[] = { "gLinkAdultSkel", "gGameplayKeepDL", "gEffFireTex", "gTitleStaticLogoTex",
+                                    "sVtx", "gSceneRoomDL", "gMtx" };
+    std::vector<std::string> paths;
+    paths.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string path = std::string("alt/") + sDirectories[rng() % std::size(sDirectories)];
+        path += sNames[rng() % std::size(sNames)];
+        path += "_" + std::to_string(rng() % 0x100000);
+        if (rng() % 4 == 0) {
+            path += "Limb_" + std::to_string(rng() % 64) + "DL";
+        }
+        paths.push_back(path.substr(rng() % 2 == 0 ? 4 : 0));
+    }
+    return paths;
+}
+
+static void Benchmark(const std::vector<const Crc64Kernel*>& kernels, size_t pathCount, std::mt19937_64& rng) {
+    const std::vector<std::string> paths = AssetPaths(pathCount, rng);
+    size_t pathBytes = 0;
+    for (const std::string& path : paths) {
+        pathBytes += path.size();
+    }
+    std::vector<uint8_t> buffer(1 << 20);
+    for (uint8_t& byte : buffer) {
+        byte = (uint8_t)rng();
+    }
+    const int bufferRounds = 64;
+
+    std::cout << pathCount << " paths of " << (double)pathBytes / pathCount << " bytes on average" << std::endl;
+    for (const Crc64Kernel* kernel : kernels) {
+        uint64_t sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& path : paths) {
+            sink ^= kernel->Update(INITIAL_CRC64, path.data(), path.size());
+        }
+        const double pathSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < bufferRounds; i++) {
+            sink ^= kernel->Update(INITIAL_CRC64, buffer.data(), buffer.size());
+        }
+        const double bufferSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << kernel->Name << ": " << pathSeconds * 1e9 / pathCount << " ns per path, "
+                  << (double)buffer.size() * bufferRounds / bufferSeconds / 1e9 << " GB/s on 1 MB buffers ("
+                  << (sink & 1) << ")" << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t maxLength = 1024;
+    size_t benchmarkPaths = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--max-length") == 0 && i + 1 < argc) {
+            maxLength = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+            benchmarkPaths = strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: crc64bench [--max-length N] [--benchmark N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937_64 rng(1234);
+    std::vector<uint8_t> data(maxLength + 16);
+    for (uint8_t& byte : data) {
+        byte = (uint8_t)rng();
+    }
+
+    int result = 0;
+    const Crc64Kernel& reference = Crc64TableKernel();
+    const auto kernels = Crc64AvailableKernels();
+    for (const Crc64Kernel* kernel : kernels) {
+        const size_t failures =
+            CheckShortInputs(*kernel, reference) + CheckLengths(*kernel, reference, data, maxLength, rng);
+        if (failures != 0) {
+            result = 1;
+        }
+        std::cout << (failures == 0 ? "ok" : "FAILED") << ": " << kernel->Name << ", " << failures << " mismatches"
+                  << std::endl;
+    }
+
+    // The public functions go through the chosen kernel
+    const std::string path = "objects/gameplay_keep/gLinkAdultSkel";
+    const uint64_t pathHash = reference.Update(INITIAL_CRC64, path.data(), path.size());
+    if (crc64("123456789", 9) != CHECK_VALUE || CRC64(path.c_str()) != pathHash ||
+        ~crc64(path.data(), (uint32_t)path.size()) != pathHash ||
+        crc64(data.data(), (uint32_t)data.size()) != ~reference.Update(INITIAL_CRC64, data.data(), data.size())) {
+        std::cout << "FAILED: the public functions through " << Crc64GetKernel().Name << " differ" << std::endl;
+        result = 1;
+    }
+
+    if (benchmarkPaths != 0) {
+        Benchmark(kernels, benchmarkPaths, rng);
+    }
+
+    return result;
+}
@@ -0,0 +1,171 @@
+// Checks the matrix kernels the CPU supports against the scalar ones and times them.
+//
+// Usage: gfxmatrix [--iterations N] [--benchmark N]
+//
+// Every kernel has to give the same bits as the scalar kernel for N random inputs and for a set of edge values. With
+// --benchmark every kernel also runs N times on the same inputs and its time per call is printed. It fails when any
+// result differs.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "fast/GfxMatrix.h"
+
+struct MatrixInputs {
+    int32_t fixed[16];
+    float a[4][4];
+    float b[4][4];
+    float v[3];
+};
+
+static float RandomElement(std::mt19937& rng) {
+    // Mostly the magnitudes game matrices use, with some that only fit s15.16 barely
+    std::uniform_real_distribution<float> small(-4.0f, 4.0f);
+    std::uniform_real_distribution<float> large(-32767.0f, 32767.0f);
+    return (rng() % 8) == 0 ? large(rng) : small(rng);
+}
+
+static MatrixInputs RandomInputs(std::mt19937& rng) {
+    MatrixInputs inputs;
+    for (int i = 0; i < 16; i++) {
+        inputs.fixed[i] = (int32_t)rng();
+        inputs.a[i / 4][i % 4] = RandomElement(rng);
+        inputs.b[i / 4][i % 4] = RandomElement(rng);
+    }
+    for (int i = 0; i < 3; i++) {
+        inputs.v[i] = RandomElement(rng);
+    }
+    return inputs;
+}
+
+static std::vector<MatrixInputs> EdgeInputs() {
+    static const float values[] = { 0.0f,           -0.0f,           1.0f,          -1.0f,
+                                    1.0f / 65536.0f, -1.0f / 65536.0f, 32767.99f,     -32768.0f,
+                                    0.99999f,        -0.99999f,        1.5f / 65536.0f, 123.456f };
+    static const int32_t words[] = { 0, -1, 0x7fffffff, (int32_t)0x80000000, 0x0000ffff, (int32_t)0xffff0000 };
+    const size_t numValues = sizeof(values) / sizeof(values[0]);
+    const size_t numWords = sizeof(words) / sizeof(words[0]);
+
+    std::vector<MatrixInputs> inputs;
+    for (size_t n = 0; n < numValues * numWords; n++) {
+        MatrixInputs input;
+        for (int i = 0; i < 16; i++) {
+            input.fixed[i] = words[(n + i) % numWords];
+            input.a[i / 4][i % 4] = values[(n + i) % numValues];
+            input.b[i / 4][i % 4] = values[(n + i * 5) % numValues];
+        }
+        for (int i = 0; i < 3; i++) {
+            input.v[i] = values[(n + i * 7) % numValues];
+        }
+        inputs.push_back(input);
+    }
+    return inputs;
+}
+
+// Returns the number of kernels whose results differ from the scalar ones
+static int Compare(const Fast::GfxMatrixKernels& kernels, const MatrixInputs& in) {
+    const Fast::GfxMatrixKernels& scalar = Fast::GfxMatrixScalarKernels();
+    int failures = 0;
+    float expected[4][4];
+    float actual[4][4];
+    float expectedDir[3];
+    float actualDir[3];
+
+    scalar.UnpackFixed(expected, in.fixed);
+    kernels.UnpackFixed(actual, in.fixed);
+    failures += memcmp(expected, actual, sizeof(expected)) != 0;
+
+    scalar.Mul(expected, in.a, in.b);
+    kernels.Mul(actual, in.a, in.b);
+    failures += memcmp(expected, actual, sizeof(expected)) != 0;
+
+    // The interpreter multiplies into one of the operands
+    memcpy(actual, in.a, sizeof(actual));
+    kernels.Mul(actual, actual, in.b);
+    failures += memcmp(expected, actual, sizeof(expected)) != 0;
+
+    scalar.Quantize(expected, in.a);
+    kernels.Quantize(actual, in.a);
+    failures += memcmp(expected, actual, sizeof(expected)) != 0;
+
+    scalar.TransposedMul(expectedDir, in.v, in.a);
+    kernels.TransposedMul(actualDir, in.v, in.a);
+    failures += memcmp(expectedDir, actualDir, sizeof(expectedDir)) != 0;
+    return failures;
+}
+
+template <typename F> static double TimePerCall(int iterations, F&& f) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+static void Benchmark(const Fast::GfxMatrixKernels& kernels, const std::vector<MatrixInputs>& inputs, int iterations) {
+    float res[4][4] = {};
+    float dir[3] = {};
+    const size_t mask = inputs.size() - 1;
+
+    double unpack = TimePerCall(iterations, [&](int i) { kernels.UnpackFixed(res, inputs[i & mask].fixed); });
+    double mul = TimePerCall(iterations, [&](int i) { kernels.Mul(res, res, inputs[i & mask].b); });
+    double quantize = TimePerCall(iterations, [&](int i) { kernels.Quantize(res, inputs[i & mask].a); });
+    double transposed =
+        TimePerCall(iterations, [&](int i) { kernels.TransposedMul(dir, inputs[i & mask].v, inputs[i & mask].a); });
+
+    // Keeps the results alive
+    volatile float sink = res[0][0] + dir[0];
+    (void)sink;
+
+    std::cout << kernels.Name << ": unpack " << unpack << " ns, mul " << mul << " ns, quantize " << quantize
+              << " ns, transposed mul " << transposed << " ns" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 100000;
+    int benchmarkIterations = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc) {
+            benchmarkIterations = atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: gfxmatrix [--iterations N] [--benchmark N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(1);
+    std::vector<MatrixInputs> inputs = EdgeInputs();
+    for (int i = 0; i < iterations; i++) {
+        inputs.push_back(RandomInputs(rng));
+    }
+
+    int result = 0;
+    const std::vector<const Fast::GfxMatrixKernels*> available = Fast::GfxMatrixAvailableKernels();
+    for (const Fast::GfxMatrixKernels* kernels : available) {
+        int failures = 0;
+        for (const MatrixInputs& input : inputs) {
+            failures += Compare(*kernels, input);
+        }
+        std::cout << kernels->Name << ": " << failures << " mismatches in " << inputs.size() << " inputs" << std::endl;
+        if (failures != 0) {
+            result = 1;
+        }
+    }
+    std::cout << "The interpreter uses " << Fast::GfxMatrixGetKernels().Name << std::endl;
+
+    if (benchmarkIterations > 0) {
+        // A power of two number of inputs, so picking one is a mask
+        std::vector<MatrixInputs> benchInputs(inputs.begin(), inputs.begin() + 64);
+        for (const Fast::GfxMatrixKernels* kernels : available) {
+            Benchmark(*kernels, benchInputs, benchmarkIterations);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,438 @@
+// Replays a frame capture written by the Gfx debugger through Fast::Interpreter, without the game.
+//
+// Usage: gfxreplay <capture> [--backend null|software|opengl] [--threads N] [--frames N] [--archive path]...
+//                  [--dispatch specialized|generic] [--output image.ppm] [--reference image] [--diff image.ppm]
+//                  [--tolerance N] [--max-mismatch F] [--max-allocations N] [--interpolation N]
+//                  [--mtx-replacements map|table] [--draw-queue] [--compare-draw-queue]
+//
+// The capture holds the resources the frame used. Resources that are read outside of the command stream, such as
+// shaders, come from the archives passed with --archive. --dispatch generic runs the command loop that looks handlers
+// up at runtime instead of the one specialized for the captured microcode, to benchmark one against the other.
+//
+// With the software backend the final frame can be written out and compared against a reference image. The replay
+// then fails when more than --max-mismatch of the pixels differ by more than --tolerance in any channel.
+//
+// In builds with GFX_COUNT_ALLOCATIONS the heap allocations made by Interpreter::Run are counted, and the replay fails
+// when a frame after the first one makes more than --max-allocations of them.
+//
+// With the OpenGL backend the texture pool counters are printed after the replay.
+//
+// --interpolation N replays every frame N times with the captured matrix replacements, the way a game running with
+// frame interpolation draws one tick, and times the whole tick. --mtx-replacements map builds an unordered_map for
+// every interpolated frame and passes it to Interpreter::Run, table builds one GfxMtxReplacementTable for the tick.
+//
+// --draw-queue replays with the draw queue, which reorders opaque draws by state. --compare-draw-queue replays the
+// frames without it, then one more frame with it, and fails when the color of more than --max-mismatch of the pixels
+// or any depth value differs between the two. It requires the software backend.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ship/Context.h"
+#include "ship/config/ConsoleVariable.h"
+#include "ship/resource/ResourceManager.h"
+#include "ship/resource/ResourceLoader.h"
+#include "fast/interpreter.h"
+#include "fast/GfxMtxReplacementTable.h"
+#include "fast/debug/GfxCapture.h"
+#include "fast/debug/GfxAllocationCounter.h"
+#include "fast/backends/gfx_null.h"
+#include "fast/backends/gfx_software.h"
+#ifdef ENABLE_OPENGL
+#include "fast/backends/gfx_opengl.h"
+#include "fast/backends/gfx_sdl.h"
+#endif
+#include "fast/resource/ResourceType.h"
+#include "fast/resource/factory/DisplayListFactory.h"
+#include "fast/resource/factory/LightFactory.h"
+#include "fast/resource/factory/MatrixFactory.h"
+#include "fast/resource/factory/TextureFactory.h"
+#include "fast/resource/factory/VertexFactory.h"
+#include <stb_image.h>
+
+namespace Fast {
+void GfxSetInstance(std::shared_ptr<Interpreter> gfx);
+}
+
+static void RegisterFastFactories() {
+    auto loader = Ship::Context::GetInstance()->GetResourceManager()->GetResourceLoader();
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryBinaryTextureV0>(), RESOURCE_FORMAT_BINARY,
+                                    "Texture", static_cast<uint32_t>(Fast::ResourceType::Texture), 0);
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryBinaryTextureV1>(), RESOURCE_FORMAT_BINARY,
+                                    "Texture", static_cast<uint32_t>(Fast::ResourceType::Texture), 1);
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryBinaryVertexV0>(), RESOURCE_FORMAT_BINARY,
+                                    "Vertex", static_cast<uint32_t>(Fast::ResourceType::Vertex), 0);
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryXMLVertexV0>(), RESOURCE_FORMAT_XML,
+                                    "Vertex", static_cast<uint32_t>(Fast::ResourceType::Vertex), 0);
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryBinaryDisplayListV0>(),
+                                    RESOURCE_FORMAT_BINARY, "DisplayList",
+                                    static_cast<uint32_t>(Fast::ResourceType::DisplayList), 0);
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryXMLDisplayListV0>(), RESOURCE_FORMAT_XML,
+                                    "DisplayList", static_cast<uint32_t>(Fast::ResourceType::DisplayList), 0);
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryBinaryMatrixV0>(), RESOURCE_FORMAT_BINARY,
+                                    "Matrix", static_cast<uint32_t>(Fast::ResourceType::Matrix), 0);
+    loader->RegisterResourceFactory(std::make_shared<Fast::ResourceFactoryBinaryLightV0>(), RESOURCE_FORMAT_BINARY,
+                                    "Light", static_cast<uint32_t>(Fast::ResourceType::Light), 0);
+}
+
+static int Usage() {
+    std::cerr << "Usage: gfxreplay <capture> [--backend null|software|opengl] [--threads N] [--frames N] "
+                 "[--archive path]... [--dispatch specialized|generic] [--output image.ppm] [--reference image] "
+                 "[--diff image.ppm] [--tolerance N] [--max-mismatch F] [--max-allocations N] "
+                 "[--interpolation N] [--mtx-replacements map|table] [--draw-queue] [--compare-draw-queue]"
+              << std::endl;
+    return 1;
+}
+
+struct Image {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgb;
+};
+
+// Converts a framebuffer to a top to bottom RGB image
+static Image ReadFramebuffer(const Fast::FramebufferSoftware& fb) {
+    Image image;
+    image.width = fb.color.width;
+    image.height = fb.color.height;
+    image.rgb.resize((size_t)image.width * image.height * 3);
+
+    for (int y = 0; y < image.height; y++) {
+        // Game framebuffers are rendered upside down, the screen buffer has its origin at the bottom
+        int row = fb.invertY ? y : image.height - 1 - y;
+        for (int x = 0; x < image.width; x++) {
+            memcpy(&image.rgb[((size_t)y * image.width + x) * 3], &fb.color.rgba[((size_t)row * image.width + x) * 4],
+                   3);
+        }
+    }
+
+    return image;
+}
+
+static bool WritePpm(const std::string& path, const Image& image) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    file << "P6\n" << image.width << " " << image.height << "\n255\n";
+    file.write((const char*)image.rgb.data(), image.rgb.size());
+    return file.good();
+}
+
+static bool LoadImage(const std::string& path, Image& image) {
+    int channels;
+    uint8_t* data = stbi_load(path.c_str(), &image.width, &image.height, &channels, 3);
+    if (data == nullptr) {
+        std::cerr << "Failed to load " << path << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    image.rgb.assign(data, data + (size_t)image.width * image.height * 3);
+    stbi_image_free(data);
+    return true;
+}
+
+// Returns the fraction of pixels which differ by more than the tolerance, differing pixels are red in the diff image
+static double CompareImages(const Image& image, const Image& reference, int tolerance, Image& diff) {
+    diff.width = image.width;
+    diff.height = image.height;
+    diff.rgb.resize(image.rgb.size());
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < image.rgb.size(); i += 3) {
+        bool mismatch = false;
+        for (int c = 0; c < 3; c++) {
+            mismatch |= std::abs(image.rgb[i + c] - reference.rgb[i + c]) > tolerance;
+        }
+
+        if (mismatch) {
+            mismatches++;
+            diff.rgb[i + 0] = 0xFF;
+            diff.rgb[i + 1] = 0;
+            diff.rgb[i + 2] = 0;
+        } else {
+            uint8_t gray = (reference.rgb[i + 0] + reference.rgb[i + 1] + reference.rgb[i + 2]) / 3 / 4;
+            diff.rgb[i + 0] = diff.rgb[i + 1] = diff.rgb[i + 2] = gray;
+        }
+    }
+
+    return image.rgb.empty() ? 0.0 : (double)mismatches / (image.rgb.size() / 3);
+}
+
+int main(int argc, char** argv) {
+    std::string capturePath;
+    std::string backend = "null";
+    int frames = 100;
+    uint32_t threads = 0;
+    std::vector<std::string> archives;
+    std::string dispatch = "specialized";
+    std::string outputPath;
+    std::string referencePath;
+    std::string diffPath;
+    int tolerance = 0;
+    double maxMismatch = 0.0;
+    int maxAllocations = -1;
+    int interpolation = 1;
+    std::string mtxReplacements = "table";
+    bool drawQueue = false;
+    bool compareDrawQueue = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--backend") == 0 && i + 1 < argc) {
+            backend = argv[++i];
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--archive") == 0 && i + 1 < argc) {
+            archives.push_back(argv[++i]);
+        } else if (strcmp(argv[i], "--dispatch") == 0 && i + 1 < argc) {
+            dispatch = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (strcmp(argv[i], "--reference") == 0 && i + 1 < argc) {
+            referencePath = argv[++i];
+        } else if (strcmp(argv[i], "--diff") == 0 && i + 1 < argc) {
+            diffPath = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--max-mismatch") == 0 && i + 1 < argc) {
+            maxMismatch = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-allocations") == 0 && i + 1 < argc) {
+            maxAllocations = std::max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--interpolation") == 0 && i + 1 < argc) {
+            interpolation = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--mtx-replacements") == 0 && i + 1 < argc) {
+            mtxReplacements = argv[++i];
+        } else if (strcmp(argv[i], "--draw-queue") == 0) {
+            drawQueue = true;
+        } else if (strcmp(argv[i], "--compare-draw-queue") == 0) {
+            compareDrawQueue = true;
+        } else if (capturePath.empty() && argv[i][0] != '-') {
+            capturePath = argv[i];
+        } else {
+            return Usage();
+        }
+    }
+    if (capturePath.empty() || (dispatch != "specialized" && dispatch != "generic") ||
+        (mtxReplacements != "map" && mtxReplacements != "table")) {
+        return Usage();
+    }
+    if ((!outputPath.empty() || !referencePath.empty() || compareDrawQueue) && backend != "software") {
+        std::cerr << "Writing and comparing images requires the software backend" << std::endl;
+        return 1;
+    }
+    if (maxAllocations >= 0 && !Fast::GfxAllocationCounter::IsAvailable()) {
+        std::cerr << "Counting allocations requires a build with GFX_COUNT_ALLOCATIONS" << std::endl;
+        return 1;
+    }
+
+    // The captured memory goes back to its original addresses, map it before anything else can claim them
+    Fast::GfxCaptureReplay capture;
+    if (!capture.Load(capturePath)) {
+        std::cerr << "Failed to load capture " << capturePath << std::endl;
+        return 1;
+    }
+    const Fast::GfxCaptureSettings& settings = capture.GetSettings();
+
+    auto context = Ship::Context::CreateUninitializedInstance("Gfx Replay", "gfxreplay", "gfxreplay.json");
+    archives.insert(archives.begin(), capturePath);
+    if (!context->InitLogging() || !context->InitConfiguration() || !context->InitConsoleVariables() ||
+        !context->InitResourceManager(archives, {}, 1, true) || !context->InitGfxDebugger()) {
+        std::cerr << "Failed to initialize the context" << std::endl;
+        return 1;
+    }
+    RegisterFastFactories();
+    // Compared frames first run without the queue
+    context->GetConsoleVariables()->SetInteger(CVAR_DRAW_QUEUE, drawQueue && !compareDrawQueue);
+
+    std::unique_ptr<Fast::GfxWindowBackend> wapi;
+    std::unique_ptr<Fast::GfxRenderingAPI> rapi;
+    if (backend == "null") {
+        wapi = std::make_unique<Fast::GfxWindowBackendNull>();
+        rapi = std::make_unique<Fast::GfxRenderingAPINull>();
+    } else if (backend == "software") {
+        wapi = std::make_unique<Fast::GfxWindowBackendNull>();
+        rapi = std::make_unique<Fast::GfxRenderingAPISoftware>(threads);
+#ifdef ENABLE_OPENGL
+    } else if (backend == "opengl") {
+        wapi = std::make_unique<Fast::GfxWindowBackendSDL2>();
+        rapi = std::make_unique<Fast::GfxRenderingAPIOGL>();
+#endif
+    } else {
+        std::cerr << "Unknown backend " << backend << std::endl;
+        return 1;
+    }
+
+    auto interpreter = std::make_shared<Fast::Interpreter>();
+    Fast::GfxSetInstance(interpreter);
+    interpreter->Init(wapi.get(), rapi.get(), "Gfx Replay", false, settings.windowWidth, settings.windowHeight, 0, 0);
+    capture.ApplySettings(interpreter.get());
+    interpreter->mSpecializedDispatch = dispatch == "specialized";
+
+    std::vector<double> times;
+    times.reserve(frames);
+    // The first frame fills the caches, only the frames after it are expected to run without allocating
+    uint64_t steadyAllocations = 0;
+    Fast::GfxMtxReplacementTable table;
+    std::vector<std::unordered_map<Mtx*, MtxF>> maps(interpolation);
+    for (int i = 0; i < frames && wapi->IsRunning(); i++) {
+        interpreter->HandleWindowEvents();
+
+        auto start = std::chrono::steady_clock::now();
+        // A game computes new replacements every tick, so they are rebuilt here too
+        if (mtxReplacements == "table") {
+            table.Clear();
+            for (int k = 0; k < interpolation; k++) {
+                table.AddFrame(capture.GetMtxReplacements());
+            }
+            table.Finish();
+        } else {
+            for (int k = 0; k < interpolation; k++) {
+                maps[k] = std::unordered_map<Mtx*, MtxF>(capture.GetMtxReplacements());
+            }
+        }
+        for (int k = 0; k < interpolation; k++) {
+            capture.ApplyFrameState(interpreter.get());
+            interpreter->StartFrame();
+            if (mtxReplacements == "table") {
+                interpreter->Run(capture.GetDisplayList(), table, k);
+            } else {
+                interpreter->Run(capture.GetDisplayList(), maps[k]);
+            }
+            interpreter->EndFrame();
+            if (i > 0) {
+                steadyAllocations = std::max(steadyAllocations, interpreter->mRunAllocations);
+            }
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    if (!times.empty()) {
+        std::sort(times.begin(), times.end());
+        double total = 0;
+        for (double time : times) {
+            total += time;
+        }
+        std::cout << "Replayed " << times.size() << " frames on " << rapi->GetName() << " with ucode "
+                  << settings.ucode << " and " << dispatch << " dispatch";
+        if (interpolation > 1) {
+            std::cout << ", " << interpolation << " interpolated frames per tick with " << mtxReplacements
+                      << " matrix replacements";
+        }
+        std::cout << ": avg " << total / times.size() << " ms, min " << times.front() << " ms, median "
+                  << times[times.size() / 2] << " ms, max " << times.back() << " ms" << std::endl;
+    }
+
+    std::cout << "Texture staging: peak " << interpreter->mTexStagingArena.GetPeakUsage() << " bytes, "
+              << interpreter->mTexStagingArena.GetReserved() << " bytes reserved" << std::endl;
+    const Fast::FbCopyStats& copies = interpreter->mFbCopyStats;
+    std::cout << "Framebuffer copies: " << copies.requested << " requested, " << copies.performed << " performed, "
+              << copies.elided << " elided, " << copies.resolves << " MSAA resolves, " << copies.elided_resolves
+              << " resolves elided" << std::endl;
+
+#ifdef ENABLE_OPENGL
+    if (backend == "opengl") {
+        const auto& pool = static_cast<Fast::GfxRenderingAPIOGL*>(rapi.get())->GetTexturePoolStats();
+        std::cout << "Texture pool: " << pool.hits << " hits, " << pool.misses << " misses, " << pool.pooled
+                  << " pooled, " << pool.uploadBytes << " bytes uploaded" << std::endl;
+        // Batches are the draws the backend was asked for, draw calls the ones it submitted after merging them
+        const auto& draws = static_cast<Fast::GfxRenderingAPIOGL*>(rapi.get())->GetDrawStats();
+        const double rendered = std::max<double>(1.0, (double)times.size() * interpolation);
+        std::cout << "Draw calls: " << draws.batches / rendered << " batches per frame submitted as "
+                  << draws.drawCalls / rendered << " glDrawArrays calls" << std::endl;
+    }
+#endif
+
+    int result = 0;
+    if (compareDrawQueue) {
+        auto software = static_cast<Fast::GfxRenderingAPISoftware*>(rapi.get());
+        int fbId = interpreter->mRendersToFb ? (int)interpreter->GetGfxFrameBuffer() : 0;
+        Image expected = ReadFramebuffer(*software->GetFramebuffer(fbId));
+        std::vector<float> expectedDepth = software->GetFramebuffer(fbId)->depth;
+
+        context->GetConsoleVariables()->SetInteger(CVAR_DRAW_QUEUE, 1);
+        capture.ApplyFrameState(interpreter.get());
+        interpreter->StartFrame();
+        interpreter->Run(capture.GetDisplayList(), capture.GetMtxReplacements());
+        interpreter->EndFrame();
+        drawQueue = true;
+
+        fbId = interpreter->mRendersToFb ? (int)interpreter->GetGfxFrameBuffer() : 0;
+        const Fast::FramebufferSoftware& fb = *software->GetFramebuffer(fbId);
+        Image actual = ReadFramebuffer(fb);
+        Image diff;
+        double mismatch = actual.rgb.size() == expected.rgb.size() ? CompareImages(actual, expected, tolerance, diff)
+                                                                     : 1.0;
+        // Queued batches all test and write depth, whatever their order each pixel keeps the nearest one
+        size_t depthMismatches = std::max(fb.depth.size(), expectedDepth.size());
+        if (fb.depth.size() == expectedDepth.size()) {
+            depthMismatches = 0;
+            for (size_t i = 0; i < expectedDepth.size(); i++) {
+                depthMismatches += fb.depth[i] != expectedDepth[i];
+            }
+        }
+        std::cout << "Draw queue: " << mismatch * 100.0 << "% of the pixels and " << depthMismatches
+                  << " depth values differ from the frame without it" << std::endl;
+        if (mismatch > maxMismatch || depthMismatches != 0) {
+            result = 1;
+        }
+    }
+    if (drawQueue) {
+        std::cout << "Draw queue: " << interpreter->mDrawQueue.queued_batches << " batches submitted in "
+                  << interpreter->mDrawQueue.submitted_draws << " draws" << std::endl;
+    }
+
+    if (Fast::GfxAllocationCounter::IsAvailable() && times.size() > 1) {
+        std::cout << "Allocations per frame after the first: max " << steadyAllocations << std::endl;
+        if (maxAllocations >= 0 && steadyAllocations > (uint64_t)maxAllocations) {
+            result = 1;
+        }
+    }
+
+    if (!outputPath.empty() || !referencePath.empty()) {
+        auto software = static_cast<Fast::GfxRenderingAPISoftware*>(rapi.get());
+        int fbId = interpreter->mRendersToFb ? (int)interpreter->GetGfxFrameBuffer() : 0;
+        Image image = ReadFramebuffer(*software->GetFramebuffer(fbId));
+
+        if (!outputPath.empty() && !WritePpm(outputPath, image)) {
+            result = 1;
+        }
+
+        Image reference;
+        if (!referencePath.empty()) {
+            if (!LoadImage(referencePath, reference)) {
+                result = 1;
+            } else if (reference.width != image.width || reference.height != image.height) {
+                std::cerr << "Frame is " << image.width << "x" << image.height << " but the reference is "
+                          << reference.width << "x" << reference.height << std::endl;
+                result = 1;
+            } else {
+                Image diff;
+                double mismatch = CompareImages(image, reference, tolerance, diff);
+                std::cout << "Mismatching pixels: " << mismatch * 100.0 << "%" << std::endl;
+                if (!diffPath.empty()) {
+                    WritePpm(diffPath, diff);
+                }
+                if (mismatch > maxMismatch) {
+                    result = 1;
+                }
+            }
+        }
+    }
+
+    interpreter->Destroy();
+    return result;
+}
@@ -0,0 +1,138 @@
+// Times cache hits through ResourceManager and counts the allocations each of them makes.
+//
+// Usage: hitbench [--resources N] [--hits N] [--path FILE]
+//
+// Writes an archive of N binary blob resources with paths as long as the games use, loads every one of them once and
+// then looks them up again N times per way of loading a resource: through a future the way LoadResource used to, and
+// through LoadResource by path and by CRC, ResourceLoad and ResourceGetDataByName. Every way is run with alternate
+// assets off and on. It fails when a hit returns something other than what is cached, or when any way other than the
+// future allocates on a hit.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common/AllocationCounter.h"
+#include "common/ZipFixture.h"
+#include "libultraship/bridge/resourcebridge.h"
+#include "ship/Context.h"
+#include "ship/resource/ResourceManager.h"
+#include "ship/resource/ResourceType.h"
+#include "ship/resource/factory/BlobFactory.h"
+#include "ship/resource/type/Blob.h"
+#include "ship/utils/StrHash64.h"
+
+static std::string EntryName(size_t index) {
+    return "objects/object_hitbench/gHitBenchBlob_" + std::to_string(index) + "Tex";
+}
+
+struct HitPath {
+    const char* Name;
+    // The resource found for entry i
+    std::function<void*(size_t i)> Hit;
+    bool MayAllocate;
+};
+
+int main(int argc, char** argv) {
+    size_t resourceCount = 1000;
+    size_t hitCount = 200000;
+    std::string path = "hitbench.o2r";
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--resources") == 0 && i + 1 < argc) {
+            resourceCount = std::max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--hits") == 0 && i + 1 < argc) {
+            hitCount = std::max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--path") == 0 && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            std::cerr << "Usage: hitbench [--resources N] [--hits N] [--path FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::vector<char>> resources;
+    for (size_t i = 0; i < resourceCount; i++) {
+        resources.push_back(BlobResource(i, std::vector<uint8_t>(64, (uint8_t)i)));
+    }
+    if (!WriteZipFixture(path, resources, EntryName)) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return 1;
+    }
+
+    // The bridge finds the resource manager through the context
+    auto context = Ship::Context::CreateUninitializedInstance("hitbench", "hitbench", "hitbench.json");
+    if (!context->InitConfiguration() || !context->InitResourceManager({ path }, {}, 0, true) ||
+        !context->GetResourceManager()->IsLoaded()) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return 1;
+    }
+    auto resourceManager = context->GetResourceManager();
+    resourceManager->GetResourceLoader()->RegisterResourceFactory(std::make_shared<Ship::ResourceFactoryBinaryBlobV0>(),
+                                                                  RESOURCE_FORMAT_BINARY, "Blob",
+                                                                  (uint32_t)Ship::ResourceType::Blob, 0);
+
+    std::vector<std::string> names;
+    std::vector<uint64_t> hashes;
+    std::vector<void*> expected;
+    for (size_t i = 0; i < resourceCount; i++) {
+        names.push_back(EntryName(i));
+        hashes.push_back(CRC64(names.back().c_str()));
+        auto resource = resourceManager->LoadResource(names.back());
+        if (resource == nullptr) {
+            std::cerr << "Failed to load " << names.back() << std::endl;
+            return 1;
+        }
+        expected.push_back(resource.get());
+    }
+
+    const std::vector<HitPath> hitPaths = {
+        { "future",
+          [&](size_t i) { return resourceManager->LoadResourceAsync(names[i], false, BS::pr::highest).get().get(); },
+          true },
+        { "LoadResource(path)", [&](size_t i) { return resourceManager->LoadResource(names[i]).get(); }, false },
+        { "LoadResource(crc)", [&](size_t i) { return resourceManager->LoadResource(hashes[i]).get(); }, false },
+        { "ResourceLoad", [&](size_t i) { return ResourceLoad(names[i].c_str()).get(); }, false },
+        { "ResourceGetDataByName",
+          [&](size_t i) {
+              // The raw pointer is the blob's data, its resource is found the same way
+              ResourceGetDataByName(names[i].c_str());
+              return (void*)resourceManager->FindCachedResource(names[i]).get();
+          },
+          false },
+    };
+
+    int result = 0;
+    for (bool altAssets : { false, true }) {
+        resourceManager->SetAltAssetsEnabled(altAssets);
+        std::cout << "alternate assets " << (altAssets ? "on" : "off") << ":" << std::endl;
+        for (const HitPath& hitPath : hitPaths) {
+            size_t mismatches = 0;
+            // Only the allocations of this thread, the thread pool may be busy with anything
+            const uint64_t allocationsBefore = GetThreadAllocationCount();
+            const auto start = std::chrono::steady_clock::now();
+            for (size_t n = 0; n < hitCount; n++) {
+                const size_t i = n % resourceCount;
+                mismatches += hitPath.Hit(i) != expected[i] ? 1 : 0;
+            }
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const double allocationsPerHit = (double)(GetThreadAllocationCount() - allocationsBefore) / hitCount;
+
+            const bool failed = mismatches != 0 || (!hitPath.MayAllocate && allocationsPerHit != 0);
+            result |= failed ? 1 : 0;
+            std::cout << (failed ? "FAILED: " : "  ") << hitPath.Name << ": " << seconds * 1e9 / hitCount
+                      << " ns per hit, " << allocationsPerHit << " allocations per hit, " << mismatches
+                      << " mismatches" << std::endl;
+        }
+    }
+
+    std::cout << (result == 0 ? "ok" : "FAILED") << ": " << resourceCount << " resources hit " << hitCount
+              << " times per way" << std::endl;
+    return result;
+}
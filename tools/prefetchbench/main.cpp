@@ -0,0 +1,256 @@
+// Records a synthetic sequence of resource loads into a prefetch manifest, replays it and measures how many resources
+// were already cached when the game first asked for them.
+//
+// Usage: prefetchbench [--areas N] [--resources N] [--work-us N] [--threads N] [--in-flight-kb N]
+//
+// The game marks an area, then asks for that area's resources one after another, spending --work-us between them.
+// A resource that is not cached yet costs a fixed latency plus a read at a fixed speed, both spent sleeping, on
+// whichever thread loads it. The first run loads everything on demand and records a manifest, which is written to a
+// file and read back. The second run starts with an empty cache and prefetches every area from the manifest as it is
+// marked. It fails when the manifest does not read back the same, when the files being prefetched ever add up to more
+// than --in-flight-kb, or when prefetching does not raise the first access hit rate.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ship/resource/PrefetchManifest.h"
+
+static constexpr auto LOAD_LATENCY = std::chrono::microseconds(150);
+static constexpr double LOAD_BYTES_PER_SECOND = 200e6;
+
+class SyntheticArchive {
+  public:
+    SyntheticArchive(size_t resourceCount, std::mt19937& rng) {
+        for (size_t i = 0; i < resourceCount; i++) {
+            // Mostly small display lists and vertices, now and then a big texture
+            const uint32_t size = rng() % 8 == 0 ? 64 * 1024 + rng() % (192 * 1024) : 256 + rng() % (8 * 1024);
+            mSizes[0x5eed000000000000ull + i] = size;
+        }
+    }
+
+    uint32_t GetSize(uint64_t hash) const {
+        return mSizes.at(hash);
+    }
+
+    // Sleeps as long as reading and parsing the resource would take
+    void Load(uint64_t hash) const {
+        const auto read = std::chrono::duration<double>(GetSize(hash) / LOAD_BYTES_PER_SECOND);
+        std::this_thread::sleep_for(LOAD_LATENCY + std::chrono::duration_cast<std::chrono::microseconds>(read));
+    }
+
+  private:
+    std::unordered_map<uint64_t, uint32_t> mSizes;
+};
+
+class SyntheticCache {
+  public:
+    bool Contains(uint64_t hash) {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        return mResources.contains(hash);
+    }
+
+    void Add(uint64_t hash) {
+        const std::lock_guard<std::mutex> lock(mMutex);
+        mResources.insert(hash);
+    }
+
+  private:
+    std::mutex mMutex;
+    std::unordered_set<uint64_t> mResources;
+};
+
+struct RunResult {
+    size_t firstAccesses = 0;
+    size_t hits = 0;
+    double seconds = 0;
+
+    double HitRate() const {
+        return firstAccesses == 0 ? 0 : (double)hits / firstAccesses;
+    }
+};
+
+// Every area asks for its own resources and a few shared ones, some of them more than once
+static std::vector<std::vector<uint64_t>> CreateAreas(size_t areaCount, size_t resourceCount, std::mt19937& rng) {
+    std::vector<std::vector<uint64_t>> areas(areaCount);
+    const size_t shared = resourceCount / 10;
+    const size_t perArea = (resourceCount - shared) / areaCount;
+    for (size_t a = 0; a < areaCount; a++) {
+        for (size_t i = 0; i < perArea; i++) {
+            areas[a].push_back(0x5eed000000000000ull + shared + a * perArea + i);
+            if (rng() % 4 == 0) {
+                areas[a].push_back(0x5eed000000000000ull + rng() % shared);
+            }
+            if (rng() % 8 == 0) {
+                areas[a].push_back(areas[a][rng() % areas[a].size()]);
+            }
+        }
+    }
+    return areas;
+}
+
+static RunResult RunGame(const std::vector<std::vector<uint64_t>>& areas, const SyntheticArchive& archive,
+                         SyntheticCache& cache, std::chrono::microseconds work, Ship::PrefetchManifest* recording,
+                         Ship::PrefetchManifest* manifest, Ship::ResourcePrefetcher* prefetcher, size_t inFlightBytes) {
+    RunResult result;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t a = 0; a < areas.size(); a++) {
+        const std::string area = "area_" + std::to_string(a);
+        if (recording != nullptr) {
+            recording->MarkArea(area);
+        }
+        if (prefetcher != nullptr) {
+            prefetcher->Start(manifest->GetArea(area), inFlightBytes);
+        }
+
+        std::unordered_set<uint64_t> accessed;
+        for (uint64_t hash : areas[a]) {
+            std::this_thread::sleep_for(work);
+            const bool firstAccess = accessed.insert(hash).second;
+            if (cache.Contains(hash)) {
+                result.hits += firstAccess ? 1 : 0;
+            } else {
+                archive.Load(hash);
+                cache.Add(hash);
+                if (recording != nullptr) {
+                    recording->Record(hash, archive.GetSize(hash));
+                }
+            }
+            result.firstAccesses += firstAccess ? 1 : 0;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (prefetcher != nullptr) {
+        prefetcher->Stop();
+        prefetcher->Wait();
+    }
+    return result;
+}
+
+static bool SameManifests(const Ship::PrefetchManifest& a, const Ship::PrefetchManifest& b, size_t areaCount) {
+    if (a.GetAreaCount() != b.GetAreaCount() || a.GetEntryCount() != b.GetEntryCount()) {
+        return false;
+    }
+    for (size_t i = 0; i < areaCount; i++) {
+        const std::string area = "area_" + std::to_string(i);
+        auto entriesA = a.GetArea(area);
+        auto entriesB = b.GetArea(area);
+        if (entriesA.size() != entriesB.size() ||
+            !std::equal(entriesA.begin(), entriesA.end(), entriesB.begin(), [](const auto& x, const auto& y) {
+                return x.Hash == y.Hash && x.Size == y.Size;
+            })) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t areaCount = 3;
+    size_t resourceCount = 300;
+    int workUs = 300;
+    unsigned int threadCount = 2;
+    size_t inFlightKb = 512;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--areas") == 0 && i + 1 < argc) {
+            areaCount = std::max<size_t>(1, strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--resources") == 0 && i + 1 < argc) {
+            resourceCount = std::max<size_t>(20, strtoul(argv[++i], nullptr, 10));
+        } else if (strcmp(argv[i], "--work-us") == 0 && i + 1 < argc) {
+            workUs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = std::max(1u, (unsigned int)atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--in-flight-kb") == 0 && i + 1 < argc) {
+            inFlightKb = strtoul(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Usage: prefetchbench [--areas N] [--resources N] [--work-us N] [--threads N] "
+                         "[--in-flight-kb N]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(1234);
+    SyntheticArchive archive(resourceCount, rng);
+    const auto areas = CreateAreas(areaCount, resourceCount, rng);
+    const auto work = std::chrono::microseconds(workUs);
+    int result = 0;
+
+    // Load everything on demand and record the order
+    Ship::PrefetchManifest recording;
+    SyntheticCache recordCache;
+    const RunResult recorded = RunGame(areas, archive, recordCache, work, &recording, nullptr, nullptr, 0);
+
+    const std::string manifestPath =
+        (std::filesystem::temp_directory_path() / ("prefetchbench_" + std::to_string(rng()) + ".bin")).string();
+    Ship::PrefetchManifest manifest;
+    const bool readBack = recording.Save(manifestPath) && manifest.Load(manifestPath);
+    std::filesystem::remove(manifestPath);
+    if (!readBack || !SameManifests(recording, manifest, areaCount)) {
+        std::cout << "FAILED: the manifest did not read back the way it was recorded" << std::endl;
+        result = 1;
+    }
+    std::cout << "manifest: " << manifest.GetEntryCount() << " resources in " << manifest.GetAreaCount() << " areas, "
+              << recording.Serialize().size() << " bytes" << std::endl;
+
+    // A cut off manifest has to be refused rather than read as far as it goes
+    const std::vector<char> data = recording.Serialize();
+    Ship::PrefetchManifest truncated;
+    if (truncated.Deserialize(data.data(), data.size() - 5)) {
+        std::cout << "FAILED: a truncated manifest was accepted" << std::endl;
+        result = 1;
+    }
+
+    // Replay with an empty cache, prefetching every area as it is marked
+    const size_t inFlightBytes = inFlightKb * 1024;
+    SyntheticCache replayCache;
+    std::atomic<size_t> loadingBytes = 0;
+    std::atomic<size_t> peakLoadingBytes = 0;
+    std::atomic<uint32_t> biggestEntry = 0;
+    auto threadPool = std::make_shared<BS::thread_pool>(threadCount);
+    Ship::ResourcePrefetcher prefetcher(threadPool, [&](uint64_t hash) {
+        if (replayCache.Contains(hash)) {
+            return;
+        }
+        const uint32_t size = archive.GetSize(hash);
+        const size_t loading = loadingBytes += size;
+        size_t peak = peakLoadingBytes.load();
+        while (loading > peak && !peakLoadingBytes.compare_exchange_weak(peak, loading)) {
+        }
+        biggestEntry = std::max(biggestEntry.load(), size);
+        archive.Load(hash);
+        replayCache.Add(hash);
+        loadingBytes -= size;
+    });
+    const RunResult replayed =
+        RunGame(areas, archive, replayCache, work, nullptr, &manifest, &prefetcher, inFlightBytes);
+
+    if (peakLoadingBytes > std::max(inFlightBytes, (size_t)biggestEntry.load())) {
+        std::cout << "FAILED: " << peakLoadingBytes << " bytes were prefetched at once with a cap of " << inFlightBytes
+                  << std::endl;
+        result = 1;
+    }
+
+    for (const auto& [name, run] : { std::pair("on demand", recorded), std::pair("prefetched", replayed) }) {
+        std::cout << name << ": " << run.HitRate() * 100.0 << "% of " << run.firstAccesses
+                  << " first accesses hit, " << run.seconds * 1000.0 << " ms" << std::endl;
+    }
+    if (replayed.HitRate() <= recorded.HitRate()) {
+        std::cout << "FAILED: prefetching did not raise the first access hit rate" << std::endl;
+        result = 1;
+    }
+    std::cout << (result == 0 ? "ok" : "FAILED") << ": recorded and replayed prefetch manifest" << std::endl;
+
+    return result;
+}
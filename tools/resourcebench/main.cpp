@@ -0,0 +1,250 @@
+// Checks the binary vertex, display list, matrix and texture factories on generated resources and times them.
+//
+// Usage: resourcebench [--iterations N]
+//
+// Every resource is written big endian, the byte order of the game data, so the reader has to swap it on little
+// endian hosts. Each factory parses its resource once and the result is compared with the values that were written,
+// it fails when any of them differs. With --iterations every factory also parses its resource N times and its
+// throughput is printed.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "libultraship/libultra/gbi.h"
+#include "ship/utils/binarytools/SpanStream.h"
+#include "fast/resource/factory/DisplayListFactory.h"
+#include "fast/resource/factory/MatrixFactory.h"
+#include "fast/resource/factory/TextureFactory.h"
+#include "fast/resource/factory/VertexFactory.h"
+#include "fast/resource/type/DisplayList.h"
+#include "fast/resource/type/Matrix.h"
+#include "fast/resource/type/Texture.h"
+#include "fast/resource/type/Vertex.h"
+
+class BigEndianWriter {
+  public:
+    void U8(uint8_t value) {
+        mData.push_back((char)value);
+    }
+    void U16(uint16_t value) {
+        U8(value >> 8);
+        U8(value & 0xff);
+    }
+    void U32(uint32_t value) {
+        U16(value >> 16);
+        U16(value & 0xffff);
+    }
+    void F32(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        U32(bits);
+    }
+    const std::vector<char>& Data() const {
+        return mData;
+    }
+
+  private:
+    std::vector<char> mData;
+};
+
+static std::shared_ptr<Ship::File> CreateFile(const std::vector<char>& data) {
+    auto file = std::make_shared<Ship::File>();
+    file->Buffer = std::make_shared<std::vector<char>>(data);
+    auto reader = std::make_shared<Ship::BinaryReader>(
+        std::make_shared<Ship::SpanStream>(file->Buffer->data(), file->Buffer->size(), file->Buffer));
+    reader->SetEndianness(Ship::Endianness::Big);
+    file->Reader = reader;
+    file->IsLoaded = true;
+    return file;
+}
+
+static std::shared_ptr<Ship::ResourceInitData> CreateInitData() {
+    auto initData = std::make_shared<Ship::ResourceInitData>();
+    initData->Path = "resourcebench";
+    initData->ByteOrder = Ship::Endianness::Big;
+    initData->ResourceVersion = 0;
+    initData->Id = 0;
+    initData->IsCustom = false;
+    initData->Format = RESOURCE_FORMAT_BINARY;
+    return initData;
+}
+
+struct FactoryCase {
+    const char* name;
+    std::shared_ptr<Ship::ResourceFactory> factory;
+    std::vector<char> data;
+    std::function<bool(std::shared_ptr<Ship::IResource>)> check;
+};
+
+static FactoryCase VertexCase(std::mt19937& rng) {
+    std::vector<Vtx> expected(20000);
+    BigEndianWriter writer;
+    writer.U32((uint32_t)expected.size());
+    for (Vtx& vtx : expected) {
+        vtx = {};
+        for (int i = 0; i < 3; i++) {
+            vtx.v.ob[i] = (int16_t)rng();
+            writer.U16((uint16_t)vtx.v.ob[i]);
+        }
+        vtx.v.flag = (uint16_t)rng();
+        writer.U16(vtx.v.flag);
+        for (int i = 0; i < 2; i++) {
+            vtx.v.tc[i] = (int16_t)rng();
+            writer.U16((uint16_t)vtx.v.tc[i]);
+        }
+        for (int i = 0; i < 4; i++) {
+            vtx.v.cn[i] = (uint8_t)rng();
+            writer.U8(vtx.v.cn[i]);
+        }
+    }
+
+    return { "vertex", std::make_shared<Fast::ResourceFactoryBinaryVertexV0>(), writer.Data(),
+             [expected](std::shared_ptr<Ship::IResource> resource) {
+                 auto vertex = std::static_pointer_cast<Fast::Vertex>(resource);
+                 if (vertex->VertexList.size() != expected.size()) {
+                     return false;
+                 }
+                 for (size_t i = 0; i < expected.size(); i++) {
+                     const Vtx_t& a = vertex->VertexList[i].v;
+                     const Vtx_t& b = expected[i].v;
+                     if (a.ob[0] != b.ob[0] || a.ob[1] != b.ob[1] || a.ob[2] != b.ob[2] || a.flag != b.flag ||
+                         a.tc[0] != b.tc[0] || a.tc[1] != b.tc[1] || memcmp(a.cn, b.cn, sizeof(a.cn)) != 0) {
+                         return false;
+                     }
+                 }
+                 return true;
+             } };
+}
+
+static FactoryCase DisplayListCase(std::mt19937& rng) {
+    std::vector<uint32_t> expected;
+    BigEndianWriter writer;
+    writer.U8(ucode_f3dex2);
+    while (writer.Data().size() % 8 != 0) {
+        writer.U8(0);
+    }
+    // No-ops with random operands, then the F3DEX2 G_ENDDL
+    for (int i = 0; i < 20000; i++) {
+        expected.push_back(rng() & 0x00ffffff);
+        expected.push_back(rng());
+    }
+    expected.push_back(0xdf000000);
+    expected.push_back(0);
+    for (uint32_t word : expected) {
+        writer.U32(word);
+    }
+
+    return { "display list", std::make_shared<Fast::ResourceFactoryBinaryDisplayListV0>(), writer.Data(),
+             [expected](std::shared_ptr<Ship::IResource> resource) {
+                 auto displayList = std::static_pointer_cast<Fast::DisplayList>(resource);
+                 if (displayList->UCode != ucode_f3dex2 || displayList->Instructions.size() * 2 != expected.size()) {
+                     return false;
+                 }
+                 for (size_t i = 0; i < displayList->Instructions.size(); i++) {
+                     if ((uint32_t)displayList->Instructions[i].words.w0 != expected[i * 2] ||
+                         (uint32_t)displayList->Instructions[i].words.w1 != expected[i * 2 + 1]) {
+                         return false;
+                     }
+                 }
+                 return true;
+             } };
+}
+
+static FactoryCase MatrixCase(std::mt19937& rng) {
+    Mtx expected;
+    BigEndianWriter writer;
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+#ifdef GBI_FLOATS
+            expected.mf[i][j] = std::uniform_real_distribution<float>(-100.0f, 100.0f)(rng);
+            writer.F32(expected.mf[i][j]);
+#else
+            expected.m[i][j] = (int32_t)rng();
+            writer.U32((uint32_t)expected.m[i][j]);
+#endif
+        }
+    }
+
+    return { "matrix", std::make_shared<Fast::ResourceFactoryBinaryMatrixV0>(), writer.Data(),
+             [expected](std::shared_ptr<Ship::IResource> resource) {
+                 auto matrix = std::static_pointer_cast<Fast::Matrix>(resource);
+                 return memcmp(&matrix->Matrx, &expected, sizeof(Mtx)) == 0;
+             } };
+}
+
+static FactoryCase TextureCase(std::mt19937& rng) {
+    std::vector<uint8_t> pixels(64 * 64 * 4);
+    for (uint8_t& pixel : pixels) {
+        pixel = (uint8_t)rng();
+    }
+    BigEndianWriter writer;
+    writer.U32((uint32_t)Fast::TextureType::RGBA32bpp);
+    writer.U32(64);
+    writer.U32(64);
+    writer.U32(3);
+    writer.F32(2.0f);
+    writer.F32(0.5f);
+    writer.U32((uint32_t)pixels.size());
+    for (uint8_t pixel : pixels) {
+        writer.U8(pixel);
+    }
+
+    return { "texture", std::make_shared<Fast::ResourceFactoryBinaryTextureV1>(), writer.Data(),
+             [pixels](std::shared_ptr<Ship::IResource> resource) {
+                 auto texture = std::static_pointer_cast<Fast::Texture>(resource);
+                 return texture->Type == Fast::TextureType::RGBA32bpp && texture->Width == 64 &&
+                        texture->Height == 64 && texture->Flags == 3 && texture->HByteScale == 2.0f &&
+                        texture->VPixelScale == 0.5f && texture->ImageDataSize == pixels.size() &&
+                        memcmp(texture->ImageData, pixels.data(), pixels.size()) == 0;
+             } };
+}
+
+int main(int argc, char** argv) {
+    int iterations = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: resourcebench [--iterations N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(1234);
+    const std::vector<FactoryCase> cases = { VertexCase(rng), DisplayListCase(rng), MatrixCase(rng),
+                                             TextureCase(rng) };
+
+    int result = 0;
+    for (const FactoryCase& factoryCase : cases) {
+        auto initData = CreateInitData();
+        auto resource = factoryCase.factory->ReadResource(CreateFile(factoryCase.data), initData);
+        bool passed = resource != nullptr && factoryCase.check(resource);
+        std::cout << (passed ? "ok" : "FAILED") << ": " << factoryCase.name << ", " << factoryCase.data.size()
+                  << " bytes" << std::endl;
+        if (!passed) {
+            result = 1;
+        }
+
+        if (iterations <= 0) {
+            continue;
+        }
+        // Only the parse is timed, every iteration gets a fresh reader
+        std::chrono::steady_clock::duration time = {};
+        for (int i = 0; i < iterations; i++) {
+            auto file = CreateFile(factoryCase.data);
+            const auto start = std::chrono::steady_clock::now();
+            resource = factoryCase.factory->ReadResource(file, initData);
+            time += std::chrono::steady_clock::now() - start;
+        }
+        const double seconds = std::chrono::duration<double>(time).count();
+        std::cout << factoryCase.name << ": " << (double)factoryCase.data.size() * iterations / seconds / 1e6
+                  << " MB/s, " << seconds * 1e6 / iterations << " us per resource" << std::endl;
+    }
+
+    return result;
+}